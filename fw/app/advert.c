@@ -4,18 +4,20 @@
 /*---------------------------------------------------------------------------*/
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "nrf51.h"
 #include "nrf_soc.h"
 #include "softdevice_handler.h"
-#include "app_scheduler.h"
-#include "ble_advdata.h"
 #include "ble_gap.h"
 
 #include "config.h"
+#include "evq.h"
 #include "ble_eddy.h"
 #include "advert.h"
 #include "eddystone.h"
+#include "privacy.h"
+#include "diag.h"
 #include "dbglog.h"
 
 /*---------------------------------------------------------------------------*/
@@ -28,7 +30,8 @@ static const char * device_name = DEVICE_NAME;
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 
-static const ble_gap_adv_params_t   m_adv_params_connectable = {
+/* The interval can be changed at run time, see advertising_interval_set(). */
+static ble_gap_adv_params_t   m_adv_params_connectable = {
     .type         = BLE_GAP_ADV_TYPE_ADV_IND,
     .p_peer_addr  = NULL,
     .fp           = 0,
@@ -37,7 +40,7 @@ static const ble_gap_adv_params_t   m_adv_params_connectable = {
     .timeout      = APP_ADV_TIMEOUT,
 };
 
-static const ble_gap_adv_params_t   m_adv_params_nonconnectable = {
+static ble_gap_adv_params_t   m_adv_params_nonconnectable = {
     .type         = BLE_GAP_ADV_TYPE_ADV_NONCONN_IND,
     .p_peer_addr  = NULL,
     .fp           = 0,
@@ -46,67 +49,114 @@ static const ble_gap_adv_params_t   m_adv_params_nonconnectable = {
     .timeout      = 0,
 };
 
+static ble_gap_adv_params_t * m_p_adv_params = NULL;    // last started
+
 /*---------------------------------------------------------------------------*/
-/*                                                                           */
+/*  The connectable payload is encoded once and kept, so that switching      */
+/*  into the configuration window only hands it back to the SoftDevice.      */
 /*---------------------------------------------------------------------------*/
-static void advertising_connectable_init(void)
+
+static uint8_t   m_conn_adv [BLE_GAP_ADV_MAX_SIZE];
+static uint8_t   m_conn_adv_len = 0;        // 0: not encoded yet
+static uint8_t   m_conn_sr  [BLE_GAP_ADV_MAX_SIZE];
+static uint8_t   m_conn_sr_len  = 0;
+
+static uint32_t  m_switch_start;            // RTC1, while a switch is timed
+static bool      m_switch_timing = false;
+
+/*---------------------------------------------------------------------------*/
+/*  One AD structure: length, type, data.  False if it does not fit.         */
+/*---------------------------------------------------------------------------*/
+static bool ad_put(uint8_t * buf, uint8_t * p_len, uint8_t type,
+                   const uint8_t * data, uint8_t size)
 {
-    uint32_t      err_code;
-    uint8_t       flags;
-    ble_advdata_t advdata;
-    ble_advdata_t scanrsp;
+    if (*p_len + 2 + size > BLE_GAP_ADV_MAX_SIZE)
+        return false;
 
-    ble_gap_addr_t  mac = { 0 };
+    buf[(*p_len)++] = size + 1;
+    buf[(*p_len)++] = type;
+    memcpy(&buf[*p_len], data, size);
+    *p_len += size;
 
-    flags = BLE_GAP_ADV_FLAGS_LE_ONLY_LIMITED_DISC_MODE;
+    return true;
+}
 
-    ble_uuid_t scan_uuids[] = {
-        {EDDY_UUID_SERVICE,                   g_eddy_service.uuid_type},
-        {BLE_UUID_BATTERY_SERVICE,            BLE_UUID_TYPE_BLE},
-        {BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_TYPE_BLE},
+/*---------------------------------------------------------------------------*/
+/*  Flags and name to advertise; the service UUIDs in the scan response.     */
+/*---------------------------------------------------------------------------*/
+static void connectable_payload_build(void)
+{
+    static const uint16_t services [] = {
+        BLE_UUID_BATTERY_SERVICE,
+        BLE_UUID_DEVICE_INFORMATION_SERVICE,
     };
 
-        /* Set the device name */
-    {
-        ble_gap_conn_sec_mode_t sec_mode;
+    uint8_t    flags = BLE_GAP_ADV_FLAGS_LE_ONLY_LIMITED_DISC_MODE;
+    uint8_t    name_len = strlen(device_name);
+    uint8_t    uuids [BLE_GAP_ADV_MAX_SIZE];
+    uint8_t    uuids_len = 0;
+    uint8_t    uuid_len;
+    ble_uuid_t eddy_uuid = {EDDY_UUID_SERVICE, g_eddy_service.uuid_type};
+    ble_gap_conn_sec_mode_t sec_mode;
+    unsigned   i;
 
-        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
+    /* Set the device name */
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&sec_mode);
 
-        PRINTF("name: \"%s\"\n", device_name);
+    PRINTF("name: \"%s\"\n", device_name);
 
-        err_code = sd_ble_gap_device_name_set(&sec_mode,
-                                              (const uint8_t *) device_name,
-                                              strlen(device_name));
-        APP_ERROR_CHECK(err_code);
+    APP_ERROR_CHECK( sd_ble_gap_device_name_set(&sec_mode,
+                                                (const uint8_t *) device_name,
+                                                name_len) );
+    /* Advertising data */
+    m_conn_adv_len = 0;
+    ad_put(m_conn_adv, &m_conn_adv_len, BLE_GAP_AD_TYPE_FLAGS,
+           &flags, sizeof(flags));
+
+    /* The name as far as it fits. */
+    if (!ad_put(m_conn_adv, &m_conn_adv_len, BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME,
+                (const uint8_t *) device_name, name_len)) {
+        ad_put(m_conn_adv, &m_conn_adv_len, BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME,
+               (const uint8_t *) device_name,
+               BLE_GAP_ADV_MAX_SIZE - m_conn_adv_len - 2);
     }
 
-    /* Build ADVertisement data */
-    memset(&advdata, 0, sizeof(advdata));
-    advdata.name_type    = BLE_ADVDATA_FULL_NAME;
-    advdata.flags.size   = sizeof(flags);
-    advdata.flags.p_data = &flags;
+    /* Scan response data: little endian UUIDs, 16 bits then 128 bits */
+    for (i = 0; i < sizeof(services) / sizeof(services[0]); i++) {
+        uuids[uuids_len++] = (uint8_t) services[i];
+        uuids[uuids_len++] = (uint8_t) (services[i] >> 8);
+    }
+    m_conn_sr_len = 0;
+    ad_put(m_conn_sr, &m_conn_sr_len, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE,
+           uuids, uuids_len);
 
-    /* Build SCAN response data */
-    memset(&scanrsp, 0, sizeof(scanrsp));
-    scanrsp.uuids_complete.uuid_cnt = sizeof(scan_uuids) / sizeof(scan_uuids[0]);
-    scanrsp.uuids_complete.p_uuids  = scan_uuids;
+    APP_ERROR_CHECK( sd_ble_uuid_encode(&eddy_uuid, &uuid_len, uuids) );
+    ad_put(m_conn_sr, &m_conn_sr_len, BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE,
+           uuids, uuid_len);
+}
 
-    /* Set ADV and SCAN data */
-    err_code = ble_advdata_set(&advdata, &scanrsp);
-    APP_ERROR_CHECK(err_code);
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void advertising_connectable_init(void)
+{
+    ble_gap_addr_t  mac = { 0 };
 
-    /* Set MAC address */
-    err_code = sd_ble_gap_address_get( &mac );
-    APP_ERROR_CHECK(err_code);
+    if (m_conn_adv_len == 0)
+        connectable_payload_build();
+
+    /* Set ADV and SCAN data */
+    APP_ERROR_CHECK( sd_ble_gap_adv_data_set(m_conn_adv, m_conn_adv_len,
+                                             m_conn_sr,  m_conn_sr_len) );
 
-    mac.addr_type = BLE_GAP_ADDR_TYPE_PUBLIC;
+    /* Set MAC address: the current resolvable private address */
+    privacy_addr_get( &mac );
 
     PRINTF("MAC address: %d, %02X:%02X:%02X:%02X:%02X:%02X\n", mac.addr_type,
             mac.addr[5], mac.addr[4], mac.addr[3],
             mac.addr[2], mac.addr[1], mac.addr[0] );
 
-    err_code = sd_ble_gap_address_set(BLE_GAP_ADDR_CYCLE_MODE_NONE, &mac);
-    APP_ERROR_CHECK(err_code);
+    APP_ERROR_CHECK( sd_ble_gap_address_set(BLE_GAP_ADDR_CYCLE_MODE_NONE, &mac) );
 }
 
 /*---------------------------------------------------------------------------*/
@@ -118,7 +168,9 @@ void advertising_start_connectable(void)
 
     advertising_connectable_init();
 
-    APP_ERROR_CHECK( sd_ble_gap_adv_start(&m_adv_params_connectable) );
+    m_p_adv_params = &m_adv_params_connectable;
+
+    APP_ERROR_CHECK( sd_ble_gap_adv_start(m_p_adv_params) );
 
     APP_ERROR_CHECK( bsp_indication_set(BSP_INDICATE_ADVERTISING) );
 }
@@ -134,13 +186,97 @@ void advertising_start_nonconnectable(void)
 
     APP_ERROR_CHECK( bsp_indication_set(BSP_INDICATE_ADVERTISING_DONE) );
 
-    APP_ERROR_CHECK( sd_ble_gap_adv_start(&m_adv_params_nonconnectable) );
+    m_p_adv_params = &m_adv_params_nonconnectable;
+
+    APP_ERROR_CHECK( sd_ble_gap_adv_start(m_p_adv_params) );
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Change the advertising interval; if advertising, restart with it.  The   */
+/*  non-connectable minimum, 100 ms, holds for both kinds.                   */
+/*---------------------------------------------------------------------------*/
+uint32_t advertising_interval_set(uint16_t interval_ms)
+{
+    uint32_t interval = MSEC_TO_UNITS(interval_ms, UNIT_0_625_MS);
+
+    if (interval < BLE_GAP_ADV_NONCON_INTERVAL_MIN ||
+        interval > BLE_GAP_ADV_INTERVAL_MAX)
+        return NRF_ERROR_INVALID_PARAM;
+
+    m_adv_params_connectable.interval    = interval;
+    m_adv_params_nonconnectable.interval = interval;
+
+    /* Not advertising (e.g. connected): it applies from the next start. */
+    if (m_p_adv_params == NULL || sd_ble_gap_adv_stop() != NRF_SUCCESS)
+        return NRF_SUCCESS;
+
+    return sd_ble_gap_adv_start(m_p_adv_params);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+uint16_t advertising_interval_get(void)
+{
+    /* Back from 0.625 ms units, without a divide: x * 5 / 8. */
+    return (m_adv_params_nonconnectable.interval * 5) >> 3;
 }
 
 /*---------------------------------------------------------------------------*/
-/*  Function for initializing the Advertising functionality.                 */
+/*  Beaconing: the Eddystone frames own the advertising data.                */
 /*---------------------------------------------------------------------------*/
-void advertising_init(void)
+bool advertising_is_beaconing(void)
 {
-    /* TBD */
+    return m_p_adv_params == &m_adv_params_nonconnectable;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  From beaconing straight into the configuration window, no reset: the     */
+/*  SoftDevice, the GATT table and every counter stay as they are.  When     */
+/*  the window times out, beaconing resumes where it left off.  Returns      */
+/*  false if the window (or a connection) is already open.                   */
+/*---------------------------------------------------------------------------*/
+bool advertising_config_window_open(void)
+{
+    if (!advertising_is_beaconing())
+        return false;
+
+    m_switch_start  = DIAG_TICKS();
+    m_switch_timing = true;
+
+    APP_ERROR_CHECK( sd_ble_gap_adv_stop() );
+
+    advertising_start_connectable();
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void switch_report(uintptr_t arg)
+{
+    PRINTF("config window: %u.%02u ms to the first packet\n",
+           (unsigned) (g_diag.switch_us / 1000),
+           (unsigned) (g_diag.switch_us % 1000) / 10);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Radio notification: the first radio event after a switch ends its time.  */
+/*---------------------------------------------------------------------------*/
+void advertising_radio_notification(bool radio_active)
+{
+    uint32_t ticks;
+
+    if (!radio_active || !m_switch_timing)
+        return;
+
+    ticks = (DIAG_TICKS() - m_switch_start) & 0x00FFFFFF;
+    m_switch_timing = false;
+
+    g_diag.switch_us = DIAG_TICKS_US(ticks);
+    DIAG_INC(switch_count);
+
+    /* Not worth a slot if the queue is full: the time is in the counters. */
+    (void) evq_put(EVQ_LOW, switch_report, 0);
 }
@@ -5,9 +5,17 @@
 #ifndef _ADVERT_H_
 #define _ADVERT_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 void advertising_start_connectable(void);
 void advertising_start_nonconnectable(void);
 
+bool advertising_is_beaconing(void);
+bool advertising_config_window_open(void);
+void advertising_radio_notification(bool radio_active);
+
+uint32_t advertising_interval_set(uint16_t interval_ms);
+uint16_t advertising_interval_get(void);
+
 #endif  /* _ADVERT_H_ */
@@ -9,7 +9,6 @@
 #include "nrf_soc.h"
 #include "softdevice_handler.h"
 #include "app_timer.h"
-#include "app_scheduler.h"
 
 #include "config.h"
 #include "battery.h"
@@ -59,8 +58,10 @@ static uint32_t battery_adc_config =
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
-uint16_t battery_level_get(void)
+uint8_t battery_adc_get(void)
 {
+    uint8_t result;
+
     /* Configure for ADC conversion */
     NRF_ADC->CONFIG = battery_adc_config;
 
@@ -75,11 +76,21 @@ uint16_t battery_level_get(void)
 
     while (!NRF_ADC->EVENTS_END) { /* spin: wait for conversion */ }
 
-    uint16_t voltage_in_mv = ADC_RESULT_IN_MILLI_VOLTS(NRF_ADC->RESULT);
+    result = NRF_ADC->RESULT;
 
     /* Stop conversion task */
     NRF_ADC->EVENTS_END = 0;
     NRF_ADC->TASKS_STOP = 1;
 
+    return result;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+uint16_t battery_level_get(void)
+{
+    uint16_t voltage_in_mv = ADC_RESULT_IN_MILLI_VOLTS(battery_adc_get());
+
     return voltage_in_mv;
 }
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 
+uint8_t  battery_adc_get(void);
 uint16_t battery_level_get(void);
 
 #endif  /* _BATTERY_H_ */
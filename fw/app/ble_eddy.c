@@ -11,6 +11,10 @@
 
 #include "config.h"
 #include "ble_eddy.h"
+#include "settings.h"
+#include "history.h"
+#include "telemetry.h"
+#include "dfu.h"
 #include "dbglog.h"
 
 static char     m_eddy_url [URL_MAX_LENGTH];
@@ -34,6 +38,19 @@ int eddy_url_len_get(void)
     return m_eddy_url_len;
 }
 
+/*
+ *  Initialize URL: last one saved, or the built-in default.  Called once
+ *  the settings are loaded, ahead of the service: the beacon's URL frame
+ *  is built from it before ble_eddy_init() runs on a fast boot.
+ */
+void ble_eddy_url_init(void)
+{
+    settings_t * p_settings = settings_get();
+
+    memcpy(m_eddy_url, p_settings->url, URL_MAX_LENGTH);
+    m_eddy_url_len = p_settings->url_len;
+}
+
 /* 
  *  Function for handling the Connect event.
  *
@@ -74,6 +91,14 @@ static void on_eddy_url_write(ble_eddy_t * p_eddy, ble_gatts_evt_write_t * p_evt
         m_eddy_url_len = strlen(m_eddy_url);
 
         PRINTF("m_eddy_url: \"%s\"\n", m_eddy_url);
+
+        /* Keep the new URL across resets. */
+        settings_t * p_settings = settings_get();
+
+        memcpy(p_settings->url, m_eddy_url, URL_MAX_LENGTH);
+        p_settings->url_len = m_eddy_url_len;
+
+        settings_save();
     }
 }
 
@@ -93,6 +118,31 @@ static void on_write(ble_eddy_t * p_eddy, ble_evt_t * p_ble_evt)
             on_eddy_url_write(p_eddy, p_evt_write);
             break;
 
+        case EDDY_UUID_HISTORY_CHAR:
+            /* Any write to the value (not the CCCD) starts a download. */
+            if (p_evt_write->handle == p_eddy->history_char_handles.value_handle) {
+                history_download_start();
+            }
+            break;
+
+        case EDDY_UUID_DFU_CTRL_CHAR:
+            if (p_evt_write->handle == p_eddy->dfu_ctrl_handles.value_handle) {
+                dfu_on_ctrl_write(p_evt_write->data, p_evt_write->len);
+            }
+            break;
+
+        case EDDY_UUID_DFU_PACKET_CHAR:
+            dfu_on_packet_write(p_evt_write->data, p_evt_write->len);
+            break;
+
+        case EDDY_UUID_TELEMETRY_CHAR:
+            /* The stream runs while its notifications are enabled. */
+            if (p_evt_write->handle == p_eddy->telemetry_char_handles.cccd_handle &&
+                p_evt_write->len == 2) {
+                telemetry_enable(ble_srv_is_notification_enabled(p_evt_write->data));
+            }
+            break;
+
         default:
             /* Quietly ignore these events. */
             break;
@@ -190,6 +240,157 @@ static uint32_t url_char_add(ble_eddy_t * p_eddy)
                                            &p_eddy->url_char_handles);
 }
 
+/*
+ *  Function for adding the history download characteristic.
+ *  Write anything to start; the log comes back as notifications.
+ */
+static uint32_t history_char_add(ble_eddy_t * p_eddy)
+{
+    ble_gatts_char_md_t  char_md;
+    ble_gatts_attr_t     attr_char_value;
+    ble_uuid_t           ble_uuid;
+    ble_gatts_attr_md_t  attr_md;
+    ble_gatts_attr_md_t  cccd_md;
+    ble_gatts_attr_md_t  desc_md;
+
+    static const uint8_t user_desc[] = "History";
+
+    memset(&desc_md, 0, sizeof(desc_md));
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&desc_md.read_perm);
+    desc_md.vloc = BLE_GATTS_VLOC_STACK;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
+    cccd_md.vloc = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.write        = 1;
+    char_md.char_props.write_wo_resp = 1;
+    char_md.char_props.notify       = 1;
+    char_md.p_char_user_desc        = (uint8_t*) &user_desc;
+    char_md.char_user_desc_size     = sizeof(user_desc);
+    char_md.char_user_desc_max_size = sizeof(user_desc);
+    char_md.p_char_pf               = NULL;
+    char_md.p_user_desc_md          = &desc_md;
+    char_md.p_cccd_md               = &cccd_md;
+    char_md.p_sccd_md               = NULL;
+
+    ble_uuid.type = p_eddy->uuid_type;
+    ble_uuid.uuid = EDDY_UUID_HISTORY_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.write_perm);
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.rd_auth    = 0;
+    attr_md.wr_auth    = 0;
+    attr_md.vlen       = 1;
+
+    /* Room for a whole notification: the download sends 20 bytes each. */
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = 1;
+    attr_char_value.init_offs    = 0;
+    attr_char_value.max_len      = 20;
+
+    return sd_ble_gatts_characteristic_add(p_eddy->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_eddy->history_char_handles);
+}
+
+/*
+ *  Function for adding one of the DFU characteristics (see dfu.h):
+ *  the control point notifies, the packet characteristic takes the patch.
+ *  Both need an encrypted link: a patch rewrites the firmware.
+ */
+static uint32_t dfu_char_add(ble_eddy_t               * p_eddy,
+                             uint16_t                   uuid,
+                             bool                       is_ctrl,
+                             ble_gatts_char_handles_t * p_handles)
+{
+    ble_gatts_char_md_t  char_md;
+    ble_gatts_attr_t     attr_char_value;
+    ble_uuid_t           ble_uuid;
+    ble_gatts_attr_md_t  attr_md;
+    ble_gatts_attr_md_t  cccd_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&cccd_md.write_perm);
+    cccd_md.vloc = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.write         = is_ctrl;
+    char_md.char_props.write_wo_resp = !is_ctrl;
+    char_md.char_props.notify        = is_ctrl;
+    char_md.p_cccd_md                = is_ctrl ? &cccd_md : NULL;
+
+    ble_uuid.type = p_eddy->uuid_type;
+    ble_uuid.uuid = uuid;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&attr_md.write_perm);
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen       = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = 1;
+    attr_char_value.max_len      = 20;
+
+    return sd_ble_gatts_characteristic_add(p_eddy->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           p_handles);
+}
+
+/*
+ *  Function for adding the live telemetry characteristic (see telemetry.h).
+ *  Notify only: enabling notifications starts the stream.
+ */
+static uint32_t telemetry_char_add(ble_eddy_t * p_eddy)
+{
+    ble_gatts_char_md_t  char_md;
+    ble_gatts_attr_t     attr_char_value;
+    ble_uuid_t           ble_uuid;
+    ble_gatts_attr_md_t  attr_md;
+    ble_gatts_attr_md_t  cccd_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.write_perm);
+    cccd_md.vloc = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.notify = 1;
+    char_md.p_cccd_md         = &cccd_md;
+
+    ble_uuid.type = p_eddy->uuid_type;
+    ble_uuid.uuid = EDDY_UUID_TELEMETRY_CHAR;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen       = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = 1;
+    attr_char_value.max_len      = 20;
+
+    return sd_ble_gatts_characteristic_add(p_eddy->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_eddy->telemetry_char_handles);
+}
+
 /*
  *  Function for initializing eddystone's BLE usage.
  */
@@ -202,10 +403,6 @@ uint32_t ble_eddy_init(void)
 
     PUTS(__func__);
 
-    /* Initialize default URL. */
-    strncpy(m_eddy_url, URL_DEFAULT_STRING, URL_MAX_LENGTH);
-    m_eddy_url_len = strlen(URL_DEFAULT_STRING);
-
     /* Initialize service structure */
     p_eddy->conn_handle    = BLE_CONN_HANDLE_INVALID;
 
@@ -231,5 +428,27 @@ uint32_t ble_eddy_init(void)
         return err_code;
     }
 
+    err_code = history_char_add(p_eddy);
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+    err_code = dfu_char_add(p_eddy, EDDY_UUID_DFU_CTRL_CHAR, true,
+                            &p_eddy->dfu_ctrl_handles);
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+    err_code = dfu_char_add(p_eddy, EDDY_UUID_DFU_PACKET_CHAR, false,
+                            &p_eddy->dfu_packet_handles);
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+    err_code = telemetry_char_add(p_eddy);
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
     return NRF_SUCCESS;
 }
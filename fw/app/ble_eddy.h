@@ -17,6 +17,10 @@
 #define EDDY_UUID_BASE {0xae, 0xad, 0xdb, 0x3c, 0x87, 0x11, 0x68, 0x90, 0x17, 0x4e, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00}
 #define EDDY_UUID_SERVICE            0xfad0
 #define EDDY_UUID_URL_CHAR           0xfad1
+#define EDDY_UUID_HISTORY_CHAR       0xfad2
+#define EDDY_UUID_DFU_CTRL_CHAR      0xfad3
+#define EDDY_UUID_DFU_PACKET_CHAR    0xfad4
+#define EDDY_UUID_TELEMETRY_CHAR     0xfad5
 
 
 
@@ -29,6 +33,10 @@ typedef struct _ble_eddy   ble_eddy_t;
 typedef struct _ble_eddy {
     uint16_t                       service_handle;
     ble_gatts_char_handles_t       url_char_handles;
+    ble_gatts_char_handles_t       history_char_handles;
+    ble_gatts_char_handles_t       dfu_ctrl_handles;
+    ble_gatts_char_handles_t       dfu_packet_handles;
+    ble_gatts_char_handles_t       telemetry_char_handles;
     uint8_t                        uuid_type;
     uint16_t                       conn_handle;  
 } ble_eddy_t;
@@ -57,6 +65,11 @@ void ble_eddy_on_ble_evt(ble_evt_t * p_ble_evt);
 char * eddy_url_str_get(void);
 int    eddy_url_len_get(void);
 
+/*
+ * Load the URL from the settings; after settings_init().
+ */
+void ble_eddy_url_init(void);
+
 
 
 #endif // BLE_EDDY_H__
@@ -0,0 +1,124 @@
+/*---------------------------------------------------------------------------*/
+/*  boot.c   boot profile: RTC1 ticks at each init stage                     */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf51.h"
+#include "app_timer.h"
+#include "app_error.h"
+
+#include "config.h"
+#include "evq.h"
+#include "boot.h"
+#include "diag.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+    const char  * p_stage;
+    uint32_t      ticks;
+} boot_mark_t;
+
+static boot_mark_t     m_marks [BOOT_MARKS_MAX];
+static uint8_t         m_count;
+
+static uint32_t        m_start;
+static volatile bool   m_adv_seen;
+
+static app_timer_id_t  m_boot_timer_id;
+
+/*---------------------------------------------------------------------------*/
+/*  Ticks since boot_init(), in microseconds.                                */
+/*---------------------------------------------------------------------------*/
+static uint32_t since_start_us(uint32_t ticks)
+{
+    return DIAG_TICKS_US((ticks - m_start) & 0x00FFFFFF);
+}
+
+#ifdef DBGLOG_SUPPORT
+/*---------------------------------------------------------------------------*/
+/*  In the scheduler.                                                        */
+/*---------------------------------------------------------------------------*/
+static void boot_report(uintptr_t arg)
+{
+    uint32_t us;
+    uint32_t prev = 0;
+    unsigned i;
+
+    PUTS("boot profile, ms since RTC1 start:");
+
+    for (i = 0; i < m_count; i++) {
+        us = since_start_us(m_marks[i].ticks);
+        PRINTF("  %-12s %4u.%02u  +%u.%02u\n", m_marks[i].p_stage,
+               (unsigned) (us / 1000), (unsigned) (us % 1000) / 10,
+               (unsigned) ((us - prev) / 1000),
+               (unsigned) ((us - prev) % 1000) / 10);
+        prev = us;
+    }
+
+    if (m_adv_seen) {
+        us = g_diag.boot_adv_us;
+        PRINTF("  first advert %4u.%02u\n",
+               (unsigned) (us / 1000), (unsigned) (us % 1000) / 10);
+    }
+    else {
+        PUTS("  no advertising yet");
+    }
+}
+#endif /* DBGLOG_SUPPORT */
+
+/*---------------------------------------------------------------------------*/
+/*  In the RTC1 interrupt.                                                   */
+/*---------------------------------------------------------------------------*/
+static void boot_timeout_handler(void * p_context)
+{
+#ifdef DBGLOG_SUPPORT
+    (void) evq_put(EVQ_LOW, boot_report, 0);
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/*  After timer_init().  app_timer only runs RTC1 while a timer is pending,  */
+/*  so the report timer also keeps the clock going through the boot.         */
+/*---------------------------------------------------------------------------*/
+void boot_init(void)
+{
+    APP_ERROR_CHECK( app_timer_create(&m_boot_timer_id,
+                                      APP_TIMER_MODE_SINGLE_SHOT,
+                                      boot_timeout_handler) );
+
+    APP_ERROR_CHECK( app_timer_start(m_boot_timer_id,
+                                     APP_TIMER_TICKS(BOOT_REPORT_MS, APP_TIMER_PRESCALER),
+                                     NULL) );
+    m_start = DIAG_TICKS();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The end of an init stage.  p_stage must be a string constant.            */
+/*---------------------------------------------------------------------------*/
+void boot_mark(const char * p_stage)
+{
+    if (m_count < BOOT_MARKS_MAX) {
+        m_marks[m_count].p_stage = p_stage;
+        m_marks[m_count].ticks   = DIAG_TICKS();
+        m_count++;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Radio notification: the first active one is the first advertising        */
+/*  event, NRF_RADIO_NOTIFICATION_DISTANCE_5500US before it goes on air.     */
+/*---------------------------------------------------------------------------*/
+void boot_radio_notification(bool radio_active)
+{
+    if (!radio_active || m_adv_seen)
+        return;
+
+    g_diag.boot_adv_us = since_start_us(DIAG_TICKS());
+    m_adv_seen = true;
+}
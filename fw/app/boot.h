@@ -0,0 +1,28 @@
+/*---------------------------------------------------------------------------*/
+/*  boot.h                                                                   */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ *  Boot profile: main() marks the end of each init stage with the RTC1
+ *  count, and the first radio notification marks the first advertising
+ *  event.  BOOT_REPORT_MS after boot_init() the stages are printed, and
+ *  the time to the first advertising event is kept in the diagnostics
+ *  (boot_adv_us).
+ *
+ *  Zero is boot_init(), which starts RTC1 just after the SoftDevice:
+ *  the reset, the SoftDevice itself and the 32 kHz crystal starting are
+ *  not on this clock, and are the same whatever order main() takes.
+ */
+#define BOOT_MARKS_MAX      16
+
+void boot_init(void);
+void boot_mark(const char * p_stage);
+void boot_radio_notification(bool radio_active);
+
+#endif  /* _BOOT_H_ */
@@ -13,8 +13,12 @@
 #include "nrf_gpiote.h"
 #include "nrf_delay.h"
 #include "app_timer.h"
+#include "app_util.h"
 
 #include "buzzer.h"
+#include "hfclk.h"
+#include "evq.h"
+#include "diag.h"
 #include "dbglog.h"
 
 /*---------------------------------------------------------------------------*/
@@ -26,17 +30,37 @@
 
 #define BUZZ_TIMER                NRF_TIMER2
 
+/*
+ *  PAN-73: TIMER events may not reach GPIOTE through PPI unless this is
+ *  set while the timer runs.  TIMER2's register; the old write went to
+ *  TIMER0's (0x40008C0C), which belongs to the SoftDevice.
+ */
+#define BUZZ_TIMER_PAN73          (*(volatile uint32_t *) 0x4000AC0C)
+
 #define GPIOTE_CHANNEL_NUMBER_0   0
 #define GPIOTE_CHANNEL_NUMBER_1   1
 
-#define TIMER_DELAY_ONE_MS APP_TIMER_TICKS( 1, APP_TIMER_PRESCALER )
+#define BUZZ_PPI_MASK             ((PPI_CHEN_CH0_Enabled << PPI_CHEN_CH0_Pos) | \
+                                   (PPI_CHEN_CH1_Enabled << PPI_CHEN_CH1_Pos))
 
 /*---------------------------------------------------------------------------*/
+/*  A playlist is a sequence: GPIOTE, PPI and the timer are set up once at   */
+/*  the start and torn down at the end.  In between, a note boundary only    */
+/*  writes the timer's compare value, and a quiet step stops the timer and   */
+/*  toggles one leg of the buzzer once, so both legs sit at the same level.  */
+/*  The next tone toggles it back.                                           */
 /*                                                                           */
+/*  The crystal is held for the whole sequence (hfclk.c); the playlist       */
+/*  waits in m_pending until it is running.  If the event queue is full      */
+/*  then, the playlist is dropped and the crystal given back.                */
 /*---------------------------------------------------------------------------*/
 
 static app_timer_id_t   m_buzzer_timer_id;
 
+static const buzzer_play_t * volatile m_pending = NULL;  // waiting for the crystal
+static bool             m_playing = false;
+static bool             m_opposed = false;  // legs at opposite levels
+
 /*---------------------------------------------------------------------------*/
 /* Configure the GPIOs used to toggle on a GPIOTE task.                      */
 /*---------------------------------------------------------------------------*/
@@ -55,6 +79,8 @@ static void buzzer_gpiote_config(void)
                            BUZZ2,
                            NRF_GPIOTE_POLARITY_TOGGLE,
                            NRF_GPIOTE_INITIAL_VALUE_HIGH);
+
+    m_opposed = true;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -74,27 +100,17 @@ static void buzzer_gpiote_unconfig(void)
 }
 
 /*---------------------------------------------------------------------------*/
-/* Use BUZZ_TIMER to generate events 'frequency' period.                     */
+/* BUZZ_TIMER clears itself on compare[0]; the value is set per note.        */
 /*---------------------------------------------------------------------------*/
-static void buzzer_timer_config(uint16_t frequency)
+static void buzzer_timer_config(void)
 {
-    /* Start 16 MHz crystal oscillator. */
-    NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
-    NRF_CLOCK->TASKS_HFCLKSTART    = 1;
-
-    /* Wait for the external oscillator to start. */
-    while (NRF_CLOCK->EVENTS_HFCLKSTARTED == 0) { /* spin */ }
-
-    /* Clear TIMER0 */
+    BUZZ_TIMER->TASKS_STOP  = 1;
     BUZZ_TIMER->TASKS_CLEAR = 1;
 
-    /*
-     * Configure TIMER0 for compare[0] event every 125µs.
-     */
-    BUZZ_TIMER->PRESCALER = 2;
-    BUZZ_TIMER->CC[0]     = frequency;
+    /* 4 MHz; TIMER2 is 16 bits wide at most. */
+    BUZZ_TIMER->PRESCALER = BUZZER_TIMER_PRESCALER;
     BUZZ_TIMER->MODE      = TIMER_MODE_MODE_Timer;
-    BUZZ_TIMER->BITMODE   = TIMER_BITMODE_BITMODE_24Bit;
+    BUZZ_TIMER->BITMODE   = TIMER_BITMODE_BITMODE_16Bit;
     BUZZ_TIMER->SHORTS    = (TIMER_SHORTS_COMPARE0_CLEAR_Enabled << TIMER_SHORTS_COMPARE0_CLEAR_Pos);
 }
 
@@ -104,8 +120,8 @@ static void buzzer_timer_config(uint16_t frequency)
 static void buzzer_ppi_config(void)
 {
     /*  
-     *  Configure PPI channel 0 to toggle GPIO_OUTPUT_PIN on 
-     *  every TIMER0 COMPARE[0] match (300µs)
+     *  Configure PPI channels 0 and 1 to toggle both buzzer pins on
+     *  every BUZZ_TIMER COMPARE[0] match.
      */
     sd_ppi_channel_assign(GPIOTE_CHANNEL_NUMBER_0,
                           &BUZZ_TIMER->EVENTS_COMPARE[0],
@@ -116,46 +132,89 @@ static void buzzer_ppi_config(void)
                           &NRF_GPIOTE->TASKS_OUT[GPIOTE_CHANNEL_NUMBER_1]);
 
     /* Enable PPI channels */
-    sd_ppi_channel_enable_set((PPI_CHEN_CH0_Enabled << PPI_CHEN_CH0_Pos) |
-                              (PPI_CHEN_CH1_Enabled << PPI_CHEN_CH1_Pos));
+    sd_ppi_channel_enable_set(BUZZ_PPI_MASK);
 }
 
 /*---------------------------------------------------------------------------*/
-/*                                                                           */
+/*  Once per playlist, with the crystal running.                             */
 /*---------------------------------------------------------------------------*/
-static void buzzer_process_playlist(buzzer_play_t * playlist)
+static void buzzer_sequence_start(void)
 {
-    switch (playlist->action) {
+    buzzer_timer_config();
+    buzzer_gpiote_config();
+    buzzer_ppi_config();
 
-        case BUZZER_PLAY_TONE:
+    m_playing = true;
+}
+
+static void buzzer_sequence_stop(void)
+{
+    BUZZ_TIMER->TASKS_STOP = 1;
+    BUZZ_TIMER_PAN73 = 0;
+
+    sd_ppi_channel_enable_clr(BUZZ_PPI_MASK);
+    buzzer_gpiote_unconfig();
+
+    m_playing = false;
 
-            BUZZ_TIMER->TASKS_STOP = 1;
+    hfclk_release();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Note boundaries: no reconfiguration, just the timer and one toggle.      */
+/*---------------------------------------------------------------------------*/
+static void buzzer_tone(uint16_t compare)
+{
+    BUZZ_TIMER->TASKS_STOP  = 1;
+    BUZZ_TIMER->CC[0]       = compare;
+    BUZZ_TIMER->TASKS_CLEAR = 1;
+
+    if (!m_opposed) {
+        NRF_GPIOTE->TASKS_OUT[GPIOTE_CHANNEL_NUMBER_1] = 1;
+        m_opposed = true;
+    }
+
+    BUZZ_TIMER_PAN73 = 1;
+    BUZZ_TIMER->TASKS_START = 1;
+}
 
-            buzzer_gpiote_config();
-            buzzer_timer_config(playlist->frequency);
-            buzzer_ppi_config();
+static void buzzer_quiet(void)
+{
+    BUZZ_TIMER->TASKS_STOP = 1;
+    BUZZ_TIMER_PAN73 = 0;
 
-            BUZZ_TIMER->TASKS_START = 1;
+    if (m_opposed) {
+        NRF_GPIOTE->TASKS_OUT[GPIOTE_CHANNEL_NUMBER_1] = 1;
+        m_opposed = false;
+    }
+}
 
-            app_timer_start(m_buzzer_timer_id,
-                            (playlist->duration * TIMER_DELAY_ONE_MS),
-                            &playlist[1]);
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void buzzer_process_playlist(const buzzer_play_t * playlist)
+{
+    switch (playlist->action) {
+
+        case BUZZER_PLAY_TONE:
+            buzzer_tone(playlist->compare);
+
+            APP_ERROR_CHECK( app_timer_start(m_buzzer_timer_id,
+                                             playlist->duration,
+                                             (void *) &playlist[1]) );
             break;
 
         case BUZZER_PLAY_QUIET:
+            buzzer_quiet();
 
-            BUZZ_TIMER->TASKS_STOP = 1;
-            buzzer_gpiote_unconfig();
-
-            app_timer_start(m_buzzer_timer_id,
-                            (playlist->duration * TIMER_DELAY_ONE_MS),
-                            &playlist[1]);
+            APP_ERROR_CHECK( app_timer_start(m_buzzer_timer_id,
+                                             playlist->duration,
+                                             (void *) &playlist[1]) );
             break;
 
         case BUZZER_PLAY_DONE:
         default:
-            BUZZ_TIMER->TASKS_STOP = 1;
-            buzzer_gpiote_unconfig();
+            buzzer_sequence_stop();
             break;
     }
 }
@@ -165,27 +224,87 @@ static void buzzer_process_playlist(buzzer_play_t * playlist)
 /*---------------------------------------------------------------------------*/
 static void buzzer_timeout_handler(void * context)
 {
-    buzzer_play_t * playlist = (buzzer_play_t*) context;
+    const buzzer_play_t * playlist = (const buzzer_play_t *) context;
+
+    DIAG_INC(wake_timer);
 
     buzzer_process_playlist(playlist);
 }
 
+/*---------------------------------------------------------------------------*/
+/*  From the scheduler, or the SoC event: whoever takes it owns it.          */
+/*---------------------------------------------------------------------------*/
+static const buzzer_play_t * pending_take(void)
+{
+    const buzzer_play_t * playlist;
+
+    CRITICAL_REGION_ENTER();
+    playlist  = m_pending;
+    m_pending = NULL;
+    CRITICAL_REGION_EXIT();
+
+    return playlist;
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
-static void buzzer_play_execute(void * p_data, uint16_t size)
+static void buzzer_start_execute(uintptr_t arg)
 {
-    buzzer_play_t ** playlist = (buzzer_play_t**) p_data;
+    const buzzer_play_t * playlist = pending_take();
+
+    /* Stopped, or dropped, while the crystal was starting. */
+    if (playlist == NULL)
+        return;
 
-    buzzer_process_playlist(*playlist);
+    buzzer_sequence_start();
+    buzzer_process_playlist(playlist);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The crystal is up: may be in the SoC event handler, so the playlist      */
+/*  starts from the scheduler, where m_pending is looked after.              */
+/*---------------------------------------------------------------------------*/
+static void buzzer_hfclk_started(void)
+{
+    if (evq_put(EVQ_LOW, buzzer_start_execute, 0) != NRF_SUCCESS &&
+        pending_take() != NULL)
+        hfclk_release();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  A new playlist cuts off the one playing.                                 */
+/*---------------------------------------------------------------------------*/
+static void buzzer_play_execute(uintptr_t arg)
+{
+    const buzzer_play_t * playlist = (const buzzer_play_t *) arg;
+    bool                  waiting;
+
+    app_timer_stop(m_buzzer_timer_id);
+
+    if (m_playing) {
+        buzzer_process_playlist(playlist);
+        return;
+    }
+
+    /* Still waiting for the crystal: play this one instead. */
+    CRITICAL_REGION_ENTER();
+    waiting   = (m_pending != NULL);
+    m_pending = playlist;
+    CRITICAL_REGION_EXIT();
+
+    if (!waiting)
+        hfclk_request(buzzer_hfclk_started);
 }
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
-void buzzer_play(buzzer_play_t * playlist)
+void buzzer_play(const buzzer_play_t * playlist)
 {
-    app_sched_event_put(&playlist, sizeof(playlist), buzzer_play_execute);
+    /* The tables are const: only the pointer goes in the queue.  If it is
+       full, the tune is not played; the overflow is counted. */
+    (void) evq_put(EVQ_LOW, buzzer_play_execute, (uintptr_t) playlist);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -195,8 +314,11 @@ void buzzer_stop(void)
 {
     app_timer_stop(m_buzzer_timer_id);
 
-    BUZZ_TIMER->TASKS_STOP = 1;
-    buzzer_gpiote_unconfig();
+    if (pending_take() != NULL)
+        hfclk_release();
+
+    if (m_playing)
+        buzzer_sequence_stop();
 }
 
 /*---------------------------------------------------------------------------*/
@@ -211,8 +333,6 @@ void buzzer_init(void)
                                 buzzer_timeout_handler);
     APP_ERROR_CHECK(err_code);
 
-    *(uint32_t *)0x40008C0C = 1;  // PAN-73 workaround
-
     nrf_gpio_cfg_output(BUZZ1);
     nrf_gpio_cfg_output(BUZZ2);
 
@@ -4,20 +4,35 @@
 #ifndef BUZZER_H__
 #define BUZZER_H__
 
+#include <stdint.h>
+
+#include "config.h"
+
+/* TIMER2 clock: fw/tools/melody.py turns Hz into compare values with it. */
+#define BUZZER_TIMER_PRESCALER  2
+#define BUZZER_TIMER_HZ         (16000000UL >> BUZZER_TIMER_PRESCALER)
+
+/* Milliseconds to the app_timer ticks a playlist step lasts. */
+#define BUZZER_MS(ms)           APP_TIMER_TICKS(ms, APP_TIMER_PRESCALER)
+
 typedef enum {
     BUZZER_PLAY_DONE = 0,
     BUZZER_PLAY_TONE,
     BUZZER_PLAY_QUIET,
 } buzzer_play_action_t;
 
+/*
+ *  Playlists live in flash, made by melody.py from tones.txt, so each
+ *  step is ready to play as it stands.
+ */
 typedef struct {
-    buzzer_play_action_t  action;    // see enum above
-    uint16_t              duration;  // in milliseconds
-    uint16_t              frequency; // frequency
+    uint8_t               action;    // buzzer_play_action_t
+    uint16_t              duration;  // in app_timer ticks, BUZZER_MS()
+    uint16_t              compare;   // TIMER2 CC[0], half a period
 } buzzer_play_t;
 
 void buzzer_init(void);
-void buzzer_play(buzzer_play_t * playlist);
+void buzzer_play(const buzzer_play_t * playlist);
 void buzzer_stop(void);
 
-#endif /* BUZZER_H__ */
\ No newline at end of file
+#endif /* BUZZER_H__ */
@@ -0,0 +1,87 @@
+/*---------------------------------------------------------------------------*/
+/*  cmac.c   AES-CMAC on the ECB peripheral                                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf_soc.h"
+#include "app_error.h"
+
+#include "cmac.h"
+
+/*---------------------------------------------------------------------------*/
+/*  ciphertext = E(key, cleartext)                                           */
+/*---------------------------------------------------------------------------*/
+static void cmac_encrypt(cmac_t * p_cmac)
+{
+    APP_ERROR_CHECK( sd_ecb_block_encrypt(&p_cmac->ecb) );
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Doubling in GF(2^128), for the subkeys.                                  */
+/*---------------------------------------------------------------------------*/
+static void cmac_double(uint8_t * p_out, uint8_t const * p_in)
+{
+    uint8_t carry = p_in[0] >> 7;
+    int     i;
+
+    for (i = 0; i < CMAC_SIZE - 1; i++)
+        p_out[i] = (uint8_t) ((p_in[i] << 1) | (p_in[i + 1] >> 7));
+
+    p_out[CMAC_SIZE - 1] = (uint8_t) ((p_in[CMAC_SIZE - 1] << 1) ^ (carry ? 0x87 : 0));
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void cmac_begin(cmac_t * p_cmac, uint8_t const * p_key)
+{
+    memcpy(p_cmac->ecb.key, p_key, CMAC_SIZE);
+    memset(p_cmac->ecb.cleartext, 0, CMAC_SIZE);
+
+    cmac_encrypt(p_cmac);
+    cmac_double(p_cmac->k1, p_cmac->ecb.ciphertext);
+
+    p_cmac->fill = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  A full block is held back until more comes: the last one is different.   */
+/*---------------------------------------------------------------------------*/
+void cmac_update(cmac_t * p_cmac, uint8_t const * p_data, uint32_t len)
+{
+    while (len-- > 0) {
+
+        if (p_cmac->fill == CMAC_SIZE) {
+            cmac_encrypt(p_cmac);
+            memcpy(p_cmac->ecb.cleartext, p_cmac->ecb.ciphertext, CMAC_SIZE);
+            p_cmac->fill = 0;
+        }
+
+        p_cmac->ecb.cleartext[p_cmac->fill++] ^= *p_data++;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void cmac_end(cmac_t * p_cmac, uint8_t * p_mac)
+{
+    uint8_t k2 [CMAC_SIZE];
+    int     i;
+
+    if (p_cmac->fill == CMAC_SIZE) {
+        for (i = 0; i < CMAC_SIZE; i++)
+            p_cmac->ecb.cleartext[i] ^= p_cmac->k1[i];
+    }
+    else {
+        p_cmac->ecb.cleartext[p_cmac->fill] ^= 0x80;
+        cmac_double(k2, p_cmac->k1);
+        for (i = 0; i < CMAC_SIZE; i++)
+            p_cmac->ecb.cleartext[i] ^= k2[i];
+    }
+
+    cmac_encrypt(p_cmac);
+    memcpy(p_mac, p_cmac->ecb.ciphertext, CMAC_SIZE);
+}
@@ -0,0 +1,30 @@
+/*---------------------------------------------------------------------------*/
+/*  cmac.h                                                                   */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _CMAC_H_
+#define _CMAC_H_
+
+#include <stdint.h>
+
+#include "nrf_soc.h"
+
+/*
+ *  AES-CMAC (RFC 4493) on the ECB peripheral, through the SoftDevice.
+ *  The message may come in pieces of any size; one block is encrypted
+ *  for every 16 bytes, and two more for the subkey and the tag.
+ */
+
+#define CMAC_SIZE                  16
+
+typedef struct {
+    nrf_ecb_hal_data_t  ecb;        // cleartext: the chain, the block so far xor'ed in
+    uint8_t             k1 [CMAC_SIZE];
+    uint8_t             fill;       // bytes of the block so far
+} cmac_t;
+
+void cmac_begin(cmac_t * p_cmac, uint8_t const * p_key);
+void cmac_update(cmac_t * p_cmac, uint8_t const * p_data, uint32_t len);
+void cmac_end(cmac_t * p_cmac, uint8_t * p_mac);
+
+#endif  /* _CMAC_H_ */
@@ -9,7 +9,6 @@
 #include <stdint.h>
 
 #include "app_timer.h"
-#include "app_scheduler.h"
 #include "trackr_bsp.h"
 
 /* 
@@ -65,6 +64,19 @@
 #define SEC_PARAM_MIN_KEY_SIZE          7 
 #define SEC_PARAM_MAX_KEY_SIZE          16
 
+/*
+ *  Resolvable private address rotation period (15 minutes).
+ *  Each new address is computed ahead of time and applied at a frame boundary.
+ */
+#define PRIVACY_RPA_INTERVAL_S          900
+
+/*
+ *  Flash job queue: jobs waiting for a radio gap, and how many
+ *  NRF_EVT_FLASH_OPERATION_ERROR retries a job gets before it fails.
+ */
+#define FLASH_QUEUE_SIZE                8
+#define FLASH_MAX_RETRIES               5
+
 /* 
  *  The advertising interval for advertisement (100 ms).
  *  This value can vary between 100ms to 10.24s). 
@@ -74,23 +86,73 @@
 #define APP_ADV_INTERVAL                MSEC_TO_UNITS(APP_ADV_INTERVAL_MS, UNIT_0_625_MS)
 
 /*
- *  Timer parameters
+ *  Battery and temperature history: sample period (1 hour) and the
+ *  battery voltage step stored in the log (the 8-bit ADC step is ~14 mV).
  */
-#define APP_TIMER_PRESCALER             0
-#define APP_TIMER_MAX_TIMERS            4
-#define APP_TIMER_OP_QUEUE_SIZE         10
+#define HISTORY_INTERVAL_MIN            60
+#define HISTORY_VBAT_UNIT_MV            10
 
-/* 
- *  Maximum size of scheduler events. 
- *  Note that scheduler BLE stack events do not contain any data, as the 
- *  events are being pulled from the stack in the event handler.
+/*
+ *  Live telemetry sample period while a client has the stream enabled.
+ *  Three samples go per notification; 20 ms keeps well inside what a
+ *  short connection interval carries.
  */
-#define SCHED_MAX_EVENT_DATA_SIZE       sizeof(app_timer_event_t)
+#define TELEMETRY_SAMPLE_MS             20
 
-/* 
- *  Maximum number of events in the scheduler queue.
+/*
+ *  Debug log transmit buffer, a power of two up to 256.  At 38400 bps it
+ *  takes 67 ms to empty; what does not fit is dropped, not waited for.
+ */
+#define UART_TX_BUFFER_SIZE             256
+
+/*
+ *  With DBGLOG_RAM the log goes to a RAM ring of this size instead (a
+ *  power of two), read over SWD; the oldest output is overwritten.
+ */
+#define RAMLOG_SIZE                     512
+
+/*
+ *  Over-the-air update.  The image may use at most DFU_IMAGE_MAX bytes (the
+ *  linker script enforces it); the patch is staged in the pages above it,
+ *  then comes the DFU boot page (dfu_boot.h), below the pstorage pages.
+ *  The boot page journals the image page it is rewriting in the pstorage
+ *  swap page, which holds nothing between pstorage operations.
+ */
+#define DFU_IMAGE_ADDR                  0x16000
+#define DFU_IMAGE_MAX                   (30 * 1024)
+#define DFU_STAGE_ADDR                  (DFU_IMAGE_ADDR + DFU_IMAGE_MAX)
+#define DFU_STAGE_PAGES                 3
+#define DFU_BOOT_ADDR                   (DFU_STAGE_ADDR + DFU_STAGE_PAGES * 1024)
+#define DFU_JOURNAL_ADDR                0x1FC00     // PSTORAGE_SWAP_ADDR
+
+/*
+ *  Button gestures, told apart by the times of the edges: a press shorter
+ *  than BUTTON_DEBOUNCE_MS is contact noise, one held BUTTON_LONG_MS is a
+ *  long press, and a press starting within BUTTON_DOUBLE_MS of the end of
+ *  a short one makes a double press.  A single press waits that long too.
+ */
+#define BUTTON_DEBOUNCE_MS              20
+#define BUTTON_LONG_MS                  2000
+#define BUTTON_DOUBLE_MS                400
+
+/*
+ *  Find-me (double press): the LED alerts for this long, and the buzzer,
+ *  if built in, plays find_me_sound.
+ */
+#define FIND_ME_MS                      5000
+
+/*
+ *  The boot profile (see boot.h) is printed this long after boot.  Its
+ *  single-shot timer stays allocated: app_timer has no delete.
  */
-#define SCHED_QUEUE_SIZE                10
+#define BOOT_REPORT_MS                  1000
+
+/*
+ *  Timer parameters
+ */
+#define APP_TIMER_PRESCALER             0
+#define APP_TIMER_MAX_TIMERS            8
+#define APP_TIMER_OP_QUEUE_SIZE         10
 
 /*
  *  The Beacon's measured RSSI at 1 meter distance in dBm.
@@ -127,6 +189,15 @@
  */
 #define UID_NAMESPACE                   {0x73,0x15,0x6B,0x80,0x24,0xC0,0x6C,0xC3,0x28,0x5F}
 
+/*
+ *  UID instance.  From the FICR, it is the chip's device address, the same
+ *  in every UID frame: it ties the rotating private addresses back to one
+ *  device.  Set UID_INSTANCE_FROM_FICR to 0 to send UID_INSTANCE instead,
+ *  and give a fleet the one instance if the addresses are to stay private.
+ */
+#define UID_INSTANCE_FROM_FICR          1
+#define UID_INSTANCE                    {0x00,0x00,0x00,0x00,0x00,0x01}
+
 /*
  *  Misc values
  */
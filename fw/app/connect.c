@@ -21,6 +21,13 @@
 #include "advert.h"
 #include "connect.h"
 #include "pstorage_platform.h"
+#include "settings.h"
+#include "flash_queue.h"
+#include "history.h"
+#include "dfu.h"
+#include "telemetry.h"
+#include "hfclk.h"
+#include "diag.h"
 #include "tones.h"
 #include "dbglog.h"
 
@@ -34,8 +41,8 @@ static uint16_t                  m_conn_handle = BLE_CONN_HANDLE_INVALID;
 /* Security requirements for this application. */
 static ble_gap_sec_params_t      m_sec_params;              
 
-/* Flag to keep track of ongoing operations on persistent memory. */
-static bool                      m_memory_access_in_progress = false;
+/* Application identifier allocated by device manager. */
+static dm_application_instance_t m_app_handle;
 
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
@@ -48,6 +55,44 @@ void sec_params_init(void)
     m_sec_params.oob          = SEC_PARAM_OOB;
     m_sec_params.min_key_size = SEC_PARAM_MIN_KEY_SIZE;
     m_sec_params.max_key_size = SEC_PARAM_MAX_KEY_SIZE;
+
+    /* Distribute our IRK so bonded peers can resolve the private address. */
+    m_sec_params.kdist_periph.enc = 1;
+    m_sec_params.kdist_periph.id  = 1;
+    m_sec_params.kdist_central.id = 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t device_manager_evt_handler(dm_handle_t const * p_handle,
+                                           dm_event_t const  * p_event,
+                                           uint32_t            event_result)
+{
+    APP_ERROR_CHECK(event_result);
+
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Must be called after storage_init() and sec_params_init().               */
+/*---------------------------------------------------------------------------*/
+void device_manager_init(void)
+{
+    dm_init_param_t        init_data;
+    dm_application_param_t register_param;
+
+    init_data.clear_persistent_data = false;
+
+    APP_ERROR_CHECK( dm_init(&init_data) );
+
+    memset(&register_param, 0, sizeof(register_param));
+
+    register_param.sec_param    = m_sec_params;
+    register_param.evt_handler  = device_manager_evt_handler;
+    register_param.service_type = DM_PROTOCOL_CNTXT_GATT_SRVR_ID;
+
+    APP_ERROR_CHECK( dm_register(&m_app_handle, &register_param) );
 }
 
 /*---------------------------------------------------------------------------*/
@@ -120,6 +165,11 @@ void gap_params_init(void)
 void storage_init(void)
 {   
     APP_ERROR_CHECK( pstorage_init() );
+
+    flash_queue_init();
+    settings_init();
+
+    ble_eddy_url_init();
 }
 
 /*---------------------------------------------------------------------------*/
@@ -159,7 +209,7 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
                 advertising_start_nonconnectable();
 
                 #ifdef BUZZER_SUPPORT
-                buzzer_play((buzzer_play_t *)&one_beep_sound);
+                buzzer_play(one_beep_sound);
                 #endif
             }
             break;
@@ -176,6 +226,8 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
 void services_init(void)
 { 
     APP_ERROR_CHECK( ble_eddy_init());
+
+    APP_ERROR_CHECK( diag_service_add(g_eddy_service.uuid_type) );
 }
 
 /*---------------------------------------------------------------------------*/
@@ -183,34 +235,24 @@ void services_init(void)
 /*---------------------------------------------------------------------------*/
 void ble_evt_dispatch(ble_evt_t * p_ble_evt)
 {
+    uint32_t start = DIAG_TICKS();
+
+    DIAG_INC(wake_ble);
+
     ble_eddy_on_ble_evt(p_ble_evt);
 
     ble_conn_params_on_ble_evt(p_ble_evt);
 
     dm_ble_evt_handler(p_ble_evt);
 
-    on_ble_evt(p_ble_evt);
-}
+    history_on_ble_evt(p_ble_evt);
 
-/*---------------------------------------------------------------------------*/
-/*                                                                           */
-/*---------------------------------------------------------------------------*/
-static void on_sys_evt(uint32_t sys_evt)
-{
-    switch (sys_evt) {
+    dfu_on_ble_evt(p_ble_evt);
+    telemetry_on_ble_evt(p_ble_evt);
 
-        case NRF_EVT_FLASH_OPERATION_SUCCESS:
-        case NRF_EVT_FLASH_OPERATION_ERROR:
-            if (m_memory_access_in_progress) {
-                m_memory_access_in_progress = false;
-                // TBD
-            }
-            break;
+    on_ble_evt(p_ble_evt);
 
-        default:
-            /* No implementation needed. */
-            break;
-    }
+    DIAG_ISR_TIME(isr_ble, start);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -218,7 +260,15 @@ static void on_sys_evt(uint32_t sys_evt)
 /*---------------------------------------------------------------------------*/
 void sys_evt_dispatch(uint32_t sys_evt)
 {
+    uint32_t start = DIAG_TICKS();
+
+    DIAG_INC(wake_soc);
+
     pstorage_sys_event_handler(sys_evt);
 
-    on_sys_evt(sys_evt);
+    flash_queue_sys_event_handler(sys_evt);
+
+    hfclk_on_sys_evt(sys_evt);
+
+    DIAG_ISR_TIME(isr_soc, start);
 }
@@ -0,0 +1,301 @@
+/*---------------------------------------------------------------------------*/
+/*  console.c   command console on the debug UART (DBGLOG_CONSOLE)          */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The UART receive interrupt edits one line; Enter hands it to the
+ *  scheduler, and the command runs there like any other event.  Input is
+ *  ignored until the command is done, so the line needs no locking.
+ *
+ *  Changes made here are live only: they are not saved, and a reset puts
+ *  everything back to what config.h says.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "nrf_error.h"
+#include "ble_gap.h"
+#include "app_util.h"
+
+#include "config.h"
+#include "evq.h"
+#include "console.h"
+#include "uart.h"
+#include "advert.h"
+#include "eddystone.h"
+#include "battery.h"
+#include "temperature.h"
+#include "diag.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define CONSOLE_LINE_MAX    40
+#define CONSOLE_ARGS_MAX    4
+
+typedef struct {
+    const char  * name;
+    void       (* run)(int argc, char ** argv);
+    const char  * help;
+} command_t;
+
+static char           m_line [CONSOLE_LINE_MAX];
+static uint8_t        m_len;
+static volatile bool  m_busy;           // line handed over, not run yet
+
+static int8_t         m_tx_power = 0;   // the SoftDevice's default
+
+/*---------------------------------------------------------------------------*/
+/*  Decimal, optionally negative; false if it is not a number.               */
+/*---------------------------------------------------------------------------*/
+static bool number(const char * s, int32_t * p_value)
+{
+    bool    neg = (*s == '-');
+    int32_t value = 0;
+
+    if (neg)
+        s++;
+    if (*s == '\0')
+        return false;
+
+    for (; *s; s++) {
+        if (*s < '0' || *s > '9')
+            return false;
+        value = (value << 3) + (value << 1) + (*s - '0');
+    }
+
+    *p_value = neg ? -value : value;
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void result(uint32_t err_code)
+{
+    if (err_code == NRF_SUCCESS)
+        PUTS("ok");
+    else
+        PRINTF("error 0x%x\n", (unsigned) err_code);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Commands                                                                 */
+/*---------------------------------------------------------------------------*/
+static void cmd_help(int argc, char ** argv);
+
+static void cmd_diag(int argc, char ** argv)
+{
+    unsigned i;
+
+    PRINTF("wake %u: radio %u ble %u soc %u timer %u button %u\n",
+           (unsigned) g_diag.wake_total, (unsigned) g_diag.wake_radio,
+           (unsigned) g_diag.wake_ble,   (unsigned) g_diag.wake_soc,
+           (unsigned) g_diag.wake_timer, (unsigned) g_diag.wake_button);
+    PRINTF("frames: uid %u url %u tlm %u\n",
+           (unsigned) g_diag.frames_uid, (unsigned) g_diag.frames_url,
+           (unsigned) g_diag.frames_tlm);
+    PRINTF("isr ticks: radio %u ble %u soc %u\n",
+           (unsigned) g_diag.isr_radio, (unsigned) g_diag.isr_ble,
+           (unsigned) g_diag.isr_soc);
+    PRINTF("radio handler: max %u ticks, %u misses\n",
+           (unsigned) g_diag.radio_max, (unsigned) g_diag.radio_misses);
+    PRINTF("config window: %u switches, last %u us\n",
+           (unsigned) g_diag.switch_count, (unsigned) g_diag.switch_us);
+    PRINTF("boot: first advert at %u us\n", (unsigned) g_diag.boot_adv_us);
+    PRINTF("rpa: %u rotations, %u frames late, %u refused\n",
+           (unsigned) g_diag.rpa_rotations, (unsigned) g_diag.rpa_late,
+           (unsigned) g_diag.rpa_failed);
+    for (i = 0; i < EVQ_PRIORITIES; i++) {
+        const evq_stats_t * p = &g_diag.evq[i];
+        PRINTF("evq %s: peak %u, full %u, runs %u, latency max %u avg %u ticks\n",
+               (i == EVQ_HIGH) ? "high" : "low", p->peak, p->overflows,
+               (unsigned) p->runs, (unsigned) p->latency_max,
+               (unsigned) (p->runs ? p->latency_sum / p->runs : 0));
+    }
+    PRINTF("stack %u/%u, heap %u/%u, log dropped %u\n",
+           (unsigned) g_diag.stack_used, (unsigned) g_diag.stack_size,
+           (unsigned) g_diag.heap_used,  (unsigned) g_diag.heap_size,
+           (unsigned) uart_dropped());
+}
+
+static void cmd_adv(int argc, char ** argv)
+{
+    int32_t ms;
+
+    if (argc == 1) {
+        PRINTF("adv %u ms\n", (unsigned) advertising_interval_get());
+        return;
+    }
+    if (!number(argv[1], &ms) || ms < 0 || ms > 0xFFFF) {
+        PUTS("adv [ms]");
+        return;
+    }
+    result(advertising_interval_set((uint16_t) ms));
+}
+
+static void cmd_mix(int argc, char ** argv)
+{
+    int32_t n [3];
+    uint8_t uid, url, tlm;
+    int     i;
+
+    if (argc == 1) {
+        eddystone_mix_get(&uid, &url, &tlm);
+        PRINTF("mix uid %u url %u tlm %u\n", uid, url, tlm);
+        return;
+    }
+    for (i = 0; i < 3; i++) {
+        if (argc != 4 || !number(argv[i + 1], &n[i]) || n[i] < 0 || n[i] > 255) {
+            PUTS("mix [uid url tlm]   radio events per frame, 0 = off");
+            return;
+        }
+    }
+    eddystone_mix_set(n[0], n[1], n[2]);
+    PUTS("ok");
+}
+
+static void cmd_tx(int argc, char ** argv)
+{
+    int32_t  dbm;
+    uint32_t err_code;
+
+    if (argc == 1) {
+        PRINTF("tx %d dBm\n", m_tx_power);
+        return;
+    }
+    if (!number(argv[1], &dbm) || dbm < -128 || dbm > 127) {
+        PUTS("tx [dBm]   -40 -30 -20 -16 -12 -8 -4 0 4");
+        return;
+    }
+    err_code = sd_ble_gap_tx_power_set((int8_t) dbm);
+    if (err_code == NRF_SUCCESS)
+        m_tx_power = dbm;
+    result(err_code);
+}
+
+static void cmd_sample(int argc, char ** argv)
+{
+    uint8_t  adc = battery_adc_get();
+    uint16_t mv  = battery_level_get();
+    int16_t  raw = temperature_raw_get();
+    unsigned mag = (raw < 0) ? -raw : raw;
+
+    /* The die temperature comes in 0.25 C steps. */
+    PRINTF("vbat %u mV (adc %u), temp %s%u.%02u C\n",
+           mv, adc, (raw < 0) ? "-" : "", mag >> 2, (mag & 3) * 25);
+}
+
+static const command_t m_commands [] = {
+    { "help",   cmd_help,   "this list"                          },
+    { "diag",   cmd_diag,   "runtime counters"                   },
+    { "adv",    cmd_adv,    "[ms] advertising interval"          },
+    { "mix",    cmd_mix,    "[uid url tlm] frame mix"            },
+    { "tx",     cmd_tx,     "[dBm] radio TX power"               },
+    { "sample", cmd_sample, "battery and temperature, now"       },
+};
+
+#define COMMAND_COUNT  (sizeof(m_commands) / sizeof(m_commands[0]))
+
+static void cmd_help(int argc, char ** argv)
+{
+    unsigned i;
+
+    for (i = 0; i < COMMAND_COUNT; i++)
+        PRINTF("%-7s %s\n", m_commands[i].name, m_commands[i].help);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  In the scheduler: split the line into words and run the command.         */
+/*---------------------------------------------------------------------------*/
+static void console_execute(uintptr_t arg)
+{
+    char   * argv [CONSOLE_ARGS_MAX];
+    int      argc = 0;
+    char   * p    = m_line;
+    unsigned i;
+
+    while (*p && argc < CONSOLE_ARGS_MAX) {
+        while (*p == ' ')
+            *p++ = '\0';
+        if (*p == '\0')
+            break;
+        argv[argc++] = p;
+        while (*p && *p != ' ')
+            p++;
+    }
+
+    if (argc > 0) {
+        for (i = 0; i < COMMAND_COUNT; i++) {
+            if (strcmp(argv[0], m_commands[i].name) == 0) {
+                m_commands[i].run(argc, argv);
+                break;
+            }
+        }
+        if (i == COMMAND_COUNT)
+            PRINTF("%s? try help\n", argv[0]);
+    }
+
+    m_len  = 0;
+    m_busy = false;
+    PRINTF("> ");
+}
+
+/*---------------------------------------------------------------------------*/
+/*  In the UART interrupt.                                                   */
+/*---------------------------------------------------------------------------*/
+static void console_rx(uint8_t ch)
+{
+    if (m_busy)
+        return;
+
+    switch (ch) {
+
+        case '\r':
+        case '\n':
+            uart_putc('\r');
+            uart_putc('\n');
+            m_line[m_len] = '\0';
+            m_busy = true;
+            if (evq_put(EVQ_LOW, console_execute, 0) != NRF_SUCCESS) {
+                m_len  = 0;
+                m_busy = false;
+            }
+            break;
+
+        case '\b':
+        case 0x7F:
+            if (m_len > 0) {
+                m_len--;
+                uart_putc('\b');
+                uart_putc(' ');
+                uart_putc('\b');
+            }
+            break;
+
+        default:
+            if (ch >= ' ' && ch < 0x7F && m_len < CONSOLE_LINE_MAX - 1) {
+                m_line[m_len++] = ch;
+                uart_putc(ch);
+            }
+            break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  After uart_init().                                                       */
+/*---------------------------------------------------------------------------*/
+void console_init(void)
+{
+    m_len  = 0;
+    m_busy = false;
+
+    uart_rx_start(console_rx);
+
+    PRINTF("> ");
+}
@@ -0,0 +1,15 @@
+/*---------------------------------------------------------------------------*/
+/*  console.h                                                                */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _CONSOLE_H_
+#define _CONSOLE_H_
+
+/*
+ *  Line console on the debug UART, for tuning without a rebuild:
+ *  counters, advertising interval, frame mix, TX power, sensor samples.
+ *  Type "help" for the list.
+ */
+void console_init(void);
+
+#endif  /* _CONSOLE_H_ */
@@ -0,0 +1,110 @@
+/*---------------------------------------------------------------------------*/
+/*  crash.c   crash record in no-init RAM, warm restart                     */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The startup code neither copies nor zeroes .noinit, so whatever was
+ *  written here before a soft reset is still here after it.  After a power
+ *  on the contents are random: magic and check have to agree before any
+ *  of it is believed.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf51_bitfields.h"
+
+#include "config.h"
+#include "crash.h"
+#include "eddystone.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define CRASH_MAGIC     0x48535243      // "CRSH"
+
+static crash_record_t   m_record  __attribute__ ((section(".noinit")));
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t record_check(void)
+{
+    return ~CRASH_MAGIC ^ m_record.count;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Runs just before the reset: no SoftDevice calls, no logging.             */
+/*---------------------------------------------------------------------------*/
+static void record_seal(crash_boot_t boot)
+{
+    eddystone_counters_get(&m_record.adv_cnt, &m_record.sec_cnt);
+
+    m_record.boot    = boot;
+    m_record.pending = true;
+    m_record.magic   = CRASH_MAGIC;
+    m_record.check   = record_check();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  From app_error_handler(), interrupts already off.                        */
+/*---------------------------------------------------------------------------*/
+void crash_error(uint32_t error_code, uint32_t pc, uint32_t line, const uint8_t * p_file)
+{
+    const char * file = (const char *) p_file;
+    size_t       len;
+
+    if (file == NULL)
+        file = "";
+
+    /* Keep the tail: it has the file name, the head is the build path. */
+    len = strlen(file);
+    if (len >= CRASH_FILE_LEN)
+        file += len - (CRASH_FILE_LEN - 1);
+
+    m_record.count++;
+    m_record.error_code = error_code;
+    m_record.pc         = pc;
+    m_record.line       = line;
+    strncpy(m_record.file, file, CRASH_FILE_LEN);
+    m_record.file[CRASH_FILE_LEN - 1] = '\0';
+
+    record_seal(CRASH_BOOT_ERROR);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+crash_record_t * crash_record_get(void)
+{
+    return &m_record;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Early in main(): decide between a cold and a warm boot.                  */
+/*---------------------------------------------------------------------------*/
+crash_boot_t crash_init(uint32_t reset_reason)
+{
+    crash_boot_t boot = CRASH_BOOT_COLD;
+
+    if (m_record.magic != CRASH_MAGIC || m_record.check != record_check()) {
+        /* Power on: start a fresh record. */
+        memset(&m_record, 0, sizeof(m_record));
+        m_record.magic = CRASH_MAGIC;
+        m_record.check = record_check();
+        return CRASH_BOOT_COLD;
+    }
+
+    /* Only resume if we asked for this reset ourselves. */
+    if (m_record.pending && (reset_reason & POWER_RESETREAS_SREQ_Msk)) {
+        boot = m_record.boot;
+        eddystone_counters_set(m_record.adv_cnt, m_record.sec_cnt);
+    }
+
+    m_record.pending = false;
+
+    return boot;
+}
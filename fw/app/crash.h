@@ -0,0 +1,43 @@
+/*---------------------------------------------------------------------------*/
+/*  crash.h                                                                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _CRASH_H_
+#define _CRASH_H_
+
+#include <stdint.h>
+
+/*
+ *  Crash record, kept in the .noinit RAM at the top of RAM (see the linker
+ *  script) so it survives NVIC_SystemReset().  The last one can be read
+ *  from the diagnostics service (characteristic 0xfae2).
+ */
+#define CRASH_FILE_LEN     16
+
+typedef enum {
+    CRASH_BOOT_COLD = 0,        // power on, pin reset, or nothing to resume
+    CRASH_BOOT_ERROR,           // app_error_handler() reset
+} crash_boot_t;
+
+typedef struct {
+    uint32_t  magic;
+    uint8_t   boot;             // crash_boot_t of the reset being recorded
+    uint8_t   pending;          // set before the reset, cleared on boot
+    uint16_t  count;            // error resets since power on
+    uint32_t  error_code;
+    uint32_t  pc;               // caller of app_error_handler()
+    uint16_t  line;
+    char      file [CRASH_FILE_LEN];    // tail of the file name
+    uint16_t  boot_count;       // the diagnostics' count, see diag_boot_count()
+    uint32_t  adv_cnt;          // Eddystone TLM counters at the reset
+    uint32_t  sec_cnt;
+    uint32_t  check;            // ~magic ^ count: catches garbage RAM
+} crash_record_t;
+
+crash_boot_t crash_init(uint32_t reset_reason);
+
+void crash_error(uint32_t error_code, uint32_t pc, uint32_t line, const uint8_t * p_file);
+
+crash_record_t * crash_record_get(void);
+
+#endif  /* _CRASH_H_ */
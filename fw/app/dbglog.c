@@ -0,0 +1,156 @@
+/*---------------------------------------------------------------------------*/
+/*  dbglog.c   tokenized debug log records (DBGLOG_TOKENS)                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  A record is built whole on the stack and then queued in one piece, or
+ *  dropped whole, so records from different interrupt levels never
+ *  interleave and the stream always decodes.
+ *  The fixed part (header, id, eight 5-byte varints) always fits.
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf51.h"
+#include "app_util.h"
+
+#include "uart.h"
+#include "ramlog.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define DBGLOG_RECORD_MAX    64
+
+/* Bytes per dump record: whole lines of the host tool's dump. */
+#define DBGLOG_DUMP_PIECE    48
+
+STATIC_ASSERT(1 + 5 + (5 * DBGLOG_MAX_ARGS) < DBGLOG_RECORD_MAX);
+STATIC_ASSERT(1 + 5 + 1 + DBGLOG_DUMP_PIECE <= DBGLOG_RECORD_MAX);
+
+typedef struct {
+    uint8_t   data [DBGLOG_RECORD_MAX];
+    uint8_t   len;
+} record_t;
+
+/*---------------------------------------------------------------------------*/
+/*  Both return false when the record is full; what fitted is still sent.    */
+/*---------------------------------------------------------------------------*/
+static bool put_byte(record_t * p_rec, uint8_t byte)
+{
+    if (p_rec->len >= DBGLOG_RECORD_MAX)
+        return false;
+
+    p_rec->data[p_rec->len++] = byte;
+    return true;
+}
+
+static bool put_varint(record_t * p_rec, uint32_t value)
+{
+    while (value >= 0x80) {
+        if (!put_byte(p_rec, (value & 0x7F) | 0x80))
+            return false;
+        value >>= 7;
+    }
+    return put_byte(p_rec, value);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void record_send(record_t * p_rec)
+{
+#if defined(DBGLOG_RAM)
+    ramlog_write(p_rec->data, p_rec->len);
+#else
+    (void) uart_write(p_rec->data, p_rec->len);
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Called by PRINTF(): id is the format's offset in .dbglog.                */
+/*---------------------------------------------------------------------------*/
+void dbglog_emit(uint32_t id, uint32_t strings, uint32_t nargs, ...)
+{
+    record_t     rec;
+    va_list      args;
+    uint32_t     i;
+    uint32_t     word;
+    const char * s;
+    uint8_t      n;
+    int          room;
+
+    rec.len = 0;
+
+    put_byte(&rec, DBGLOG_REC_PRINTF | nargs);
+    put_varint(&rec, id);
+
+    va_start(args, nargs);
+
+    for (i = 0; i < nargs; i++) {
+        word = va_arg(args, uint32_t);
+
+        if (strings & (1 << i)) {
+            /*
+             *  Strings are cut short to leave room for the NUL and for the
+             *  arguments still to come, so the record always decodes.
+             */
+            s = (const char *) (uintptr_t) word;
+            if (s == NULL)
+                s = "(null)";
+
+            room = DBGLOG_RECORD_MAX - rec.len - 1 - 5 * (int) (nargs - i - 1);
+            if (room > DBGLOG_MAX_STRING - 1)
+                room = DBGLOG_MAX_STRING - 1;
+
+            for (n = 0; (int) n < room && s[n] != '\0'; n++)
+                put_byte(&rec, s[n]);
+            put_byte(&rec, '\0');
+        }
+        else {
+            put_varint(&rec, word);
+        }
+    }
+
+    va_end(args);
+
+    record_send(&rec);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Raw bytes, a record per piece; the host tool prints the dump.            */
+/*---------------------------------------------------------------------------*/
+void dump_bytes(uint8_t * Buffer, int Length)
+{
+    record_t rec;
+    int      offset = 0;
+    int      count;
+    int      i;
+
+    if (Length < 0)
+        Length = 0;
+
+    do {
+        count = Length - offset;
+        if (count > DBGLOG_DUMP_PIECE)
+            count = DBGLOG_DUMP_PIECE;
+
+        rec.len = 0;
+
+        put_byte(&rec, DBGLOG_REC_DUMP |
+                       ((offset + count < Length) ? DBGLOG_DUMP_MORE : 0));
+        put_varint(&rec, offset);
+        put_varint(&rec, count);
+
+        for (i = 0; i < count; i++)
+            put_byte(&rec, Buffer[offset + i]);
+
+        record_send(&rec);
+
+        offset += count;
+    } while (offset < Length);
+}
@@ -4,7 +4,83 @@
 #ifndef DBGLOG_H
 #define DBGLOG_H
 
-#if defined(DBGLOG_SUPPORT)
+#if defined(DBGLOG_SUPPORT) && defined(DBGLOG_TOKENS)
+
+/*
+ *  Tokenized log: the format string goes in the .dbglog section, which the
+ *  linker script keeps out of the image, and only its offset there is sent
+ *  along with the arguments.  fw/tools/dbglog.py puts the text back
+ *  together from the .elf.
+ *
+ *  Record:  DBGLOG_REC_PRINTF | nargs, varint id, then each argument:
+ *           a varint, or for char pointers the string itself, NUL ended.
+ *           DBGLOG_REC_DUMP, varint offset, varint length, the bytes:
+ *           a long dump goes in pieces of whole 16 byte lines, each but
+ *           the last with DBGLOG_DUMP_MORE set in its first byte.
+ */
+#include <stdint.h>
+
+#define DBGLOG_REC_PRINTF    0xA0
+#define DBGLOG_REC_DUMP      0xB0
+#define DBGLOG_DUMP_MORE     0x01
+
+#define DBGLOG_MAX_ARGS      8
+#define DBGLOG_MAX_STRING    32
+
+void dbglog_emit(uint32_t id, uint32_t strings, uint32_t nargs, ...);
+void dump_bytes(uint8_t * Buffer, int Length);
+
+/* Argument count, 0 to 8. */
+#define DBGLOG_NARGS(...)    DBGLOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DBGLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...)  N
+
+#define DBGLOG_CAT(a, b)     DBGLOG_CAT_(a, b)
+#define DBGLOG_CAT_(a, b)    a ## b
+
+/* 1 for arguments that are strings: those are copied into the record. */
+#define DBGLOG_IS_STR(a)                                                  \
+    (__builtin_types_compatible_p(__typeof__(a), char *)        ||       \
+     __builtin_types_compatible_p(__typeof__(a), const char *)  ||       \
+     __builtin_types_compatible_p(__typeof__(a), char [])       ||       \
+     __builtin_types_compatible_p(__typeof__(a), const char []))
+
+#define DBGLOG_S(a, n)       (DBGLOG_IS_STR(a) << (n))
+#define DBGLOG_W(a)          ((uint32_t) (uintptr_t) (a))
+
+#define DBGLOG_STRINGS(...)  DBGLOG_CAT(DBGLOG_S_, DBGLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define DBGLOG_S_0()                        0
+#define DBGLOG_S_1(a)                       DBGLOG_S(a, 0)
+#define DBGLOG_S_2(a, b)                    DBGLOG_S_1(a) | DBGLOG_S(b, 1)
+#define DBGLOG_S_3(a, b, c)                 DBGLOG_S_2(a, b) | DBGLOG_S(c, 2)
+#define DBGLOG_S_4(a, b, c, d)              DBGLOG_S_3(a, b, c) | DBGLOG_S(d, 3)
+#define DBGLOG_S_5(a, b, c, d, e)           DBGLOG_S_4(a, b, c, d) | DBGLOG_S(e, 4)
+#define DBGLOG_S_6(a, b, c, d, e, f)        DBGLOG_S_5(a, b, c, d, e) | DBGLOG_S(f, 5)
+#define DBGLOG_S_7(a, b, c, d, e, f, g)     DBGLOG_S_6(a, b, c, d, e, f) | DBGLOG_S(g, 6)
+#define DBGLOG_S_8(a, b, c, d, e, f, g, h)  DBGLOG_S_7(a, b, c, d, e, f, g) | DBGLOG_S(h, 7)
+
+#define DBGLOG_WORDS(...)    DBGLOG_CAT(DBGLOG_W_, DBGLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define DBGLOG_W_0()
+#define DBGLOG_W_1(a)                       , DBGLOG_W(a)
+#define DBGLOG_W_2(a, b)                    DBGLOG_W_1(a) DBGLOG_W_1(b)
+#define DBGLOG_W_3(a, b, c)                 DBGLOG_W_2(a, b) DBGLOG_W_1(c)
+#define DBGLOG_W_4(a, b, c, d)              DBGLOG_W_3(a, b, c) DBGLOG_W_1(d)
+#define DBGLOG_W_5(a, b, c, d, e)           DBGLOG_W_4(a, b, c, d) DBGLOG_W_1(e)
+#define DBGLOG_W_6(a, b, c, d, e, f)        DBGLOG_W_5(a, b, c, d, e) DBGLOG_W_1(f)
+#define DBGLOG_W_7(a, b, c, d, e, f, g)     DBGLOG_W_6(a, b, c, d, e, f) DBGLOG_W_1(g)
+#define DBGLOG_W_8(a, b, c, d, e, f, g, h)  DBGLOG_W_7(a, b, c, d, e, f, g) DBGLOG_W_1(h)
+
+#define PRINTF(fmt, ...)                                                  \
+    do {                                                                  \
+        static const char dbglog_fmt [] __attribute__ ((section(".dbglog"), used)) = fmt; \
+        dbglog_emit((uint32_t) (uintptr_t) dbglog_fmt,                    \
+                    DBGLOG_STRINGS(__VA_ARGS__),                          \
+                    DBGLOG_NARGS(__VA_ARGS__)                             \
+                    DBGLOG_WORDS(__VA_ARGS__));                           \
+    } while (0)
+
+#define PUTS(s)              PRINTF("%s\n", (const char *) (s))
+
+#elif defined(DBGLOG_SUPPORT)
 
 #include <stdio.h>
 
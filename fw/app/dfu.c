@@ -0,0 +1,612 @@
+/*---------------------------------------------------------------------------*/
+/*  dfu.c   over-the-air update with delta patches                          */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  There is no room for a second image, so an update is done in three
+ *  steps:
+ *
+ *  1. The patch is received into the staging pages above the image.  Flash
+ *     writes go through the flash queue, between radio events.
+ *  2. VERIFY checks the patch's MAC, then the running image against the
+ *     patch header, then dry runs the whole patch, one page per scheduler
+ *     event, and checks the CRC of the result.  Nothing is written and the
+ *     radio keeps running.
+ *  3. ACTIVATE begins the apply log (dfu_boot.h) and resets.  The DFU boot
+ *     page rebuilds the image in place, page by page, before it starts
+ *     it; a power loss in the second or two that takes is resumed on the
+ *     next boot.
+ *
+ *  The characteristics need an encrypted link, so the central pairs first.
+ *  Pairing is Just Works (no display, no keyboard): encryption without
+ *  MITM protection is all the link can have, and it says nothing about
+ *  who is at the other end.  The patch vouches for itself instead: its
+ *  AES-CMAC is under a key that only this device and whoever makes its
+ *  patches know, written to UICR.CUSTOMER[0..3] when the device is
+ *  programmed (dfupatch.py key).  With no key there, no patch verifies.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf51_bitfields.h"
+#include "nrf_soc.h"
+#include "ble.h"
+#include "ble_gatts.h"
+#include "app_util.h"
+#include "pstorage.h"
+
+#include "config.h"
+#include "evq.h"
+#include "dfu.h"
+#include "dfu_patch.h"
+#include "dfu_boot.h"
+#include "cmac.h"
+#include "ble_eddy.h"
+#include "flash_queue.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+/* The patch, and the apply log after it. */
+#define DFU_STAGE_SIZE             (DFU_STAGE_PAGES * DFU_PATCH_PAGE_SIZE)
+#define DFU_PATCH_MAX              (DFU_STAGE_SIZE - DFU_BOOT_LOG_SIZE)
+
+/* Erased, all ones: not provisioned. */
+#define DFU_KEY                    ((uint8_t const *) (uintptr_t) NRF_UICR->CUSTOMER)
+#define DFU_KEY_WORDS              (CMAC_SIZE / sizeof(uint32_t))
+
+typedef enum {
+    DFU_STATE_IDLE = 0,
+    DFU_STATE_RECEIVING,
+    DFU_STATE_RECEIVED,
+    DFU_STATE_VERIFY_MAC,
+    DFU_STATE_VERIFY_OLD,
+    DFU_STATE_VERIFY_NEW,
+    DFU_STATE_READY,
+    DFU_STATE_ACTIVATING,
+} dfu_state_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+static dfu_state_t          m_state = DFU_STATE_IDLE;
+
+/* Receive double buffer: one filling while the other is written. */
+static uint32_t             m_chunk [2][DFU_CHUNK_SIZE / sizeof(uint32_t)];
+static uint8_t              m_chunk_idx;
+static uint16_t             m_chunk_fill;
+static uint8_t              m_chunks_in_flight;
+
+static uint32_t             m_total;        // patch bytes expected
+static uint32_t             m_received;     // patch bytes taken from the link
+static uint32_t             m_stored;       // patch bytes written to flash
+
+/* Verify progress. */
+static cmac_t               m_cmac;
+static dfu_patch_t          m_patch;
+static uint32_t             m_offset;
+static uint32_t             m_crc;
+
+static bool                 m_notify_pending = false;
+static uint8_t              m_notify [5];
+
+/* Flash queue source: must stay put until the write is done. */
+static uint32_t             m_log_begin = DFU_BOOT_LOG_BEGIN;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static dfu_patch_header_t const * stage_header(void)
+{
+    return (dfu_patch_header_t const *) DFU_STAGE_ADDR;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The MBR starts the boot page, and it is the one this image knows.        */
+/*---------------------------------------------------------------------------*/
+static bool boot_installed(void)
+{
+    uint32_t const * p_magic = (uint32_t const *) DFU_BOOT_MAGIC_ADDR;
+
+    return NRF_UICR->BOOTLOADERADDR == DFU_BOOT_ADDR &&
+           p_magic[0] == DFU_BOOT_MAGIC && p_magic[1] == DFU_BOOT_VERSION;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static bool key_provisioned(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < DFU_KEY_WORDS; i++)
+        if (NRF_UICR->CUSTOMER[i] != 0xFFFFFFFF)
+            return true;
+
+    return false;
+}
+
+/* Every byte compared, however early they differ. */
+static bool mac_equal(uint8_t const * p_a, uint8_t const * p_b)
+{
+    uint8_t diff = 0;
+    int     i;
+
+    for (i = 0; i < CMAC_SIZE; i++)
+        diff |= p_a[i] ^ p_b[i];
+
+    return diff == 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void notify_send(void)
+{
+    ble_gatts_hvx_params_t hvx;
+    uint16_t               len = sizeof(m_notify);
+
+    memset(&hvx, 0, sizeof(hvx));
+    hvx.handle = g_eddy_service.dfu_ctrl_handles.value_handle;
+    hvx.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx.p_len  = &len;
+    hvx.p_data = m_notify;
+
+    /* Out of buffers: resend (the newest event) on TX complete. */
+    m_notify_pending =
+        (sd_ble_gatts_hvx(g_eddy_service.conn_handle, &hvx) == BLE_ERROR_NO_TX_BUFFERS);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void dfu_notify(uint8_t event, uint32_t value)
+{
+    m_notify[0] = event;
+    uint32_encode(value, &m_notify[1]);
+
+    notify_send();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void dfu_fail(dfu_error_t error)
+{
+    PRINTF("dfu: error %d\n", error);
+
+    m_state = DFU_STATE_IDLE;
+
+    dfu_notify(DFU_EVT_ERROR, error);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The next step, from the scheduler.  If the queue is full, the command    */
+/*  is refused, from the state it can be sent again in.                      */
+/*---------------------------------------------------------------------------*/
+static void dfu_next(evq_handler_t handler, dfu_state_t retry_state)
+{
+    if (evq_put(EVQ_LOW, handler, 0) == NRF_SUCCESS)
+        return;
+
+    PUTS("dfu: event queue full");
+
+    m_state = retry_state;
+
+    dfu_notify(DFU_EVT_ERROR, DFU_ERROR_BUSY);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Flash queue context.  Chunks complete in the order they were queued.     */
+/*---------------------------------------------------------------------------*/
+static void dfu_flash_cb(uint32_t result, void * p_context)
+{
+    uint32_t size = (uint32_t) (uintptr_t) p_context;
+
+    if (m_chunks_in_flight > 0)
+        m_chunks_in_flight--;
+
+    if (m_state != DFU_STATE_RECEIVING)
+        return;
+
+    if (result != NRF_SUCCESS) {
+        dfu_fail(DFU_ERROR_FLASH);
+        return;
+    }
+
+    m_stored += size;
+
+    if (m_stored >= m_total) {
+        m_stored = m_total;
+        m_state  = DFU_STATE_RECEIVED;
+        PUTS("dfu: patch received");
+    }
+
+    dfu_notify(DFU_EVT_STORED, m_stored);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void chunk_flush(void)
+{
+    uint8_t * p_chunk = (uint8_t *) m_chunk[m_chunk_idx];
+    uint32_t  offset  = m_received - m_chunk_fill;
+
+    memset(&p_chunk[m_chunk_fill], 0xFF, DFU_CHUNK_SIZE - m_chunk_fill);
+
+    APP_ERROR_CHECK( flash_queue_write((uint32_t *) (uintptr_t) (DFU_STAGE_ADDR + offset),
+                                       m_chunk[m_chunk_idx],
+                                       (m_chunk_fill + 3) / sizeof(uint32_t),
+                                       dfu_flash_cb,
+                                       (void *) (uintptr_t) m_chunk_fill) );
+    m_chunks_in_flight++;
+
+    m_chunk_idx ^= 1;
+    m_chunk_fill = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void dfu_on_packet_write(uint8_t const * p_data, uint16_t len)
+{
+    uint16_t n;
+
+    if (m_state != DFU_STATE_RECEIVING) {
+        dfu_fail(DFU_ERROR_STATE);
+        return;
+    }
+
+    if (len > m_total - m_received) {
+        dfu_fail(DFU_ERROR_LENGTH);
+        return;
+    }
+
+    while (len > 0) {
+
+        /* The current buffer is still being written: the sender overran. */
+        if (m_chunk_fill == 0 && m_chunks_in_flight == 2) {
+            dfu_fail(DFU_ERROR_OVERRUN);
+            return;
+        }
+
+        n = MIN(len, DFU_CHUNK_SIZE - m_chunk_fill);
+
+        memcpy((uint8_t *) m_chunk[m_chunk_idx] + m_chunk_fill, p_data, n);
+
+        m_chunk_fill += n;
+        m_received   += n;
+        p_data       += n;
+        len          -= n;
+
+        if (m_chunk_fill == DFU_CHUNK_SIZE || m_received == m_total)
+            chunk_flush();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Scheduler context, one page per event so the main loop keeps going.      */
+/*---------------------------------------------------------------------------*/
+static void dfu_verify_step(uintptr_t arg)
+{
+    dfu_patch_header_t const * p_header = stage_header();
+    uint8_t                  * p_buf    = (uint8_t *) m_chunk;
+    uint32_t                   signed_len;
+    uint32_t                   n;
+    int32_t                    produced;
+    uint8_t                    mac [CMAC_SIZE];
+
+    if (m_state == DFU_STATE_VERIFY_MAC) {
+
+        /* Header and ops, and the MAC after them. */
+        signed_len = sizeof(dfu_patch_header_t) + p_header->body_len;
+
+        n = MIN(DFU_PATCH_PAGE_SIZE, signed_len - m_offset);
+
+        cmac_update(&m_cmac, (uint8_t const *) (uintptr_t) (DFU_STAGE_ADDR + m_offset), n);
+        m_offset += n;
+
+        if (m_offset == signed_len) {
+            cmac_end(&m_cmac, mac);
+            if (!mac_equal(mac, (uint8_t const *) (uintptr_t) (DFU_STAGE_ADDR + signed_len))) {
+                dfu_fail(DFU_ERROR_PATCH);
+                return;
+            }
+
+            m_offset = 0;
+            m_state  = DFU_STATE_VERIFY_OLD;
+        }
+    }
+    else if (m_state == DFU_STATE_VERIFY_OLD) {
+
+        n = MIN(DFU_PATCH_PAGE_SIZE, p_header->old_len - m_offset);
+
+        m_crc     = dfu_crc32(m_crc, (uint8_t const *) (uintptr_t) (DFU_IMAGE_ADDR + m_offset), n);
+        m_offset += n;
+
+        if (m_offset == p_header->old_len) {
+            if (m_crc != p_header->old_crc) {
+                dfu_fail(DFU_ERROR_OLD_IMAGE);
+                return;
+            }
+
+            dfu_patch_begin(&m_patch, p_header,
+                            (uint8_t const *) (p_header + 1),
+                            (uint8_t const *) DFU_IMAGE_ADDR);
+            m_offset = 0;
+            m_crc    = 0;
+            m_state  = DFU_STATE_VERIFY_NEW;
+        }
+    }
+    else if (m_state == DFU_STATE_VERIFY_NEW) {
+
+        /* The receive buffers are free now; use them as scratch.  This
+           fails on a COPY that the in-place apply could not do, too. */
+        n = MIN(sizeof(m_chunk), p_header->new_len - m_offset);
+
+        produced = dfu_patch_run(&m_patch, p_buf, n);
+        if (produced != (int32_t) n) {
+            dfu_fail(DFU_ERROR_PATCH);
+            return;
+        }
+
+        m_crc     = dfu_crc32(m_crc, p_buf, n);
+        m_offset += n;
+
+        if (m_offset == p_header->new_len) {
+            if (m_patch.pos != m_patch.body_len || m_patch.left != 0) {
+                dfu_fail(DFU_ERROR_PATCH);
+                return;
+            }
+            if (m_crc != p_header->new_crc) {
+                dfu_fail(DFU_ERROR_NEW_IMAGE);
+                return;
+            }
+
+            m_state = DFU_STATE_READY;
+            PRINTF("dfu: ready, %u -> %u bytes\n",
+                   (unsigned) p_header->old_len, (unsigned) p_header->new_len);
+            dfu_notify(DFU_EVT_VERIFIED, m_crc);
+            return;
+        }
+    }
+    else {
+        return;     /* aborted */
+    }
+
+    dfu_next(dfu_verify_step, DFU_STATE_RECEIVED);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Flash queue context: the boot page takes it from here.                   */
+/*---------------------------------------------------------------------------*/
+static void dfu_activate_cb(uint32_t result, void * p_context)
+{
+    if (result != NRF_SUCCESS) {
+        dfu_fail(DFU_ERROR_FLASH);
+        return;
+    }
+
+    PUTS("dfu: activated, resetting");
+    NVIC_SystemReset();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Scheduler context.  The journal is pstorage's swap page: wait until     */
+/*  pstorage and the queue are done with the flash.                          */
+/*---------------------------------------------------------------------------*/
+static void dfu_activate(uintptr_t arg)
+{
+    uint32_t count;
+
+    if (m_state != DFU_STATE_ACTIVATING)
+        return;     /* aborted */
+
+    APP_ERROR_CHECK( pstorage_access_status_get(&count) );
+
+    if (count != 0 || flash_queue_busy()) {
+        dfu_next(dfu_activate, DFU_STATE_READY);
+        return;
+    }
+
+    PUTS("dfu: activating");
+
+    APP_ERROR_CHECK( flash_queue_write(DFU_BOOT_LOG(stage_header()), &m_log_begin, 1,
+                                       dfu_activate_cb, NULL) );
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void dfu_start(uint32_t len)
+{
+    if (m_state >= DFU_STATE_VERIFY_OLD && m_state != DFU_STATE_READY) {
+        dfu_fail(DFU_ERROR_STATE);
+        return;
+    }
+
+    if (len < sizeof(dfu_patch_header_t) + DFU_PATCH_MAC_SIZE || len > DFU_PATCH_MAX) {
+        dfu_fail(DFU_ERROR_LENGTH);
+        return;
+    }
+
+    if (m_chunks_in_flight != 0) {
+        dfu_fail(DFU_ERROR_STATE);
+        return;
+    }
+
+    APP_ERROR_CHECK( flash_queue_erase((uint32_t *) DFU_STAGE_ADDR, DFU_STAGE_PAGES,
+                                       NULL, NULL) );
+
+    m_total       = len;
+    m_received    = 0;
+    m_stored      = 0;
+    m_chunk_idx   = 0;
+    m_chunk_fill  = 0;
+    m_state       = DFU_STATE_RECEIVING;
+
+    PRINTF("dfu: start, %u bytes\n", (unsigned) len);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void dfu_verify(void)
+{
+    dfu_patch_header_t const * p_header = stage_header();
+
+    if (m_state != DFU_STATE_RECEIVED) {
+        dfu_fail(DFU_ERROR_STATE);
+        return;
+    }
+
+    if (p_header->magic   != DFU_PATCH_MAGIC                           ||
+        p_header->body_len != m_total - sizeof(dfu_patch_header_t) -
+                              DFU_PATCH_MAC_SIZE                       ||
+        p_header->old_len  == 0 || p_header->old_len > DFU_IMAGE_MAX   ||
+        p_header->new_len  == 0 || p_header->new_len > DFU_IMAGE_MAX) {
+        dfu_fail(DFU_ERROR_HEADER);
+        return;
+    }
+
+    if (!key_provisioned()) {
+        dfu_fail(DFU_ERROR_PATCH);
+        return;
+    }
+
+    cmac_begin(&m_cmac, DFU_KEY);
+
+    m_offset = 0;
+    m_crc    = 0;
+    m_state  = DFU_STATE_VERIFY_MAC;
+
+    dfu_next(dfu_verify_step, DFU_STATE_RECEIVED);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void dfu_on_ctrl_write(uint8_t const * p_data, uint16_t len)
+{
+    if (len == 0)
+        return;
+
+    switch (p_data[0]) {
+
+        case DFU_CMD_START:
+            if (len < 5) {
+                dfu_fail(DFU_ERROR_LENGTH);
+                break;
+            }
+            dfu_start(uint32_decode(&p_data[1]));
+            break;
+
+        case DFU_CMD_VERIFY:
+            dfu_verify();
+            break;
+
+        case DFU_CMD_ACTIVATE:
+            if (m_state != DFU_STATE_READY) {
+                dfu_fail(DFU_ERROR_STATE);
+                break;
+            }
+            if (!boot_installed()) {
+                dfu_fail(DFU_ERROR_BOOT);
+                break;
+            }
+            m_state = DFU_STATE_ACTIVATING;
+            dfu_next(dfu_activate, DFU_STATE_READY);
+            break;
+
+        case DFU_CMD_ABORT:
+            m_state = DFU_STATE_IDLE;
+            break;
+
+        default:
+            dfu_fail(DFU_ERROR_STATE);
+            break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void dfu_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id) {
+
+        case BLE_EVT_TX_COMPLETE:
+            if (m_notify_pending)
+                notify_send();
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            /* A verified patch may still be activated after a reconnect. */
+            if (m_state == DFU_STATE_RECEIVING)
+                m_state = DFU_STATE_IDLE;
+            m_notify_pending = false;
+            break;
+
+        default:
+            /* No implementation needed. */
+            break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void dfu_init(void)
+{
+    m_state = DFU_STATE_IDLE;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Before the SoftDevice is enabled: the NVMC is ours.  The boot page is    */
+/*  written, and checked, before UICR points the MBR at it, so a power loss  */
+/*  here leaves the next boot to try again.  Once installed it stays: a new  */
+/*  image cannot replace the code that would resume its own apply.  The      */
+/*  host build has no boot page to install.                                  */
+/*---------------------------------------------------------------------------*/
+void dfu_install_boot(void)
+{
+#if defined(__arm__)
+    extern uint32_t const __dfu_boot_load [];
+    extern uint32_t const __dfu_boot_start [];
+    extern uint32_t const __dfu_boot_end [];
+
+    uint32_t         words  = __dfu_boot_end - __dfu_boot_start;
+    uint32_t const * p_boot = (uint32_t const *) DFU_BOOT_ADDR;
+    uint32_t         i;
+
+    if (NRF_UICR->BOOTLOADERADDR != 0xFFFFFFFF)
+        return;
+
+    NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Een << NVMC_CONFIG_WEN_Pos;
+    NRF_NVMC->ERASEPAGE = DFU_BOOT_ADDR;
+    while (NRF_NVMC->READY == NVMC_READY_READY_Busy) { }
+
+    NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Wen << NVMC_CONFIG_WEN_Pos;
+    for (i = 0; i < words; i++) {
+        ((uint32_t volatile *) p_boot)[i] = __dfu_boot_load[i];
+        while (NRF_NVMC->READY == NVMC_READY_READY_Busy) { }
+    }
+
+    for (i = 0; i < words; i++)
+        if (p_boot[i] != __dfu_boot_load[i])
+            break;
+
+    if (i == words) {
+        NRF_UICR->BOOTLOADERADDR = DFU_BOOT_ADDR;
+        while (NRF_NVMC->READY == NVMC_READY_READY_Busy) { }
+    }
+
+    NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Ren << NVMC_CONFIG_WEN_Pos;
+#endif
+}
@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------*/
+/*  dfu.h                                                                    */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _DFU_H_
+#define _DFU_H_
+
+#include <stdint.h>
+
+#include "ble.h"
+
+/*
+ *  Over-the-air update with delta patches (see dfu_patch.h).
+ *
+ *  Control point (write, notify):
+ *    01 <u32 len>   START: erase the staging area, expect len patch bytes
+ *    02             VERIFY: check the patch against the running image
+ *    03             ACTIVATE: reset into the DFU boot page, which applies it
+ *    04             ABORT
+ *
+ *  Packet (write without response): the patch file, header first and its
+ *  MAC last (dfu_patch.h), made for this device's DFU key.  The sender
+ *  keeps at most DFU_WINDOW bytes beyond the last STORED offset.
+ *
+ *  Notifications: <u8 event> <u32 value>
+ */
+#define DFU_CMD_START              0x01
+#define DFU_CMD_VERIFY             0x02
+#define DFU_CMD_ACTIVATE           0x03
+#define DFU_CMD_ABORT              0x04
+
+#define DFU_EVT_STORED             0x81    // value: patch bytes in flash
+#define DFU_EVT_VERIFIED           0x82    // value: CRC32 of the new image
+#define DFU_EVT_ERROR              0x8F    // value: dfu_error_t
+
+#define DFU_CHUNK_SIZE             128
+#define DFU_WINDOW                 (2 * DFU_CHUNK_SIZE)
+
+typedef enum {
+    DFU_ERROR_STATE = 1,       // command not valid now
+    DFU_ERROR_LENGTH,          // patch does not fit the staging area
+    DFU_ERROR_OVERRUN,         // sender ignored the window
+    DFU_ERROR_FLASH,
+    DFU_ERROR_HEADER,          // bad magic, or new image too large
+    DFU_ERROR_OLD_IMAGE,       // patch was made against another image
+    DFU_ERROR_PATCH,           // wrong MAC, no key, or malformed op stream
+    DFU_ERROR_NEW_IMAGE,       // result does not match new_crc
+    DFU_ERROR_BOOT,            // the DFU boot page is not installed
+    DFU_ERROR_BUSY,            // event queue full: send the command again
+} dfu_error_t;
+
+void dfu_init(void);
+void dfu_install_boot(void);
+
+void dfu_on_ctrl_write(uint8_t const * p_data, uint16_t len);
+void dfu_on_packet_write(uint8_t const * p_data, uint16_t len);
+void dfu_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif  /* _DFU_H_ */
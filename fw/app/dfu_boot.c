@@ -0,0 +1,211 @@
+/*---------------------------------------------------------------------------*/
+/*  dfu_boot.c   the DFU boot page: resumes an apply, then starts the image  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Linked to run at DFU_BOOT_ADDR (see the linker script and the makefile)
+ *  and calls nothing outside this file: not the image, which it rewrites,
+ *  nor the C library.  It keeps everything on the stack, as no startup
+ *  code runs before it.  The patch applier is its own static copy.
+ *
+ *  With DFU_BOOT_HOST defined (fw/tools/dfu) there is no vector table and
+ *  the flash primitives are the host's.
+ */
+#include <stdint.h>
+
+#define DFU_PATCH_API              static __attribute__((unused))
+
+#include "config.h"
+#include "dfu_boot.h"
+#include "dfu_patch.c"
+
+#if !defined(DFU_BOOT_HOST)
+  #include "nrf51.h"
+  #include "nrf51_bitfields.h"
+  #include "nrf_mbr.h"
+  #include "nrf_sdm.h"
+#endif
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define ERASED                     0xFFFFFFFF
+
+#define PAGE_WORDS                 (DFU_PATCH_PAGE_SIZE / sizeof(uint32_t))
+
+#define BODY_MAX                   (DFU_STAGE_PAGES * DFU_PATCH_PAGE_SIZE -  \
+                                    sizeof(dfu_patch_header_t) -           \
+                                    DFU_PATCH_MAC_SIZE - DFU_BOOT_LOG_SIZE)
+
+/*---------------------------------------------------------------------------*/
+/*  NVMC, directly: the SoftDevice is not running yet.                       */
+/*---------------------------------------------------------------------------*/
+#if defined(DFU_BOOT_HOST)
+
+void dfu_boot_flash_erase(uint32_t addr);
+void dfu_boot_flash_write(uint32_t addr, uint32_t word);
+
+#else
+
+static void dfu_boot_flash_erase(uint32_t addr)
+{
+    NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Een << NVMC_CONFIG_WEN_Pos;
+    NRF_NVMC->ERASEPAGE = addr;
+    while (NRF_NVMC->READY == NVMC_READY_READY_Busy) { }
+    NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Ren << NVMC_CONFIG_WEN_Pos;
+}
+
+static void dfu_boot_flash_write(uint32_t addr, uint32_t word)
+{
+    NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Wen << NVMC_CONFIG_WEN_Pos;
+    *(volatile uint32_t *) (uintptr_t) addr = word;
+    while (NRF_NVMC->READY == NVMC_READY_READY_Busy) { }
+    NRF_NVMC->CONFIG = NVMC_CONFIG_WEN_Ren << NVMC_CONFIG_WEN_Pos;
+}
+
+#endif
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void page_program(uint32_t addr, uint32_t const * p_page)
+{
+    uint32_t i;
+
+    dfu_boot_flash_erase(addr);
+
+    for (i = 0; i < PAGE_WORDS; i++)
+        dfu_boot_flash_write(addr + i * sizeof(uint32_t), p_page[i]);
+}
+
+static void log_write(uint32_t const * p_log, uint32_t record)
+{
+    dfu_boot_flash_write((uint32_t) (uintptr_t) &p_log[record], DFU_BOOT_LOG_DONE);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void dfu_boot_resume(void)
+{
+    dfu_patch_header_t const * p_header = (dfu_patch_header_t const *) DFU_STAGE_ADDR;
+    uint32_t                   page [PAGE_WORDS];
+    dfu_patch_t                patch;
+    uint32_t const           * p_log;
+    uint32_t                   pages;
+    uint32_t                   record;
+    uint32_t                   k;
+    int32_t                    produced;
+
+    /* Only a patch that ACTIVATE began: VERIFY has been through it. */
+    if (p_header->magic != DFU_PATCH_MAGIC ||
+        p_header->body_len > BODY_MAX      ||
+        p_header->new_len == 0 || p_header->new_len > DFU_IMAGE_MAX)
+        return;
+
+    p_log = DFU_BOOT_LOG(p_header);
+    if (p_log[0] != DFU_BOOT_LOG_BEGIN)
+        return;
+
+    pages = (p_header->new_len + DFU_PATCH_PAGE_SIZE - 1) / DFU_PATCH_PAGE_SIZE;
+
+    for (record = 1; record <= 1 + 2 * pages; record++)
+        if (p_log[record] == ERASED)
+            break;
+
+    if (record > 1 + 2 * pages)
+        return;     /* done */
+
+    k = (record - 1) / 2;
+
+    if (record == 1 + 2 * pages) {
+        dfu_boot_flash_erase(DFU_JOURNAL_ADDR);
+        log_write(p_log, record);
+        return;
+    }
+
+    /* The journal holds page k, which may be half written: write it again. */
+    if (record % 2 == 0) {
+        page_program(DFU_IMAGE_ADDR + k * DFU_PATCH_PAGE_SIZE,
+                     (uint32_t const *) DFU_JOURNAL_ADDR);
+        log_write(p_log, record);
+        k++;
+    }
+
+    /* The pages before k are new: step over their ops without reading them. */
+    dfu_patch_begin(&patch, p_header,
+                    (uint8_t const *) (p_header + 1),
+                    (uint8_t const *) DFU_IMAGE_ADDR);
+
+    if (k > 0 && dfu_patch_run(&patch, NULL, k * DFU_PATCH_PAGE_SIZE) < 0)
+        return;     /* verified beforehand: cannot happen */
+
+    for (; k < pages; k++) {
+
+        produced = dfu_patch_run(&patch, (uint8_t *) page, DFU_PATCH_PAGE_SIZE);
+        if (produced < 0)
+            return;
+
+        for (; produced < DFU_PATCH_PAGE_SIZE; produced++)
+            ((uint8_t *) page)[produced] = 0xFF;
+
+        page_program(DFU_JOURNAL_ADDR, page);
+        log_write(p_log, 1 + 2 * k);
+
+        page_program(DFU_IMAGE_ADDR + k * DFU_PATCH_PAGE_SIZE, page);
+        log_write(p_log, 2 + 2 * k);
+    }
+
+    dfu_boot_flash_erase(DFU_JOURNAL_ADDR);
+    log_write(p_log, 1 + 2 * pages);
+}
+
+#if !defined(DFU_BOOT_HOST)
+
+/*---------------------------------------------------------------------------*/
+/*  The image starts as it does from the MBR when there is no boot page.     */
+/*---------------------------------------------------------------------------*/
+static void __attribute__((noreturn)) image_start(void)
+{
+    uint32_t const   * p_vectors = (uint32_t const *) DFU_IMAGE_ADDR;
+    sd_mbr_command_t   command;
+
+    command.command = SD_MBR_COMMAND_INIT_SD;
+    (void) sd_mbr_command(&command);
+    (void) sd_softdevice_vector_table_base_set(DFU_IMAGE_ADDR);
+
+    __asm volatile ("msr msp, %0  \n"
+                    "bx  %1       \n"
+                    : : "r" (p_vectors[0]), "r" (p_vectors[1]));
+    for (;;) { }
+}
+
+static void __attribute__((noreturn)) dfu_boot_reset(void)
+{
+    dfu_boot_resume();
+    image_start();
+}
+
+/* No interrupt is enabled here: anything else is a fault, so start over. */
+static void dfu_boot_fault(void)
+{
+    SCB->AIRCR = (0x5FAUL << SCB_AIRCR_VECTKEY_Pos) | SCB_AIRCR_SYSRESETREQ_Msk;
+    for (;;) { }
+}
+
+extern uint32_t __StackTop;
+
+static const struct {
+    uint32_t   * p_stack;
+    void      (* handlers [DFU_BOOT_VECTORS - 1])(void);
+    uint32_t     magic;
+    uint32_t     version;
+} m_vectors __attribute__((used, section(".dfu_boot_vectors"))) = {
+    .p_stack  = &__StackTop,
+    .handlers = { [0] = dfu_boot_reset, [1 ... DFU_BOOT_VECTORS - 2] = dfu_boot_fault },
+    .magic    = DFU_BOOT_MAGIC,
+    .version  = DFU_BOOT_VERSION,
+};
+
+#endif
@@ -0,0 +1,55 @@
+/*---------------------------------------------------------------------------*/
+/*  dfu_boot.h                                                               */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _DFU_BOOT_H_
+#define _DFU_BOOT_H_
+
+#include <stdint.h>
+
+#include "config.h"
+#include "dfu_patch.h"
+
+/*
+ *  The DFU boot page, at DFU_BOOT_ADDR.  The MBR starts it at every reset
+ *  (UICR.BOOTLOADERADDR points at it); it finishes an apply that ACTIVATE
+ *  began, then starts the image.  It is the one piece of code that an
+ *  update never rewrites, so a power loss part way through the apply is
+ *  resumed on the next boot rather than leaving half an image.
+ *
+ *  The image carries the boot page's code; dfu_install_boot() (dfu.c)
+ *  copies it to DFU_BOOT_ADDR once, on the first boot.
+ *
+ *  Each image page is built in RAM, then written to the journal (the
+ *  pstorage swap page, idle during the apply), then to the image.  The
+ *  apply log, in the staging pages right after the patch, records the
+ *  steps: a word when ACTIVATE begins the apply, two per image page,
+ *  written once the journal holds the page and once the page is written,
+ *  and one when the journal is erased again.  Each record is written
+ *  after the step it records, so any word that is not erased counts, and
+ *  the first erased one is where the apply stopped.
+ */
+
+#define DFU_BOOT_MAGIC             0x544F4244   /* "DBOT" */
+#define DFU_BOOT_VERSION           1
+
+/* Cortex-M0 exceptions and the nRF51's 32 interrupts, then magic, version. */
+#define DFU_BOOT_VECTORS           (16 + 32)
+#define DFU_BOOT_MAGIC_ADDR        (DFU_BOOT_ADDR + DFU_BOOT_VECTORS * sizeof(uint32_t))
+
+#define DFU_BOOT_LOG_BEGIN         0x4E474542   /* "BEGN" */
+#define DFU_BOOT_LOG_DONE          0
+#define DFU_BOOT_LOG_WORDS         (2 + 2 * (DFU_IMAGE_MAX / DFU_PATCH_PAGE_SIZE))
+#define DFU_BOOT_LOG_SIZE          (DFU_BOOT_LOG_WORDS * sizeof(uint32_t))
+
+/* The first word after the patch and its MAC. */
+#define DFU_BOOT_LOG(p_header)                                                \
+        ((uint32_t *) (uintptr_t) (DFU_STAGE_ADDR +                           \
+         ((sizeof(dfu_patch_header_t) + (p_header)->body_len +                \
+           DFU_PATCH_MAC_SIZE + 3) & ~3UL)))
+
+/* Finish the apply the log describes, if any.  From the boot page's reset
+   handler, before the SoftDevice; fw/tools/dfu runs it on the host. */
+void dfu_boot_resume(void);
+
+#endif  /* _DFU_BOOT_H_ */
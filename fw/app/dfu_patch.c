@@ -0,0 +1,210 @@
+/*---------------------------------------------------------------------------*/
+/*  dfu_patch.c   delta patch applier (builds on the host as well)          */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dfu_patch.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int patch_varint(dfu_patch_t * p_patch, uint32_t * p_value)
+{
+    uint32_t value = 0;
+    uint8_t  shift = 0;
+    uint8_t  b;
+
+    do {
+        if (p_patch->pos >= p_patch->body_len || shift > 28)
+            return -1;
+
+        b = p_patch->p_body[p_patch->pos++];
+        value |= (uint32_t) (b & 0x7F) << shift;
+        shift += 7;
+
+    } while (b & 0x80);
+
+    *p_value = value;
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Decode the next op into p_patch->op/left; SEEKs are applied here.        */
+/*---------------------------------------------------------------------------*/
+static int patch_next_op(dfu_patch_t * p_patch)
+{
+    uint32_t len;
+    uint8_t  b;
+
+    for (;;) {
+        if (p_patch->pos >= p_patch->body_len)
+            return 0;
+
+        b = p_patch->p_body[p_patch->pos++];
+
+        p_patch->op = b >> 6;
+        len         = b & 0x3F;
+
+        if (p_patch->op == DFU_OP_SEEK) {
+            if (patch_varint(p_patch, &len) < 0)
+                return -1;
+            /* zigzag decode */
+            p_patch->src += (len >> 1) ^ (uint32_t) -(int32_t) (len & 1);
+            continue;
+        }
+
+        if (len == 0x3F) {
+            if (patch_varint(p_patch, &len) < 0)
+                return -1;
+            len += 0x40;
+        }
+        else {
+            len += 1;
+        }
+
+        switch (p_patch->op) {
+
+            case DFU_OP_COPY:
+                if (p_patch->src > p_patch->old_len || len > p_patch->old_len - p_patch->src)
+                    return -1;
+                break;
+
+            case DFU_OP_INSERT:
+                if (len > p_patch->body_len - p_patch->pos)
+                    return -1;
+                break;
+
+            default:
+                if (p_patch->pos >= p_patch->body_len)
+                    return -1;
+                p_patch->fill = p_patch->p_body[p_patch->pos++];
+                break;
+        }
+
+        p_patch->left = len;
+        return 1;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Applied in place, the pages before the one being built are new: a COPY   */
+/*  of n bytes to offset out reads none of them.                             */
+/*---------------------------------------------------------------------------*/
+static int copy_in_place(dfu_patch_t const * p_patch, uint32_t out, uint32_t n)
+{
+    uint32_t page = out - out % DFU_PATCH_PAGE_SIZE;
+
+    if (p_patch->src < page)
+        return 0;
+
+    /* Into the next page, the source must keep up with the output. */
+    if (out + n > page + DFU_PATCH_PAGE_SIZE && p_patch->src < out)
+        return 0;
+
+    return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+DFU_PATCH_API void dfu_patch_begin(dfu_patch_t              * p_patch,
+                                   dfu_patch_header_t const * p_header,
+                                   uint8_t const            * p_body,
+                                   uint8_t const            * p_old)
+{
+    p_patch->p_body   = p_body;
+    p_patch->body_len = p_header->body_len;
+    p_patch->pos      = 0;
+    p_patch->p_old    = p_old;
+    p_patch->old_len  = p_header->old_len;
+    p_patch->src      = 0;
+    p_patch->out      = 0;
+    p_patch->left     = 0;
+    p_patch->op       = DFU_OP_COPY;
+    p_patch->fill     = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+DFU_PATCH_API int32_t dfu_patch_run(dfu_patch_t * p_patch, uint8_t * p_out, uint32_t len)
+{
+    uint32_t done = 0;
+    uint32_t n;
+    int      rc;
+
+    while (done < len) {
+
+        if (p_patch->left == 0) {
+            rc = patch_next_op(p_patch);
+            if (rc < 0)
+                return -1;
+            if (rc == 0)
+                break;
+        }
+
+        n = len - done;
+        if (n > p_patch->left)
+            n = p_patch->left;
+
+        p_patch->left -= n;
+
+        switch (p_patch->op) {
+
+            case DFU_OP_COPY:
+                if (!copy_in_place(p_patch, p_patch->out + done, n))
+                    return -1;
+                if (p_out == NULL) {
+                    p_patch->src += n;
+                    done         += n;
+                    break;
+                }
+                while (n--)
+                    p_out[done++] = p_patch->p_old[p_patch->src++];
+                break;
+
+            case DFU_OP_INSERT:
+                if (p_out == NULL) {
+                    p_patch->pos += n;
+                    done         += n;
+                    break;
+                }
+                while (n--)
+                    p_out[done++] = p_patch->p_body[p_patch->pos++];
+                break;
+
+            default:
+                if (p_out == NULL) {
+                    done += n;
+                    break;
+                }
+                while (n--)
+                    p_out[done++] = p_patch->fill;
+                break;
+        }
+    }
+
+    p_patch->out += done;
+
+    return (int32_t) done;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  CRC-32 (IEEE 802.3), bitwise: no table in flash.                         */
+/*---------------------------------------------------------------------------*/
+DFU_PATCH_API uint32_t dfu_crc32(uint32_t crc, uint8_t const * p_data, uint32_t len)
+{
+    uint8_t bit;
+
+    crc = ~crc;
+
+    while (len--) {
+        crc ^= *p_data++;
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+
+    return ~crc;
+}
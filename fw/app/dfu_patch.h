@@ -0,0 +1,84 @@
+/*---------------------------------------------------------------------------*/
+/*  dfu_patch.h                                                              */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _DFU_PATCH_H_
+#define _DFU_PATCH_H_
+
+#include <stdint.h>
+
+/*
+ *  Delta patch applier.  No SDK dependencies: the same file builds on the
+ *  host, where fw/tools/dfupatch.py produces and checks patches, and
+ *  fw/tools/dfu runs them.
+ *
+ *  A patch is a header followed by a stream of ops that rebuild the new
+ *  image front to back, then the AES-CMAC of the two under the device's
+ *  DFU key (dfu.c).  Each op byte is tt:llllll, with length l + 1, or
+ *  64 + varint when l is 63:
+ *
+ *    00  COPY    length bytes from the old image at the source offset
+ *    01  INSERT  length literal bytes follow
+ *    10  SEEK    zigzag varint follows, added to the source offset
+ *    11  FILL    one byte follows, repeated length times
+ *
+ *  The patch is applied in place, one page at a time.  The diff tool only
+ *  copies from old pages at or after the page being built, so the old
+ *  bytes it needs are still in flash; a COPY from before that page is
+ *  malformed.
+ */
+
+#define DFU_PATCH_MAGIC            0x31504454   /* "TDP1" */
+
+#define DFU_PATCH_PAGE_SIZE        1024
+
+#define DFU_PATCH_MAC_SIZE         16
+
+#define DFU_OP_COPY                0
+#define DFU_OP_INSERT              1
+#define DFU_OP_SEEK                2
+#define DFU_OP_FILL                3
+
+typedef struct {
+    uint32_t  magic;
+    uint32_t  old_len;
+    uint32_t  old_crc;        // CRC32 of the image the patch applies to
+    uint32_t  new_len;
+    uint32_t  new_crc;
+    uint32_t  body_len;       // op stream that follows this header
+} dfu_patch_header_t;
+
+typedef struct {
+    uint8_t const * p_body;
+    uint32_t        body_len;
+    uint32_t        pos;      // read position in the op stream
+    uint8_t const * p_old;
+    uint32_t        old_len;
+    uint32_t        src;      // source offset in the old image
+    uint32_t        out;      // bytes produced so far
+    uint32_t        left;     // bytes left in the current op
+    uint8_t         op;
+    uint8_t         fill;
+} dfu_patch_t;
+
+/*
+ *  The DFU boot page (dfu_boot.c) builds its own copy, static, with
+ *  DFU_PATCH_API defined before it includes dfu_patch.c: it cannot call
+ *  into an image that the update replaces.
+ */
+#if !defined(DFU_PATCH_API)
+  #define DFU_PATCH_API
+#endif
+
+DFU_PATCH_API void     dfu_patch_begin(dfu_patch_t              * p_patch,
+                                       dfu_patch_header_t const * p_header,
+                                       uint8_t const            * p_body,
+                                       uint8_t const            * p_old);
+
+/* Returns the bytes produced (less than len at the end), or -1 if malformed.
+   With p_out NULL the ops are stepped over and the old image is not read. */
+DFU_PATCH_API int32_t  dfu_patch_run(dfu_patch_t * p_patch, uint8_t * p_out, uint32_t len);
+
+DFU_PATCH_API uint32_t dfu_crc32(uint32_t crc, uint8_t const * p_data, uint32_t len);
+
+#endif  /* _DFU_PATCH_H_ */
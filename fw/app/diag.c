@@ -0,0 +1,220 @@
+/*---------------------------------------------------------------------------*/
+/*  diag.c   runtime counters and memory watermarks                         */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "ble.h"
+#include "ble_gatts.h"
+#include "app_util.h"
+
+#include "config.h"
+#include "diag.h"
+#include "evq.h"
+#include "settings.h"
+#include "crash.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define DIAG_PAINT          0xDEADBEEF
+
+/* Rescan the painted RAM every this many wakeups. */
+#define DIAG_SCAN_EVERY     256
+
+/* From the startup file and gcc_nrf51_common.ld. */
+extern uint32_t __HeapBase;
+extern uint32_t __HeapLimit;
+extern uint32_t __StackTop;
+
+diag_t  g_diag;
+
+static uint16_t          m_service_handle;
+static ble_gatts_char_handles_t  m_char_handles;
+static ble_gatts_char_handles_t  m_crash_handles;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void radio_miss_report(uintptr_t ticks)
+{
+    PRINTF("radio deadline missed: %u ticks\n", (unsigned) ticks);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  End of the radio notification handler, which started at `start`.        */
+/*---------------------------------------------------------------------------*/
+void diag_radio_done(uint32_t start, bool radio_active)
+{
+    uint32_t ticks = (DIAG_TICKS() - start) & 0x00FFFFFF;
+    uint32_t t;
+    uint8_t  bin   = 0;
+
+    g_diag.isr_radio += ticks;
+
+    if (!radio_active)
+        return;
+
+    /* No CLZ on the M0; at most eight shifts. */
+    for (t = ticks; t != 0 && bin < DIAG_RADIO_BINS - 1; t >>= 1)
+        bin++;
+
+    g_diag.radio_hist[bin]++;
+
+    if (ticks > g_diag.radio_max)
+        g_diag.radio_max = ticks;
+
+    if (ticks >= DIAG_RADIO_DEADLINE) {
+        g_diag.radio_misses++;
+
+        /* Not worth a slot if the queue is full: the miss is counted. */
+        (void) evq_put(EVQ_LOW, radio_miss_report, ticks);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Measure how far the stack came down and the heap went up.                */
+/*---------------------------------------------------------------------------*/
+static void watermarks_scan(void)
+{
+    uint32_t * p;
+
+    p = &__HeapLimit;
+    while (p < &__StackTop && *p == DIAG_PAINT)
+        p++;
+    g_diag.stack_used = (uint32_t) ((uintptr_t) &__StackTop - (uintptr_t) p);
+
+    p = &__HeapLimit;
+    while (p > &__HeapBase && p[-1] == DIAG_PAINT)
+        p--;
+    g_diag.heap_used = (uint32_t) ((uintptr_t) p - (uintptr_t) &__HeapBase);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Main loop, before the event queue runs.                                  */
+/*---------------------------------------------------------------------------*/
+void diag_idle(void)
+{
+    if ((++g_diag.wake_total % DIAG_SCAN_EVERY) == 0)
+        watermarks_scan();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Once settings are loaded: count this boot.  Not a flash write per boot:  */
+/*  the count is kept in the crash record, which lives through resets, and   */
+/*  goes to flash with the next settings change.  After a power on the       */
+/*  record is empty and the count carries on from the settings, less the     */
+/*  boots that were never written.                                           */
+/*---------------------------------------------------------------------------*/
+void diag_boot_count(void)
+{
+    settings_t     * p_settings = settings_get();
+    crash_record_t * p_record   = crash_record_get();
+    uint16_t         count      = p_settings->reset_count;
+
+    if ((int16_t) (p_record->boot_count - count) > 0)
+        count = p_record->boot_count;
+    count++;
+
+    p_record->boot_count    = count;
+    p_settings->reset_count = count;
+    g_diag.reset_count      = count;
+
+    PRINTF("boot %u, reset reason 0x%x\n",
+           (unsigned) g_diag.reset_count, (unsigned) g_diag.reset_reason);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  A read-only characteristic over a RAM struct: reads see it live.         */
+/*---------------------------------------------------------------------------*/
+static uint32_t ram_char_add(uint8_t                    uuid_type,
+                             uint16_t                   uuid,
+                             void                     * p_value,
+                             uint16_t                   len,
+                             ble_gatts_char_handles_t * p_handles)
+{
+    ble_gatts_char_md_t  char_md;
+    ble_gatts_attr_t     attr_char_value;
+    ble_uuid_t           ble_uuid;
+    ble_gatts_attr_md_t  attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.read = 1;
+
+    ble_uuid.type = uuid_type;
+    ble_uuid.uuid = uuid;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid       = &ble_uuid;
+    attr_char_value.p_attr_md    = &attr_md;
+    attr_char_value.init_len     = len;
+    attr_char_value.max_len      = len;
+    attr_char_value.p_value      = p_value;
+
+    return sd_ble_gatts_characteristic_add(m_service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           p_handles);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Diagnostics service: the counters, and the last crash.                   */
+/*---------------------------------------------------------------------------*/
+uint32_t diag_service_add(uint8_t uuid_type)
+{
+    uint32_t   err_code;
+    ble_uuid_t ble_uuid;
+
+    ble_uuid.type = uuid_type;
+    ble_uuid.uuid = DIAG_UUID_SERVICE;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY,
+                                        &ble_uuid,
+                                        &m_service_handle);
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+    err_code = ram_char_add(uuid_type, DIAG_UUID_CHAR,
+                            &g_diag, sizeof(g_diag), &m_char_handles);
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+    return ram_char_add(uuid_type, DIAG_UUID_CRASH_CHAR,
+                        crash_record_get(), sizeof(crash_record_t), &m_crash_handles);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  First thing in main(), before the SoftDevice owns the POWER block.       */
+/*---------------------------------------------------------------------------*/
+void diag_init(void)
+{
+    uint32_t * p   = &__HeapBase;
+    uint32_t * end = (uint32_t *) (uintptr_t) (__get_MSP() - 32);   // spare this frame
+
+    /* Paint the heap and everything below the stack pointer. */
+    while (p < end)
+        *p++ = DIAG_PAINT;
+
+    g_diag.version        = DIAG_VERSION;
+    g_diag.radio_deadline = DIAG_RADIO_DEADLINE;
+    g_diag.stack_size     = (uint32_t) ((uintptr_t) &__StackTop  - (uintptr_t) &__HeapLimit);
+    g_diag.heap_size      = (uint32_t) ((uintptr_t) &__HeapLimit - (uintptr_t) &__HeapBase);
+
+    g_diag.reset_reason = NRF_POWER->RESETREAS;
+    NRF_POWER->RESETREAS = 0xFFFFFFFF;   // write 1 to clear
+
+    watermarks_scan();
+}
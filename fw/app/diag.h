@@ -0,0 +1,106 @@
+/*---------------------------------------------------------------------------*/
+/*  diag.h                                                                   */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _DIAG_H_
+#define _DIAG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf51.h"
+
+#include "evq.h"
+
+/*
+ *  Runtime counters, read as one value from the Diagnostics service
+ *  (0xfae0, characteristic 0xfae1).  The SoftDevice reads the struct in
+ *  place, so the hot paths only ever do a single increment or store.
+ *
+ *  ISR times are in RTC1 ticks (30.5 us): a short handler usually reads
+ *  as 0 or 1 tick, but the totals are right on average.
+ *
+ *  The radio active handler has to finish before the radio starts,
+ *  NRF_RADIO_NOTIFICATION_DISTANCE_5500US after the notification.  Its
+ *  durations go in a log2 histogram: bin 0 is 0 ticks, bin n holds
+ *  2^(n-1) .. 2^n - 1 ticks, the last bin everything from 128 (3.9 ms).
+ *
+ *  A switch from beaconing into the connectable window is timed from the
+ *  stop of the beacon to the radio notification of the first connectable
+ *  packet, in RTC1 ticks but kept in microseconds.  So is the time from
+ *  boot to the first advertising event, see boot.h.
+ *
+ *  A private address rotation that is due is retried at every frame
+ *  boundary until it goes through; each boundary it misses counts once.
+ */
+#define DIAG_VERSION          6
+
+#define DIAG_UUID_SERVICE     0xfae0      // on the Eddy base UUID
+#define DIAG_UUID_CHAR        0xfae1
+#define DIAG_UUID_CRASH_CHAR  0xfae2      // crash_record_t, see crash.h
+
+#define DIAG_RADIO_DEADLINE   180         // 5.5 ms in RTC1 ticks
+#define DIAG_RADIO_BINS       9
+
+typedef struct {
+    uint8_t   version;
+    uint8_t   reserved;
+    uint16_t  reset_count;      // boots since the settings were created
+    uint32_t  reset_reason;     // POWER->RESETREAS at this boot
+
+    uint32_t  wake_total;       // main loop passes, one per wakeup
+    uint32_t  wake_radio;       // radio notifications, both edges
+    uint32_t  wake_ble;         // BLE events
+    uint32_t  wake_soc;         // SoC (flash) events
+    uint32_t  wake_timer;       // application timer expiries
+    uint32_t  wake_button;
+
+    uint32_t  radio_active;     // radio active notifications
+    uint32_t  frames_uid;       // advertising frames set, per type
+    uint32_t  frames_url;
+    uint32_t  frames_tlm;
+
+    uint32_t  isr_radio;        // RTC1 ticks spent in each handler
+    uint32_t  isr_ble;
+    uint32_t  isr_soc;
+
+    uint16_t  stack_used;       // bytes, high-water mark
+    uint16_t  stack_size;       // bytes, room between the heap and the top
+    uint16_t  heap_used;
+    uint16_t  heap_size;
+
+    uint16_t  radio_max;        // longest radio active handler, ticks
+    uint16_t  radio_deadline;   // DIAG_RADIO_DEADLINE
+    uint32_t  radio_misses;     // handler ran past the deadline
+    uint32_t  radio_hist [DIAG_RADIO_BINS];
+
+    uint32_t  switch_count;     // warm switches into the connectable window
+    uint32_t  switch_us;        // last one: beacon stop to first packet
+
+    uint32_t  boot_adv_us;      // RTC1 start to the first advertising event
+
+    uint32_t  rpa_rotations;    // private address changes
+    uint32_t  rpa_late;         // frames a rotation was due, no address ready
+    uint32_t  rpa_failed;       // frames the SoftDevice refused the address
+
+    evq_stats_t  evq [EVQ_PRIORITIES];      // main loop queues, see evq.h
+} diag_t;
+
+extern diag_t  g_diag;
+
+#define DIAG_INC(counter)      (g_diag.counter++)
+
+#define DIAG_TICKS()           (NRF_RTC1->COUNTER)
+/* 1 tick is 1000000 / 32768 = 15625 / 512 us. */
+#define DIAG_TICKS_US(ticks)   ((uint32_t) (((uint64_t) (ticks) * 15625) >> 9))
+#define DIAG_ISR_TIME(counter, start)  \
+    (g_diag.counter += (DIAG_TICKS() - (start)) & 0x00FFFFFF)
+
+void diag_init(void);
+void diag_boot_count(void);
+void diag_idle(void);
+void diag_radio_done(uint32_t start, bool radio_active);
+
+uint32_t diag_service_add(uint8_t uuid_type);
+
+#endif  /* _DIAG_H_ */
@@ -7,6 +7,17 @@
 
 #include "dbglog.h"
 
+/* With DBGLOG_TOKENS, dbglog.c sends dumps as records instead. */
+#if !defined(DBGLOG_TOKENS)
+
+/*---------------------------------------------------------------------------*/
+/*  "00000: " + 16 x "XX " + " " + 16 chars + NUL                            */
+/*---------------------------------------------------------------------------*/
+#define DUMP_PER_LINE   16
+#define DUMP_LINE_LEN   (7 + (3 * DUMP_PER_LINE) + 1 + DUMP_PER_LINE + 1)
+
+static const char hex_digits [] = "0123456789ABCDEF";
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -16,67 +27,64 @@ static char makechar(uint8_t byte)
 }
 
 /*---------------------------------------------------------------------------*/
-/*                                                                           */
+/*  Format one line into `line`, then write it out in one go.                */
 /*---------------------------------------------------------------------------*/
-void dump_bytes(uint8_t * Buffer, int Length)
+static void dump_line(uint32_t offset, uint8_t * ptr, int count)
 {
+   char   line [DUMP_LINE_LEN];
+   char * p = line;
    int    i;
-   int    wholelines;
-   uint8_t * ptr;
 
-   if (Length == 0) {
-      puts("");
-      return;
-   }
+   for (i = 16; i >= 0; i -= 4)
+      *p++ = hex_digits[(offset >> i) & 0xF];
+   *p++ = ':';
+   *p++ = ' ';
 
-   ptr = Buffer;
-   wholelines = Length / 16;
-
-   for (i=0; i < wholelines; i++) {
-      printf("%05X: %02X %02X %02X %02X %02X %02X %02X %02X "
-                   "%02X %02X %02X %02X %02X %02X %02X %02X  ",
-                (ptr-Buffer),
-                (unsigned) ptr[0], (unsigned) ptr[1], 
-                (unsigned) ptr[2], (unsigned) ptr[3],
-                (unsigned) ptr[4], (unsigned) ptr[5], 
-                (unsigned) ptr[6], (unsigned) ptr[7],
-                (unsigned) ptr[8], (unsigned) ptr[9], 
-                (unsigned) ptr[10],(unsigned) ptr[11],
-                (unsigned) ptr[12],(unsigned) ptr[13],
-                (unsigned) ptr[14],(unsigned) ptr[15] );
-
-            printf("%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c%c\n",
-                makechar(ptr[0]),  makechar(ptr[1]), 
-                makechar(ptr[2]),  makechar(ptr[3]),
-                makechar(ptr[4]),  makechar(ptr[5]), 
-                makechar(ptr[6]),  makechar(ptr[7]),
-                makechar(ptr[8]),  makechar(ptr[9]), 
-                makechar(ptr[10]), makechar(ptr[11]),
-                makechar(ptr[12]), makechar(ptr[13]),
-                makechar(ptr[14]), makechar(ptr[15]) );
-
-      ptr    += 16;
-      Length -= 16;
+   for (i = 0; i < DUMP_PER_LINE; i++) {
+      if (i < count) {
+         *p++ = hex_digits[ptr[i] >> 4];
+         *p++ = hex_digits[ptr[i] & 0xF];
+      }
+      else {
+         *p++ = ' ';
+         *p++ = ' ';
+      }
+      *p++ = ' ';
    }
+   *p++ = ' ';
 
-   if (Length) {
+   for (i = 0; i < count; i++)
+      *p++ = makechar(ptr[i]);
+   *p = '\0';
 
-      printf("%05X: ", (ptr-Buffer));
-      for (i=0; i < Length; i++) {
-         printf("%02X ", (unsigned) ptr[i]);
-      }
-
-      for (i=0; i < (16 - Length); i++) {
-         printf("%c%c%c", ' ',' ',' ');
-      }
-      printf("%c", ' ');
+   puts(line);
+}
 
-      for (i=0; i < Length; i++) {
-         printf("%c", makechar(ptr[i]));
-      }
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void dump_bytes(uint8_t * Buffer, int Length)
+{
+   uint32_t offset = 0;
+   int      count;
 
+   if (Length <= 0) {
       puts("");
+      return;
    }
-   else
+
+   while (Length > 0) {
+      count = (Length < DUMP_PER_LINE) ? Length : DUMP_PER_LINE;
+
+      dump_line(offset, Buffer + offset, count);
+
+      offset += count;
+      Length -= count;
+   }
+
+   /* As before: a blank line after a dump of whole lines. */
+   if (count == DUMP_PER_LINE)
       puts("");
 }
+
+#endif /* !DBGLOG_TOKENS */
@@ -9,12 +9,17 @@
 #include "nrf51.h"
 #include "ble_gap.h"
 #include "nrf_error.h"
+#include "nrf_soc.h"
+#include "app_util.h"
 
 #include "config.h"
 #include "eddystone.h"
 #include "ble_eddy.h"
 #include "battery.h"
 #include "temperature.h"
+#include "privacy.h"
+#include "advert.h"
+#include "diag.h"
 #include "dbglog.h"
 
 /*---------------------------------------------------------------------------*/
@@ -63,6 +68,18 @@ static eddystone_frame_t eddystone_frames [3];
 static uint32_t adv_cnt = 0;
 static uint32_t sec_cnt = 0;
 
+/* Frame mix: each frame type goes out every n-th radio event, 0 never. */
+static uint8_t  m_period [3] = {
+    [EDDYSTONE_UID] = 3,
+    [EDDYSTONE_URL] = 5,
+    [EDDYSTONE_TLM] = 9,
+};
+static uint8_t  m_countdown [3] = {
+    [EDDYSTONE_UID] = 3,
+    [EDDYSTONE_URL] = 5,
+    [EDDYSTONE_TLM] = 9,
+};
+
 static const eddystone_header_t  header = {
     .flags_len     = 0x02,
     .flags_type    = 0x01,
@@ -129,7 +146,7 @@ static uint32_t encode_url(uint8_t * encoded_advdata, uint8_t * len_advdata)
             url     += prefix_len;
             url_len -= prefix_len;
 
-            printf("url: \"%s\", url_len: %u, prefix: %d\n", 
+            PRINTF("url: \"%s\", url_len: %u, prefix: %d\n",
                    url, (unsigned) url_len, prefix);
             break;
         }
@@ -209,6 +226,9 @@ static void eddystone_set_adv_data(uint32_t frame_index)
     uint8_t * encoded_advdata = eddystone_frames[frame_index].adv_frame;
     uint8_t   len_advdata     = eddystone_frames[frame_index].adv_len; 
 
+    /* Address rotation rides along with the frame change. */
+    privacy_frame_boundary();
+
     err_code = sd_ble_gap_adv_data_set(encoded_advdata, len_advdata, NULL, 0);
     APP_ERROR_CHECK( err_code );
 }
@@ -293,13 +313,21 @@ static void build_uid_frame_buffer(void)
     memcpy(&encoded_advdata[(*len_advdata)], &namespace, sizeof(namespace));
     *len_advdata += sizeof(namespace);
 
-    /* Set Beacon Id (BID) to FICR Device Address */
+#if UID_INSTANCE_FROM_FICR
+    /* Set Beacon Id (BID) to FICR Device Address: see config.h */
     encoded_advdata[(*len_advdata)++] = FICR_DEVICEADDR[5];
     encoded_advdata[(*len_advdata)++] = FICR_DEVICEADDR[4];
     encoded_advdata[(*len_advdata)++] = FICR_DEVICEADDR[3];
     encoded_advdata[(*len_advdata)++] = FICR_DEVICEADDR[2];
     encoded_advdata[(*len_advdata)++] = FICR_DEVICEADDR[1];
     encoded_advdata[(*len_advdata)++] = FICR_DEVICEADDR[0];
+#else
+    /* Set Beacon Id (BID) */
+    static const uint8_t instance[] = UID_INSTANCE;
+    STATIC_ASSERT(sizeof(instance) == 6);
+    memcpy(&encoded_advdata[(*len_advdata)], &instance, sizeof(instance));
+    *len_advdata += sizeof(instance);
+#endif
 
     /* RFU field must be 0x00 */
     encoded_advdata[(*len_advdata)++] = 0x00;
@@ -323,30 +351,101 @@ void eddystone_init(void)
     eddystone_set_adv_data(EDDYSTONE_UID);
 }
 
+/*---------------------------------------------------------------------------*/
+/*  Counts down to each frame type's next turn (no '%': this runs in the     */
+/*  radio notification, and the M0 has no divide).  When turns coincide,     */
+/*  TLM goes before URL before UID, and the others wait for their next.      */
+/*---------------------------------------------------------------------------*/
+static bool frame_due(uint32_t frame_index)
+{
+    if (m_period[frame_index] == 0)
+        return false;
+
+    if (--m_countdown[frame_index] != 0)
+        return false;
+
+    m_countdown[frame_index] = m_period[frame_index];
+    return true;
+}
+
 /*---------------------------------------------------------------------------*/
 /*  Crappy scheduler -- will re-implement later (sigh)                       */
 /*---------------------------------------------------------------------------*/
 void eddystone_scheduler(bool radio_is_active)
 {
-    static uint32_t iterations = 0;
+    bool uid, url, tlm;
 
     if (radio_is_active == false)
         return;
 
-    iterations++;
     sec_cnt++;
+    DIAG_INC(radio_active);
+
+    /* The connectable window has its own payload: leave it alone. */
+    if (!advertising_is_beaconing())
+        return;
 
-    if ((iterations % 9) == 0) {
+    /* All three count down every time. */
+    uid = frame_due(EDDYSTONE_UID);
+    url = frame_due(EDDYSTONE_URL);
+    tlm = frame_due(EDDYSTONE_TLM);
+
+    if (tlm) {
         build_tlm_frame_buffer();
         eddystone_set_adv_data(EDDYSTONE_TLM);
         adv_cnt++;
+        DIAG_INC(frames_tlm);
     }
-    else if ((iterations % 5) == 0) {
+    else if (url) {
         eddystone_set_adv_data(EDDYSTONE_URL);
         adv_cnt++;
+        DIAG_INC(frames_url);
     }
-    else if ((iterations % 3) == 0) {
+    else if (uid) {
         eddystone_set_adv_data(EDDYSTONE_UID);
         adv_cnt++;
+        DIAG_INC(frames_uid);
     }
 }
+
+/*---------------------------------------------------------------------------*/
+/*  The TLM counters, for the telemetry stream.                              */
+/*---------------------------------------------------------------------------*/
+void eddystone_counters_get(uint32_t * p_adv_cnt, uint32_t * p_sec_cnt)
+{
+    *p_adv_cnt = adv_cnt;
+    *p_sec_cnt = sec_cnt;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Carry the counters over a warm restart; call before eddystone_init().    */
+/*---------------------------------------------------------------------------*/
+void eddystone_counters_set(uint32_t adv_count, uint32_t sec_count)
+{
+    adv_cnt = adv_count;
+    sec_cnt = sec_count;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Frame mix, in radio events per frame; 0 turns a frame type off.          */
+/*---------------------------------------------------------------------------*/
+void eddystone_mix_set(uint8_t uid, uint8_t url, uint8_t tlm)
+{
+    CRITICAL_REGION_ENTER();
+
+    m_period[EDDYSTONE_UID] = m_countdown[EDDYSTONE_UID] = uid;
+    m_period[EDDYSTONE_URL] = m_countdown[EDDYSTONE_URL] = url;
+    m_period[EDDYSTONE_TLM] = m_countdown[EDDYSTONE_TLM] = tlm;
+
+    CRITICAL_REGION_EXIT();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void eddystone_mix_get(uint8_t * p_uid, uint8_t * p_url, uint8_t * p_tlm)
+{
+    *p_uid = m_period[EDDYSTONE_UID];
+    *p_url = m_period[EDDYSTONE_URL];
+    *p_tlm = m_period[EDDYSTONE_TLM];
+}
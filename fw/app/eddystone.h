@@ -7,5 +7,9 @@
 
 void eddystone_init(void);
 void eddystone_scheduler(bool radio_is_active);
+void eddystone_counters_get(uint32_t * p_adv_cnt, uint32_t * p_sec_cnt);
+void eddystone_counters_set(uint32_t adv_count, uint32_t sec_count);
+void eddystone_mix_set(uint8_t uid, uint8_t url, uint8_t tlm);
+void eddystone_mix_get(uint8_t * p_uid, uint8_t * p_url, uint8_t * p_tlm);
 
 #endif /* EDDYSTONE_H */
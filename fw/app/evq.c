@@ -0,0 +1,141 @@
+/*---------------------------------------------------------------------------*/
+/*  evq.c   main loop event queue: two priorities, word payloads, stats      */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "app_util.h"
+
+#include "evq.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+STATIC_ASSERT((EVQ_HIGH_SIZE & (EVQ_HIGH_SIZE - 1)) == 0 && EVQ_HIGH_SIZE <= 128);
+STATIC_ASSERT((EVQ_LOW_SIZE  & (EVQ_LOW_SIZE  - 1)) == 0 && EVQ_LOW_SIZE  <= 128);
+
+typedef struct {
+    evq_handler_t  handler;
+    uintptr_t      arg;
+    uint32_t       put_ticks;
+} event_t;
+
+typedef struct {
+    event_t      * p_ring;
+    uint8_t        mask;
+    uint8_t        head;            // next to run
+} queue_t;
+
+static event_t        m_high [EVQ_HIGH_SIZE];
+static event_t        m_low  [EVQ_LOW_SIZE];
+
+static queue_t        m_queues [EVQ_PRIORITIES] = {
+    { m_high, EVQ_HIGH_SIZE - 1, 0 },
+    { m_low,  EVQ_LOW_SIZE  - 1, 0 },
+};
+
+static evq_clock_t    m_clock;
+static evq_stats_t  * m_p_stats;
+
+/*---------------------------------------------------------------------------*/
+/*  The stats live with the caller, in the diagnostics on the target.        */
+/*---------------------------------------------------------------------------*/
+void evq_init(evq_clock_t clock, evq_stats_t * p_stats)
+{
+    unsigned i;
+
+    m_clock   = clock;
+    m_p_stats = p_stats;
+
+    memset(m_p_stats, 0, EVQ_PRIORITIES * sizeof(evq_stats_t));
+
+    for (i = 0; i < EVQ_PRIORITIES; i++)
+        m_queues[i].head = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  From any priority.  NRF_ERROR_NO_MEM if that priority's queue is full.   */
+/*---------------------------------------------------------------------------*/
+uint32_t evq_put(evq_priority_t priority, evq_handler_t handler, uintptr_t arg)
+{
+    queue_t     * p_queue = &m_queues[priority];
+    evq_stats_t * p_stats = &m_p_stats[priority];
+    event_t     * p_event;
+    uint32_t      err_code = NRF_SUCCESS;
+
+    CRITICAL_REGION_ENTER();
+
+    if (p_stats->depth > p_queue->mask) {
+        p_stats->overflows++;
+        err_code = NRF_ERROR_NO_MEM;
+    }
+    else {
+        p_event = &p_queue->p_ring[(p_queue->head + p_stats->depth) & p_queue->mask];
+        p_event->handler   = handler;
+        p_event->arg       = arg;
+        p_event->put_ticks = m_clock();
+
+        if (++p_stats->depth > p_stats->peak)
+            p_stats->peak = p_stats->depth;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The next event to run, highest priority first; false if there is none.   */
+/*---------------------------------------------------------------------------*/
+static bool evq_get(event_t * p_out)
+{
+    queue_t     * p_queue;
+    evq_stats_t * p_stats;
+    uint32_t      latency;
+    bool          found = false;
+    unsigned      i;
+
+    CRITICAL_REGION_ENTER();
+
+    for (i = 0; i < EVQ_PRIORITIES && !found; i++) {
+        p_queue = &m_queues[i];
+        p_stats = &m_p_stats[i];
+
+        if (p_stats->depth == 0)
+            continue;
+
+        *p_out = p_queue->p_ring[p_queue->head];
+        p_queue->head = (p_queue->head + 1) & p_queue->mask;
+        p_stats->depth--;
+
+        latency = (m_clock() - p_out->put_ticks) & EVQ_TICKS_MASK;
+        p_stats->runs++;
+        p_stats->latency_sum += latency;
+        if (latency > p_stats->latency_max)
+            p_stats->latency_max = latency;
+
+        found = true;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return found;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Main loop: run until both queues are empty, including what the events    */
+/*  themselves put.  The priority is looked at again before every event.     */
+/*---------------------------------------------------------------------------*/
+void evq_execute(void)
+{
+    event_t event;
+
+    while (evq_get(&event)) {
+        event.handler(event.arg);
+    }
+}
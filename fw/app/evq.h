@@ -0,0 +1,56 @@
+/*---------------------------------------------------------------------------*/
+/*  evq.h                                                                    */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _EVQ_H_
+#define _EVQ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ *  Event queue for the main loop, in place of app_scheduler.  Interrupt
+ *  handlers put work here and the main loop runs it, high priority first:
+ *  a low priority event only runs when no high priority one is waiting,
+ *  so the radio's work never queues up behind the LED or the buzzer.
+ *  Within a priority, first in first out.
+ *
+ *  The payload is one word, passed by value: a number, an enum, or a
+ *  pointer to data that stays put until the handler has run (const
+ *  tables, statics).  Nothing is copied but that word.
+ *
+ *  Each priority keeps its depth, peak depth, refused puts and latency
+ *  (put to start of run, in clock ticks) in an evq_stats_t the caller
+ *  owns; the firmware keeps them in the diagnostics.  No hardware here,
+ *  so it is also built and tested on the host (fw/tools/evq).
+ */
+#define EVQ_TICKS_MASK  0x00FFFFFF          // the clock wraps at 24 bits
+
+/* Slots per priority, powers of two; 12 bytes each on the target. */
+#define EVQ_HIGH_SIZE   4
+#define EVQ_LOW_SIZE    8
+
+typedef enum {
+    EVQ_HIGH = 0,       // radio and link work: addresses, telemetry
+    EVQ_LOW,            // everything else: LED, buzzer, flash, logs
+    EVQ_PRIORITIES,
+} evq_priority_t;
+
+typedef void (* evq_handler_t)(uintptr_t arg);
+
+typedef uint32_t (* evq_clock_t)(void);
+
+typedef struct {
+    uint8_t   depth;            // waiting now
+    uint8_t   peak;             // most ever waiting
+    uint16_t  overflows;        // puts refused, queue full
+    uint32_t  runs;
+    uint32_t  latency_max;      // ticks from put to run
+    uint32_t  latency_sum;      // ticks, over all runs
+} evq_stats_t;
+
+void     evq_init(evq_clock_t clock, evq_stats_t * p_stats);
+uint32_t evq_put(evq_priority_t priority, evq_handler_t handler, uintptr_t arg);
+void     evq_execute(void);
+
+#endif  /* _EVQ_H_ */
@@ -0,0 +1,384 @@
+/*---------------------------------------------------------------------------*/
+/*  flash_queue.c   radio-aware flash job queue                             */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Flash erase and write stall the CPU and need a SoftDevice timeslot.
+ *  Jobs are queued here and only started in the gap between radio events,
+ *  announced by the radio notification: the gap opens when the radio goes
+ *  inactive and closes with the next active notification.  Each operation
+ *  is sized to fit in what is left of the gap (estimated from the length
+ *  of the previous gap), so several page erases or a long write may be
+ *  issued back-to-back inside one gap, or split across several gaps.
+ *
+ *  NRF_EVT_FLASH_OPERATION_ERROR means the SoftDevice could not find the
+ *  time; the operation is retried in the next gap.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "nrf_error.h"
+#include "app_timer.h"
+#include "app_util.h"
+
+#include "config.h"
+#include "flash_queue.h"
+#include "advert.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define FLASH_PAGE_SIZE            ((uint32_t) NRF_FICR->CODEPAGESIZE)
+
+/* nRF51 PS v3.x: tWRITE max 46.3 us, tERASEPAGE max 22.3 ms. */
+#define FLASH_WORD_WRITE_US        47
+#define FLASH_PAGE_ERASE_US        22400
+
+/* Largest single sd_flash_write (one page of words). */
+#define FLASH_MAX_WRITE_WORDS      256
+
+/* Keep clear of the next active notification. */
+#define FLASH_GAP_MARGIN_US        1000
+
+/* No radio notification for two advertising intervals, and at least this
+   long: the radio is idle, no gap to wait for.  See radio_idle_ticks(). */
+#define FLASH_RADIO_IDLE_MIN_MS    1000
+
+#define TICKS_TO_US(T)             ((uint32_t)(((uint64_t)(T) * 15625) >> 9))
+#define TICKS_TO_MS(T)             ((uint32_t)(((uint64_t)(T) * 125) >> 12))
+
+/* 32.768 ticks per ms, as 4194 / 128: 0.01% short, and no divide. */
+#define MS_TO_TICKS(M)             ((uint32_t)(((uint64_t)(M) * 4194) >> 7))
+
+typedef enum {
+    FLASH_OP_WRITE = 0,
+    FLASH_OP_ERASE,
+} flash_op_t;
+
+typedef struct {
+    uint8_t            op;
+    uint8_t            retries;
+    uint16_t           count;        // words (write) or pages (erase) left
+    uint32_t         * p_dst;
+    uint32_t const   * p_src;
+    uint32_t           enqueued;     // app_timer ticks
+    flash_queue_cb_t   cb;
+    void             * p_context;
+} flash_job_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+static flash_job_t          m_queue [FLASH_QUEUE_SIZE];
+static uint8_t              m_head        = 0;
+static uint8_t              m_count       = 0;
+
+static bool                 m_in_progress = false;
+static uint16_t             m_op_units    = 0;     // words or pages in flight
+static bool                 m_deferred    = false; // head op waiting for a gap
+
+static bool                 m_gap_open    = false;
+static uint32_t             m_gap_start   = 0;
+static uint32_t             m_gap_len_us  = (APP_ADV_INTERVAL_MS * 1000) / 2;
+static uint32_t             m_last_notify = 0;
+
+static flash_queue_stats_t  m_stats;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t ticks_since(uint32_t then)
+{
+    uint32_t now;
+    uint32_t diff;
+
+    app_timer_cnt_get(&now);
+    app_timer_cnt_diff_compute(now, then, &diff);
+
+    return diff;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The advertising interval can be set up to 10.24 s at run time: a fixed   */
+/*  threshold shorter than that would call the radio idle between two        */
+/*  advertising events, and start an erase across the next one.              */
+/*---------------------------------------------------------------------------*/
+static uint32_t radio_idle_ticks(void)
+{
+    uint32_t ms = 2 * (uint32_t) advertising_interval_get();
+
+    if (ms < FLASH_RADIO_IDLE_MIN_MS)
+        ms = FLASH_RADIO_IDLE_MIN_MS;
+
+    return MS_TO_TICKS(ms);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Time left in the current radio gap, in microseconds.                     */
+/*---------------------------------------------------------------------------*/
+static uint32_t gap_budget_us(void)
+{
+    uint32_t elapsed;
+
+    if (ticks_since(m_last_notify) > radio_idle_ticks())
+        return UINT32_MAX;
+
+    if (!m_gap_open)
+        return 0;
+
+    elapsed = TICKS_TO_US(ticks_since(m_gap_start)) + FLASH_GAP_MARGIN_US;
+
+    return (elapsed < m_gap_len_us) ? (m_gap_len_us - elapsed) : 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void job_complete(uint32_t result)
+{
+    flash_job_t * p_job   = &m_queue[m_head];
+    uint32_t      latency = TICKS_TO_MS(ticks_since(p_job->enqueued));
+
+    if (result == NRF_SUCCESS) {
+        m_stats.jobs_done++;
+        m_stats.latency_total_ms += latency;
+        if (latency > m_stats.latency_max_ms)
+            m_stats.latency_max_ms = latency;
+    }
+    else {
+        m_stats.jobs_failed++;
+    }
+
+    m_head = (m_head + 1) % FLASH_QUEUE_SIZE;
+    m_count--;
+
+    m_deferred = false;
+
+    if (p_job->cb != NULL) {
+        p_job->cb(result, p_job->p_context);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start the next operation of the head job if it fits in the gap.          */
+/*---------------------------------------------------------------------------*/
+static void flash_queue_kick(void)
+{
+    flash_job_t * p_job;
+    uint32_t      budget;
+    uint32_t      err_code;
+
+    while (!m_in_progress && m_count > 0) {
+
+        p_job  = &m_queue[m_head];
+        budget = gap_budget_us();
+
+        if (p_job->op == FLASH_OP_ERASE) {
+            m_op_units = (budget >= FLASH_PAGE_ERASE_US) ? 1 : 0;
+        }
+        else {
+            m_op_units = MIN(p_job->count, MIN(budget / FLASH_WORD_WRITE_US,
+                                               FLASH_MAX_WRITE_WORDS));
+        }
+
+        if (m_op_units == 0) {
+            if (!m_deferred) {
+                m_deferred = true;
+                m_stats.ops_deferred++;
+            }
+            return;
+        }
+
+        if (p_job->op == FLASH_OP_ERASE)
+            err_code = sd_flash_page_erase((uint32_t) ((uintptr_t) p_job->p_dst / FLASH_PAGE_SIZE));
+        else
+            err_code = sd_flash_write(p_job->p_dst, p_job->p_src, m_op_units);
+
+        if (err_code == NRF_SUCCESS) {
+            m_in_progress = true;
+            m_deferred    = false;
+            return;
+        }
+
+        /* Another flash user (pstorage) owns the flash: wait for its event. */
+        if (err_code == NRF_ERROR_BUSY)
+            return;
+
+        job_complete(err_code);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t job_enqueue(flash_op_t op, uint32_t * p_dst, uint32_t const * p_src,
+                            uint16_t count, flash_queue_cb_t cb, void * p_context)
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    if (count == 0)
+        return NRF_ERROR_INVALID_LENGTH;
+
+    CRITICAL_REGION_ENTER();
+
+    if (m_count < FLASH_QUEUE_SIZE) {
+
+        flash_job_t * p_job = &m_queue[(m_head + m_count) % FLASH_QUEUE_SIZE];
+
+        p_job->op        = op;
+        p_job->retries   = 0;
+        p_job->count     = count;
+        p_job->p_dst     = p_dst;
+        p_job->p_src     = p_src;
+        p_job->cb        = cb;
+        p_job->p_context = p_context;
+
+        app_timer_cnt_get(&p_job->enqueued);
+
+        m_count++;
+        if (m_count > m_stats.queue_peak)
+            m_stats.queue_peak = m_count;
+
+        flash_queue_kick();
+    }
+    else {
+        err_code = NRF_ERROR_NO_MEM;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return err_code;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  p_src must stay valid until the callback.                                */
+/*---------------------------------------------------------------------------*/
+uint32_t flash_queue_write(uint32_t * p_dst, uint32_t const * p_src, uint16_t words,
+                           flash_queue_cb_t cb, void * p_context)
+{
+    return job_enqueue(FLASH_OP_WRITE, p_dst, p_src, words, cb, p_context);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+uint32_t flash_queue_erase(uint32_t * p_page, uint16_t pages,
+                           flash_queue_cb_t cb, void * p_context)
+{
+    return job_enqueue(FLASH_OP_ERASE, p_page, NULL, pages, cb, p_context);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+bool flash_queue_busy(void)
+{
+    return (m_count > 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Radio notification: inactive opens a gap, active closes it.              */
+/*---------------------------------------------------------------------------*/
+void flash_queue_radio_notification(bool radio_active)
+{
+    uint32_t now;
+
+    app_timer_cnt_get(&now);
+
+    m_last_notify = now;
+
+    if (radio_active) {
+        if (m_gap_open) {
+            uint32_t diff;
+
+            app_timer_cnt_diff_compute(now, m_gap_start, &diff);
+            m_gap_len_us = TICKS_TO_US(diff);
+        }
+        m_gap_open = false;
+    }
+    else {
+        m_gap_open  = true;
+        m_gap_start = now;
+
+        flash_queue_kick();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void flash_queue_sys_event_handler(uint32_t sys_evt)
+{
+    flash_job_t * p_job;
+
+    if (sys_evt != NRF_EVT_FLASH_OPERATION_SUCCESS &&
+        sys_evt != NRF_EVT_FLASH_OPERATION_ERROR) {
+        return;
+    }
+
+    if (!m_in_progress) {
+        /* Somebody else's operation finished: the flash may be free now. */
+        flash_queue_kick();
+        return;
+    }
+
+    m_in_progress = false;
+    p_job = &m_queue[m_head];
+
+    if (sys_evt == NRF_EVT_FLASH_OPERATION_SUCCESS) {
+
+        p_job->count -= m_op_units;
+
+        if (p_job->op == FLASH_OP_ERASE) {
+            p_job->p_dst += m_op_units * (FLASH_PAGE_SIZE / sizeof(uint32_t));
+        }
+        else {
+            p_job->p_dst += m_op_units;
+            p_job->p_src += m_op_units;
+        }
+
+        if (p_job->count == 0)
+            job_complete(NRF_SUCCESS);
+    }
+    else {
+        m_stats.retries++;
+
+        if (++p_job->retries > FLASH_MAX_RETRIES) {
+            job_complete(NRF_ERROR_TIMEOUT);
+        }
+        else {
+            /* The SoftDevice ran out of time: wait for the next gap. */
+            m_gap_open = false;
+        }
+    }
+
+    flash_queue_kick();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+flash_queue_stats_t const * flash_queue_stats_get(void)
+{
+    return &m_stats;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void flash_queue_init(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    m_head        = 0;
+    m_count       = 0;
+    m_in_progress = false;
+
+    app_timer_cnt_get(&m_last_notify);
+}
@@ -0,0 +1,41 @@
+/*---------------------------------------------------------------------------*/
+/*  flash_queue.h                                                            */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _FLASH_QUEUE_H_
+#define _FLASH_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ *  Completion callback: result is NRF_SUCCESS, or the last error once the
+ *  retries are used up.  Called from the SoftDevice event context.
+ */
+typedef void (* flash_queue_cb_t)(uint32_t result, void * p_context);
+
+typedef struct {
+    uint32_t  jobs_done;
+    uint32_t  jobs_failed;
+    uint32_t  ops_deferred;      // ops that had to wait for a later radio gap
+    uint32_t  retries;           // NRF_EVT_FLASH_OPERATION_ERROR retries
+    uint32_t  latency_max_ms;    // enqueue to completion
+    uint32_t  latency_total_ms;  // divide by jobs_done for the average
+    uint8_t   queue_peak;
+} flash_queue_stats_t;
+
+void     flash_queue_init(void);
+
+uint32_t flash_queue_write(uint32_t * p_dst, uint32_t const * p_src, uint16_t words,
+                           flash_queue_cb_t cb, void * p_context);
+uint32_t flash_queue_erase(uint32_t * p_page, uint16_t pages,
+                           flash_queue_cb_t cb, void * p_context);
+
+bool     flash_queue_busy(void);
+
+void     flash_queue_radio_notification(bool radio_active);
+void     flash_queue_sys_event_handler(uint32_t sys_evt);
+
+flash_queue_stats_t const * flash_queue_stats_get(void);
+
+#endif  /* _FLASH_QUEUE_H_ */
@@ -0,0 +1,134 @@
+/*---------------------------------------------------------------------------*/
+/*  gesture.c   short, long and double press from edge timestamps            */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gesture.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+enum {
+    STATE_IDLE = 0,
+    STATE_DOWN,             // first press
+    STATE_WAIT,             // released after a short press: a second?
+    STATE_DOWN_AGAIN,       // second press
+};
+
+static uint32_t elapsed(uint32_t now, uint32_t then)
+{
+    return (now - then) & GESTURE_TICKS_MASK;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void gesture_init(gesture_engine_t * p_engine, const gesture_cfg_t * p_cfg)
+{
+    p_engine->p_cfg = p_cfg;
+    p_engine->state = STATE_IDLE;
+    p_engine->down  = 0;
+    p_engine->up    = 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  An edge seen twice (a bounce too quick to read) is ignored.              */
+/*---------------------------------------------------------------------------*/
+gesture_t gesture_edge(gesture_engine_t * p_engine, bool pressed, uint32_t now)
+{
+    const gesture_cfg_t * p_cfg = p_engine->p_cfg;
+    gesture_t             gesture = GESTURE_NONE;
+    uint32_t              held;
+
+    switch (p_engine->state) {
+
+        case STATE_IDLE:
+            if (pressed) {
+                p_engine->down  = now;
+                p_engine->state = STATE_DOWN;
+            }
+            break;
+
+        case STATE_DOWN:
+            if (pressed)
+                break;
+            held = elapsed(now, p_engine->down);
+            if (held < p_cfg->debounce) {
+                p_engine->state = STATE_IDLE;
+            }
+            else if (held >= p_cfg->hold) {
+                gesture = GESTURE_LONG;
+                p_engine->state = STATE_IDLE;
+            }
+            else {
+                p_engine->up    = now;
+                p_engine->state = STATE_WAIT;
+            }
+            break;
+
+        case STATE_WAIT:
+            if (!pressed)
+                break;
+            /* The timeout was late: the first press stands on its own. */
+            if (elapsed(now, p_engine->up) >= p_cfg->gap) {
+                gesture = GESTURE_SHORT;
+                p_engine->state = STATE_DOWN;
+            }
+            else {
+                p_engine->state = STATE_DOWN_AGAIN;
+            }
+            p_engine->down = now;
+            break;
+
+        case STATE_DOWN_AGAIN:
+            if (pressed)
+                break;
+            /* Noise: still waiting for a second press, as before. */
+            if (elapsed(now, p_engine->down) < p_cfg->debounce) {
+                p_engine->state = STATE_WAIT;
+            }
+            else {
+                gesture = GESTURE_DOUBLE;
+                p_engine->state = STATE_IDLE;
+            }
+            break;
+
+        default:
+            p_engine->state = STATE_IDLE;
+            break;
+    }
+
+    return gesture;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Called when gesture_wait() said; early or spurious calls do nothing.     */
+/*---------------------------------------------------------------------------*/
+gesture_t gesture_timeout(gesture_engine_t * p_engine, uint32_t now)
+{
+    if (p_engine->state == STATE_WAIT &&
+        elapsed(now, p_engine->up) >= p_engine->p_cfg->gap) {
+
+        p_engine->state = STATE_IDLE;
+        return GESTURE_SHORT;
+    }
+    return GESTURE_NONE;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Ticks until gesture_timeout() is due, at least 1; 0 when none is.        */
+/*---------------------------------------------------------------------------*/
+uint32_t gesture_wait(const gesture_engine_t * p_engine, uint32_t now)
+{
+    uint32_t waited;
+
+    if (p_engine->state != STATE_WAIT)
+        return 0;
+
+    waited = elapsed(now, p_engine->up);
+
+    return (waited < p_engine->p_cfg->gap) ? p_engine->p_cfg->gap - waited : 1;
+}
@@ -0,0 +1,49 @@
+/*---------------------------------------------------------------------------*/
+/*  gesture.h                                                                */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _GESTURE_H_
+#define _GESTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ *  Button gestures from edge timestamps alone: short, long and double
+ *  press.  No hardware here, so it is also built and tested on the host
+ *  (fw/tools/gesture).
+ *
+ *  Times are RTC ticks, which wrap at 24 bits.  A press shorter than
+ *  debounce is contact noise and is dropped, which is all the debouncing
+ *  there is: bounces on either edge are such presses.  A long press is
+ *  known when it ends.  Only a short press needs a timeout, to tell it
+ *  from the first half of a double press; gesture_wait() says when.
+ */
+#define GESTURE_TICKS_MASK  0x00FFFFFF
+
+typedef enum {
+    GESTURE_NONE = 0,
+    GESTURE_SHORT,
+    GESTURE_LONG,
+    GESTURE_DOUBLE,
+} gesture_t;
+
+typedef struct {
+    uint32_t  debounce;     // shorter presses are noise
+    uint32_t  hold;         // a press this long is a long press
+    uint32_t  gap;          // the second press starts within this of the first
+} gesture_cfg_t;
+
+typedef struct {
+    const gesture_cfg_t * p_cfg;
+    uint8_t               state;
+    uint32_t              down;     // start of the press in progress
+    uint32_t              up;       // end of the first press
+} gesture_engine_t;
+
+void      gesture_init(gesture_engine_t * p_engine, const gesture_cfg_t * p_cfg);
+gesture_t gesture_edge(gesture_engine_t * p_engine, bool pressed, uint32_t now);
+gesture_t gesture_timeout(gesture_engine_t * p_engine, uint32_t now);
+uint32_t  gesture_wait(const gesture_engine_t * p_engine, uint32_t now);
+
+#endif  /* _GESTURE_H_ */
@@ -0,0 +1,114 @@
+/*---------------------------------------------------------------------------*/
+/*  hfclk.c   reference counted 16 MHz crystal                              */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The first request asks the SoftDevice for the crystal, the last
+ *  release gives it back; the SoftDevice keeps it on for the radio anyway
+ *  when it needs it.  Nobody spins on HFCLKSTARTED: handlers wait here
+ *  until NRF_EVT_HFCLKSTARTED comes, unless the crystal is already up.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "app_error.h"
+#include "app_util.h"
+
+#include "hfclk.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define HFCLK_MAX_WAITING   4
+
+static uint8_t          m_refs    = 0;
+static bool             m_running = false;
+static hfclk_handler_t  m_waiting [HFCLK_MAX_WAITING];
+static uint8_t          m_waiting_count = 0;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void hfclk_request(hfclk_handler_t handler)
+{
+    uint32_t err_code = NRF_SUCCESS;
+    uint32_t running  = 0;
+    bool     call_now = false;
+
+    CRITICAL_REGION_ENTER();
+
+    if (m_refs++ == 0) {
+        m_running = false;
+        err_code  = sd_clock_hfclk_request();
+    }
+
+    /* Already up, e.g. for the radio: there may be no event to wait for. */
+    if (err_code == NRF_SUCCESS && !m_running) {
+        err_code  = sd_clock_hfclk_is_running(&running);
+        m_running = (running != 0);
+    }
+
+    if (m_running)
+        call_now = true;
+    else if (handler != NULL && m_waiting_count < HFCLK_MAX_WAITING)
+        m_waiting[m_waiting_count++] = handler;
+    else if (handler != NULL)
+        err_code = NRF_ERROR_NO_MEM;
+
+    CRITICAL_REGION_EXIT();
+
+    APP_ERROR_CHECK(err_code);
+
+    if (call_now && handler != NULL)
+        handler();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void hfclk_release(void)
+{
+    uint32_t err_code = NRF_SUCCESS;
+
+    CRITICAL_REGION_ENTER();
+
+    if (m_refs > 0 && --m_refs == 0) {
+        m_running       = false;
+        m_waiting_count = 0;
+        err_code        = sd_clock_hfclk_release();
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    APP_ERROR_CHECK(err_code);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  From sys_evt_dispatch().                                                 */
+/*---------------------------------------------------------------------------*/
+void hfclk_on_sys_evt(uint32_t sys_evt)
+{
+    hfclk_handler_t handlers [HFCLK_MAX_WAITING];
+    uint8_t         count = 0;
+    uint8_t         i;
+
+    if (sys_evt != NRF_EVT_HFCLKSTARTED)
+        return;
+
+    CRITICAL_REGION_ENTER();
+
+    if (m_refs > 0) {
+        m_running = true;
+        for (count = 0; count < m_waiting_count; count++)
+            handlers[count] = m_waiting[count];
+        m_waiting_count = 0;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    for (i = 0; i < count; i++)
+        handlers[i]();
+}
@@ -0,0 +1,25 @@
+/*---------------------------------------------------------------------------*/
+/*  hfclk.h                                                                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _HFCLK_H_
+#define _HFCLK_H_
+
+#include <stdint.h>
+
+/*
+ *  The 16 MHz crystal, shared: it runs while anyone holds a request.
+ *  The handler is called once it is running, which may be at once, from
+ *  inside hfclk_request(), or later from the SoC event (SWI2).  Each
+ *  request is paired with one hfclk_release().
+ *
+ *  Only for users that need the crystal's accuracy: timers, ADC and
+ *  UART run from the HFCLK RC oscillator, which they start by themselves.
+ */
+typedef void (*hfclk_handler_t)(void);
+
+void hfclk_request(hfclk_handler_t handler);
+void hfclk_release(void);
+void hfclk_on_sys_evt(uint32_t sys_evt);
+
+#endif  /* _HFCLK_H_ */
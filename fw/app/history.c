@@ -0,0 +1,597 @@
+/*---------------------------------------------------------------------------*/
+/*  history.c   battery and temperature history log                         */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Samples are packed into 32 byte blocks.  A block header carries the
+ *  first sample in full; each following sample is one token holding the
+ *  change from the previous one:
+ *
+ *    0x00..0x7F  one sample: bits 6-4 zigzag(dvbat), bits 3-0 zigzag(dtemp)
+ *    0x80        one sample: zigzag varint dvbat, zigzag varint dtemp
+ *    0x81..0xFE  run of 2..127 unchanged samples
+ *
+ *  Hourly battery and temperature readings rarely move by more than a few
+ *  steps, so most samples cost one byte and a quiet day costs one byte in
+ *  total.  Blocks fill up in RAM and are appended to a two page flash ring;
+ *  the oldest page is erased when the ring wraps.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "ble.h"
+#include "ble_gatts.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "pstorage.h"
+#include "crc16.h"
+
+#include "config.h"
+#include "evq.h"
+#include "history.h"
+#include "ble_eddy.h"
+#include "battery.h"
+#include "temperature.h"
+#include "flash_queue.h"
+#include "diag.h"
+#include "pstorage_platform.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define HISTORY_PAGES              2
+
+#define HISTORY_TICK_INTERVAL      APP_TIMER_TICKS(60000, APP_TIMER_PRESCALER)
+
+#define HISTORY_DATA_SIZE          (HISTORY_BLOCK_SIZE - 10)
+
+#define HISTORY_FLAG_BOOT          0x01    // first block after a reset
+
+#define TOKEN_ESCAPE               0x80
+#define TOKEN_RUN_MIN              0x81
+#define TOKEN_RUN_MAX              0xFE
+#define TOKEN_MAX_LEN              7
+#define TOKEN_NONE                 0xFF
+
+#define SEQ_INVALID                0xFFFF  // erased flash
+
+#define NOTIFY_LEN                 20      // default ATT MTU - 3
+
+typedef struct {
+    uint16_t  crc;          // CRC16 over everything after this field
+    uint16_t  seq;
+    uint8_t   count;        // samples in this block, including the first
+    uint8_t   flags;
+    uint16_t  vbat;         // first sample, HISTORY_VBAT_UNIT_MV units
+    int16_t   temp;         // first sample, 0.25 C units
+    uint8_t   data [HISTORY_DATA_SIZE];
+} history_block_t;
+
+STATIC_ASSERT(sizeof(history_block_t) == HISTORY_BLOCK_SIZE);
+
+/* Download progress; only committed once a notification is queued. */
+typedef struct {
+    bool      active;
+    bool      preamble;     // preamble still to send
+    bool      tail;         // RAM block still to send
+    uint16_t  slot;         // next flash slot to look at
+    uint16_t  slots_left;
+    uint8_t   pos;          // read position in buf
+    uint8_t   buf [HISTORY_BLOCK_SIZE];
+} history_dl_t;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+static app_timer_id_t      m_history_timer_id;
+
+static pstorage_handle_t   m_base_handle;
+static uint32_t            m_base_addr;
+
+static history_block_t     m_block;                // being filled
+static history_block_t     m_flash_block;          // being written
+static volatile bool       m_write_pending = false;
+
+static uint8_t             m_data_len      = 0;
+static uint8_t             m_last_tok      = TOKEN_NONE;
+static uint16_t            m_last_vbat     = 0;
+static int16_t             m_last_temp     = 0;
+static bool                m_boot          = true;
+
+static uint16_t            m_slot_count    = 0;
+static uint16_t            m_head          = 0;    // next slot to write
+static uint16_t            m_seq           = 0;
+
+static volatile uint16_t   m_minutes       = 0;    // since the last sample
+
+static history_dl_t        m_dl;
+static history_block_t     m_dl_tail;
+static history_preamble_t  m_dl_preamble;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static history_block_t const * slot_block(uint16_t slot)
+{
+    return (history_block_t const *) (uintptr_t) (m_base_addr + slot * HISTORY_BLOCK_SIZE);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint16_t block_crc(history_block_t const * p_block)
+{
+    return crc16_compute((uint8_t const *) &p_block->seq,
+                         sizeof(history_block_t) - sizeof(p_block->crc),
+                         NULL);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static bool block_valid(history_block_t const * p_block)
+{
+    return (p_block->seq   != SEQ_INVALID &&
+            p_block->count != 0           &&
+            p_block->crc   == block_crc(p_block));
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static bool slot_is_erased(uint16_t slot)
+{
+    return (*(uint32_t const *) slot_block(slot) == PSTORAGE_FLASH_EMPTY_MASK);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint8_t varint_put(uint8_t * p_buf, uint32_t value)
+{
+    uint8_t len = 0;
+
+    while (value >= 0x80) {
+        p_buf[len++] = (uint8_t) value | 0x80;
+        value >>= 7;
+    }
+    p_buf[len++] = (uint8_t) value;
+
+    return len;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint8_t token_encode(uint8_t * p_buf, int32_t dvbat, int32_t dtemp)
+{
+    uint32_t zv = zigzag(dvbat);
+    uint32_t zt = zigzag(dtemp);
+    uint8_t  len;
+
+    if (zv < 8 && zt < 16) {
+        p_buf[0] = (uint8_t) ((zv << 4) | zt);
+        return 1;
+    }
+
+    len  = 0;
+    p_buf[len++] = TOKEN_ESCAPE;
+    len += varint_put(&p_buf[len], zv);
+    len += varint_put(&p_buf[len], zt);
+
+    return len;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void block_reset(void)
+{
+    memset(&m_block, 0xFF, sizeof(m_block));
+
+    m_block.count = 0;
+    m_data_len    = 0;
+    m_last_tok    = TOKEN_NONE;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void history_flash_cb(uint32_t result, void * p_context)
+{
+    if (result != NRF_SUCCESS) {
+        PRINTF("history: flash op failed 0x%x\n", (unsigned) result);
+    }
+    m_write_pending = false;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The block goes in once its page is erased; on a failed erase it is lost. */
+/*---------------------------------------------------------------------------*/
+static void history_erase_cb(uint32_t result, void * p_context)
+{
+    if (result != NRF_SUCCESS) {
+        PRINTF("history: erase failed 0x%x, block dropped\n", (unsigned) result);
+        m_write_pending = false;
+        return;
+    }
+
+    APP_ERROR_CHECK( flash_queue_write((uint32_t *) p_context,
+                                       (uint32_t const *) &m_flash_block,
+                                       sizeof(m_flash_block) / sizeof(uint32_t),
+                                       history_flash_cb, NULL) );
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Append the full RAM block to the ring, erasing the next page on entry.   */
+/*---------------------------------------------------------------------------*/
+static void block_close(void)
+{
+    uint32_t * p_dst;
+
+    m_block.seq   = m_seq;
+    m_block.flags = m_boot ? HISTORY_FLAG_BOOT : 0;
+    m_block.crc   = block_crc(&m_block);
+
+    if (m_write_pending) {
+        /* Previous block still in the queue: drop this one. */
+        PUTS("history: block dropped");
+        block_reset();
+        return;
+    }
+
+    if (++m_seq == SEQ_INVALID)
+        m_seq = 0;
+
+    m_boot = false;
+
+    m_flash_block   = m_block;
+    m_write_pending = true;
+
+    p_dst = (uint32_t *) slot_block(m_head);
+
+    if ((m_head * HISTORY_BLOCK_SIZE) % PSTORAGE_FLASH_PAGE_SIZE == 0) {
+        APP_ERROR_CHECK( flash_queue_erase(p_dst, 1, history_erase_cb, p_dst) );
+    }
+    else {
+        APP_ERROR_CHECK( flash_queue_write(p_dst,
+                                           (uint32_t const *) &m_flash_block,
+                                           sizeof(m_flash_block) / sizeof(uint32_t),
+                                           history_flash_cb, NULL) );
+    }
+
+    m_head = (m_head + 1) % m_slot_count;
+
+    block_reset();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void history_append(uint16_t vbat, int16_t temp)
+{
+    uint8_t  token [TOKEN_MAX_LEN];
+    uint8_t  len;
+    uint8_t *p_last;
+
+    if (m_block.count == UINT8_MAX)
+        block_close();
+
+    if (m_block.count == 0) {
+        m_block.vbat  = vbat;
+        m_block.temp  = temp;
+        m_block.count = 1;
+        goto done;
+    }
+
+    if (vbat == m_last_vbat && temp == m_last_temp && m_last_tok != TOKEN_NONE) {
+
+        p_last = &m_block.data[m_last_tok];
+
+        if (*p_last == 0x00) {
+            *p_last = TOKEN_RUN_MIN;
+            m_block.count++;
+            goto done;
+        }
+        if (*p_last >= TOKEN_RUN_MIN && *p_last < TOKEN_RUN_MAX) {
+            (*p_last)++;
+            m_block.count++;
+            goto done;
+        }
+    }
+
+    len = token_encode(token, vbat - m_last_vbat, temp - m_last_temp);
+
+    if (m_data_len + len > HISTORY_DATA_SIZE) {
+        block_close();
+        history_append(vbat, temp);
+        return;
+    }
+
+    memcpy(&m_block.data[m_data_len], token, len);
+    m_last_tok  = m_data_len;
+    m_data_len += len;
+    m_block.count++;
+
+done:
+    m_last_vbat = vbat;
+    m_last_temp = temp;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Scheduler context: the ADC read spins and sd_temp_get blocks.            */
+/*---------------------------------------------------------------------------*/
+static void history_sample(uintptr_t arg)
+{
+    uint16_t vbat = battery_level_get() / HISTORY_VBAT_UNIT_MV;
+    int16_t  temp = temperature_raw_get();
+
+    CRITICAL_REGION_ENTER();
+
+    history_append(vbat, temp);
+    m_minutes = 0;
+
+    CRITICAL_REGION_EXIT();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void history_timeout_handler(void * p_context)
+{
+    DIAG_INC(wake_timer);
+
+    /* If the scheduler queue is full, try again next minute. */
+    if (++m_minutes >= HISTORY_INTERVAL_MIN) {
+        (void) evq_put(EVQ_LOW, history_sample, 0);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static bool dl_next_block(history_dl_t * p_dl)
+{
+    history_block_t const * p_block;
+
+    while (p_dl->slots_left > 0) {
+
+        p_block = slot_block(p_dl->slot);
+
+        p_dl->slot = (p_dl->slot + 1) % m_slot_count;
+        p_dl->slots_left--;
+
+        if (block_valid(p_block)) {
+            memcpy(p_dl->buf, p_block, HISTORY_BLOCK_SIZE);
+            p_dl->pos = 0;
+            return true;
+        }
+    }
+
+    if (p_dl->tail) {
+        p_dl->tail = false;
+        memcpy(p_dl->buf, &m_dl_tail, HISTORY_BLOCK_SIZE);
+        p_dl->pos = 0;
+        return true;
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Keep every free TX buffer busy; resumes on BLE_EVT_TX_COMPLETE.          */
+/*---------------------------------------------------------------------------*/
+static void dl_pump(void)
+{
+    ble_gatts_hvx_params_t  hvx;
+    history_dl_t            next;
+    uint8_t                 packet [NOTIFY_LEN];
+    uint16_t                len;
+    uint8_t                 n;
+    uint32_t                err_code;
+
+    while (m_dl.active) {
+
+        next = m_dl;
+        len  = 0;
+
+        if (next.preamble) {
+            next.preamble = false;
+            memcpy(packet, &m_dl_preamble, sizeof(m_dl_preamble));
+            len = sizeof(m_dl_preamble);
+        }
+        else {
+            while (len < NOTIFY_LEN) {
+                if (next.pos == HISTORY_BLOCK_SIZE && !dl_next_block(&next))
+                    break;
+
+                n = MIN(NOTIFY_LEN - len, HISTORY_BLOCK_SIZE - next.pos);
+                memcpy(&packet[len], &next.buf[next.pos], n);
+                next.pos += n;
+                len      += n;
+            }
+        }
+
+        if (len == 0) {
+            PUTS("history: download done");
+            m_dl.active = false;
+            return;
+        }
+
+        memset(&hvx, 0, sizeof(hvx));
+        hvx.handle = g_eddy_service.history_char_handles.value_handle;
+        hvx.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx.p_len  = &len;
+        hvx.p_data = packet;
+
+        err_code = sd_ble_gatts_hvx(g_eddy_service.conn_handle, &hvx);
+
+        if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+            return;
+
+        if (err_code != NRF_SUCCESS) {
+            /* Not connected or notifications not enabled. */
+            m_dl.active = false;
+            return;
+        }
+
+        m_dl = next;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Stream the ring, oldest block first, then the partly filled RAM block.   */
+/*---------------------------------------------------------------------------*/
+void history_download_start(void)
+{
+    uint16_t blocks = 0;
+    uint16_t slot;
+
+    for (slot = 0; slot < m_slot_count; slot++) {
+        if (block_valid(slot_block(slot)))
+            blocks++;
+    }
+
+    /* The sampler runs in thread mode, so this snapshot is consistent. */
+    m_dl_tail       = m_block;
+    m_dl_tail.seq   = m_seq;
+    m_dl_tail.flags = m_boot ? HISTORY_FLAG_BOOT : 0;
+    m_dl_tail.crc   = block_crc(&m_dl_tail);
+
+    memset(&m_dl, 0, sizeof(m_dl));
+    m_dl.active     = true;
+    m_dl.preamble   = true;
+    m_dl.tail       = (m_dl_tail.count > 0);
+    m_dl.slot       = m_head;
+    m_dl.slots_left = m_slot_count;
+    m_dl.pos        = HISTORY_BLOCK_SIZE;
+
+    m_dl_preamble.version      = HISTORY_VERSION;
+    m_dl_preamble.block_size   = HISTORY_BLOCK_SIZE;
+    m_dl_preamble.block_count  = blocks + (m_dl.tail ? 1 : 0);
+    m_dl_preamble.interval_min = HISTORY_INTERVAL_MIN;
+    m_dl_preamble.age_min      = m_minutes;
+
+    PRINTF("history: download %u blocks\n", m_dl_preamble.block_count);
+
+    dl_pump();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void history_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id) {
+
+        case BLE_EVT_TX_COMPLETE:
+            dl_pump();
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            m_dl.active = false;
+            break;
+
+        default:
+            /* No implementation needed. */
+            break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void history_pstorage_cb(pstorage_handle_t * p_handle,
+                                uint8_t             op_code,
+                                uint32_t            result,
+                                uint8_t           * p_data,
+                                uint32_t            data_len)
+{
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Find the newest block; writing resumes in the slot after it.             */
+/*---------------------------------------------------------------------------*/
+static void history_scan(void)
+{
+    history_block_t const * p_block;
+    uint16_t                newest = 0;
+    bool                    found  = false;
+    uint16_t                slot;
+
+    for (slot = 0; slot < m_slot_count; slot++) {
+
+        p_block = slot_block(slot);
+
+        if (!block_valid(p_block))
+            continue;
+
+        if (!found || (int16_t)(p_block->seq - slot_block(newest)->seq) > 0) {
+            newest = slot;
+            found  = true;
+        }
+    }
+
+    if (!found)
+        return;
+
+    m_seq  = slot_block(newest)->seq + 1;
+    m_head = (newest + 1) % m_slot_count;
+
+    if (m_seq == SEQ_INVALID)
+        m_seq = 0;
+
+    /* Skip over a torn write; a page start is always erased before use. */
+    while (!slot_is_erased(m_head) &&
+           (m_head * HISTORY_BLOCK_SIZE) % PSTORAGE_FLASH_PAGE_SIZE != 0) {
+        m_head = (m_head + 1) % m_slot_count;
+    }
+
+    PRINTF("history: head %u, seq %u\n", m_head, m_seq);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Must be called after pstorage_init(), flash_queue_init() and the timer   */
+/*  and scheduler init.                                                      */
+/*---------------------------------------------------------------------------*/
+void history_init(void)
+{
+    pstorage_module_param_t param;
+
+    param.block_size  = PSTORAGE_FLASH_PAGE_SIZE;
+    param.block_count = HISTORY_PAGES;
+    param.cb          = history_pstorage_cb;
+
+    APP_ERROR_CHECK( pstorage_register(&param, &m_base_handle) );
+
+    m_base_addr  = m_base_handle.block_id;
+    m_slot_count = (HISTORY_PAGES * PSTORAGE_FLASH_PAGE_SIZE) / HISTORY_BLOCK_SIZE;
+
+    block_reset();
+    history_scan();
+
+    APP_ERROR_CHECK( app_timer_create(&m_history_timer_id,
+                                      APP_TIMER_MODE_REPEATED,
+                                      history_timeout_handler) );
+
+    APP_ERROR_CHECK( app_timer_start(m_history_timer_id, HISTORY_TICK_INTERVAL, NULL) );
+
+    /* First sample right away, so a fresh boot is on record; at the next
+       tick if the queue is full. */
+    if (evq_put(EVQ_LOW, history_sample, 0) != NRF_SUCCESS)
+        m_minutes = HISTORY_INTERVAL_MIN;
+}
@@ -0,0 +1,36 @@
+/*---------------------------------------------------------------------------*/
+/*  history.h                                                                */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ble.h"
+
+/*
+ *  Battery and temperature history, sampled every HISTORY_INTERVAL_MIN
+ *  minutes into a two page flash ring.  See fw/tools/history.py for the
+ *  block format and the download stream.
+ */
+
+#define HISTORY_VERSION            1
+#define HISTORY_BLOCK_SIZE         32
+
+/* First notification of a download. */
+typedef struct {
+    uint8_t   version;
+    uint8_t   block_size;
+    uint16_t  block_count;       // blocks that follow, oldest first
+    uint16_t  interval_min;
+    uint16_t  age_min;           // minutes since the newest sample
+} history_preamble_t;
+
+void history_init(void);
+
+void history_download_start(void);
+void history_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif  /* _HISTORY_H_ */
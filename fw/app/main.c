@@ -13,7 +13,6 @@
 #include "app_timer.h"
 #include "app_gpiote.h"
 #include "app_error.h"
-#include "app_scheduler.h"
 
 #include "config.h"
 #include "buzzer.h"
@@ -21,7 +20,18 @@
 #include "advert.h"
 #include "connect.h"
 #include "eddystone.h"
+#include "privacy.h"
+#include "flash_queue.h"
+#include "history.h"
+#include "dfu.h"
+#include "telemetry.h"
+#include "diag.h"
+#include "crash.h"
+#include "boot.h"
+#include "evq.h"
 #include "uart.h"
+#include "ramlog.h"
+#include "console.h"
 #include "dbglog.h"
 
 #ifdef BUZZER_SUPPORT
@@ -58,6 +68,9 @@ static const struct {
 #define NRF_ERRORS_COUNT (sizeof(nrf_errors)/sizeof(nrf_errors[0]))
 #endif /* DBGLOG_SUPPORT */
 
+/* Cold, or warm after a crash: see crash_init(). */
+static crash_boot_t  m_boot;
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -85,6 +98,10 @@ void app_error_handler(uint32_t error_code,
     PRINTF("app_error_handler: NRF_ERROR_%s 0x%x, at %s(%d)\n", 
            text, (unsigned)error_code, (char*)filename, (int)line);
 
+#if !defined(DBGLOG_RAM)
+    uart_flush();
+#endif
+
 #ifdef DEBUG
     __BKPT();
 #endif
@@ -93,6 +110,9 @@ void app_error_handler(uint32_t error_code,
 
     __disable_irq();
 
+    /* Leave a record, and the state to carry on beaconing after the reset. */
+    crash_error(error_code, (uint32_t) (uintptr_t) __builtin_return_address(0), line, filename);
+
     /* The system can only recover with a reset (reboot). */
     NVIC_SystemReset(); 
 }
@@ -106,18 +126,87 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t *p_file_name)
 }
 
 /*---------------------------------------------------------------------------*/
-/*                                                                           */
+/*  Find-me: alert on the LED for a while, then show what it showed before.  */
+/*---------------------------------------------------------------------------*/
+static app_timer_id_t   m_find_me_timer_id;
+static bsp_indication_t m_find_me_restore;
+
+static void find_me_timeout_handler(void * p_context)
+{
+    /* Unless something else took the LED over meanwhile. */
+    if (bsp_indication_get() == BSP_INDICATE_ALERT)
+        APP_ERROR_CHECK( bsp_indication_set(m_find_me_restore) );
+}
+
+static void find_me_start(void)
+{
+    if (bsp_indication_get() != BSP_INDICATE_ALERT)
+        m_find_me_restore = bsp_indication_get();
+
+    APP_ERROR_CHECK( bsp_indication_set(BSP_INDICATE_ALERT) );
+
+    APP_ERROR_CHECK( app_timer_stop(m_find_me_timer_id) );
+    APP_ERROR_CHECK( app_timer_start(m_find_me_timer_id,
+                                     APP_TIMER_TICKS(FIND_ME_MS, APP_TIMER_PRESCALER),
+                                     NULL) );
+#ifdef BUZZER_SUPPORT
+    buzzer_play(find_me_sound);
+#endif
+}
+
+static void find_me_init(void)
+{
+    APP_ERROR_CHECK( app_timer_create(&m_find_me_timer_id,
+                                      APP_TIMER_MODE_SINGLE_SHOT,
+                                      find_me_timeout_handler) );
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Storage (shipping) mode: everything off until the button is pressed,     */
+/*  which wakes the chip with a reset, as if a battery had been put in.      */
+/*---------------------------------------------------------------------------*/
+static void storage_mode(void)
+{
+    PUTS("storage mode");
+
+#ifdef BUZZER_SUPPORT
+    buzzer_stop();
+#endif
+#if defined(DBGLOG_SUPPORT) && !defined(DBGLOG_RAM)
+    uart_flush();
+#endif
+
+    APP_ERROR_CHECK( bsp_indication_set(BSP_INDICATE_IDLE) );
+    APP_ERROR_CHECK( bsp_buttons_enable(1 << 0) );
+
+    APP_ERROR_CHECK( sd_power_system_off() );
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Button gestures, from the scheduler.                                     */
 /*---------------------------------------------------------------------------*/
 static void bsp_events(bsp_event_t event)
 {
-    /* Button press means restart to allow URL update. */
-    if (event == BSP_EVENT_KEY_0) {
+    switch (event) {
 
-        NVIC_SystemReset();
-        return;
-    }
+        case BSP_EVENT_BUTTON_SHORT:
+            /* Open the connectable window to allow URL update. */
+            if (!advertising_config_window_open())
+                PUTS("already connectable");
+            break;
 
-    PRINTF("bsp_event: %d\n", (int) event);
+        case BSP_EVENT_BUTTON_DOUBLE:
+            find_me_start();
+            break;
+
+        case BSP_EVENT_BUTTON_LONG:
+            storage_mode();
+            break;
+
+        default:
+            PRINTF("bsp_event: %d\n", (int) event);
+            break;
+    }
 }
 
 //*---------------------------------------------------------------------------*/
@@ -125,7 +214,6 @@ static void bsp_events(bsp_event_t event)
 /*---------------------------------------------------------------------------*/
 static void ble_stack_init(void)
 {
-    ble_gap_addr_t      addr;
     ble_enable_params_t ble_enable_params;
 
     /* Initialize the SoftDevice handler module. */
@@ -138,8 +226,8 @@ static void ble_stack_init(void)
 
     APP_ERROR_CHECK( sd_ble_enable(&ble_enable_params) );
 
-    sd_ble_gap_address_get(&addr);
-    sd_ble_gap_address_set(BLE_GAP_ADDR_CYCLE_MODE_NONE, &addr);
+    /* Use a rotating resolvable private address rather than the public one. */
+    privacy_init();
 
     /* Subscribe for BLE events. */
     APP_ERROR_CHECK( softdevice_ble_evt_handler_set(ble_evt_dispatch) );
@@ -180,6 +268,25 @@ static void button_and_led_init(void)
     APP_ERROR_CHECK(err_code);
 }
 
+/*---------------------------------------------------------------------------*/
+/*  Radio notification: flash jobs run in the gaps between radio events.     */
+/*---------------------------------------------------------------------------*/
+static void radio_notification_dispatch(bool radio_active)
+{
+    uint32_t start = DIAG_TICKS();
+
+    DIAG_INC(wake_radio);
+
+    flash_queue_radio_notification(radio_active);
+
+    boot_radio_notification(radio_active);
+    advertising_radio_notification(radio_active);
+
+    eddystone_scheduler(radio_active);
+
+    diag_radio_done(start, radio_active);
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -189,16 +296,21 @@ static void radio_init(void)
 
     err_code = ble_radio_notification_init(NRF_APP_PRIORITY_LOW,
                                            NRF_RADIO_NOTIFICATION_DISTANCE_5500US,
-                                           eddystone_scheduler);
+                                           radio_notification_dispatch);
     APP_ERROR_CHECK(err_code);
 }
 
 /*---------------------------------------------------------------------------*/
-/*                                                                           */
+/*  Event latencies are timed on RTC1, the stats kept in the diagnostics.    */
 /*---------------------------------------------------------------------------*/
+static uint32_t evq_clock(void)
+{
+    return DIAG_TICKS();
+}
+
 static void scheduler_init(void)
 {
-    APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
+    evq_init(evq_clock, g_diag.evq);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -209,42 +321,143 @@ static void power_manage(void)
     APP_ERROR_CHECK( sd_app_evt_wait() );
 }
 
+/*---------------------------------------------------------------------------*/
+/*  What advertising does not need: the GATT services, connection and        */
+/*  security handling, the flash history.  pstorage hands out flash in the   */
+/*  order of registration, so settings, the device manager and the history   */
+/*  keep theirs in both boot orders.                                         */
+/*---------------------------------------------------------------------------*/
+static void connection_init(void)
+{
+    diag_boot_count();
+    find_me_init();
+    gap_params_init();
+    services_init();
+    boot_mark("services");
+
+    conn_params_init();
+    sec_params_init();
+    device_manager_init();
+    boot_mark("security");
+
+    history_init();
+    dfu_init();
+    telemetry_init();
+    boot_mark("history");
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Warm boots, after a crash, skip the startup sound.                       */
+/*---------------------------------------------------------------------------*/
+static void sound_init(void)
+{
+#ifdef BUZZER_SUPPORT
+    buzzer_init();
+    if (m_boot == CRASH_BOOT_COLD)
+        buzzer_play(startup_sound);
+    boot_mark("buzzer");
+#endif
+}
+
+#ifdef FAST_BOOT
+/*---------------------------------------------------------------------------*/
+/*  Fast boot, first pass of the main loop: the rest of the init, then the   */
+/*  connectable window, switched into as if the button had opened it.        */
+/*---------------------------------------------------------------------------*/
+static void boot_deferred(uintptr_t arg)
+{
+    connection_init();
+    sound_init();
+
+    if (m_boot != CRASH_BOOT_ERROR)
+        advertising_config_window_open();
+}
+#endif
+
 /*---------------------------------------------------------------------------*/
 /*  Function for application main entry.                                     */
 /*---------------------------------------------------------------------------*/
 int main(void)
 {
-    ble_stack_init();
+    diag_init();
+    m_boot = crash_init(g_diag.reset_reason);
+
+    /* Ahead of the stack: privacy_init() already queues its first address. */
     scheduler_init();
 
-#if defined(DBGLOG_SUPPORT)
+    /* Ahead of the stack too: it writes the flash directly. */
+    dfu_install_boot();
+
+    ble_stack_init();
+    timer_init();
+    boot_init();
+
+#if defined(DBGLOG_RAM)
+    ramlog_init();
+#elif defined(DBGLOG_SUPPORT)
     uart_init();
 #endif
 
     PRINTF("\n*** firmware built: %s %s ***\n\n", __DATE__, __TIME__);
 
+#if defined(DBGLOG_SUPPORT)
+    if (m_boot == CRASH_BOOT_ERROR) {
+        crash_record_t * p_crash = crash_record_get();
+        PRINTF("crash: 0x%x at %s(%d) pc 0x%x\n",
+               (unsigned) p_crash->error_code, p_crash->file,
+               (int) p_crash->line, (unsigned) p_crash->pc);
+    }
+#endif
+
+#if defined(DBGLOG_CONSOLE)
+    console_init();
+#endif
+    boot_mark("log");
+
     storage_init();
-    timer_init();
+    boot_mark("storage");
+
     gpiote_init();
     button_and_led_init();
     radio_init();
+    boot_mark("peripherals");
+
+#ifdef FAST_BOOT
+    /*
+     *  Beacon first: nothing can connect to it, so the rest of the init
+     *  can wait for the main loop.  A cold boot then switches into the
+     *  connectable window; after a crash the beacon just carries on.
+     */
+    advertising_start_nonconnectable();
+    boot_mark("advertising");
+
+    /* The queue can hardly be full this early; if it is, carry on now. */
+    if (evq_put(EVQ_HIGH, boot_deferred, 0) != NRF_SUCCESS)
+        boot_deferred(0);
+#else
+    connection_init();
+
+    /*
+     *  After a crash go straight back to beaconing, without the startup
+     *  sound.  The button opens the connectable window later, if need be.
+     *  Beaconing builds its frames itself.
+     */
+    if (m_boot == CRASH_BOOT_ERROR) {
+        advertising_start_nonconnectable();
+    }
+    else {
+        eddystone_init();
+        advertising_start_connectable();
+    }
+    boot_mark("advertising");
 
-    gap_params_init();
-    services_init();
-    eddystone_init();
-    conn_params_init();
-    sec_params_init();
-
-    advertising_start_connectable();
-
-#ifdef BUZZER_SUPPORT
-    buzzer_init();
-    buzzer_play((buzzer_play_t *)&startup_sound);
+    sound_init();
 #endif
 
     /* Enter main loop. */
     for (;;) {
-        app_sched_execute();
+        diag_idle();
+        evq_execute();
         power_manage();
     }
 }
@@ -1,18 +1,38 @@
 //-----------------------------------------------------------------------------
 // printf.c  (use stdio.h for header)
 //-----------------------------------------------------------------------------
+//
+// The Cortex-M0 has no divide instruction: every '/' or '%' is a call into
+// the runtime library costing tens of cycles.  Hex conversion is shifts and
+// a table lookup, decimal uses divu10() below, which is a multiply by the
+// reciprocal of 10 done in shifts and adds.  No division anywhere.
+//
+// All output goes through an out_t: either the console, or a buffer with a
+// known amount of room.  The buffer is never written past its room; the
+// return value is what the whole output would have been, as in C99.
+//
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "uart.h"
 
+/* Not unless it is used: ramlog.h brings config.h and the SDK with it,
+   which fw/tools/fmtbench builds without. */
+#if defined(DBGLOG_RAM)
+#include "ramlog.h"
+#endif
+
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
 int putchar( int c )
 {
-#if defined(DBGLOG_SUPPORT)
+#if defined(DBGLOG_RAM)
+    ramlog_putc((uint8_t)c);
+#elif defined(DBGLOG_SUPPORT)
     uart_putc((uint8_t)c);
 #endif
     return 0;
@@ -21,11 +41,18 @@ int putchar( int c )
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
-static void printchar(char ** str, int c)
+typedef struct {
+    char     * buf;         // NULL: console
+    unsigned   room;        // chars that still fit, not counting the NUL
+} out_t;
+
+static void printchar(out_t * out, int c)
 {
-    if (str) {
-        **str = c;
-        ++(*str);
+    if (out->buf) {
+        if (out->room) {
+            *out->buf++ = c;
+            out->room--;
+        }
     }
     else {
         if (c == '\n') {
@@ -41,7 +68,7 @@ static void printchar(char ** str, int c)
 #define PAD_RIGHT 1
 #define PAD_ZERO  2
 
-static int prints(char ** out, const char * string, int width, int pad)
+static int prints(out_t * out, const char * string, int width, int pad)
 {
     register int pc = 0, padchar = ' ';
 
@@ -71,25 +98,41 @@ static int prints(char ** out, const char * string, int width, int pad)
     return pc;
 }
 
+//-----------------------------------------------------------------------------
+// n / 10 without a divide (Hacker's Delight, 10-17): q ~ n * 0.8 / 8, then
+// one correction step.  Exact for all 32-bit n.
+//-----------------------------------------------------------------------------
+static unsigned divu10(unsigned n)
+{
+    unsigned q, r;
+
+    q  = (n >> 1) + (n >> 2);
+    q += (q >> 4);
+    q += (q >> 8);
+    q += (q >> 16);
+    q >>= 3;
+    r  = n - ((q << 3) + (q << 1));
+
+    return q + (r > 9);
+}
+
+static const char hex_lower [] = "0123456789abcdef";
+static const char hex_upper [] = "0123456789ABCDEF";
+
 //-----------------------------------------------------------------------------
 // the following should be enough for 32 bit int
 //-----------------------------------------------------------------------------
 #define PRINT_BUF_LEN 12
 
-static int printi(char ** out, int i, int b, int sg, int width, int pad, int letbase)
+static int printi(out_t * out, int i, int b, int sg, int width, int pad, const char * digits)
 {
     char print_buf[PRINT_BUF_LEN];
     register char *s;
-    register int t, neg = 0, pc = 0;
+    register int neg = 0, pc = 0;
     register unsigned int u = i;
+    unsigned q;
 
-    if (i == 0) {
-        print_buf[0] = '0';
-        print_buf[1] = '\0';
-        return prints (out, print_buf, width, pad);
-    }
-
-    if (sg && b == 10 && i < 0) {
+    if (sg && i < 0) {
         neg = 1;
         u = -i;
     }
@@ -97,12 +140,18 @@ static int printi(char ** out, int i, int b, int sg, int width, int pad, int let
     s = print_buf + PRINT_BUF_LEN-1;
     *s = '\0';
 
-    while (u) {
-        t = u % b;
-        if( t >= 10 )
-            t += letbase - '0' - 10;
-        *--s = t + '0';
-        u /= b;
+    if (b == 16) {
+        do {
+            *--s = digits[u & 0xF];
+            u >>= 4;
+        } while (u);
+    }
+    else {
+        do {
+            q = divu10(u);
+            *--s = '0' + (u - ((q << 3) + (q << 1)));
+            u = q;
+        } while (u);
     }
 
     if (neg) {
@@ -122,7 +171,7 @@ static int printi(char ** out, int i, int b, int sg, int width, int pad, int let
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
-static int print( char ** out, const char * format, va_list args )
+static int print( out_t * out, const char * format, va_list args )
 {
     register int width, pad;
     register int pc = 0;
@@ -143,28 +192,28 @@ static int print( char ** out, const char * format, va_list args )
                 pad |= PAD_ZERO;
             }
             for ( ; *format >= '0' && *format <= '9'; ++format) {
-                width *= 10;
+                width = (width << 3) + (width << 1);
                 width += *format - '0';
             }
             if( *format == 's' ) {
-                register char *s = (char *)va_arg( args, int );
+                register char *s = va_arg( args, char * );
                 pc += prints (out, s ? s : "(null)", width, pad);
                 continue;
             }
             if( *format == 'd' ) {
-                pc += printi (out, va_arg( args, int ), 10, 1, width, pad, 'a');
+                pc += printi (out, va_arg( args, int ), 10, 1, width, pad, hex_lower);
                 continue;
             }
             if( *format == 'x' ) {
-                pc += printi (out, va_arg( args, int ), 16, 0, width, pad, 'a');
+                pc += printi (out, va_arg( args, int ), 16, 0, width, pad, hex_lower);
                 continue;
             }
             if( *format == 'X' ) {
-                pc += printi (out, va_arg( args, int ), 16, 0, width, pad, 'A');
+                pc += printi (out, va_arg( args, int ), 16, 0, width, pad, hex_upper);
                 continue;
             }
             if( *format == 'u' ) {
-                pc += printi (out, va_arg( args, int ), 10, 0, width, pad, 'a');
+                pc += printi (out, va_arg( args, int ), 10, 0, width, pad, hex_lower);
                 continue;
             }
             if( *format == 'c' ) {
@@ -181,8 +230,7 @@ static int print( char ** out, const char * format, va_list args )
             ++pc;
         }
     }
-    if (out) **out = '\0';
-    va_end( args );
+    if (out->buf) *out->buf = '\0';
     return pc;
 }
 
@@ -192,33 +240,50 @@ static int print( char ** out, const char * format, va_list args )
 int printf(const char * format, ...)
 {
     va_list args;
+    out_t   out = { NULL, 0 };
+    int     pc;
 
     va_start( args, format );
-    return print( 0, format, args );
+    pc = print( &out, format, args );
+    va_end( args );
+    return pc;
 }
 
 //-----------------------------------------------------------------------------
 //
 //-----------------------------------------------------------------------------
-int sprintf(char * out, const char * format, ...)
+int sprintf(char * buf, const char * format, ...)
 {
     va_list args;
+    out_t   out = { buf, ~0u };         // caller vouches for the room
+    int     pc;
 
     va_start( args, format );
-    return print( &out, format, args );
+    pc = print( &out, format, args );
+    va_end( args );
+    return pc;
 }
 
 //-----------------------------------------------------------------------------
-//
+// Writes at most count chars, the NUL included.
 //-----------------------------------------------------------------------------
 int snprintf( char * buf, unsigned int count, const char *format, ... )
 {
     va_list args;
+    char    nothing;
+    out_t   out = { buf, count - 1 };
+    int     pc;
 
-    ( void ) count;
+    if (count == 0) {
+        /* Only the length is wanted: nothing may be written to buf. */
+        out.buf  = &nothing;
+        out.room = 0;
+    }
 
     va_start( args, format );
-    return print( &buf, format, args );
+    pc = print( &out, format, args );
+    va_end( args );
+    return pc;
 }
 
 //-----------------------------------------------------------------------------
@@ -233,4 +298,3 @@ int puts(const char * string)
     putchar('\n');
     return 0;
 }
-
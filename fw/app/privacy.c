@@ -0,0 +1,225 @@
+/*---------------------------------------------------------------------------*/
+/*  privacy.c   resolvable private address rotation                         */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "nrf_error.h"
+#include "ble.h"
+#include "ble_gap.h"
+#include "app_timer.h"
+
+#include "config.h"
+#include "evq.h"
+#include "privacy.h"
+#include "diag.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define PRIVACY_RPA_INTERVAL_TICKS \
+        APP_TIMER_TICKS(PRIVACY_RPA_INTERVAL_S * 1000, APP_TIMER_PRESCALER)
+
+/* The two most significant bits of prand are 0b01 for a resolvable address. */
+#define RPA_PRAND_MSB_MASK       0x3F
+#define RPA_PRAND_MSB_TYPE       0x40
+
+#define RPA_PRAND_LEN            3
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+/* Identity Resolving Key, LSB first as the SoftDevice expects it. */
+static ble_gap_irk_t      m_irk;
+
+static ble_gap_addr_t     m_addr;
+static ble_gap_addr_t     m_next_addr;
+
+static volatile bool      m_next_ready      = false;
+static volatile bool      m_prepare_pending = false;
+
+static uint32_t           m_last_ticks      = 0;
+static uint32_t           m_elapsed_ticks   = 0;
+
+/*---------------------------------------------------------------------------*/
+/*  Random address hash: ah(k, r) = e(k, r') mod 2^24  (Core v4.1 Vol 3 H.2.2) */
+/*  The ECB peripheral works MSB first, BLE addresses and keys LSB first.    */
+/*---------------------------------------------------------------------------*/
+static uint32_t rpa_generate(ble_gap_addr_t * p_addr)
+{
+    nrf_ecb_hal_data_t  ecb;
+    uint8_t             prand [RPA_PRAND_LEN];
+    uint32_t            err_code;
+    int                 i;
+
+    err_code = sd_rand_application_vector_get(prand, sizeof(prand));
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+    prand[2] = (prand[2] & RPA_PRAND_MSB_MASK) | RPA_PRAND_MSB_TYPE;
+
+    memset(&ecb, 0, sizeof(ecb));
+
+    for (i = 0; i < SOC_ECB_KEY_LENGTH; i++) {
+        ecb.key[i] = m_irk.irk[SOC_ECB_KEY_LENGTH - 1 - i];
+    }
+
+    ecb.cleartext[13] = prand[2];
+    ecb.cleartext[14] = prand[1];
+    ecb.cleartext[15] = prand[0];
+
+    err_code = sd_ecb_block_encrypt(&ecb);
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+    p_addr->addr_type = BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_RESOLVABLE;
+    p_addr->addr[0]   = ecb.ciphertext[15];
+    p_addr->addr[1]   = ecb.ciphertext[14];
+    p_addr->addr[2]   = ecb.ciphertext[13];
+    p_addr->addr[3]   = prand[0];
+    p_addr->addr[4]   = prand[1];
+    p_addr->addr[5]   = prand[2];
+
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Derive the IRK from the factory Identity Root: IRK = d1(IR, 1, 0)        */
+/*---------------------------------------------------------------------------*/
+static void irk_derive(void)
+{
+    nrf_ecb_hal_data_t  ecb;
+    int                 i;
+
+    memset(&ecb, 0, sizeof(ecb));
+
+    memcpy(ecb.key, (uint8_t*) &NRF_FICR->IR[0], SOC_ECB_KEY_LENGTH);
+
+    ecb.cleartext[15] = 0x01;
+
+    APP_ERROR_CHECK( sd_ecb_block_encrypt(&ecb) );
+
+    for (i = 0; i < BLE_GAP_SEC_KEY_LEN; i++) {
+        m_irk.irk[i] = ecb.ciphertext[BLE_GAP_SEC_KEY_LEN - 1 - i];
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Scheduler context: compute the next address away from the radio path.   */
+/*---------------------------------------------------------------------------*/
+static void privacy_prepare_next(uintptr_t arg)
+{
+    m_prepare_pending = false;
+
+    if (rpa_generate(&m_next_addr) == NRF_SUCCESS) {
+        m_next_ready = true;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void privacy_schedule_prepare(void)
+{
+    if (m_next_ready || m_prepare_pending)
+        return;
+
+    if (evq_put(EVQ_HIGH, privacy_prepare_next, 0) == NRF_SUCCESS) {
+        m_prepare_pending = true;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Called from the radio notification, ahead of the advertising event that  */
+/*  carries the next frame.  A new address is only ever applied here, so a   */
+/*  rotation never lands inside an advertising event.                        */
+/*---------------------------------------------------------------------------*/
+void privacy_frame_boundary(void)
+{
+    uint32_t now;
+    uint32_t diff;
+
+    app_timer_cnt_get(&now);
+    app_timer_cnt_diff_compute(now, m_last_ticks, &diff);
+
+    m_last_ticks     = now;
+    m_elapsed_ticks += diff;
+
+    if (m_elapsed_ticks < PRIVACY_RPA_INTERVAL_TICKS)
+        return;
+
+    if (!m_next_ready) {
+        DIAG_INC(rpa_late);
+        privacy_schedule_prepare();
+        return;
+    }
+
+    /* If the stack is busy, try again at the next frame boundary. */
+    if (sd_ble_gap_address_set(BLE_GAP_ADDR_CYCLE_MODE_NONE, &m_next_addr) != NRF_SUCCESS) {
+        DIAG_INC(rpa_failed);
+        return;
+    }
+
+    DIAG_INC(rpa_rotations);
+
+    m_addr          = m_next_addr;
+    m_next_ready    = false;
+    m_elapsed_ticks = 0;
+
+    privacy_schedule_prepare();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void privacy_addr_get(ble_gap_addr_t * p_addr)
+{
+    *p_addr = m_addr;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Must be called after the BLE stack is enabled.                           */
+/*---------------------------------------------------------------------------*/
+void privacy_init(void)
+{
+    ble_opt_t opt;
+    uint32_t  err_code;
+
+    irk_derive();
+
+    /*
+     *  Hand the IRK to the SoftDevice: it is distributed as our identity
+     *  information when device_manager bonds, so paired phones can resolve us.
+     *  Address cycling itself stays manual (see privacy_frame_boundary).
+     */
+    memset(&opt, 0, sizeof(opt));
+    opt.gap.privacy.p_irk      = &m_irk;
+    opt.gap.privacy.interval_s = PRIVACY_RPA_INTERVAL_S;
+
+    APP_ERROR_CHECK( sd_ble_opt_set(BLE_GAP_OPT_PRIVACY, &opt) );
+
+    /* The RNG pool may still be filling right after stack enable. */
+    do {
+        err_code = rpa_generate(&m_addr);
+    } while (err_code == NRF_ERROR_SOC_RAND_NOT_ENOUGH_VALUES);
+    APP_ERROR_CHECK(err_code);
+
+    APP_ERROR_CHECK( sd_ble_gap_address_set(BLE_GAP_ADDR_CYCLE_MODE_NONE, &m_addr) );
+
+    PRINTF("RPA: %02X:%02X:%02X:%02X:%02X:%02X\n",
+           m_addr.addr[5], m_addr.addr[4], m_addr.addr[3],
+           m_addr.addr[2], m_addr.addr[1], m_addr.addr[0]);
+
+    app_timer_cnt_get(&m_last_ticks);
+
+    privacy_schedule_prepare();
+}
@@ -0,0 +1,16 @@
+/*---------------------------------------------------------------------------*/
+/*  privacy.h                                                                */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _PRIVACY_H_
+#define _PRIVACY_H_
+
+#include <stdint.h>
+
+#include "ble_gap.h"
+
+void privacy_init(void);
+void privacy_addr_get(ble_gap_addr_t * p_addr);
+void privacy_frame_boundary(void);
+
+#endif  /* _PRIVACY_H_ */
@@ -9,16 +9,17 @@
 #define PSTORAGE_FLASH_PAGE_SIZE    ((uint16_t)NRF_FICR->CODEPAGESIZE)
 #define PSTORAGE_FLASH_EMPTY_MASK    0xFFFFFFFF
 
-#define PSTORAGE_FLASH_PAGE_END                                     \
-        ((NRF_UICR->BOOTLOADERADDR != PSTORAGE_FLASH_EMPTY_MASK)    \
-        ? (NRF_UICR->BOOTLOADERADDR / PSTORAGE_FLASH_PAGE_SIZE)     \
-        : NRF_FICR->CODESIZE)
+/* The top of flash, even with the DFU boot page in UICR.BOOTLOADERADDR:
+   it sits below the pstorage pages (config.h), which stay where they were. */
+#define PSTORAGE_FLASH_PAGE_END     NRF_FICR->CODESIZE
 
 
+/* device_manager: 1 page, settings: 2 pages (A/B), history: 2 pages. */
 #define PSTORAGE_MAX_APPLICATIONS   3    
+#define PSTORAGE_DATA_PAGES         5
 #define PSTORAGE_MIN_BLOCK_SIZE     0x0010
 
-#define PSTORAGE_DATA_START_ADDR    ((PSTORAGE_FLASH_PAGE_END - PSTORAGE_MAX_APPLICATIONS - 1) * PSTORAGE_FLASH_PAGE_SIZE)
+#define PSTORAGE_DATA_START_ADDR    ((PSTORAGE_FLASH_PAGE_END - PSTORAGE_DATA_PAGES - 1) * PSTORAGE_FLASH_PAGE_SIZE)
 #define PSTORAGE_DATA_END_ADDR      ((PSTORAGE_FLASH_PAGE_END - 1) * PSTORAGE_FLASH_PAGE_SIZE) 
 
 #define PSTORAGE_SWAP_ADDR          PSTORAGE_DATA_END_ADDR 
@@ -0,0 +1,74 @@
+/*---------------------------------------------------------------------------*/
+/*  ramlog.c   debug log into a RAM ring, read over SWD (DBGLOG_RAM)        */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  No pins, no peripheral, no interrupt: a byte costs a store and an
+ *  increment, whether a debugger is attached or not.  So the log can be
+ *  left on in the production configuration, buzzer included.
+ *
+ *  The id is written last in ramlog_init(), so a reader never takes a
+ *  half set up block for a real one.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "app_util.h"
+
+#include "config.h"
+#include "ramlog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define RAMLOG_MASK    (RAMLOG_SIZE - 1)
+
+STATIC_ASSERT((RAMLOG_SIZE & RAMLOG_MASK) == 0);
+
+ramlog_t g_ramlog;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void ramlog_init(void)
+{
+    g_ramlog.size    = RAMLOG_SIZE;
+    g_ramlog.written = 0;
+
+    memcpy(g_ramlog.id, RAMLOG_ID, sizeof(g_ramlog.id));
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Called from any priority: one writer at a time.                          */
+/*---------------------------------------------------------------------------*/
+void ramlog_putc(uint8_t ch)
+{
+    CRITICAL_REGION_ENTER();
+
+    g_ramlog.data[g_ramlog.written & RAMLOG_MASK] = ch;
+    g_ramlog.written++;
+
+    CRITICAL_REGION_EXIT();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  A block goes in whole, so a record is never split by another writer.     */
+/*---------------------------------------------------------------------------*/
+void ramlog_write(const uint8_t * data, uint16_t length)
+{
+    uint32_t at;
+    uint16_t i;
+
+    CRITICAL_REGION_ENTER();
+
+    at = g_ramlog.written;
+    for (i = 0; i < length; i++)
+        g_ramlog.data[(at + i) & RAMLOG_MASK] = data[i];
+    g_ramlog.written = at + length;
+
+    CRITICAL_REGION_EXIT();
+}
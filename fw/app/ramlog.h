@@ -0,0 +1,33 @@
+/*---------------------------------------------------------------------------*/
+/*  ramlog.h                                                                 */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _RAMLOG_H_
+#define _RAMLOG_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ *  Debug log kept in RAM, for a debugger to read over SWD (DBGLOG_RAM).
+ *  The writer never waits and never looks at the reader: the oldest bytes
+ *  are overwritten, and the reader works out from `written` what it has
+ *  missed.  fw/tools/ramlog.py finds the block by symbol or by its id.
+ */
+#define RAMLOG_ID          "RAMLOG1"
+
+typedef struct {
+    char               id [8];
+    uint32_t           size;            // of data, a power of two
+    volatile uint32_t  written;         // bytes ever written; never wraps back
+    uint8_t            data [RAMLOG_SIZE];
+} ramlog_t;
+
+extern ramlog_t g_ramlog;
+
+void ramlog_init(void);
+void ramlog_putc(uint8_t ch);
+void ramlog_write(const uint8_t * data, uint16_t length);
+
+#endif /* _RAMLOG_H_ */
@@ -0,0 +1,405 @@
+/*---------------------------------------------------------------------------*/
+/*  settings.c   log-structured persistent configuration on pstorage        */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Two flash pages (A and B) are used in turn.  Each page starts with a
+ *  header slot holding an epoch; the page with the highest valid epoch is
+ *  the active one.  Records are fixed size snapshots appended to the
+ *  active page, each protected by a CRC.  When the active page is full
+ *  the spare page is erased, the newest record is copied into it and
+ *  then its header is written with epoch + 1: that header write is the
+ *  commit point, so a power loss at any step leaves one valid page.
+ *  Each step is queued only once the one before it has succeeded: after
+ *  a failed erase nothing is written over the old contents, and the
+ *  active page stays the active page until the commit.  A failed step
+ *  starts the compaction over, at most SETTINGS_ATTEMPTS times a save.
+ *
+ *  Because records are only ever appended, the written part of a page is
+ *  a prefix: the boot scan binary searches for the first erased slot and
+ *  walks back over any torn record, instead of reading the whole page.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "pstorage.h"
+#include "crc16.h"
+#include "app_util.h"
+
+#include "config.h"
+#include "settings.h"
+#include "flash_queue.h"
+#include "pstorage_platform.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define SETTINGS_PAGES             2
+
+#define SETTINGS_PAGE_MAGIC        0x53455454   /* "SETT" */
+
+#define SETTINGS_RECORD_DATA_SIZE  24
+
+#define FLASH_ERASED_WORD          0xFFFFFFFF
+
+/* Failed flash ops per settings_save(), before it waits for the next. */
+#define SETTINGS_ATTEMPTS          3
+
+/* What a queued flash operation is, for its callback. */
+typedef enum {
+    SETTINGS_OP_APPEND = 0,
+    SETTINGS_OP_ERASE,          // compaction: the spare page
+    SETTINGS_OP_COPY,           // then the newest record into it
+    SETTINGS_OP_COMMIT,         // then its header
+} settings_op_t;
+
+typedef struct {
+    uint16_t  crc;          // CRC16 over everything after this field
+    uint8_t   len;          // valid bytes in data (never 0xFF)
+    uint8_t   rfu;
+    uint32_t  seq;          // record sequence number
+    uint8_t   data [SETTINGS_RECORD_DATA_SIZE];
+} settings_record_t;
+
+typedef struct {
+    uint32_t  magic;
+    uint32_t  epoch;
+    uint32_t  epoch_inv;    // ~epoch: detects a torn header write
+} settings_header_t;
+
+STATIC_ASSERT(sizeof(settings_t) <= SETTINGS_RECORD_DATA_SIZE);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+static pstorage_handle_t  m_base_handle;
+static pstorage_handle_t  m_page_handle [SETTINGS_PAGES];
+
+static settings_t         m_settings;
+
+/* The flash queue keeps pointers to these until the operation completes. */
+static settings_record_t  m_record;
+static settings_header_t  m_header;
+
+static uint8_t            m_active      = 0;
+static uint32_t           m_epoch       = 0;
+static uint32_t           m_seq         = 0;
+static uint16_t           m_next_slot   = 0;
+static uint16_t           m_slot_count  = 0;
+
+static uint8_t            m_ops_pending = 0;
+static bool               m_dirty       = false;
+static bool               m_compact     = false;
+static uint8_t            m_failures    = 0;    // since the last save
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint16_t record_crc(settings_record_t const * p_record)
+{
+    return crc16_compute((uint8_t const *) &p_record->len,
+                         sizeof(settings_record_t) - sizeof(p_record->crc),
+                         NULL);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void record_read(uint8_t page, uint16_t slot, settings_record_t * p_record)
+{
+    APP_ERROR_CHECK( pstorage_load((uint8_t*) p_record,
+                                   &m_page_handle[page],
+                                   sizeof(settings_record_t),
+                                   slot * sizeof(settings_record_t)) );
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Only the first word is checked: writes land in address order, so a       */
+/*  record whose first word is still erased has not been started.            */
+/*---------------------------------------------------------------------------*/
+static bool slot_is_erased(uint8_t page, uint16_t slot)
+{
+    uint32_t word;
+
+    APP_ERROR_CHECK( pstorage_load((uint8_t*) &word,
+                                   &m_page_handle[page],
+                                   sizeof(word),
+                                   slot * sizeof(settings_record_t)) );
+
+    return (word == FLASH_ERASED_WORD);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static bool page_epoch_get(uint8_t page, uint32_t * p_epoch)
+{
+    settings_header_t header;
+
+    APP_ERROR_CHECK( pstorage_load((uint8_t*) &header,
+                                   &m_page_handle[page],
+                                   sizeof(header), 0) );
+
+    if (header.magic != SETTINGS_PAGE_MAGIC || header.epoch != ~header.epoch_inv)
+        return false;
+
+    *p_epoch = header.epoch;
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Returns the first erased slot; slot 0 is the page header.                */
+/*---------------------------------------------------------------------------*/
+static uint16_t page_first_free_slot(uint8_t page)
+{
+    uint16_t lo = 1;
+    uint16_t hi = m_slot_count;
+
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+
+        if (slot_is_erased(page, mid))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return lo;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Walk back from the end of the written prefix to the newest good record.  */
+/*---------------------------------------------------------------------------*/
+static bool page_newest_record(uint8_t page, uint16_t end, settings_record_t * p_record)
+{
+    while (end > 1) {
+        end--;
+        record_read(page, end, p_record);
+
+        if (p_record->len <= SETTINGS_RECORD_DATA_SIZE &&
+            p_record->crc == record_crc(p_record)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void settings_defaults(void)
+{
+    memset(&m_settings, 0, sizeof(m_settings));
+
+    strncpy(m_settings.url, URL_DEFAULT_STRING, URL_MAX_LENGTH);
+    m_settings.url_len = strlen(URL_DEFAULT_STRING);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void settings_scan(void)
+{
+    settings_record_t record;
+    uint32_t          epoch [SETTINGS_PAGES];
+    bool              valid [SETTINGS_PAGES];
+    uint8_t           page;
+
+    for (page = 0; page < SETTINGS_PAGES; page++) {
+        valid[page] = page_epoch_get(page, &epoch[page]);
+    }
+
+    if (!valid[0] && !valid[1]) {
+        /* Fresh device: the first save starts a new page. */
+        m_compact = true;
+        return;
+    }
+
+    if (valid[0] && valid[1])
+        m_active = (epoch[1] > epoch[0]) ? 1 : 0;
+    else
+        m_active = valid[1] ? 1 : 0;
+
+    m_epoch     = epoch[m_active];
+    m_next_slot = page_first_free_slot(m_active);
+
+    if (!page_newest_record(m_active, m_next_slot, &record)) {
+        m_compact = true;
+        return;
+    }
+
+    m_seq = record.seq;
+
+    memcpy(&m_settings, record.data, MIN(record.len, sizeof(m_settings)));
+
+    PRINTF("settings: page %d, epoch %u, slot %u, seq %u\n",
+           m_active, (unsigned) m_epoch, m_next_slot, (unsigned) m_seq);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void record_build(void)
+{
+    memset(&m_record, 0, sizeof(m_record));
+
+    m_record.len = sizeof(m_settings);
+    m_record.seq = ++m_seq;
+
+    memcpy(m_record.data, &m_settings, sizeof(m_settings));
+
+    m_record.crc = record_crc(&m_record);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t * page_addr(uint8_t page, uint16_t slot)
+{
+    return (uint32_t*) (m_page_handle[page].block_id + slot * sizeof(settings_record_t));
+}
+
+static void settings_flash_cb(uint32_t result, void * p_context);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void flash_store(uint8_t page, uint16_t slot, void const * p_src, uint16_t size,
+                        settings_op_t op)
+{
+    APP_ERROR_CHECK( flash_queue_write(page_addr(page, slot),
+                                       (uint32_t const *) p_src,
+                                       size / sizeof(uint32_t),
+                                       settings_flash_cb, (void *) (uintptr_t) op) );
+    m_ops_pending++;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Queue an append, or start a compaction into the spare page when full.    */
+/*---------------------------------------------------------------------------*/
+static void settings_write_kick(void)
+{
+    if (m_ops_pending != 0 || !m_dirty)
+        return;
+
+    m_dirty = false;
+
+    record_build();
+
+    if (m_next_slot >= m_slot_count)
+        m_compact = true;
+
+    if (!m_compact) {
+        flash_store(m_active, m_next_slot, &m_record, sizeof(m_record), SETTINGS_OP_APPEND);
+        m_next_slot++;
+        return;
+    }
+
+    APP_ERROR_CHECK( flash_queue_erase(page_addr(m_active ^ 1, 0), 1,
+                                       settings_flash_cb, (void *) (uintptr_t) SETTINGS_OP_ERASE) );
+    m_ops_pending++;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void settings_flash_cb(uint32_t result, void * p_context)
+{
+    settings_op_t op = (settings_op_t) (uintptr_t) p_context;
+
+    if (m_ops_pending > 0)
+        m_ops_pending--;
+
+    if (result != NRF_SUCCESS) {
+        /* Start over on a freshly erased page with the latest settings.  A
+           failed compaction step goes no further. */
+        PRINTF("settings: flash op %u failed 0x%x\n", (unsigned) op, (unsigned) result);
+        m_compact = true;
+        m_dirty   = true;
+
+        /* A worn page would fail for ever: try again on the next save. */
+        if (++m_failures >= SETTINGS_ATTEMPTS)
+            return;
+    }
+    else if (op == SETTINGS_OP_ERASE) {
+        flash_store(m_active ^ 1, 1, &m_record, sizeof(m_record), SETTINGS_OP_COPY);
+    }
+    else if (op == SETTINGS_OP_COPY) {
+        m_header.magic     = SETTINGS_PAGE_MAGIC;
+        m_header.epoch     = m_epoch + 1;
+        m_header.epoch_inv = ~(m_epoch + 1);
+
+        /* Commit point: the header makes this page the newest. */
+        flash_store(m_active ^ 1, 0, &m_header, sizeof(m_header), SETTINGS_OP_COMMIT);
+    }
+    else if (op == SETTINGS_OP_COMMIT) {
+        m_active   ^= 1;
+        m_epoch    += 1;
+        m_next_slot = 2;
+        m_compact   = false;
+    }
+
+    settings_write_kick();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  pstorage only allocates the pages and loads; writes go via flash_queue.  */
+/*---------------------------------------------------------------------------*/
+static void settings_pstorage_cb(pstorage_handle_t * p_handle,
+                                 uint8_t             op_code,
+                                 uint32_t            result,
+                                 uint8_t           * p_data,
+                                 uint32_t            data_len)
+{
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+settings_t * settings_get(void)
+{
+    return &m_settings;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Persist the current settings; back-to-back saves are coalesced.          */
+/*---------------------------------------------------------------------------*/
+void settings_save(void)
+{
+    m_dirty    = true;
+    m_failures = 0;
+
+    settings_write_kick();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Must be called after pstorage_init() and flash_queue_init().             */
+/*---------------------------------------------------------------------------*/
+void settings_init(void)
+{
+    pstorage_module_param_t param;
+    uint8_t                 page;
+
+    param.block_size  = PSTORAGE_FLASH_PAGE_SIZE;
+    param.block_count = SETTINGS_PAGES;
+    param.cb          = settings_pstorage_cb;
+
+    APP_ERROR_CHECK( pstorage_register(&param, &m_base_handle) );
+
+    for (page = 0; page < SETTINGS_PAGES; page++) {
+        APP_ERROR_CHECK( pstorage_block_identifier_get(&m_base_handle,
+                                                       page,
+                                                       &m_page_handle[page]) );
+    }
+
+    m_slot_count = PSTORAGE_FLASH_PAGE_SIZE / sizeof(settings_record_t);
+
+    settings_defaults();
+    settings_scan();
+}
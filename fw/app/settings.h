@@ -0,0 +1,27 @@
+/*---------------------------------------------------------------------------*/
+/*  settings.h                                                               */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _SETTINGS_H_
+#define _SETTINGS_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+/*
+ *  Persistent configuration.  Stored as a whole snapshot in each record,
+ *  so it must fit in SETTINGS_RECORD_DATA_SIZE bytes.  Append new fields
+ *  at the end: older records are zero-extended when loaded.
+ */
+typedef struct {
+    uint8_t   url_len;
+    char      url [URL_MAX_LENGTH];
+    uint16_t  reset_count;
+} settings_t;
+
+void         settings_init(void);
+settings_t * settings_get(void);
+void         settings_save(void);
+
+#endif  /* _SETTINGS_H_ */
@@ -0,0 +1,317 @@
+/*---------------------------------------------------------------------------*/
+/*  telemetry.c   live sample stream over GATT notifications                */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  A repeating timer stamps the time and hands over to the scheduler,
+ *  which takes the sample and queues it in a small ring.  The ring is
+ *  drained, three samples per notification, into every TX buffer the
+ *  SoftDevice will take; BLE_EVT_TX_COMPLETE schedules the next round.
+ *  The timer only stamps the time, and the BLE events (SWI2) only read
+ *  m_enabled: turning the stream on and off is queued like the rest, so
+ *  the ring and the counters only change in the main loop and need no
+ *  locking.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "ble.h"
+#include "ble_gatts.h"
+#include "app_timer.h"
+#include "app_util.h"
+
+#include "config.h"
+#include "evq.h"
+#include "telemetry.h"
+#include "ble_eddy.h"
+#include "battery.h"
+#include "temperature.h"
+#include "eddystone.h"
+#include "diag.h"
+#include "dbglog.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define TELEMETRY_INTERVAL     APP_TIMER_TICKS(TELEMETRY_SAMPLE_MS, APP_TIMER_PRESCALER)
+
+#define TELEMETRY_STATS_EVERY  (1000 / TELEMETRY_SAMPLE_MS)
+
+#define TELEMETRY_RING_SIZE    (8 * TELEMETRY_SAMPLES_PER_PACKET)
+
+#define TELEMETRY_PACKET_LEN   20
+
+STATIC_ASSERT(2 + TELEMETRY_SAMPLES_PER_PACKET * sizeof(telemetry_sample_t) <= TELEMETRY_PACKET_LEN);
+STATIC_ASSERT(2 + sizeof(telemetry_stats_t) <= TELEMETRY_PACKET_LEN);
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+static app_timer_id_t       m_telemetry_timer_id;
+
+static bool                 m_enabled       = false;
+
+static telemetry_sample_t   m_ring [TELEMETRY_RING_SIZE];
+static uint8_t              m_head          = 0;
+static uint8_t              m_count         = 0;
+
+static volatile uint32_t    m_fired_ticks;          // set by the timer
+static volatile bool        m_sample_pending = false;
+static volatile uint8_t     m_missed        = 0;    // ticks skipped, timer side
+static uint8_t              m_missed_seen   = 0;
+
+static uint8_t              m_seq           = 0;
+static uint8_t              m_dropped_since = 0;    // since the last packet
+static uint16_t             m_until_stats   = TELEMETRY_STATS_EVERY;
+static bool                 m_stats_due     = false;
+
+static telemetry_stats_t    m_stats;
+static uint32_t             m_bytes_last    = 0;    // bytes_sent a second ago
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t packet_send(uint8_t * p_packet)
+{
+    ble_gatts_hvx_params_t hvx;
+    uint16_t               len = TELEMETRY_PACKET_LEN;
+
+    memset(&hvx, 0, sizeof(hvx));
+    hvx.handle = g_eddy_service.telemetry_char_handles.value_handle;
+    hvx.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx.p_len  = &len;
+    hvx.p_data = p_packet;
+
+    return sd_ble_gatts_hvx(g_eddy_service.conn_handle, &hvx);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The ring is not a power of two: wrap by compare, there is no divider.    */
+/*---------------------------------------------------------------------------*/
+static uint8_t ring_next(uint8_t index)
+{
+    return (index + 1 == TELEMETRY_RING_SIZE) ? 0 : index + 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Fill the TX buffers: stats first when due, then whole sample packets.    */
+/*---------------------------------------------------------------------------*/
+static void telemetry_enable_execute(uintptr_t enable);
+
+static void telemetry_pump(uintptr_t arg)
+{
+    uint8_t  packet [TELEMETRY_PACKET_LEN];
+    uint8_t  tail;
+    uint8_t  i;
+    uint32_t err_code;
+
+    while (m_enabled) {
+
+        memset(packet, 0, sizeof(packet));
+
+        if (m_stats_due) {
+            packet[0] = TELEMETRY_PACKET_STATS | (m_seq & 0x7F);
+            memcpy(&packet[2], &m_stats, sizeof(m_stats));
+        }
+        else if (m_count >= TELEMETRY_SAMPLES_PER_PACKET) {
+            packet[0] = m_seq & 0x7F;
+            packet[1] = m_dropped_since;
+
+            tail = (m_head >= m_count) ? m_head - m_count :
+                                         m_head + TELEMETRY_RING_SIZE - m_count;
+            for (i = 0; i < TELEMETRY_SAMPLES_PER_PACKET; i++) {
+                memcpy(&packet[2 + i * sizeof(telemetry_sample_t)],
+                       &m_ring[tail], sizeof(telemetry_sample_t));
+                tail = ring_next(tail);
+            }
+        }
+        else {
+            return;
+        }
+
+        err_code = packet_send(packet);
+
+        if (err_code == BLE_ERROR_NO_TX_BUFFERS)
+            return;
+
+        if (err_code != NRF_SUCCESS) {
+            /* Disconnected or notifications turned off under us. */
+            telemetry_enable_execute(false);
+            return;
+        }
+
+        m_seq++;
+        m_stats.bytes_sent += TELEMETRY_PACKET_LEN;
+
+        if (m_stats_due) {
+            m_stats_due = false;
+        }
+        else {
+            m_count        -= TELEMETRY_SAMPLES_PER_PACKET;
+            m_dropped_since = 0;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void samples_dropped(uint8_t count)
+{
+    m_stats.dropped += count;
+
+    m_dropped_since = (m_dropped_since + count > UINT8_MAX) ?
+                      UINT8_MAX : m_dropped_since + count;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void telemetry_sample(uintptr_t arg)
+{
+    telemetry_sample_t * p_sample;
+    uint32_t             now;
+    uint32_t             latency;
+    uint8_t              missed;
+    uint32_t             adv_cnt;
+    uint32_t             radio_cnt;
+
+    app_timer_cnt_get(&now);
+    app_timer_cnt_diff_compute(now, m_fired_ticks, &latency);
+
+    m_sample_pending = false;
+
+    if (!m_enabled)
+        return;
+
+    /* Ticks the timer skipped because the scheduler was behind. */
+    missed = m_missed;
+    if (missed != m_missed_seen) {
+        samples_dropped((uint8_t)(missed - m_missed_seen));
+        m_missed_seen = missed;
+    }
+
+    if (m_count == TELEMETRY_RING_SIZE) {
+        /* The link is not keeping up. */
+        samples_dropped(1);
+    }
+    else {
+        p_sample = &m_ring[m_head];
+
+        p_sample->ticks         = (uint16_t) m_fired_ticks;
+        p_sample->vbat_adc      = battery_adc_get();
+        p_sample->sched_latency = (latency > UINT8_MAX) ? UINT8_MAX : latency;
+        p_sample->temp          = temperature_raw_get();
+
+        m_head = ring_next(m_head);
+        m_count++;
+    }
+
+    if (--m_until_stats == 0) {
+        m_until_stats = TELEMETRY_STATS_EVERY;
+
+        eddystone_counters_get(&adv_cnt, &radio_cnt);
+        m_stats.adv_count     = adv_cnt;
+        m_stats.radio_count   = radio_cnt;
+        m_stats.bytes_per_sec = m_stats.bytes_sent - m_bytes_last;
+        m_bytes_last          = m_stats.bytes_sent;
+        m_stats_due           = true;
+    }
+
+    telemetry_pump(0);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Timer context: only stamp the time, the sampling blocks.                 */
+/*---------------------------------------------------------------------------*/
+static void telemetry_timeout_handler(void * p_context)
+{
+    DIAG_INC(wake_timer);
+
+    if (m_sample_pending) {
+        /* The previous sample has not even been taken yet. */
+        m_missed++;
+        return;
+    }
+
+    app_timer_cnt_get((uint32_t *) &m_fired_ticks);
+
+    if (evq_put(EVQ_HIGH, telemetry_sample, 0) == NRF_SUCCESS)
+        m_sample_pending = true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void telemetry_enable_execute(uintptr_t enable)
+{
+    if ((bool) enable == m_enabled)
+        return;
+
+    m_enabled = enable;
+
+    if (enable) {
+        memset(&m_stats, 0, sizeof(m_stats));
+        m_count         = 0;
+        m_dropped_since = 0;
+        m_missed_seen   = m_missed;
+        m_bytes_last    = 0;
+        m_until_stats   = TELEMETRY_STATS_EVERY;
+        m_stats_due     = false;
+
+        APP_ERROR_CHECK( app_timer_start(m_telemetry_timer_id, TELEMETRY_INTERVAL, NULL) );
+    }
+    else {
+        APP_ERROR_CHECK( app_timer_stop(m_telemetry_timer_id) );
+    }
+
+    PRINTF("telemetry: %s\n", enable ? "on" : "off");
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Called on a CCCD write, and when the link goes away (SWI2).              */
+/*---------------------------------------------------------------------------*/
+void telemetry_enable(bool enable)
+{
+    /* Queue full: an enable is lost until the CCCD is written again; a
+       stream left running stops itself at the first send that fails. */
+    (void) evq_put(EVQ_HIGH, telemetry_enable_execute, enable);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void telemetry_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id) {
+
+        case BLE_EVT_TX_COMPLETE:
+            /* Queue full: the next sample pumps as well. */
+            if (m_enabled)
+                (void) evq_put(EVQ_HIGH, telemetry_pump, 0);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            telemetry_enable(false);
+            break;
+
+        default:
+            /* No implementation needed. */
+            break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void telemetry_init(void)
+{
+    APP_ERROR_CHECK( app_timer_create(&m_telemetry_timer_id,
+                                      APP_TIMER_MODE_REPEATED,
+                                      telemetry_timeout_handler) );
+}
@@ -0,0 +1,48 @@
+/*---------------------------------------------------------------------------*/
+/*  telemetry.h                                                              */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ble.h"
+
+/*
+ *  Live telemetry on the Telemetry characteristic (0xfad5), streaming
+ *  while its notifications are enabled.  Every notification is 20 bytes:
+ *
+ *  Samples:  u8 seq (bit 7 clear), u8 samples dropped since the previous
+ *            packet (saturating), then TELEMETRY_SAMPLES_PER_PACKET x
+ *            telemetry_sample_t.
+ *
+ *  Stats:    u8 seq | 0x80, u8 0, then telemetry_stats_t, once a second.
+ */
+
+#define TELEMETRY_SAMPLES_PER_PACKET   3
+
+#define TELEMETRY_PACKET_STATS         0x80
+
+typedef struct {
+    uint16_t  ticks;            // RTC1 count, low 16 bits (30.5 us units)
+    uint8_t   vbat_adc;         // raw 8-bit ADC reading, VDD/3 against 1.2 V
+    uint8_t   sched_latency;    // timer to scheduler delay, RTC1 ticks (sat.)
+    int16_t   temp;             // 0.25 C units
+} __attribute__ ((packed)) telemetry_sample_t;
+
+typedef struct {
+    uint32_t  adv_count;        // advertising frames set
+    uint32_t  radio_count;      // radio active notifications
+    uint32_t  bytes_sent;       // of telemetry queued, since the stream was enabled
+    uint16_t  bytes_per_sec;    // over the last second
+    uint32_t  dropped;          // samples, since the stream was enabled
+} __attribute__ ((packed)) telemetry_stats_t;
+
+void telemetry_init(void);
+
+void telemetry_enable(bool enable);
+void telemetry_on_ble_evt(ble_evt_t * p_ble_evt);
+
+#endif  /* _TELEMETRY_H_ */
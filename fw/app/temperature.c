@@ -26,3 +26,15 @@ uint16_t temperature_data_get(void)
 
     return (hi << 8) | lo;
 }
+
+/*---------------------------------------------------------------------------*/
+/*  Die temperature in 0.25 C steps, as returned by the SoftDevice.          */
+/*---------------------------------------------------------------------------*/
+int16_t temperature_raw_get(void)
+{
+    int32_t temp;
+
+    APP_ERROR_CHECK( sd_temp_get(&temp) );
+
+    return (int16_t) temp;
+}
@@ -8,5 +8,6 @@
 #include <stdint.h>
 
 uint16_t temperature_data_get(void);
+int16_t  temperature_raw_get(void);
 
 #endif  /* _TEMPERATURE_H_ */
@@ -1,42 +1,67 @@
-/* 
- *  Copyright (c) 2016 Robin Callender. All Rights Reserved.
- */
+/*---------------------------------------------------------------------------*/
+/*  tones.c   generated by melody.py from tones.txt: do not edit             */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
 #include <stdint.h>
 
+#include "app_util.h"
+
 #include "config.h"
 #include "buzzer.h"
+#include "tones.h"
 
-/*---------------------------------------------------------------------------*/
-/* Collection of sounds and tones                                            */
-/*---------------------------------------------------------------------------*/
+/* melody.py worked to this timer clock and this longest note. */
+STATIC_ASSERT(BUZZER_TIMER_HZ == 4000000 && BUZZER_MS(700) <= 0xFFFF);
 
-buzzer_play_t startup_sound [] = {
-    {.action = BUZZER_PLAY_TONE,  .duration=200, .frequency=400},   // short buzz   200ms
-    {.action = BUZZER_PLAY_QUIET, .duration=200, .frequency=0},     // short quiet
-    {.action = BUZZER_PLAY_TONE,  .duration=200, .frequency=400},   // short buzz
-    {.action = BUZZER_PLAY_QUIET, .duration=200, .frequency=0},     // short quiet
-    {.action = BUZZER_PLAY_TONE,  .duration=700, .frequency=400},   // long buzz    700ms
-    {.action = BUZZER_PLAY_DONE,  .duration=0,   .frequency=0},     // stop
+/* d=4,o=8,b=300: d#, p, d#, p, d#/700 */
+const buzzer_play_t startup_sound [] = {
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_QUIET, .duration = BUZZER_MS( 200), .compare =     0},
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_QUIET, .duration = BUZZER_MS( 200), .compare =     0},
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 700), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_DONE,  .duration = 0,              .compare =     0},
 };
 
-buzzer_play_t one_beep_sound [] = {
-    {.action = BUZZER_PLAY_TONE,  .duration=200, .frequency=400},   // short buzz   200ms
-    {.action = BUZZER_PLAY_DONE,  .duration=0,   .frequency=0},     // stop
+/* d=4,o=8,b=300: d# */
+const buzzer_play_t one_beep_sound [] = {
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_DONE,  .duration = 0,              .compare =     0},
 };
 
-buzzer_play_t two_beeps_sound [] = {
-    {.action = BUZZER_PLAY_TONE,  .duration=200, .frequency=400},   // short buzz   200ms
-    {.action = BUZZER_PLAY_QUIET, .duration=200, .frequency=0},     // short quiet
-    {.action = BUZZER_PLAY_TONE,  .duration=200, .frequency=400},   // short buzz
-    {.action = BUZZER_PLAY_DONE,  .duration=0,   .frequency=0},     // stop
+/* d=4,o=8,b=300: d#, p, d# */
+const buzzer_play_t two_beeps_sound [] = {
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_QUIET, .duration = BUZZER_MS( 200), .compare =     0},
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_DONE,  .duration = 0,              .compare =     0},
 };
 
-buzzer_play_t three_beeps_sound [] = {
-    {.action = BUZZER_PLAY_TONE,  .duration=200, .frequency=400},   // short buzz   200ms
-    {.action = BUZZER_PLAY_QUIET, .duration=200, .frequency=0},     // short quiet
-    {.action = BUZZER_PLAY_TONE,  .duration=200, .frequency=400},   // short buzz
-    {.action = BUZZER_PLAY_QUIET, .duration=200, .frequency=0},     // short quiet
-    {.action = BUZZER_PLAY_TONE,  .duration=200, .frequency=400},   // short buzz
-    {.action = BUZZER_PLAY_DONE,  .duration=0,   .frequency=0},     // stop
+/* d=4,o=8,b=300: d#, p, d#, p, d# */
+const buzzer_play_t three_beeps_sound [] = {
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_QUIET, .duration = BUZZER_MS( 200), .compare =     0},
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_QUIET, .duration = BUZZER_MS( 200), .compare =     0},
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =   402},   // d#8  4978 Hz
+    {.action = BUZZER_PLAY_DONE,  .duration = 0,              .compare =     0},
 };
 
+/* d=16,o=7,b=180: c, e, g, c8, 8p, c, e, g, c8, 8p, c, e, g, c8 */
+const buzzer_play_t find_me_sound [] = {
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   956},   // c7   2093 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   758},   // e7   2637 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   638},   // g7   3136 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   478},   // c8   4186 Hz
+    {.action = BUZZER_PLAY_QUIET, .duration = BUZZER_MS( 167), .compare =     0},
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   956},   // c7   2093 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   758},   // e7   2637 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   638},   // g7   3136 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   478},   // c8   4186 Hz
+    {.action = BUZZER_PLAY_QUIET, .duration = BUZZER_MS( 167), .compare =     0},
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   956},   // c7   2093 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   758},   // e7   2637 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   638},   // g7   3136 Hz
+    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(  83), .compare =   478},   // c8   4186 Hz
+    {.action = BUZZER_PLAY_DONE,  .duration = 0,              .compare =     0},
+};
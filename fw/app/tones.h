@@ -1,18 +1,16 @@
-/* 
- *  Copyright (c) 2016 Robin Callender. All Rights Reserved.
- */
+/*---------------------------------------------------------------------------*/
+/*  tones.h   generated by melody.py from tones.txt: do not edit             */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
 #ifndef __TONES_H__
 #define __TONES_H__
 
 #include "buzzer.h"
 
-/*---------------------------------------------------------------------------*/
-/* Collection of sounds and tones                                            */
-/*---------------------------------------------------------------------------*/
-
-extern buzzer_play_t startup_sound;
-extern buzzer_play_t one_beep_sound;
-extern buzzer_play_t two_beeps_sound;
-extern buzzer_play_t three_beeps_sound;
+extern const buzzer_play_t startup_sound [];
+extern const buzzer_play_t one_beep_sound [];
+extern const buzzer_play_t two_beeps_sound [];
+extern const buzzer_play_t three_beeps_sound [];
+extern const buzzer_play_t find_me_sound [];
 
 #endif /* __TONES_H__ */
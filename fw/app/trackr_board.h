@@ -16,9 +16,10 @@
 
 /*---------------------------------------------------------------------------*/
 /*  The UART and Buzzer use the same GPIO pins, so mutually exclusive.       */
+/*  The RAM log (DBGLOG_RAM) needs no pins and goes with either.             */
 /*---------------------------------------------------------------------------*/
 
-#ifdef DBGLOG_SUPPORT
+#if defined(DBGLOG_SUPPORT) && !defined(DBGLOG_RAM)
   #define TRACKR_RX            P0_10
   #define TRACKR_TX            P0_23
   #define TX_PIN_NUMBER        TRACKR_TX
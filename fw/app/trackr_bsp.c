@@ -10,11 +10,16 @@
 #include "nordic_common.h"
 #include "nrf.h"
 #include "nrf_gpio.h"
+#include "nrf_gpiote.h"
 #include "nrf_error.h"
+#include "nrf_soc.h"
 
+#include "app_util.h"
 #include "app_timer.h"
 #include "app_gpiote.h"
-#include "app_button.h"
+#include "gesture.h"
+#include "evq.h"
+#include "diag.h"
 #include "dbglog.h"
 
 /*---------------------------------------------------------------------------*/
@@ -43,28 +48,91 @@
 
 #define ALERT_INTERVAL                         200
 
+/*
+ *  Connected: the LED is dimmed, not solid, at this many 256ths.
+ */
+#define CONNECTED_LED_DUTY                     24
+
+/*---------------------------------------------------------------------------*/
+/*  The connected LED is dimmed in hardware: TIMER1 counts at 31.25 kHz,     */
+/*  CC[0] ends the on time and CC[1] the period (and clears the count), and  */
+/*  PPI routes both compares to a GPIOTE toggle of the LED pin: PWM at       */
+/*  122 Hz, and the timer never interrupts.                                  */
+/*                                                                           */
+/*  The timer runs on the HFCLK, which it requests by itself: the RC         */
+/*  oscillator, about 0.85 mA with the timer, for as long as it runs.  That  */
+/*  is cheaper than the LED on solid (2 mA), but dearer than waking the CPU  */
+/*  a few times a second: the slow blinks, advertising and alert, toggle     */
+/*  the pin from an app_timer instead.                                       */
+/*                                                                           */
+/*  The buzzer has TIMER2, GPIOTE channels 0-1 and PPI channels 0-1.         */
+/*---------------------------------------------------------------------------*/
+
+#define LED_TIMER               NRF_TIMER1
+#define LED_TIMER_PAN73         (*(volatile uint32_t *) 0x40009C0C)   // see buzzer.c
+#define LED_TIMER_PRESCALER     9                   // 16 MHz / 2^9
+#define LED_GPIOTE_CHANNEL      2
+#define LED_PPI_CH_ON           2                   // CC[0]: on time over
+#define LED_PPI_CH_PERIOD       3                   // CC[1]: period over
+
+#define LED_PPI_MASK            ((PPI_CHEN_CH2_Enabled << PPI_CHEN_CH2_Pos) | \
+                                 (PPI_CHEN_CH3_Enabled << PPI_CHEN_CH3_Pos))
+
+typedef struct {
+    uint16_t  on;               // timer ticks
+    uint16_t  period;
+} led_pattern_t;
+
+static const led_pattern_t m_led_connected = {
+    .on     = CONNECTED_LED_DUTY,
+    .period = 256,
+};
+
+typedef struct {
+    uint16_t  on;               // ms
+    uint16_t  off;
+} led_blink_t;
+
+static const led_blink_t m_blink_advertising = {
+    .on     = ADVERTISING_LED_ON_INTERVAL,
+    .off    = ADVERTISING_LED_OFF_INTERVAL,
+};
+
+static const led_blink_t m_blink_alert = {
+    .on     = ALERT_INTERVAL,
+    .off    = ALERT_INTERVAL,
+};
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
 
 static bsp_indication_t m_stable_state        = BSP_INDICATE_IDLE;
-static uint32_t         m_app_ticks_per_100ms = 0;
 static uint32_t         m_indication_type     = 0;
 static app_timer_id_t   m_leds_timer_id;
 
-static bsp_event_callback_t m_registered_callback         = NULL;
-static bsp_event_t          m_events_list[BUTTONS_NUMBER] = {BSP_EVENT_NOTHING};
+static const led_blink_t * volatile mp_blink  = NULL;     // NULL: not blinking
 
-static void bsp_button_event_handler(uint8_t pin_no, uint8_t button_action);
+static bsp_event_callback_t m_registered_callback         = NULL;
 
 static const uint32_t m_buttons_list[BUTTONS_NUMBER] = BUTTONS_LIST;
 
-static const app_button_cfg_t app_buttons[BUTTONS_NUMBER] =
-{
-    {BSP_BUTTON_0, false, BUTTON_PULL, bsp_button_event_handler},
+/*---------------------------------------------------------------------------*/
+/*  The button: app_gpiote flips the pin's PORT sense on every edge, and     */
+/*  each edge is stamped with the RTC and handed to the gesture engine.      */
+/*  A timer runs only between a short press and the end of the window for    */
+/*  a second one; otherwise nothing is armed and nothing wakes the CPU.      */
+/*---------------------------------------------------------------------------*/
+
+static const gesture_cfg_t  m_gesture_cfg = {
+    .debounce = APP_TIMER_TICKS(BUTTON_DEBOUNCE_MS, APP_TIMER_PRESCALER),
+    .hold     = APP_TIMER_TICKS(BUTTON_LONG_MS,     APP_TIMER_PRESCALER),
+    .gap      = APP_TIMER_TICKS(BUTTON_DOUBLE_MS,   APP_TIMER_PRESCALER),
 };
 
-#define BSP_MS_TO_TICK(MS) (m_app_ticks_per_100ms * (MS / 100))
+static gesture_engine_t     m_gesture;
+static app_gpiote_user_id_t m_gpiote_user;
+static app_timer_id_t       m_gesture_timer_id;
 
 #define ALERT_LED_MASK BSP_LED_0_MASK
 
@@ -101,27 +169,199 @@ uint32_t bsp_button_is_pressed(uint32_t button, bool * p_state)
     return NRF_SUCCESS;
 }
 
+/*---------------------------------------------------------------------------*/
+/*  The callback runs from the scheduler, not the interrupt.                 */
+/*---------------------------------------------------------------------------*/
+static void bsp_event_execute(uintptr_t arg)
+{
+    m_registered_callback((bsp_event_t) arg);
+}
+
+static void bsp_gesture(gesture_t gesture)
+{
+    bsp_event_t event;
+
+    switch (gesture) {
+        case GESTURE_SHORT:   event = BSP_EVENT_BUTTON_SHORT;   break;
+        case GESTURE_LONG:    event = BSP_EVENT_BUTTON_LONG;    break;
+        case GESTURE_DOUBLE:  event = BSP_EVENT_BUTTON_DOUBLE;  break;
+        default:              return;
+    }
+
+    /* Queue full: the press is lost, and counted in the overflows. */
+    if (m_registered_callback != NULL)
+        (void) evq_put(EVQ_LOW, bsp_event_execute, event);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start, move or stop the timeout after every change of state.             */
+/*---------------------------------------------------------------------------*/
+static void bsp_gesture_timer_update(uint32_t now)
+{
+    uint32_t wait = gesture_wait(&m_gesture, now);
+
+    if (wait == 0) {
+        APP_ERROR_CHECK( app_timer_stop(m_gesture_timer_id) );
+        return;
+    }
+
+    if (wait < APP_TIMER_MIN_TIMEOUT_TICKS)
+        wait = APP_TIMER_MIN_TIMEOUT_TICKS;
+
+    APP_ERROR_CHECK( app_timer_stop(m_gesture_timer_id) );
+    APP_ERROR_CHECK( app_timer_start(m_gesture_timer_id, wait, NULL) );
+}
+
+/*---------------------------------------------------------------------------*/
+/*  In the GPIOTE interrupt.  The button pulls the pin low.                  */
+/*---------------------------------------------------------------------------*/
+static void bsp_button_event_handler(uint32_t pins_low_to_high, uint32_t pins_high_to_low)
+{
+    uint32_t now;
+
+    DIAG_INC(wake_button);
+
+    app_timer_cnt_get(&now);
+
+    if (pins_high_to_low & BSP_BUTTON_0_MASK)
+        bsp_gesture(gesture_edge(&m_gesture, true, now));
+    else if (pins_low_to_high & BSP_BUTTON_0_MASK)
+        bsp_gesture(gesture_edge(&m_gesture, false, now));
+
+    bsp_gesture_timer_update(now);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  In the RTC1 interrupt, below GPIOTE: keep the edges out meanwhile.       */
+/*---------------------------------------------------------------------------*/
+static void bsp_gesture_timeout_handler(void * p_context)
+{
+    gesture_t gesture;
+    uint32_t  now;
+
+    CRITICAL_REGION_ENTER();
+
+    app_timer_cnt_get(&now);
+    gesture = gesture_timeout(&m_gesture, now);
+
+    CRITICAL_REGION_EXIT();
+
+    bsp_gesture(gesture);
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
-static void bsp_button_event_handler(uint8_t pin_no, uint8_t button_action)
+static void led_blink_stop(void)
 {
-    bsp_event_t event  = BSP_EVENT_NOTHING;
-    uint32_t    button = 0;
+    mp_blink = NULL;
 
-    if ((button_action == APP_BUTTON_PUSH) && (m_registered_callback != NULL)) {
-        while (m_buttons_list[button] != pin_no) {
-            button++;
-        }
+    (void) app_timer_stop(m_leds_timer_id);
 
-        if (button < BUTTONS_NUMBER) {
-            event = m_events_list[button];
-        }
+    LEDS_OFF(BSP_LED_0_MASK);
+}
 
-        if (event != BSP_EVENT_NOTHING) {
-            m_registered_callback(event);
-        }
+/*---------------------------------------------------------------------------*/
+/*  Hand the LED back to the GPIO, off.                                      */
+/*---------------------------------------------------------------------------*/
+static void led_pattern_stop(void)
+{
+    LED_TIMER->TASKS_STOP = 1;
+    LED_TIMER_PAN73 = 0;
+
+    (void) sd_ppi_channel_enable_clr(LED_PPI_MASK);
+
+    nrf_gpiote_unconfig(LED_GPIOTE_CHANNEL);
+
+    LEDS_OFF(BSP_LED_0_MASK);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start a pattern from the beginning of its on time.                       */
+/*---------------------------------------------------------------------------*/
+static uint32_t led_pattern_start(const led_pattern_t * p_pattern)
+{
+    uint32_t err_code;
+
+    led_blink_stop();
+    led_pattern_stop();
+
+    LED_TIMER->MODE      = TIMER_MODE_MODE_Timer;
+    LED_TIMER->BITMODE   = TIMER_BITMODE_BITMODE_16Bit;
+    LED_TIMER->PRESCALER = LED_TIMER_PRESCALER;
+    LED_TIMER->CC[0]     = p_pattern->on;
+    LED_TIMER->CC[1]     = p_pattern->period;
+    LED_TIMER->SHORTS    = (TIMER_SHORTS_COMPARE1_CLEAR_Enabled << TIMER_SHORTS_COMPARE1_CLEAR_Pos);
+    LED_TIMER->INTENCLR  = 0xFFFFFFFF;
+    LED_TIMER->TASKS_CLEAR = 1;
+
+    /* The pin goes to its initial value, on, as soon as it is configured. */
+    nrf_gpiote_task_config(LED_GPIOTE_CHANNEL,
+                           BSP_LED_0,
+                           NRF_GPIOTE_POLARITY_TOGGLE,
+                           (LEDS_INV_MASK & BSP_LED_0_MASK) ? NRF_GPIOTE_INITIAL_VALUE_LOW
+                                                            : NRF_GPIOTE_INITIAL_VALUE_HIGH);
+
+    err_code = sd_ppi_channel_assign(LED_PPI_CH_ON,
+                                     &LED_TIMER->EVENTS_COMPARE[0],
+                                     &NRF_GPIOTE->TASKS_OUT[LED_GPIOTE_CHANNEL]);
+    if (err_code != NRF_SUCCESS) return err_code;
+
+    err_code = sd_ppi_channel_assign(LED_PPI_CH_PERIOD,
+                                     &LED_TIMER->EVENTS_COMPARE[1],
+                                     &NRF_GPIOTE->TASKS_OUT[LED_GPIOTE_CHANNEL]);
+    if (err_code != NRF_SUCCESS) return err_code;
+
+    err_code = sd_ppi_channel_enable_set(LED_PPI_MASK);
+    if (err_code != NRF_SUCCESS) return err_code;
+
+    LED_TIMER_PAN73 = 1;
+    LED_TIMER->TASKS_START = 1;
+
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Start a blink from the beginning of its on time.                         */
+/*---------------------------------------------------------------------------*/
+static uint32_t led_blink_start(const led_blink_t * p_blink)
+{
+    led_pattern_stop();
+    led_blink_stop();
+
+    mp_blink = p_blink;
+    LEDS_ON(BSP_LED_0_MASK);
+
+    return app_timer_start(m_leds_timer_id,
+                           APP_TIMER_TICKS(p_blink->on, APP_TIMER_PRESCALER),
+                           NULL);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void leds_timer_handler(void * p_context)
+{
+    const led_blink_t * p_blink = mp_blink;
+    uint32_t            next;
+
+    DIAG_INC(wake_timer);
+
+    if (p_blink == NULL)
+        return;
+
+    if (LED_IS_ON(BSP_LED_0_MASK)) {
+        LEDS_OFF(BSP_LED_0_MASK);
+        next = p_blink->off;
     }
+    else {
+        LEDS_ON(BSP_LED_0_MASK);
+        next = p_blink->on;
+    }
+
+    APP_ERROR_CHECK( app_timer_start(m_leds_timer_id,
+                                     APP_TIMER_TICKS(next, APP_TIMER_PRESCALER),
+                                     NULL) );
 }
 
 /*---------------------------------------------------------------------------*/
@@ -129,54 +369,35 @@ static void bsp_button_event_handler(uint8_t pin_no, uint8_t button_action)
 /*---------------------------------------------------------------------------*/
 static uint32_t bsp_led_indication(bsp_indication_t indicate)
 {
-    uint32_t err_code   = NRF_SUCCESS;
-    uint32_t next_delay = 0;
+    uint32_t err_code = NRF_SUCCESS;
+
+    /* Already showing it: leave the pattern running, in phase. */
+    if (indicate == m_stable_state)
+        return NRF_SUCCESS;
 
     switch (indicate) {
 
         case BSP_INDICATE_IDLE:
-            LEDS_OFF(LEDS_MASK & ~ALERT_LED_MASK);
+        case BSP_INDICATE_ADVERTISING_DONE:
+        case BSP_INDICATE_USER_STATE_OFF:
+            led_pattern_stop();
+            led_blink_stop();
             m_stable_state = indicate;
             break;
 
         case BSP_INDICATE_ADVERTISING:
-            LEDS_OFF(LEDS_MASK & ~BSP_LED_0_MASK & ~ALERT_LED_MASK);
-            if (LED_IS_ON(BSP_LED_0_MASK)) {
-                LEDS_OFF(BSP_LED_0_MASK);
-                next_delay = indicate ==
-                             BSP_INDICATE_ADVERTISING ? ADVERTISING_LED_OFF_INTERVAL :
-                             ADVERTISING_SLOW_LED_OFF_INTERVAL;
-            }
-            else {
-                LEDS_ON(BSP_LED_0_MASK);
-                next_delay = indicate ==
-                             BSP_INDICATE_ADVERTISING ? ADVERTISING_LED_ON_INTERVAL :
-                             ADVERTISING_SLOW_LED_ON_INTERVAL;
-            }
+            err_code = led_blink_start(&m_blink_advertising);
             m_stable_state = indicate;
-            err_code = app_timer_start(m_leds_timer_id, BSP_MS_TO_TICK(next_delay), NULL);
-            break;
-
-        case BSP_INDICATE_ADVERTISING_DONE:
-            LEDS_OFF(BSP_LED_0_MASK);
-            m_stable_state = indicate;
-            err_code = app_timer_stop(m_leds_timer_id);
             break;
 
         case BSP_INDICATE_CONNECTED:
-            LEDS_OFF(LEDS_MASK & ~BSP_LED_0_MASK & ~ALERT_LED_MASK);
-            LEDS_ON(BSP_LED_0_MASK);
-            m_stable_state = indicate;
-            break;
-
         case BSP_INDICATE_USER_STATE_ON:
-            LEDS_OFF(LEDS_MASK & ~BSP_LED_0_MASK & ~ALERT_LED_MASK);
-            LEDS_ON(BSP_LED_0_MASK);
+            err_code = led_pattern_start(&m_led_connected);
             m_stable_state = indicate;
             break;
 
-        case BSP_INDICATE_USER_STATE_OFF:
-            LEDS_OFF(BSP_LED_0_MASK);
+        case BSP_INDICATE_ALERT:
+            err_code = led_blink_start(&m_blink_alert);
             m_stable_state = indicate;
             break;
 
@@ -194,16 +415,6 @@ static uint32_t bsp_led_indication(bsp_indication_t indicate)
     return err_code;
 }
 
-/*---------------------------------------------------------------------------*/
-/*                                                                           */
-/*---------------------------------------------------------------------------*/
-static void leds_timer_handler(void * p_context)
-{
-    if (m_indication_type & BSP_INIT_LED) {
-        bsp_led_indication(m_stable_state);
-    }
-}
-
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -218,6 +429,14 @@ uint32_t bsp_indication_set(bsp_indication_t indicate)
     return err_code;
 }
 
+/*---------------------------------------------------------------------------*/
+/*  What the LED shows now, e.g. to go back to after an alert.               */
+/*---------------------------------------------------------------------------*/
+bsp_indication_t bsp_indication_get(void)
+{
+    return m_stable_state;
+}
+
 /*---------------------------------------------------------------------------*/
 /*                                                                           */
 /*---------------------------------------------------------------------------*/
@@ -234,58 +453,39 @@ uint32_t bsp_init(uint32_t type, uint32_t ticks_per_100ms,
 {
     uint32_t err_code = NRF_SUCCESS;
 
-    m_app_ticks_per_100ms = ticks_per_100ms;
     m_indication_type     = type;
 
     m_registered_callback = callback;
 
     if (type & BSP_INIT_BUTTON) {
-        uint32_t button_id;
+        nrf_gpio_cfg_input(BSP_BUTTON_0, BUTTON_PULL);
 
-        for (button_id = 0; (button_id < BUTTONS_NUMBER); button_id++) {
-            bsp_event_t event_id;
+        gesture_init(&m_gesture, &m_gesture_cfg);
 
-            event_id = (bsp_event_t)(BSP_EVENT_KEY_0 + button_id);
-
-            err_code = bsp_event_to_button_assign( button_id, event_id );
-            if (err_code != NRF_SUCCESS) return err_code;
-        }
+        err_code = app_timer_create(&m_gesture_timer_id,
+                                    APP_TIMER_MODE_SINGLE_SHOT,
+                                    bsp_gesture_timeout_handler);
+        if (err_code != NRF_SUCCESS) return err_code;
 
-        APP_BUTTON_INIT((app_button_cfg_t *)app_buttons, 
-                         BUTTONS_NUMBER,
-                         ticks_per_100ms / 2,
-                         false);
+        err_code = app_gpiote_user_register(&m_gpiote_user,
+                                            BSP_BUTTON_0_MASK,
+                                            BSP_BUTTON_0_MASK,
+                                            bsp_button_event_handler);
+        if (err_code != NRF_SUCCESS) return err_code;
 
-        err_code = app_button_enable();
+        err_code = app_gpiote_user_enable(m_gpiote_user);
     }
 
     if (type & BSP_INIT_LED) {
         NRF_GPIO->DIRCLR = BUTTONS_MASK;
         LEDS_OFF(LEDS_MASK);
         NRF_GPIO->DIRSET = LEDS_MASK;
-    }
-
-    if (err_code == NRF_SUCCESS) {
-        err_code = app_timer_create(&m_leds_timer_id, 
-                                    APP_TIMER_MODE_SINGLE_SHOT,
-                                    leds_timer_handler);
-    }
 
-    return err_code;
-}
-
-/*---------------------------------------------------------------------------*/
-/*                                                                           */
-/*---------------------------------------------------------------------------*/
-uint32_t bsp_event_to_button_assign(uint32_t button, bsp_event_t event)
-{
-    uint32_t err_code = NRF_SUCCESS;
-
-    if (button < BUTTONS_NUMBER) {
-        m_events_list[button] = event;
-    }
-    else {
-        err_code = NRF_ERROR_INVALID_PARAM;
+        if (err_code == NRF_SUCCESS) {
+            err_code = app_timer_create(&m_leds_timer_id,
+                                        APP_TIMER_MODE_SINGLE_SHOT,
+                                        leds_timer_handler);
+        }
     }
 
     return err_code;
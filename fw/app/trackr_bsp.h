@@ -33,7 +33,8 @@ typedef enum {
     BSP_INDICATE_FATAL_ERROR,
     BSP_INDICATE_USER_STATE_OFF,
     BSP_INDICATE_USER_STATE_ON,
-    BSP_INDICATE_LAST = BSP_INDICATE_USER_STATE_ON
+    BSP_INDICATE_ALERT,
+    BSP_INDICATE_LAST = BSP_INDICATE_ALERT
 } bsp_indication_t;
 
 typedef enum {
@@ -41,8 +42,9 @@ typedef enum {
     BSP_EVENT_DISCONNECT,
     BSP_EVENT_ADVERTISING_START,
     BSP_EVENT_ADVERTISING_STOP,
-    BSP_EVENT_KEY_0,
-    BSP_EVENT_KEY_LAST = BSP_EVENT_KEY_0,
+    BSP_EVENT_BUTTON_SHORT,
+    BSP_EVENT_BUTTON_LONG,
+    BSP_EVENT_BUTTON_DOUBLE,
 } bsp_event_t;
 
 typedef void (* bsp_event_callback_t)(bsp_event_t);
@@ -54,8 +56,8 @@ typedef void (* bsp_event_callback_t)(bsp_event_t);
 uint32_t bsp_init(uint32_t type, uint32_t ticks_per_100ms, bsp_event_callback_t callback);
 uint32_t bsp_buttons_state_get(uint32_t * p_buttons_state);
 uint32_t bsp_button_is_pressed(uint32_t button, bool * p_state);
-uint32_t bsp_event_to_button_assign(uint32_t button, bsp_event_t event);
 uint32_t bsp_indication_set(bsp_indication_t indicate);
+bsp_indication_t bsp_indication_get(void);
 uint32_t bsp_indication_text_set(bsp_indication_t indicate, const char * p_text);
 uint32_t bsp_buttons_enable(uint32_t buttons);
 
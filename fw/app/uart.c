@@ -2,10 +2,24 @@
 /* uart.c                                                                     */
 /* 38400 bps, 8 data bits, 1 stop bit, No Flow Control                        */
 /*----------------------------------------------------------------------------*/
+/*
+ *  Transmit is buffered: callers copy into a ring and return, the UART
+ *  interrupt sends it.  When the ring is full the rest of the message is
+ *  dropped and counted, nobody waits.  The UART is only enabled while it
+ *  has something to send, as it keeps the HFCLK running while enabled.
+ *
+ *  A message is a text line (up to '\n') or one uart_write() block.
+ *
+ *  Receive is off unless uart_rx_start() is called; from then on the UART
+ *  stays enabled, and each byte is handed to the handler in the interrupt.
+ */
 
 #include <stdbool.h>
 
 #include "nrf.h"
+#include "nrf_soc.h"
+#include "app_util.h"
+#include "app_error.h"
 #include "uart.h"
 #include "nrf_gpio.h"
 #include "config.h"
@@ -16,12 +30,96 @@
 
 #define BAUD_RATE  (UART_BAUDRATE_BAUDRATE_Baud38400 << UART_BAUDRATE_BAUDRATE_Pos)
 
+#define TX_MASK    (UART_TX_BUFFER_SIZE - 1)
+
+STATIC_ASSERT((UART_TX_BUFFER_SIZE & TX_MASK) == 0);
+STATIC_ASSERT(UART_TX_BUFFER_SIZE <= 256);
+
+static uint8_t            m_tx_buf [UART_TX_BUFFER_SIZE];
+static volatile uint8_t   m_tx_head;        /* next free, written by callers  */
+static volatile uint8_t   m_tx_tail;        /* next to send, written by IRQ   */
+static volatile uint16_t  m_tx_count;
+static volatile bool      m_tx_busy;        /* UART enabled and sending       */
+static volatile bool      m_tx_dropping;    /* rest of this line is dropped   */
+static volatile uint32_t  m_tx_dropped;
+
+static uart_rx_handler_t  m_rx_handler;     /* NULL: receive is off           */
+
+/*----------------------------------------------------------------------------*/
+/*  Called in a critical region with the ring not empty.                      */
+/*----------------------------------------------------------------------------*/
+static void tx_start(void)
+{
+    NRF_UART0->ENABLE        = UART_ENABLE_ENABLE_Enabled;
+    NRF_UART0->EVENTS_TXDRDY = 0;
+    NRF_UART0->TASKS_STARTTX = 1;
+    NRF_UART0->TXD           = m_tx_buf[m_tx_tail];
+    m_tx_busy = true;
+}
+
+/*----------------------------------------------------------------------------*/
+/*  A byte has gone: send the next one, or power down.                        */
+/*----------------------------------------------------------------------------*/
+static void tx_next(void)
+{
+    CRITICAL_REGION_ENTER();
+
+    if (NRF_UART0->EVENTS_TXDRDY) {
+        NRF_UART0->EVENTS_TXDRDY = 0;
+
+        m_tx_tail = (m_tx_tail + 1) & TX_MASK;
+        m_tx_count--;
+
+        if (m_tx_count) {
+            NRF_UART0->TXD = m_tx_buf[m_tx_tail];
+        }
+        else {
+            NRF_UART0->TASKS_STOPTX = 1;
+            if (m_rx_handler == NULL)
+                NRF_UART0->ENABLE   = UART_ENABLE_ENABLE_Disabled;
+            m_tx_busy = false;
+        }
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+/*----------------------------------------------------------------------------*/
+/*                                                                            */
+/*----------------------------------------------------------------------------*/
+void UART0_IRQHandler(void)
+{
+    if (NRF_UART0->EVENTS_RXDRDY) {
+        NRF_UART0->EVENTS_RXDRDY = 0;
+        m_rx_handler((uint8_t) NRF_UART0->RXD);
+    }
+
+    if (NRF_UART0->EVENTS_ERROR) {
+        /* Overrun, framing or break: the byte is lost, carry on. */
+        NRF_UART0->EVENTS_ERROR = 0;
+        NRF_UART0->ERRORSRC     = NRF_UART0->ERRORSRC;
+    }
+
+    tx_next();
+}
+
+/*----------------------------------------------------------------------------*/
+/*  Called in a critical region.                                              */
+/*----------------------------------------------------------------------------*/
+static void tx_put(uint8_t ch)
+{
+    m_tx_buf[m_tx_head] = ch;
+    m_tx_head = (m_tx_head + 1) & TX_MASK;
+    m_tx_count++;
+}
+
 /*----------------------------------------------------------------------------*/
 /*                                                                            */
 /*----------------------------------------------------------------------------*/
 void uart_init(void)
 {
-    // Configure UART0 pins.
+    // Configure UART0 pins; TX idles high while the UART is off.
+    nrf_gpio_pin_set(TX_PIN_NUMBER);
     nrf_gpio_cfg_output(TX_PIN_NUMBER);
     nrf_gpio_cfg_input(RX_PIN_NUMBER, NRF_GPIO_PIN_NOPULL);
 
@@ -34,20 +132,84 @@ void uart_init(void)
     NRF_UART0->EVENTS_TXDRDY   = 0;
     NRF_UART0->EVENTS_ERROR    = 0;
 
-    // Activate UART.
-    NRF_UART0->ENABLE          = UART_ENABLE_ENABLE_Enabled;
-    NRF_UART0->INTENSET        = 0;
-    NRF_UART0->TASKS_STARTTX   = 1;
-    NRF_UART0->TASKS_STARTRX   = 1;
+    // Left disabled until there is something to send.
+    NRF_UART0->ENABLE          = UART_ENABLE_ENABLE_Disabled;
+    NRF_UART0->INTENSET        = UART_INTENSET_TXDRDY_Msk;
+
+    APP_ERROR_CHECK( sd_nvic_SetPriority(UART0_IRQn, NRF_APP_PRIORITY_LOW) );
+    APP_ERROR_CHECK( sd_nvic_EnableIRQ(UART0_IRQn) );
 }
 
 /*----------------------------------------------------------------------------*/
-/*                                                                            */
+/*  Keeps the UART enabled from now on: it draws the HFCLK all the time.      */
 /*----------------------------------------------------------------------------*/
-void uart_putc(uint8_t ch) {
-    NRF_UART0->TXD = ch;
-    while (NRF_UART0->EVENTS_TXDRDY != 1) {/* spin */};
-    NRF_UART0->EVENTS_TXDRDY = 0;
+void uart_rx_start(uart_rx_handler_t handler)
+{
+    CRITICAL_REGION_ENTER();
+
+    m_rx_handler = handler;
+
+    NRF_UART0->ENABLE        = UART_ENABLE_ENABLE_Enabled;
+    NRF_UART0->EVENTS_RXDRDY = 0;
+    NRF_UART0->EVENTS_ERROR  = 0;
+    NRF_UART0->INTENSET      = UART_INTENSET_RXDRDY_Msk | UART_INTENSET_ERROR_Msk;
+    NRF_UART0->TASKS_STARTRX = 1;
+
+    CRITICAL_REGION_EXIT();
+}
+
+/*----------------------------------------------------------------------------*/
+/*  Once a byte of a line has been dropped, so is the rest of it: a whole     */
+/*  line is better than one with a hole in it.  The '\n' still goes if it     */
+/*  fits, ending what was sent of the line; either way the next line starts   */
+/*  afresh.                                                                   */
+/*----------------------------------------------------------------------------*/
+void uart_putc(uint8_t ch)
+{
+    CRITICAL_REGION_ENTER();
+
+    if (m_tx_dropping && ch != '\n') {
+        /* dropped */
+    }
+    else if (m_tx_count < UART_TX_BUFFER_SIZE) {
+        m_tx_dropping = false;
+        tx_put(ch);
+        if (!m_tx_busy)
+            tx_start();
+    }
+    else {
+        if (!m_tx_dropping)
+            m_tx_dropped++;
+        m_tx_dropping = (ch != '\n');
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+/*----------------------------------------------------------------------------*/
+/*  All of it or none of it.                                                  */
+/*----------------------------------------------------------------------------*/
+bool uart_write(const uint8_t * data, uint16_t length)
+{
+    bool     fits;
+    uint16_t i;
+
+    CRITICAL_REGION_ENTER();
+
+    fits = (length <= UART_TX_BUFFER_SIZE - m_tx_count);
+    if (fits) {
+        for (i = 0; i < length; i++)
+            tx_put(data[i]);
+        if (length && !m_tx_busy)
+            tx_start();
+    }
+    else {
+        m_tx_dropped++;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return fits;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -56,13 +218,26 @@ void uart_putc(uint8_t ch) {
 void uart_puts(uint8_t * str) {
 
     while(*str) {
-        NRF_UART0->TXD = *str;
-        while (NRF_UART0->EVENTS_TXDRDY != 1) {/* spin */};
-        NRF_UART0->EVENTS_TXDRDY = 0;
-        ++str;
+        uart_putc(*str++);
     }
+    uart_putc('\n');
+}
 
-    NRF_UART0->TXD = '\n';
-    while (NRF_UART0->EVENTS_TXDRDY != 1) {/* spin */};
-    NRF_UART0->EVENTS_TXDRDY = 0;
+/*----------------------------------------------------------------------------*/
+/*  Wait until everything is out, e.g. before a reset.  Polls, so it also     */
+/*  works from above the UART's priority (not with interrupts disabled).      */
+/*----------------------------------------------------------------------------*/
+void uart_flush(void)
+{
+    while (m_tx_busy) {
+        tx_next();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/*                                                                            */
+/*----------------------------------------------------------------------------*/
+uint32_t uart_dropped(void)
+{
+    return m_tx_dropped;
 }
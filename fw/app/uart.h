@@ -4,10 +4,17 @@
 #ifndef UART_H
 #define UART_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
-void    uart_putc( uint8_t ch );
-void    uart_puts( uint8_t * str );
-void    uart_init( void );
+typedef void (*uart_rx_handler_t)( uint8_t ch );
+
+void     uart_putc( uint8_t ch );
+void     uart_puts( uint8_t * str );
+bool     uart_write( const uint8_t * data, uint16_t length );
+void     uart_flush( void );
+uint32_t uart_dropped( void );
+void     uart_init( void );
+void     uart_rx_start( uart_rx_handler_t handler );
 
 #endif  /* UART_H */
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+#
+#  dbglog.py   turn a tokenized debug log back into text
+#  Copyright (c) 2016 Robin Callender. All Rights Reserved.
+#
+#  Firmware built with DBGLOG_TOKENS="yes" sends records instead of text
+#  (see fw/app/dbglog.h); the format strings stay behind in the .dbglog
+#  section of the .elf.  Capture the UART to a file, raw bytes, then:
+#
+#  Usage:
+#    dbglog.py <trackr.elf> <capture.bin>
+#    dbglog.py <trackr.elf> -              read the capture from stdin
+#
+#  The .elf has to be the one that is running on the device.
+#
+
+import re
+import struct
+import sys
+
+REC_PRINTF = 0xA0
+REC_DUMP   = 0xB0
+DUMP_MORE  = 0x01
+MAX_ARGS   = 8
+
+SPEC = re.compile(r'%(-?)(0*)(\d*)([sdiuxXc%])')
+
+
+# --- ELF -------------------------------------------------------------------
+
+def read_section(path, wanted):
+    elf = open(path, 'rb').read()
+    if elf[:4] != b'\x7fELF':
+        raise ValueError('%s: not an ELF file' % path)
+    wide = elf[4] == 2
+    if wide:
+        shoff, = struct.unpack_from('<Q', elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x3A)
+        fmt, name_at, off_at, size_at = '<IIQQQQ', 0, 4, 5
+    else:
+        shoff, = struct.unpack_from('<I', elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+        fmt, name_at, off_at, size_at = '<IIIIII', 0, 4, 5
+
+    def header(i):
+        return struct.unpack_from(fmt, elf, shoff + i * shentsize)
+
+    names = header(shstrndx)
+    for i in range(shnum):
+        h = header(i)
+        start = names[off_at] + h[name_at]
+        name = elf[start:elf.index(b'\0', start)].decode()
+        if name == wanted:
+            return elf[h[off_at]:h[off_at] + h[size_at]]
+    raise ValueError('%s: no %s section (built without DBGLOG_TOKENS?)' % (path, wanted))
+
+
+# --- records ---------------------------------------------------------------
+
+class Truncated(Exception):
+    pass
+
+
+class Reader:
+    def __init__(self, data, pos):
+        self.data, self.pos = data, pos
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise Truncated()
+        b = self.data[self.pos]
+        self.pos += 1
+        return b
+
+    def varint(self):
+        v = shift = 0
+        while True:
+            b = self.byte()
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return v & 0xFFFFFFFF
+            if shift > 35:
+                raise ValueError('bad varint')
+
+    def string(self):
+        out = bytearray()
+        while True:
+            b = self.byte()
+            if b == 0:
+                return out.decode('latin-1')
+            out.append(b)
+
+
+def format_string(strings, ident):
+    if ident >= len(strings):
+        raise ValueError('unknown id %d' % ident)
+    end = strings.index(b'\0', ident)
+    return strings[ident:end].decode('latin-1')
+
+
+def render(fmt, reader):
+    """Pull each argument in the order the format asks for it."""
+    out = []
+    last = 0
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        left, zero, width, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        if conv == 's':
+            text = reader.string()
+        else:
+            v = reader.varint()
+            if conv in 'di':
+                text = str(v - (1 << 32) if v & 0x80000000 else v)
+            elif conv == 'u':
+                text = str(v)
+            elif conv == 'x':
+                text = '%x' % v
+            elif conv == 'X':
+                text = '%X' % v
+            else:
+                text = chr(v & 0xFF)
+        w = int(width) if width else 0
+        if left:
+            text = text.ljust(w)
+        elif zero and conv != 's':
+            neg = text.startswith('-')
+            text = ('-' if neg else '') + text.lstrip('-').rjust(w - neg, '0')
+        else:
+            text = text.rjust(w)
+        out.append(text)
+    out.append(fmt[last:])
+    return ''.join(out)
+
+
+def dump(data, offset=0, last=True):
+    """Laid out as fw/app/dump.c does it, blank line after whole lines."""
+    lines = []
+    for off in range(0, len(data), 16):
+        chunk = data[off:off + 16]
+        hexes = ' '.join('%02X' % b for b in chunk).ljust(47)
+        text = ''.join(chr(b) if 32 <= b < 127 else '.' for b in chunk)
+        lines.append('%05X: %s  %s\n' % (offset + off, hexes, text))
+    if last and len(data) % 16 == 0:
+        lines.append('\n')
+    return ''.join(lines)
+
+
+def decode(strings, data):
+    """Yield text for each record; skip bytes until a record decodes."""
+    pos = 0
+    skipped = 0
+    while pos < len(data):
+        head = data[pos]
+        reader = Reader(data, pos + 1)
+        try:
+            if head & 0xF0 == REC_PRINTF and head & 0x0F <= MAX_ARGS:
+                text = render(format_string(strings, reader.varint()), reader)
+            elif head & ~DUMP_MORE == REC_DUMP:
+                offset = reader.varint()
+                n = reader.varint()
+                text = dump(bytes(reader.byte() for _ in range(n)), offset,
+                            not head & DUMP_MORE)
+            else:
+                raise ValueError('not a record')
+        except Truncated:
+            break
+        except (ValueError, UnicodeDecodeError):
+            pos += 1
+            skipped += 1
+            continue
+        if skipped:
+            yield '[%d bytes skipped]\n' % skipped
+            skipped = 0
+        yield text
+        pos = reader.pos
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write('usage: dbglog.py <app.elf> <capture.bin | ->\n')
+        return 2
+    strings = read_section(argv[1], '.dbglog')
+    data = sys.stdin.buffer.read() if argv[2] == '-' else open(argv[2], 'rb').read()
+    for text in decode(strings, data):
+        sys.stdout.write(text)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,601 @@
+/*---------------------------------------------------------------------------*/
+/*  dfu_test.c   fw/app/dfu_patch.c and dfu_boot.c against a simulated flash */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The patch is made by ../dfupatch.py from two images made up here: an
+ *  old one, and a new one with bytes inserted, deleted and changed, so
+ *  that the diff has to keep to the in-place rule.  Its MAC is checked
+ *  with fw/app/cmac.c, on the host's AES (../host/aes.c).
+ *
+ *  The image, staging and journal pages are host memory at their nRF51
+ *  addresses that behaves as NOR flash: a write can only clear bits, an
+ *  erase sets the whole page.  dfu_boot_resume() is what the boot page
+ *  runs at every reset; each boot is a fork(), and sees only the flash,
+ *  which is shared.  A power cut is a step number: every word written and
+ *  every erase is a step, and at that one the boot dies with the word half
+ *  written or the page half erased.  The boots after it have to finish
+ *  the apply with the new image, however many of them are cut.
+ */
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "dfu_patch.h"
+#include "dfu_boot.h"
+#include "cmac.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define PAGE_SIZE           DFU_PATCH_PAGE_SIZE
+#define FLASH_BASE          DFU_IMAGE_ADDR
+#define FLASH_END           (DFU_JOURNAL_ADDR + PAGE_SIZE)
+
+#define OLD_LEN             11800
+#define NEW_MAX             (OLD_LEN + 400)
+
+#define EXIT_CUT            42
+
+/* Shared between the boots, and with the parent. */
+typedef struct {
+    uint32_t  steps;                // words written and pages erased
+    uint32_t  cut_at;               // the step the power goes at; 0: never
+    bool      bad_address;
+} sim_t;
+
+static sim_t  * m_sim;
+
+static int      m_failed;
+
+static uint8_t  m_old [OLD_LEN];
+static uint8_t  m_new [NEW_MAX];
+static uint32_t m_new_len;
+static uint8_t  m_patch [DFU_STAGE_PAGES * PAGE_SIZE];
+static uint32_t m_patch_len;
+
+static const uint8_t m_key [CMAC_SIZE] = {
+    0x5e, 0x11, 0x0a, 0x93, 0x2c, 0x7d, 0xb4, 0x08,
+    0xe1, 0x46, 0x3f, 0xc2, 0x9b, 0x70, 0x25, 0xd8 };
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: %s: %s\n", __FILE__, __LINE__, __func__, #cond); \
+            m_failed++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/*---------------------------------------------------------------------------*/
+/*  Flash, for dfu_boot.c                                                    */
+/*---------------------------------------------------------------------------*/
+static uint8_t * flash(uint32_t addr)
+{
+    return (uint8_t *) (uintptr_t) addr;
+}
+
+/* True if the power goes now. */
+static bool flash_step(void)
+{
+    return (++m_sim->steps == m_sim->cut_at);
+}
+
+void dfu_boot_flash_erase(uint32_t addr)
+{
+    if (addr % PAGE_SIZE != 0 || addr < FLASH_BASE || addr >= FLASH_END) {
+        m_sim->bad_address = true;
+        return;
+    }
+    if (flash_step()) {
+        memset(flash(addr), 0xFF, PAGE_SIZE / 2);   // half way through
+        _exit(EXIT_CUT);
+    }
+    memset(flash(addr), 0xFF, PAGE_SIZE);
+}
+
+void dfu_boot_flash_write(uint32_t addr, uint32_t word)
+{
+    uint32_t * p_word = (uint32_t *) flash(addr);
+
+    if (addr % 4 != 0 || addr < FLASH_BASE || addr >= FLASH_END) {
+        m_sim->bad_address = true;
+        return;
+    }
+    if (flash_step()) {
+        *p_word &= word | 0xFFFF0000;               // half the bits programmed
+        _exit(EXIT_CUT);
+    }
+    *p_word &= word;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The ECB, for cmac.c                                                      */
+/*---------------------------------------------------------------------------*/
+void aes128_encrypt(const uint8_t key [16], const uint8_t in [16], uint8_t out [16]);
+
+uint32_t sd_ecb_block_encrypt(nrf_ecb_hal_data_t * p_ecb_data)
+{
+    aes128_encrypt(p_ecb_data->key, p_ecb_data->cleartext, p_ecb_data->ciphertext);
+    return NRF_SUCCESS;
+}
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    fprintf(stderr, "dfu_test: error %u at %s:%u\n",
+            (unsigned) error_code, (const char *) p_file_name, (unsigned) line_num);
+    exit(2);
+}
+
+static void mac_of(uint8_t const * p_data, uint32_t len, uint8_t * p_mac)
+{
+    cmac_t cmac;
+
+    cmac_begin(&cmac, m_key);
+    cmac_update(&cmac, p_data, len);
+    cmac_end(&cmac, p_mac);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The images, and the patch between them from dfupatch.py.                 */
+/*---------------------------------------------------------------------------*/
+static uint32_t m_seed = 1;
+
+static uint8_t random_byte(void)
+{
+    m_seed = m_seed * 1103515245 + 12345;
+    return (uint8_t) (m_seed >> 16);
+}
+
+static void append(uint8_t const * p_data, uint32_t len)
+{
+    memcpy(&m_new[m_new_len], p_data, len);
+    m_new_len += len;
+}
+
+static void append_random(uint32_t len)
+{
+    while (len-- > 0)
+        m_new[m_new_len++] = random_byte();
+}
+
+/* Code that moved: 300 bytes in early on push the next pages' starts out
+   of reach of their old pages; 200 out and 40 in further on. */
+static void images_make(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < OLD_LEN; i++)
+        m_old[i] = random_byte();
+    memset(&m_old[5000], 0xFF, 400);
+
+    m_new_len = 0;
+    append(&m_old[0], 1500);
+    append_random(300);
+    append(&m_old[1500], 1500);
+    append(&m_old[3200], 4800);
+    append_random(40);
+    append(&m_old[8000], OLD_LEN - 8000);
+
+    for (i = 600; i < 620; i++)
+        m_new[i] ^= 0x5A;
+    m_new[9000] ^= 0x01;
+}
+
+static void hex_write(const char * name, uint8_t const * p_data, uint32_t len)
+{
+    FILE   * p_file = fopen(name, "w");
+    uint32_t i, n, j;
+    uint8_t  sum;
+
+    if (p_file == NULL) {
+        perror(name);
+        exit(2);
+    }
+    fprintf(p_file, ":02000004%04X%02X\n", (unsigned) (DFU_IMAGE_ADDR >> 16),
+            (unsigned) (uint8_t) -(2 + 4 + (DFU_IMAGE_ADDR >> 24) + (DFU_IMAGE_ADDR >> 16)));
+
+    for (i = 0; i < len; i += n) {
+        uint32_t addr = (DFU_IMAGE_ADDR + i) & 0xFFFF;
+
+        n   = (len - i < 16) ? len - i : 16;
+        sum = (uint8_t) (n + (addr >> 8) + addr);
+        fprintf(p_file, ":%02X%04X00", (unsigned) n, (unsigned) addr);
+        for (j = 0; j < n; j++) {
+            fprintf(p_file, "%02X", p_data[i + j]);
+            sum += p_data[i + j];
+        }
+        fprintf(p_file, "%02X\n", (uint8_t) -sum);
+    }
+    fprintf(p_file, ":00000001FF\n");
+    fclose(p_file);
+}
+
+static void patch_make(void)
+{
+    FILE   * p_file;
+    uint32_t i;
+
+    hex_write("old.hex", m_old, OLD_LEN);
+    hex_write("new.hex", m_new, m_new_len);
+
+    p_file = fopen("key.txt", "w");
+    if (p_file == NULL) {
+        perror("key.txt");
+        exit(2);
+    }
+    for (i = 0; i < CMAC_SIZE; i++)
+        fprintf(p_file, "%02x", m_key[i]);
+    fprintf(p_file, "\n");
+    fclose(p_file);
+
+    if (system("python3 ../dfupatch.py diff key.txt old.hex new.hex patch.bin > /dev/null") != 0) {
+        fprintf(stderr, "dfu_test: dfupatch.py diff failed\n");
+        exit(2);
+    }
+    p_file = fopen("patch.bin", "rb");
+    if (p_file == NULL) {
+        perror("patch.bin");
+        exit(2);
+    }
+    m_patch_len = fread(m_patch, 1, sizeof(m_patch), p_file);
+    fclose(p_file);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The device as ACTIVATE leaves it: the old image, the patch, the log      */
+/*  begun.  A pstorage swap page is erased between operations.               */
+/*---------------------------------------------------------------------------*/
+static uint32_t const * stage_log(void)
+{
+    return DFU_BOOT_LOG((dfu_patch_header_t const *) m_patch);
+}
+
+static void stage(bool activated)
+{
+    memset(flash(FLASH_BASE), 0xFF, FLASH_END - FLASH_BASE);
+    memcpy(flash(DFU_IMAGE_ADDR), m_old, OLD_LEN);
+    memcpy(flash(DFU_STAGE_ADDR), m_patch, m_patch_len);
+
+    if (activated)
+        *(uint32_t *) stage_log() = DFU_BOOT_LOG_BEGIN;
+
+    memset(m_sim, 0, sizeof(*m_sim));
+}
+
+/* The exit status: 0, or EXIT_CUT. */
+static int boot(uint32_t cut_at)
+{
+    pid_t pid;
+    int   status;
+
+    m_sim->steps  = 0;
+    m_sim->cut_at = cut_at;
+
+    pid = fork();
+    if (pid == 0) {
+        dfu_boot_resume();
+        _exit(0);
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        fprintf(stderr, "dfu_test: boot died\n");
+        exit(2);
+    }
+    return WEXITSTATUS(status);
+}
+
+static bool image_is(uint8_t const * p_image, uint32_t len)
+{
+    uint32_t end = (len + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    uint32_t i;
+
+    if (memcmp(flash(DFU_IMAGE_ADDR), p_image, len) != 0)
+        return false;
+    for (i = len; i < end; i++)
+        if (*flash(DFU_IMAGE_ADDR + i) != 0xFF)
+            return false;
+    return true;
+}
+
+static bool journal_erased(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < PAGE_SIZE; i++)
+        if (*flash(DFU_JOURNAL_ADDR + i) != 0xFF)
+            return false;
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Tests                                                                    */
+/*---------------------------------------------------------------------------*/
+static void test_patch_rebuilds_new_image(void)
+{
+    dfu_patch_header_t const * p_header = (dfu_patch_header_t const *) m_patch;
+    static uint8_t             out [NEW_MAX + PAGE_SIZE];
+    dfu_patch_t                patch;
+    int32_t                    produced;
+
+    CHECK(p_header->magic == DFU_PATCH_MAGIC);
+    CHECK(p_header->old_len == OLD_LEN);
+    CHECK(p_header->old_crc == dfu_crc32(0, m_old, OLD_LEN));
+    CHECK(p_header->new_len == m_new_len);
+    CHECK(m_patch_len == sizeof(*p_header) + p_header->body_len + DFU_PATCH_MAC_SIZE);
+    CHECK(m_patch_len + DFU_BOOT_LOG_SIZE <= DFU_STAGE_PAGES * PAGE_SIZE);
+
+    dfu_patch_begin(&patch, p_header, (uint8_t const *) (p_header + 1), m_old);
+    produced = dfu_patch_run(&patch, out, sizeof(out));
+
+    CHECK(produced == (int32_t) m_new_len);
+    CHECK(memcmp(out, m_new, m_new_len) == 0);
+    CHECK(dfu_crc32(0, out, m_new_len) == p_header->new_crc);
+    CHECK(patch.pos == patch.body_len && patch.left == 0);
+}
+
+/* RFC 4493, section 4, with the message in pieces of every size. */
+static void test_cmac_rfc4493(void)
+{
+    static const uint8_t key [CMAC_SIZE] = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+    static const uint8_t msg [64] = {
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+        0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+        0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10 };
+    static const struct {
+        uint32_t len;
+        uint8_t  mac [CMAC_SIZE];
+    } vectors [] = {
+        {  0, { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28,
+                0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 } },
+        { 16, { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44,
+                0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c } },
+        { 40, { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30,
+                0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 } },
+        { 64, { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92,
+                0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe } },
+    };
+    cmac_t   cmac;
+    uint8_t  mac [CMAC_SIZE];
+    uint32_t v, piece, off, n;
+
+    for (v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+        for (piece = 1; piece <= 17; piece++) {
+            cmac_begin(&cmac, key);
+            for (off = 0; off < vectors[v].len; off += n) {
+                n = vectors[v].len - off < piece ? vectors[v].len - off : piece;
+                cmac_update(&cmac, &msg[off], n);
+            }
+            cmac_end(&cmac, mac);
+            CHECK(memcmp(mac, vectors[v].mac, CMAC_SIZE) == 0);
+        }
+    }
+}
+
+/* dfupatch.py's MAC is the device's; its apply() takes only that key's. */
+static void test_patch_mac(void)
+{
+    uint8_t mac [CMAC_SIZE];
+    FILE  * p_file;
+
+    mac_of(m_patch, m_patch_len - CMAC_SIZE, mac);
+    CHECK(memcmp(mac, &m_patch[m_patch_len - CMAC_SIZE], CMAC_SIZE) == 0);
+
+    m_patch[100] ^= 0x01;
+    mac_of(m_patch, m_patch_len - CMAC_SIZE, mac);
+    CHECK(memcmp(mac, &m_patch[m_patch_len - CMAC_SIZE], CMAC_SIZE) != 0);
+    m_patch[100] ^= 0x01;
+
+    CHECK(system("python3 ../dfupatch.py apply key.txt old.hex patch.bin mac_new.hex") == 0);
+
+    p_file = fopen("other_key.txt", "w");
+    if (p_file == NULL) {
+        perror("other_key.txt");
+        exit(2);
+    }
+    fprintf(p_file, "000102030405060708090a0b0c0d0e0f\n");
+    fclose(p_file);
+    CHECK(system("python3 ../dfupatch.py apply other_key.txt old.hex patch.bin mac_new.hex "
+                 "2> /dev/null") != 0);
+}
+
+/* The ops of the first pages stepped over, the rest as before. */
+static void test_patch_steps_over_pages(void)
+{
+    dfu_patch_header_t const * p_header = (dfu_patch_header_t const *) m_patch;
+    static uint8_t             out [NEW_MAX];
+    dfu_patch_t                patch;
+
+    dfu_patch_begin(&patch, p_header, (uint8_t const *) (p_header + 1), NULL);
+    CHECK(dfu_patch_run(&patch, NULL, 5 * PAGE_SIZE) == 5 * PAGE_SIZE);
+
+    patch.p_old = m_old;
+    CHECK(dfu_patch_run(&patch, out, sizeof(out)) == (int32_t) (m_new_len - 5 * PAGE_SIZE));
+    CHECK(memcmp(out, &m_new[5 * PAGE_SIZE], m_new_len - 5 * PAGE_SIZE) == 0);
+}
+
+static void test_resume_applies_patch(void)
+{
+    stage(true);
+
+    CHECK(boot(0) == 0);
+    CHECK(image_is(m_new, m_new_len));
+    CHECK(journal_erased());
+    CHECK(!m_sim->bad_address);
+
+    /* And the boots after it leave the flash alone. */
+    CHECK(boot(0) == 0);
+    CHECK(m_sim->steps == 0);
+    CHECK(image_is(m_new, m_new_len));
+}
+
+static void test_not_activated_is_left_alone(void)
+{
+    stage(false);
+
+    CHECK(boot(0) == 0);
+    CHECK(m_sim->steps == 0);
+    CHECK(image_is(m_old, OLD_LEN));
+}
+
+static void test_power_cut_at_every_step(void)
+{
+    uint32_t total;
+    uint32_t cut;
+    uint32_t bad = 0;
+
+    stage(true);
+    boot(0);
+    total = m_sim->steps;
+    CHECK(total > 2 * (m_new_len / PAGE_SIZE) * (PAGE_SIZE / 4));
+
+    for (cut = 1; cut <= total; cut++) {
+        stage(true);
+        if (boot(cut) != EXIT_CUT || boot(0) != 0 ||
+            !image_is(m_new, m_new_len) || !journal_erased())
+            bad++;
+    }
+    CHECK(bad == 0);
+}
+
+/* Cut again while resuming, at the journal's steps and at the image's. */
+static void test_power_cut_twice(void)
+{
+    uint32_t total;
+    uint32_t cut, again;
+    uint32_t bad = 0;
+
+    stage(true);
+    boot(0);
+    total = m_sim->steps;
+
+    for (cut = 1; cut <= total; cut += 97) {
+        for (again = 1; again <= total; again += 211) {
+            stage(true);
+            if (boot(cut) != EXIT_CUT)
+                bad++;
+            if (boot(again) == 0) {
+                if (!image_is(m_new, m_new_len))
+                    bad++;
+                continue;
+            }
+            if (boot(0) != 0 || !image_is(m_new, m_new_len) || !journal_erased())
+                bad++;
+        }
+    }
+    CHECK(bad == 0);
+}
+
+/* The in-place rule, in the applier and in dfupatch.py's apply().  The
+   new image's CRC is that of the bytes the copy would find in flash, so
+   apply() has only the rule to refuse the patch on. */
+static int32_t bad_patch_run(uint8_t const * p_body, uint32_t body_len,
+                             uint8_t const * p_image, uint32_t new_len, bool dry)
+{
+    static uint8_t     out [2 * PAGE_SIZE];
+    static uint8_t     signed_patch [sizeof(dfu_patch_header_t) + 64];
+    dfu_patch_header_t header;
+    dfu_patch_t        patch;
+    FILE             * p_file;
+    int32_t            produced;
+    uint8_t            mac [CMAC_SIZE];
+
+    header.magic    = DFU_PATCH_MAGIC;
+    header.old_len  = 2 * PAGE_SIZE;
+    header.old_crc  = dfu_crc32(0, m_old, 2 * PAGE_SIZE);
+    header.new_len  = new_len;
+    header.new_crc  = dfu_crc32(0, p_image, new_len);
+    header.body_len = body_len;
+
+    dfu_patch_begin(&patch, &header, p_body, m_old);
+    produced = dfu_patch_run(&patch, dry ? NULL : out, sizeof(out));
+
+    /* Signed, so that apply() does not refuse it for the MAC. */
+    memcpy(signed_patch, &header, sizeof(header));
+    memcpy(&signed_patch[sizeof(header)], p_body, body_len);
+    mac_of(signed_patch, sizeof(header) + body_len, mac);
+
+    p_file = fopen("bad.bin", "wb");
+    if (p_file == NULL || fwrite(signed_patch, sizeof(header) + body_len, 1, p_file) != 1 ||
+        fwrite(mac, sizeof(mac), 1, p_file) != 1 || fclose(p_file) != 0) {
+        perror("bad.bin");
+        exit(2);
+    }
+    hex_write("bad_old.hex", m_old, 2 * PAGE_SIZE);
+    CHECK(system("python3 ../dfupatch.py apply key.txt bad_old.hex bad.bin bad_new.hex "
+                 "2> /dev/null") != 0);
+    return produced;
+}
+
+static void test_copy_from_rewritten_page_fails(void)
+{
+    /* FILL 1024, COPY 16 from 0: page 0 is new by then. */
+    static const uint8_t before [] = { 0xFF, 0xC0, 0x07, 0xAA, 0x0F };
+
+    /* FILL 1000, SEEK to 990, COPY 100: into page 1 it reads 1014 for 1024. */
+    static const uint8_t across [] = { 0xFF, 0xA8, 0x07, 0xAA, 0x80, 0xBC, 0x0F, 0x3F, 0x24 };
+
+    static uint8_t image [1100];
+
+    memset(image, 0xAA, 1040);
+    CHECK(bad_patch_run(before, sizeof(before), image, 1040, false) == -1);
+    CHECK(bad_patch_run(before, sizeof(before), image, 1040, true) == -1);
+
+    memcpy(&image[1000], &m_old[990], 100);
+    CHECK(bad_patch_run(across, sizeof(across), image, 1100, false) == -1);
+    CHECK(bad_patch_run(across, sizeof(across), image, 1100, true) == -1);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void * map(uintptr_t base, size_t size)
+{
+    void * p = mmap((void *) base, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS | (base ? MAP_FIXED_NOREPLACE : 0), -1, 0);
+
+    if (p == MAP_FAILED || (base != 0 && p != (void *) base)) {
+        perror("dfu_test: mmap");
+        exit(2);
+    }
+    return p;
+}
+
+int main(void)
+{
+    static void (* const tests [])(void) = {
+        test_cmac_rfc4493,
+        test_patch_rebuilds_new_image,
+        test_patch_mac,
+        test_patch_steps_over_pages,
+        test_resume_applies_patch,
+        test_not_activated_is_left_alone,
+        test_power_cut_at_every_step,
+        test_power_cut_twice,
+        test_copy_from_rewritten_page_fails,
+    };
+    const int count = sizeof(tests) / sizeof(tests[0]);
+    int       i;
+
+    /* Image, staging, boot page and pstorage: kept over forks. */
+    map(FLASH_BASE, FLASH_END - FLASH_BASE);
+    m_sim = map(0, sizeof(sim_t));
+
+    images_make();
+    patch_make();
+
+    for (i = 0; i < count; i++)
+        tests[i]();
+
+    printf("%d tests, %d checks failed\n", count, m_failed);
+    return m_failed ? 1 : 0;
+}
@@ -0,0 +1,382 @@
+#!/usr/bin/env python3
+#
+#  dfupatch.py   make and apply over-the-air delta patches
+#  Copyright (c) 2016 Robin Callender. All Rights Reserved.
+#
+#  The patch format is described in fw/app/dfu_patch.h; apply() below does
+#  exactly what the device does, including the in-place page order.
+#
+#  Usage:
+#    dfupatch.py key   <key> <uicr.hex>
+#    dfupatch.py diff  <key> <old.hex> <new.hex> <patch.bin|patch.hex>
+#    dfupatch.py apply <key> <old.hex> <patch.bin> <new.hex>
+#    dfupatch.py check <old.hex> <new.hex>
+#
+#  A device only takes a patch with its own DFU key's AES-CMAC.  key makes
+#  a new key: the <key> file, 32 hex digits, to keep for the device's
+#  patches, and a .hex that writes it to UICR.CUSTOMER[0..3] when the
+#  device is programmed.  check uses a throwaway key.
+#
+#  A .hex patch is placed at the staging address, for loading over SWD.
+#
+
+import os
+import struct
+import sys
+import zlib
+
+IMAGE_ADDR  = 0x16000               # DFU_IMAGE_ADDR
+IMAGE_MAX   = 30 * 1024             # DFU_IMAGE_MAX
+STAGE_ADDR  = IMAGE_ADDR + IMAGE_MAX
+PAGE_SIZE   = 1024
+LOG_SIZE    = 4 * (2 + 2 * IMAGE_MAX // PAGE_SIZE)     # DFU_BOOT_LOG_SIZE
+STAGE_SIZE  = 3 * PAGE_SIZE - LOG_SIZE  # DFU_STAGE_PAGES pages, less the log
+
+MAGIC       = 0x31504454            # "TDP1"
+HEADER      = struct.Struct('<6I')
+MAC_SIZE    = 16                    # DFU_PATCH_MAC_SIZE
+
+KEY_ADDR    = 0x10001080            # UICR.CUSTOMER[0]
+
+OP_COPY, OP_INSERT, OP_SEEK, OP_FILL = range(4)
+
+MIN_MATCH   = 6
+GRAM        = 4
+
+
+# --- Intel hex -------------------------------------------------------------
+
+def read_hex(path, lo=IMAGE_ADDR, hi=IMAGE_ADDR + IMAGE_MAX):
+    mem = {}
+    base = 0
+    for line in open(path):
+        line = line.strip()
+        if not line.startswith(':'):
+            continue
+        rec = bytes.fromhex(line[1:])
+        if sum(rec) & 0xFF:
+            raise ValueError('%s: bad checksum: %s' % (path, line))
+        n, addr, kind, data = rec[0], (rec[1] << 8) | rec[2], rec[3], rec[4:4 + rec[0]]
+        if kind == 0:
+            for i, b in enumerate(data):
+                a = base + addr + i
+                if lo <= a < hi:
+                    mem[a - lo] = b
+        elif kind == 2:
+            base = ((data[0] << 8) | data[1]) << 4
+        elif kind == 4:
+            base = ((data[0] << 8) | data[1]) << 16
+        elif kind == 1:
+            break
+    if not mem:
+        raise ValueError('%s: nothing in 0x%x..0x%x' % (path, lo, hi))
+    image = bytearray(b'\xff' * (max(mem) + 1))
+    for a, b in mem.items():
+        image[a] = b
+    return bytes(image)
+
+
+def write_hex(path, data, addr):
+    out = []
+    upper = None
+    for off in range(0, len(data), 16):
+        a = addr + off
+        if a >> 16 != upper:
+            upper = a >> 16
+            rec = bytes([2, 0, 0, 4, upper >> 8, upper & 0xFF])
+            out.append(':' + (rec + bytes([-sum(rec) & 0xFF])).hex().upper())
+        chunk = data[off:off + 16]
+        rec = bytes([len(chunk), (a >> 8) & 0xFF, a & 0xFF, 0]) + chunk
+        out.append(':' + (rec + bytes([-sum(rec) & 0xFF])).hex().upper())
+    out.append(':00000001FF')
+    open(path, 'w').write('\n'.join(out) + '\n')
+
+
+# --- AES-CMAC (RFC 4493), as fw/app/cmac.c ---------------------------------
+
+def _xtime(x):
+    return ((x << 1) ^ (0x1B if x & 0x80 else 0)) & 0xFF
+
+
+def _sbox():
+    # p runs through GF(2^8)* by powers of 3, q by powers of 1/3: q is the
+    # inverse of p, and the affine map of q is the entry.
+    rot = lambda x, k: ((x << k) | (x >> (8 - k))) & 0xFF
+    sbox = [0x63] * 256
+    p = q = 1
+    while True:
+        p ^= _xtime(p)
+        q ^= q << 1
+        q ^= q << 2
+        q ^= q << 4
+        q &= 0xFF
+        if q & 0x80:
+            q ^= 0x09
+        sbox[p] = q ^ rot(q, 1) ^ rot(q, 2) ^ rot(q, 3) ^ rot(q, 4) ^ 0x63
+        if p == 1:
+            return sbox
+
+
+SBOX = _sbox()
+
+
+def aes128(key, block):
+    k = list(key)
+    s = [b ^ k[i] for i, b in enumerate(block)]
+    rcon = 1
+    for rnd in range(1, 11):
+        t = [SBOX[s[(i + 4 * (i % 4)) % 16]] for i in range(16)]
+        if rnd < 10:
+            for c in range(0, 16, 4):
+                a = t[c:c + 4]
+                x = a[0] ^ a[1] ^ a[2] ^ a[3]
+                for i in range(4):
+                    t[c + i] ^= x ^ _xtime(a[i] ^ a[(i + 1) % 4])
+        k[0] ^= SBOX[k[13]] ^ rcon
+        k[1] ^= SBOX[k[14]]
+        k[2] ^= SBOX[k[15]]
+        k[3] ^= SBOX[k[12]]
+        for i in range(4, 16):
+            k[i] ^= k[i - 4]
+        rcon = _xtime(rcon)
+        s = [t[i] ^ k[i] for i in range(16)]
+    return bytes(s)
+
+
+def cmac(key, msg):
+    def double(b):
+        v = int.from_bytes(b, 'big') << 1
+        if v >> 128:
+            v ^= (1 << 128) | 0x87
+        return v.to_bytes(16, 'big')
+
+    k1 = double(aes128(key, bytes(16)))
+    k2 = double(k1)
+    n = max(1, (len(msg) + 15) // 16)
+    last = msg[16 * (n - 1):]
+    if len(last) == 16:
+        last = bytes(a ^ b for a, b in zip(last, k1))
+    else:
+        last = bytes(a ^ b for a, b in zip(last + b'\x80' + bytes(15 - len(last)), k2))
+    x = bytes(16)
+    for i in range(n - 1):
+        x = aes128(key, bytes(a ^ b for a, b in zip(x, msg[16 * i:16 * i + 16])))
+    return aes128(key, bytes(a ^ b for a, b in zip(x, last)))
+
+
+def read_key(path):
+    key = bytes.fromhex(open(path).read().strip())
+    if len(key) != 16 or key == b'\xff' * 16:
+        raise ValueError('%s: not a DFU key' % path)
+    return key
+
+
+# --- encoding --------------------------------------------------------------
+
+def varint(v):
+    out = bytearray()
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+    return bytes(out)
+
+
+def op(kind, length):
+    if length <= 63:
+        return bytes([(kind << 6) | (length - 1)])
+    return bytes([(kind << 6) | 0x3F]) + varint(length - 64)
+
+
+def seek(delta):
+    return bytes([OP_SEEK << 6]) + varint(((delta << 1) ^ (delta >> 31)) & 0xFFFFFFFF)
+
+
+# --- diff ------------------------------------------------------------------
+
+def diff(old, new):
+    """Greedy match against the old image, honouring the in-place rule:
+       output page k may only copy from old offsets >= k * PAGE_SIZE."""
+    index = {}
+    for i in range(len(old) - GRAM + 1):
+        index.setdefault(old[i:i + GRAM], []).append(i)
+
+    def match_len(p, s):
+        n = 0
+        while (p + n < len(new) and s + n < len(old) and new[p + n] == old[s + n]
+               and s + n >= ((p + n) // PAGE_SIZE) * PAGE_SIZE):
+            n += 1
+        return n
+
+    body = bytearray()
+    literal = bytearray()
+    src = 0
+    p = 0
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:4096]
+            body.extend(op(OP_INSERT, len(chunk)) + chunk)
+            del literal[:4096]
+
+    while p < len(new):
+        # Runs of one byte value (erased padding, zeroed tables).
+        run = 1
+        while p + run < len(new) and new[p + run] == new[p]:
+            run += 1
+
+        best_len, best_src = 0, src
+        if src < len(old):
+            best_len = match_len(p, src)
+        if best_len < 32:
+            for s in index.get(new[p:p + GRAM], ())[-64:]:
+                n = match_len(p, s)
+                if n > best_len:
+                    best_len, best_src = n, s
+
+        if run >= 8 and run >= best_len:
+            flush_literal()
+            body.extend(op(OP_FILL, run) + bytes([new[p]]))
+            p += run
+        elif best_len >= MIN_MATCH:
+            flush_literal()
+            if best_src != src:
+                body.extend(seek(best_src - src))
+            body.extend(op(OP_COPY, best_len))
+            src = best_src + best_len
+            p += best_len
+        else:
+            literal.append(new[p])
+            p += 1
+
+    flush_literal()
+
+    header = HEADER.pack(MAGIC, len(old), zlib.crc32(old), len(new), zlib.crc32(new), len(body))
+    return header + bytes(body)
+
+
+def sign(key, patch):
+    return patch + cmac(key, patch)
+
+
+# --- apply (mirrors dfu_patch_run() and dfu_boot_resume()) -----------------
+
+def apply(key, old, patch):
+    magic, old_len, old_crc, new_len, new_crc, body_len = HEADER.unpack_from(patch)
+    if magic != MAGIC:
+        raise ValueError('not a patch')
+    if new_len > IMAGE_MAX or len(patch) - HEADER.size - MAC_SIZE != body_len:
+        raise ValueError('bad header')
+    if cmac(key, patch[:-MAC_SIZE]) != patch[-MAC_SIZE:]:
+        raise ValueError('the MAC does not match the key')
+    if old_len != len(old) or zlib.crc32(old) != old_crc:
+        raise ValueError('patch was made against another image')
+
+    body = patch[HEADER.size:-MAC_SIZE]
+    flash = bytearray(old + b'\xff' * (IMAGE_MAX - len(old)))
+    state = {'pos': 0, 'src': 0, 'left': 0, 'op': 0, 'fill': 0}
+
+    def get_varint():
+        v = shift = 0
+        while True:
+            b = body[state['pos']]
+            state['pos'] += 1
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return v
+
+    def run(n, base):
+        out = bytearray()
+        while len(out) < n:
+            if state['left'] == 0:
+                while True:
+                    if state['pos'] >= len(body):
+                        return out
+                    b = body[state['pos']]
+                    state['pos'] += 1
+                    state['op'], length = b >> 6, b & 0x3F
+                    if state['op'] == OP_SEEK:
+                        z = get_varint()
+                        state['src'] += (z >> 1) ^ -(z & 1)
+                        continue
+                    length = 64 + get_varint() if length == 0x3F else length + 1
+                    if state['op'] == OP_COPY and state['src'] + length > old_len:
+                        raise ValueError('copy past the old image')
+                    if state['op'] == OP_FILL:
+                        state['fill'] = body[state['pos']]
+                        state['pos'] += 1
+                    state['left'] = length
+                    break
+            k = min(n - len(out), state['left'])
+            state['left'] -= k
+            if state['op'] == OP_COPY:
+                # The device's check: one page is built at a time, from old
+                # pages at or after it.
+                if state['src'] < base:
+                    raise ValueError('copy from a page already rewritten')
+                # Reads the flash as it is now: earlier pages already rewritten.
+                out += flash[state['src']:state['src'] + k]
+                state['src'] += k
+            elif state['op'] == OP_INSERT:
+                out += body[state['pos']:state['pos'] + k]
+                state['pos'] += k
+            else:
+                out += bytes([state['fill']]) * k
+        return out
+
+    for page in range(0, new_len, PAGE_SIZE):
+        data = run(PAGE_SIZE, page)
+        flash[page:page + PAGE_SIZE] = data + b'\xff' * (PAGE_SIZE - len(data))
+
+    new = bytes(flash[:new_len])
+    if zlib.crc32(new) != new_crc:
+        raise ValueError('result does not match the new image CRC')
+    return new
+
+
+# --- commands --------------------------------------------------------------
+
+def main(argv):
+    if len(argv) == 4 and argv[1] == 'key':
+        if os.path.exists(argv[2]):
+            sys.stderr.write('%s: already there; a device keeps its key\n' % argv[2])
+            return 1
+        key = os.urandom(16)
+        open(argv[2], 'w').write(key.hex() + '\n')
+        write_hex(argv[3], key, KEY_ADDR)
+    elif len(argv) == 6 and argv[1] == 'diff':
+        key = read_key(argv[2])
+        old, new = read_hex(argv[3]), read_hex(argv[4])
+        patch = sign(key, diff(old, new))
+        apply(key, old, patch)
+        if len(patch) > STAGE_SIZE:
+            sys.stderr.write('patch is %d bytes, staging area is %d\n' % (len(patch), STAGE_SIZE))
+            return 1
+        if argv[5].endswith('.hex'):
+            write_hex(argv[5], patch, STAGE_ADDR)
+        else:
+            open(argv[5], 'wb').write(patch)
+        print('%d -> %d bytes, patch %d bytes' % (len(old), len(new), len(patch)))
+    elif len(argv) == 6 and argv[1] == 'apply':
+        new = apply(read_key(argv[2]), read_hex(argv[3]), open(argv[4], 'rb').read())
+        write_hex(argv[5], new, IMAGE_ADDR)
+    elif len(argv) == 4 and argv[1] == 'check':
+        key = os.urandom(16)
+        old, new = read_hex(argv[2]), read_hex(argv[3])
+        patch = sign(key, diff(old, new))
+        ok = apply(key, old, patch) == new
+        print('%d -> %d bytes, patch %d bytes (%.1f%%): %s' %
+              (len(old), len(new), len(patch), 100.0 * len(patch) / len(new),
+               'ok' if ok else 'MISMATCH'))
+        return 0 if ok else 1
+    else:
+        sys.stderr.write('usage: dfupatch.py key <key> <uicr.hex> | '
+                         'diff <key> <old.hex> <new.hex> <patch> | '
+                         'apply <key> <old.hex> <patch> <new.hex> | check <old.hex> <new.hex>\n')
+        return 2
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,287 @@
+/*---------------------------------------------------------------------------*/
+/*  evq_test.c   unit tests for fw/app/evq.c                                 */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The clock is a plain variable the tests move, and the critical region
+ *  (stub/app_util.h) only counts, so each test can check that every put
+ *  and every run took the lock and left it again.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nrf_error.h"
+#include "evq.h"
+
+int  g_critical_depth;
+int  g_critical_count;
+
+static uint32_t     m_now;
+static evq_stats_t  m_stats [EVQ_PRIORITIES];
+
+/* What the handlers saw, in the order they ran. */
+static uintptr_t    m_ran [64];
+static int          m_ran_count;
+
+static int          m_failed;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: %s: %s\n", __FILE__, __LINE__, __func__, #cond); \
+            m_failed++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t clock(void)
+{
+    return m_now & EVQ_TICKS_MASK;
+}
+
+static void setup(void)
+{
+    m_now       = 0;
+    m_ran_count = 0;
+    g_critical_depth = 0;
+    g_critical_count = 0;
+
+    /* Rubbish first: evq_init() has to clear it. */
+    memset(m_stats, 0xA5, sizeof(m_stats));
+    evq_init(clock, m_stats);
+}
+
+static void record(uintptr_t arg)
+{
+    m_ran[m_ran_count++] = arg;
+}
+
+/* Records its argument, and puts one high priority event behind it. */
+static void record_and_put_high(uintptr_t arg)
+{
+    record(arg);
+    CHECK(evq_put(EVQ_HIGH, record, arg + 100) == NRF_SUCCESS);
+}
+
+/* Moves the clock on by its argument. */
+static void take_time(uintptr_t ticks)
+{
+    m_now += ticks;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Tests                                                                    */
+/*---------------------------------------------------------------------------*/
+static void test_init_clears_stats(void)
+{
+    int i;
+
+    setup();
+    for (i = 0; i < EVQ_PRIORITIES; i++) {
+        CHECK(m_stats[i].depth == 0 && m_stats[i].peak == 0);
+        CHECK(m_stats[i].overflows == 0 && m_stats[i].runs == 0);
+        CHECK(m_stats[i].latency_max == 0 && m_stats[i].latency_sum == 0);
+    }
+    evq_execute();
+    CHECK(m_ran_count == 0);
+}
+
+static void test_fifo_within_a_priority(void)
+{
+    uintptr_t i;
+
+    setup();
+    for (i = 1; i <= EVQ_LOW_SIZE; i++)
+        CHECK(evq_put(EVQ_LOW, record, i) == NRF_SUCCESS);
+
+    evq_execute();
+
+    CHECK(m_ran_count == EVQ_LOW_SIZE);
+    for (i = 0; i < EVQ_LOW_SIZE; i++)
+        CHECK(m_ran[i] == i + 1);
+}
+
+static void test_high_runs_first(void)
+{
+    setup();
+    CHECK(evq_put(EVQ_LOW,  record, 1) == NRF_SUCCESS);
+    CHECK(evq_put(EVQ_LOW,  record, 2) == NRF_SUCCESS);
+    CHECK(evq_put(EVQ_HIGH, record, 3) == NRF_SUCCESS);
+    CHECK(evq_put(EVQ_HIGH, record, 4) == NRF_SUCCESS);
+
+    evq_execute();
+
+    CHECK(m_ran_count == 4);
+    CHECK(m_ran[0] == 3 && m_ran[1] == 4 && m_ran[2] == 1 && m_ran[3] == 2);
+}
+
+static void test_high_put_meanwhile_jumps_the_low_queue(void)
+{
+    /* As if a radio notification had come in while event 1 ran. */
+    setup();
+    CHECK(evq_put(EVQ_LOW, record_and_put_high, 1) == NRF_SUCCESS);
+    CHECK(evq_put(EVQ_LOW, record, 2) == NRF_SUCCESS);
+
+    evq_execute();
+
+    CHECK(m_ran_count == 3);
+    CHECK(m_ran[0] == 1 && m_ran[1] == 101 && m_ran[2] == 2);
+}
+
+static void test_payload_by_value(void)
+{
+    static const char table [] = "a table, not copied";
+    uintptr_t         value = 0xDEADBEEF;
+
+    setup();
+    CHECK(evq_put(EVQ_LOW, record, value) == NRF_SUCCESS);
+    CHECK(evq_put(EVQ_LOW, record, (uintptr_t) table) == NRF_SUCCESS);
+    value = 0;
+
+    evq_execute();
+
+    CHECK(m_ran_count == 2);
+    CHECK(m_ran[0] == 0xDEADBEEF);
+    CHECK((const char *) m_ran[1] == table);
+}
+
+static void test_overflow_is_counted(void)
+{
+    uintptr_t i;
+
+    setup();
+    for (i = 0; i < EVQ_HIGH_SIZE; i++)
+        CHECK(evq_put(EVQ_HIGH, record, i) == NRF_SUCCESS);
+
+    CHECK(evq_put(EVQ_HIGH, record, 99) == NRF_ERROR_NO_MEM);
+    CHECK(evq_put(EVQ_HIGH, record, 99) == NRF_ERROR_NO_MEM);
+    CHECK(m_stats[EVQ_HIGH].overflows == 2);
+    CHECK(m_stats[EVQ_HIGH].depth == EVQ_HIGH_SIZE);
+
+    /* A full high queue leaves the low one alone. */
+    CHECK(evq_put(EVQ_LOW, record, 7) == NRF_SUCCESS);
+    CHECK(m_stats[EVQ_LOW].overflows == 0);
+
+    evq_execute();
+
+    CHECK(m_ran_count == EVQ_HIGH_SIZE + 1);
+    for (i = 0; i < EVQ_HIGH_SIZE; i++)
+        CHECK(m_ran[i] == i);
+    CHECK(m_ran[EVQ_HIGH_SIZE] == 7);
+
+    /* Room again once drained. */
+    CHECK(evq_put(EVQ_HIGH, record, 8) == NRF_SUCCESS);
+    CHECK(m_stats[EVQ_HIGH].overflows == 2);
+}
+
+static void test_peak_depth(void)
+{
+    setup();
+    CHECK(evq_put(EVQ_LOW, record, 1) == NRF_SUCCESS);
+    CHECK(evq_put(EVQ_LOW, record, 2) == NRF_SUCCESS);
+    CHECK(evq_put(EVQ_LOW, record, 3) == NRF_SUCCESS);
+    CHECK(m_stats[EVQ_LOW].depth == 3 && m_stats[EVQ_LOW].peak == 3);
+
+    evq_execute();
+    CHECK(m_stats[EVQ_LOW].depth == 0 && m_stats[EVQ_LOW].peak == 3);
+
+    CHECK(evq_put(EVQ_LOW, record, 4) == NRF_SUCCESS);
+    evq_execute();
+    CHECK(m_stats[EVQ_LOW].peak == 3);
+    CHECK(m_stats[EVQ_LOW].runs == 4);
+    CHECK(m_stats[EVQ_HIGH].peak == 0 && m_stats[EVQ_HIGH].runs == 0);
+}
+
+static void test_latency(void)
+{
+    setup();
+    m_now = 10;
+    CHECK(evq_put(EVQ_LOW, take_time, 5) == NRF_SUCCESS);     // waits 40
+    m_now = 30;
+    CHECK(evq_put(EVQ_LOW, take_time, 0) == NRF_SUCCESS);     // waits 25
+    m_now = 50;
+
+    evq_execute();
+
+    CHECK(m_stats[EVQ_LOW].runs == 2);
+    CHECK(m_stats[EVQ_LOW].latency_max == 40);
+    CHECK(m_stats[EVQ_LOW].latency_sum == 65);
+}
+
+static void test_latency_across_the_wrap(void)
+{
+    setup();
+    m_now = EVQ_TICKS_MASK - 0x0F;
+    CHECK(evq_put(EVQ_HIGH, record, 1) == NRF_SUCCESS);
+    m_now = EVQ_TICKS_MASK + 1 + 0x10;
+
+    evq_execute();
+
+    CHECK(m_stats[EVQ_HIGH].latency_max == 0x20);
+}
+
+static void test_ring_wraps(void)
+{
+    uintptr_t i;
+
+    /* Odd batches against a power of two ring: every slot gets reused. */
+    setup();
+    for (i = 0; i < 50; i++) {
+        CHECK(evq_put(EVQ_LOW, record, 2 * i) == NRF_SUCCESS);
+        CHECK(evq_put(EVQ_LOW, record, 2 * i + 1) == NRF_SUCCESS);
+        if (i % 3 == 2) {
+            evq_execute();
+            CHECK(m_ran_count == 6);
+            CHECK(m_ran[0] == 2 * i - 4 && m_ran[5] == 2 * i + 1);
+            m_ran_count = 0;
+        }
+    }
+}
+
+static void test_locking(void)
+{
+    setup();
+    g_critical_count = 0;
+
+    CHECK(evq_put(EVQ_LOW,  record, 1) == NRF_SUCCESS);
+    CHECK(evq_put(EVQ_HIGH, record, 2) == NRF_SUCCESS);
+    CHECK(g_critical_count == 2);
+
+    evq_execute();
+
+    /* One per event taken, one to find both queues empty. */
+    CHECK(g_critical_count == 2 + 3);
+    CHECK(g_critical_depth == 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int main(void)
+{
+    static void (* const tests [])(void) = {
+        test_init_clears_stats,
+        test_fifo_within_a_priority,
+        test_high_runs_first,
+        test_high_put_meanwhile_jumps_the_low_queue,
+        test_payload_by_value,
+        test_overflow_is_counted,
+        test_peak_depth,
+        test_latency,
+        test_latency_across_the_wrap,
+        test_ring_wraps,
+        test_locking,
+    };
+    const int count = sizeof(tests) / sizeof(tests[0]);
+    int       i;
+
+    for (i = 0; i < count; i++)
+        tests[i]();
+
+    printf("%d tests, %d checks failed\n", count, m_failed);
+    return m_failed ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+/*---------------------------------------------------------------------------*/
+/*  app_util.h   host stand-in for the SDK's, for evq_test                   */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef APP_UTIL_H__
+#define APP_UTIL_H__
+
+#include <stdint.h>
+
+#define STATIC_ASSERT(EXPR)  typedef char static_assert_failed[(EXPR) ? 1 : -1]
+
+/* evq_test checks every region is left again, and none is nested. */
+extern int  g_critical_depth;
+extern int  g_critical_count;
+
+#define CRITICAL_REGION_ENTER()  do { g_critical_depth++; g_critical_count++;
+#define CRITICAL_REGION_EXIT()   g_critical_depth--; } while (0)
+
+#endif
@@ -0,0 +1,11 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf_error.h   host stand-in for the SDK's, for evq_test                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NRF_ERROR_H__
+#define NRF_ERROR_H__
+
+#define NRF_SUCCESS         0
+#define NRF_ERROR_NO_MEM    4
+
+#endif
@@ -0,0 +1,4 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf_soc.h   host stand-in for the SDK's, for evq_test: nothing needed    */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,279 @@
+/*---------------------------------------------------------------------------*/
+/*  fmtbench.c   instruction counts: printf.c/dump.c against the old ones   */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Each case runs in a traced child and is single-stepped, counting host
+ *  instructions and the divide instructions among them.  Host counts are
+ *  not M0 cycles, but the divides are the point: on the Cortex-M0 every
+ *  one of them is a call to __aeabi_uidivmod, tens of cycles each.
+ *
+ *  The outputs of both versions are compared first, and the decimal
+ *  conversion is checked against the C library.
+ */
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ *  Typical instructions executed by libgcc's Thumb-1 __aeabi_uidivmod for
+ *  the operands printf sees; it ranges from about 20 to over 100.
+ */
+#define UIDIVMOD_INSNS  45
+
+/* The firmware versions, renamed by the makefile. */
+int ref_sprintf(char * out, const char * format, ...);
+int ref_printf(const char * format, ...);
+void ref_dump_bytes(uint8_t * buffer, int length);
+
+int new_sprintf(char * out, const char * format, ...);
+int new_snprintf(char * buf, unsigned int count, const char * format, ...);
+int new_printf(const char * format, ...);
+void new_dump_bytes(uint8_t * buffer, int length);
+
+/*---------------------------------------------------------------------------*/
+/*  The console: uart_putc() collects into a sink.                          */
+/*---------------------------------------------------------------------------*/
+static char     m_sink [4096];
+static unsigned m_sink_len;
+
+void uart_putc(uint8_t ch)
+{
+    if (m_sink_len < sizeof(m_sink) - 1)
+        m_sink[m_sink_len++] = ch;
+}
+
+static void sink_reset(void)
+{
+    m_sink_len = 0;
+    memset(m_sink, 0, sizeof(m_sink));
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Cases, run identically for both versions.                                */
+/*---------------------------------------------------------------------------*/
+static uint8_t  m_bytes [64];
+static char     m_buf   [128];
+
+typedef struct {
+    const char * name;
+    void      (* run)(int use_new);
+} bench_case_t;
+
+#define SPRINTF(use_new, ...) \
+    ((use_new) ? new_sprintf(__VA_ARGS__) : ref_sprintf(__VA_ARGS__))
+#define PRINTF(use_new, ...) \
+    ((use_new) ? new_printf(__VA_ARGS__) : ref_printf(__VA_ARGS__))
+
+static void case_dec(int n)     { SPRINTF(n, m_buf, "%d", 123456789); }
+static void case_udec(int n)    { SPRINTF(n, m_buf, "%u", 4294967295u); }
+static void case_neg(int n)     { SPRINTF(n, m_buf, "%05d", -42); }
+static void case_hex(int n)     { SPRINTF(n, m_buf, "0x%08X", 0xDEADBEEFu); }
+
+static void case_error(int n)
+{
+    PRINTF(n, "app_error_handler: NRF_ERROR_%s 0x%x, at %s(%d)\n",
+           "INVALID_STATE", 8u, "../settings.c", 212);
+}
+
+static void case_boot(int n)
+{
+    PRINTF(n, "boot %u, reset reason 0x%x\n", 1234u, 4u);
+}
+
+static void case_dump(int n)
+{
+    if (n) new_dump_bytes(m_bytes, sizeof(m_bytes));
+    else   ref_dump_bytes(m_bytes, sizeof(m_bytes));
+}
+
+static const bench_case_t m_cases [] = {
+    { "sprintf %d",         case_dec   },
+    { "sprintf %u max",     case_udec  },
+    { "sprintf %05d",       case_neg   },
+    { "sprintf 0x%08X",     case_hex   },
+    { "printf error line",  case_error },
+    { "printf boot line",   case_boot  },
+    { "dump_bytes 64",      case_dump  },
+};
+
+#define CASE_COUNT  (sizeof(m_cases) / sizeof(m_cases[0]))
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static int check_outputs(void)
+{
+    char     ref [sizeof(m_sink)];
+    char     new [sizeof(m_sink)];
+    char     want [32];
+    char     got [32];
+    unsigned i;
+    uint32_t x;
+    int      bad = 0;
+
+    for (i = 0; i < CASE_COUNT; i++) {
+        sink_reset();
+        memset(m_buf, 0, sizeof(m_buf));
+        m_cases[i].run(0);
+        snprintf(ref, sizeof(ref), "%s%s", m_buf, m_sink);
+
+        sink_reset();
+        memset(m_buf, 0, sizeof(m_buf));
+        m_cases[i].run(1);
+        snprintf(new, sizeof(new), "%s%s", m_buf, m_sink);
+
+        if (strcmp(ref, new) != 0) {
+            printf("MISMATCH %s:\n  old: %s\n  new: %s\n", m_cases[i].name, ref, new);
+            bad++;
+        }
+    }
+
+    /* divu10() against the C library. */
+    for (i = 0; i < 2000000; i++) {
+        x = (i < 1000) ? i : (i < 2000) ? 0xFFFFFFFFu - i : (uint32_t) rand() * 2654435761u;
+        snprintf(want, sizeof(want), "%u", x);
+        new_sprintf(got, "%u", x);
+        if (strcmp(want, got) != 0) {
+            printf("MISMATCH %%u %u: %s\n", x, got);
+            bad++;
+            break;
+        }
+    }
+
+    /* snprintf stays inside its buffer and reports the full length. */
+    memset(got, 'z', sizeof(got));
+    if (new_snprintf(got, 6, "%s-%d", "abcd", 1234) != 9 ||
+        strcmp(got, "abcd-") != 0 || got[6] != 'z') {
+        printf("MISMATCH snprintf bound\n");
+        bad++;
+    }
+    if (new_snprintf(got, 0, "%d", 1) != 1 || got[0] != 'a') {
+        printf("MISMATCH snprintf zero\n");
+        bad++;
+    }
+
+    return bad;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  x86-64 DIV/IDIV: optional prefixes, F6/F7 with reg field 6 or 7.         */
+/*---------------------------------------------------------------------------*/
+static int is_divide(pid_t pid, unsigned long rip)
+{
+    unsigned long word = ptrace(PTRACE_PEEKTEXT, pid, (void *) rip, NULL);
+    uint8_t       b [8];
+    int           i = 0;
+
+    memcpy(b, &word, sizeof(b));
+
+    while (i < 4 && (b[i] == 0x66 || (b[i] & 0xF0) == 0x40))
+        i++;
+
+    return (b[i] == 0xF6 || b[i] == 0xF7) && ((b[i + 1] >> 3) & 7) >= 6;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Child: SIGUSR1 around each run; parent single-steps in between.          */
+/*---------------------------------------------------------------------------*/
+static void child(void)
+{
+    unsigned i;
+    int      n;
+
+    ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+    raise(SIGSTOP);
+
+    for (n = 0; n < 2; n++) {
+        /* An empty run first: the cost of the markers themselves. */
+        raise(SIGUSR1);
+        raise(SIGUSR1);
+
+        for (i = 0; i < CASE_COUNT; i++) {
+            sink_reset();
+            raise(SIGUSR1);
+            m_cases[i].run(n);
+            raise(SIGUSR1);
+        }
+    }
+    _exit(0);
+}
+
+static void step_between_markers(pid_t pid, long * p_insns, long * p_divs)
+{
+    struct user_regs_struct regs;
+    int                     status;
+
+    /* Run to the opening marker... */
+    ptrace(PTRACE_CONT, pid, NULL, NULL);
+    waitpid(pid, &status, 0);
+
+    /* ...then step to the closing one, swallowing the first SIGUSR1. */
+    *p_insns = 0;
+    *p_divs  = 0;
+    ptrace(PTRACE_SINGLESTEP, pid, NULL, NULL);
+    for (;;) {
+        waitpid(pid, &status, 0);
+        if (!WIFSTOPPED(status))
+            exit(1);
+        if (WSTOPSIG(status) == SIGUSR1)
+            return;
+
+        ptrace(PTRACE_GETREGS, pid, NULL, &regs);
+        if (is_divide(pid, regs.rip))
+            (*p_divs)++;
+        (*p_insns)++;
+
+        ptrace(PTRACE_SINGLESTEP, pid, NULL, NULL);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+int main(void)
+{
+    long     insns [2][CASE_COUNT], divs [2][CASE_COUNT];
+    long     base_insns, base_divs;
+    unsigned i;
+    int      n, status;
+    pid_t    pid;
+
+    for (i = 0; i < sizeof(m_bytes); i++)
+        m_bytes[i] = (uint8_t)(i * 7 + 0x20);
+
+    if (check_outputs() != 0)
+        return 1;
+
+    pid = fork();
+    if (pid == 0)
+        child();
+    waitpid(pid, &status, 0);
+
+    for (n = 0; n < 2; n++) {
+        step_between_markers(pid, &base_insns, &base_divs);
+        for (i = 0; i < CASE_COUNT; i++) {
+            step_between_markers(pid, &insns[n][i], &divs[n][i]);
+            insns[n][i] -= base_insns;
+        }
+    }
+    ptrace(PTRACE_CONT, pid, NULL, NULL);
+    waitpid(pid, &status, 0);
+
+    printf("%-20s %10s %6s %10s   %10s %6s %10s\n", "",
+           "old insns", "divs", "weighted", "new insns", "divs", "weighted");
+    for (i = 0; i < CASE_COUNT; i++) {
+        printf("%-20s %10ld %6ld %10ld   %10ld %6ld %10ld\n", m_cases[i].name,
+               insns[0][i], divs[0][i], insns[0][i] + divs[0][i] * UIDIVMOD_INSNS,
+               insns[1][i], divs[1][i], insns[1][i] + divs[1][i] * UIDIVMOD_INSNS);
+    }
+    printf("\nweighted: host instructions, each divide counted as %d (__aeabi_uidivmod)\n",
+           UIDIVMOD_INSNS);
+    return 0;
+}
@@ -0,0 +1,13 @@
+/*---------------------------------------------------------------------------*/
+/*  stdio.h   the firmware's view of stdio (printf.c), for fmtbench          */
+/*---------------------------------------------------------------------------*/
+#ifndef FMTBENCH_STDIO_H
+#define FMTBENCH_STDIO_H
+
+int printf(const char * format, ...);
+int sprintf(char * out, const char * format, ...);
+int snprintf(char * buf, unsigned int count, const char * format, ...);
+int puts(const char * string);
+int putchar(int c);
+
+#endif
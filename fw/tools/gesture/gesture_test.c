@@ -0,0 +1,230 @@
+/*---------------------------------------------------------------------------*/
+/*  gesture_test.c   fw/app/gesture.c against button edge timelines          */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  A timeline is a text file, times in milliseconds from its start:
+ *
+ *    # comment
+ *    cfg <debounce> <long> <double>    optional, defaults from config.h
+ *    <ms> down | up                    an edge, in time order
+ *    expect <ms> short | long | double a gesture, reported at that time
+ *
+ *  Edges go through gesture_edge() as the GPIOTE handler would, and the
+ *  timeout is simulated the way trackr_bsp.c arms it, with app_timer's
+ *  minimum.  Each timeline is run twice, the second time just before the
+ *  24-bit RTC wraps.  Reported times may be 1 ms off from rounding.
+ *
+ *  The timelines are written by hand, the bounces after a dome switch's
+ *  usual few ms: none is a capture from the board yet.  A logic analyser
+ *  export of the button pin, its edges turned into down/up lines, drops
+ *  straight in beside them.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gesture.h"
+
+#define TICKS_PER_SEC   32768           // RTC1, APP_TIMER_PRESCALER 0
+#define MIN_TICKS       5               // APP_TIMER_MIN_TIMEOUT_TICKS
+#define MAX_LINES       256
+
+/* The firmware's, from config.h. */
+#define BUTTON_DEBOUNCE_MS              20
+#define BUTTON_LONG_MS                  2000
+#define BUTTON_DOUBLE_MS                400
+
+typedef struct {
+    uint32_t  ms;
+    int       kind;         // EDGE_*, or a gesture_t for an expectation
+    bool      expect;
+} line_t;
+
+enum { EDGE_UP = 100, EDGE_DOWN };
+
+static const char * const m_names [] = { "none", "short", "long", "double" };
+
+static line_t   m_edges [MAX_LINES];
+static int      m_edge_count;
+static line_t   m_got [MAX_LINES];
+static int      m_got_count;
+static line_t   m_want [MAX_LINES];
+static int      m_want_count;
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static uint32_t ms_to_ticks(uint32_t ms)
+{
+    return (uint32_t) (((uint64_t) ms * TICKS_PER_SEC + 500) / 1000);
+}
+
+static uint32_t ticks_to_ms(uint32_t ticks)
+{
+    return (uint32_t) (((uint64_t) ticks * 1000 + TICKS_PER_SEC / 2) / TICKS_PER_SEC);
+}
+
+static int gesture_named(const char * name)
+{
+    int i;
+
+    for (i = GESTURE_SHORT; i <= GESTURE_DOUBLE; i++)
+        if (strcmp(name, m_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static bool load(const char * path, gesture_cfg_t * p_cfg)
+{
+    FILE   * f = fopen(path, "r");
+    char     text [128];
+    char     word [16];
+    unsigned a, b, c;
+    int      number = 0;
+    int      kind;
+
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    m_edge_count = m_want_count = 0;
+    p_cfg->debounce = BUTTON_DEBOUNCE_MS;
+    p_cfg->hold     = BUTTON_LONG_MS;
+    p_cfg->gap      = BUTTON_DOUBLE_MS;
+
+    while (fgets(text, sizeof(text), f)) {
+        number++;
+        if (text[strspn(text, " \t\r\n")] == '\0' || text[strspn(text, " \t")] == '#')
+            continue;
+
+        if (sscanf(text, " cfg %u %u %u", &a, &b, &c) == 3) {
+            p_cfg->debounce = a;
+            p_cfg->hold     = b;
+            p_cfg->gap      = c;
+        }
+        else if (sscanf(text, " expect %u %15s", &a, word) == 2 &&
+                 (kind = gesture_named(word)) > 0 && m_want_count < MAX_LINES) {
+            m_want[m_want_count++] = (line_t) { a, kind, true };
+        }
+        else if (sscanf(text, " %u %15s", &a, word) == 2 && m_edge_count < MAX_LINES &&
+                 (strcmp(word, "down") == 0 || strcmp(word, "up") == 0)) {
+            m_edges[m_edge_count++] = (line_t) { a, word[0] == 'd' ? EDGE_DOWN : EDGE_UP, false };
+        }
+        else {
+            fprintf(stderr, "%s:%d: what is this?\n", path, number);
+            fclose(f);
+            return false;
+        }
+    }
+
+    fclose(f);
+
+    /* The engine takes ticks. */
+    p_cfg->debounce = ms_to_ticks(p_cfg->debounce);
+    p_cfg->hold     = ms_to_ticks(p_cfg->hold);
+    p_cfg->gap      = ms_to_ticks(p_cfg->gap);
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Feed the edges, firing the timeout whenever it falls due before one.     */
+/*---------------------------------------------------------------------------*/
+static void report(gesture_t gesture, uint32_t ticks)
+{
+    if (gesture != GESTURE_NONE && m_got_count < MAX_LINES)
+        m_got[m_got_count++] = (line_t) { ticks_to_ms(ticks), gesture, true };
+}
+
+static void arm(gesture_engine_t * p_engine, uint32_t now, bool * p_armed, uint32_t * p_due)
+{
+    uint32_t wait = gesture_wait(p_engine, now);
+
+    *p_armed = (wait != 0);
+    *p_due   = now + (wait < MIN_TICKS ? MIN_TICKS : wait);
+}
+
+static void run(const gesture_cfg_t * p_cfg, uint32_t base)
+{
+    gesture_engine_t engine;
+    bool             armed = false;
+    uint32_t         due   = 0;
+    uint32_t         now;
+    int              i;
+
+    gesture_init(&engine, p_cfg);
+    m_got_count = 0;
+
+    for (i = 0; i <= m_edge_count; i++) {
+        /* The timeline's end counts as "a long time later". */
+        uint32_t at = (i < m_edge_count) ? ms_to_ticks(m_edges[i].ms)
+                                         : 0xFFFFFFFF;
+
+        while (armed && due <= at) {
+            report(gesture_timeout(&engine, (base + due) & GESTURE_TICKS_MASK), due);
+            arm(&engine, due, &armed, &due);
+        }
+        if (i == m_edge_count)
+            break;
+
+        now = (base + at) & GESTURE_TICKS_MASK;
+        report(gesture_edge(&engine, m_edges[i].kind == EDGE_DOWN, now), at);
+        arm(&engine, at, &armed, &due);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static bool check(const char * path, uint32_t base)
+{
+    bool ok = (m_got_count == m_want_count);
+    int  i;
+
+    for (i = 0; ok && i < m_got_count; i++) {
+        ok = m_got[i].kind == m_want[i].kind &&
+             abs((int) m_got[i].ms - (int) m_want[i].ms) <= 1;
+    }
+    if (ok)
+        return true;
+
+    printf("%s (base 0x%06x):\n  expected:", path, (unsigned) base);
+    for (i = 0; i < m_want_count; i++)
+        printf(" %s@%u", m_names[m_want[i].kind], (unsigned) m_want[i].ms);
+    printf("\n  got:     ");
+    for (i = 0; i < m_got_count; i++)
+        printf(" %s@%u", m_names[m_got[i].kind], (unsigned) m_got[i].ms);
+    printf("\n");
+    return false;
+}
+
+int main(int argc, char ** argv)
+{
+    static const uint32_t bases [] = { 0, GESTURE_TICKS_MASK - 1000 };
+    gesture_cfg_t cfg;
+    int           failed = 0;
+    int           i, b;
+
+    for (i = 1; i < argc; i++) {
+        if (!load(argv[i], &cfg)) {
+            failed++;
+            continue;
+        }
+        for (b = 0; b < 2; b++) {
+            run(&cfg, bases[b]);
+            if (!check(argv[i], bases[b])) {
+                failed++;
+                break;
+            }
+        }
+    }
+
+    printf("%d timelines, %d failed\n", argc - 1, failed);
+    return failed ? 1 : 0;
+}
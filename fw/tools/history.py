@@ -0,0 +1,332 @@
+#!/usr/bin/env python3
+#
+#  history.py   decode the battery/temperature history download
+#  Copyright (c) 2016 Robin Callender. All Rights Reserved.
+#
+#  The download is the concatenation of the notifications received from
+#  the History characteristic (0xfad2) after writing to it:
+#
+#    preamble  <BBHHH  version, block_size, block_count, interval_min, age_min
+#    blocks    block_count x 32 bytes, oldest first (see fw/app/history.c)
+#
+#  Usage:
+#    history.py decode  <dump>          dump is raw bytes, or hex text
+#    history.py encode  <trace.csv> <dump>
+#    history.py check   [trace.csv ...] round trip recorded or synthetic traces
+#    history.py host    <history_host> [trace.csv | dump ...]
+#                                       the firmware's encoder against this one
+#
+#  A trace is CSV with one "vbat_mv,temp_c" sample per line.  host runs
+#  fw/app/history.c built for the host (fw/tools/history) on the synthetic
+#  traces and on the ones given, and wants the download it makes to be
+#  the one encode would, less the blocks the flash ring has let go.  A
+#  dump given to it is a recorded download: both encoders have to make it
+#  again from its own samples.
+#
+
+import math
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+
+VERSION      = 1
+BLOCK_SIZE   = 32
+HEADER       = struct.Struct('<HHBBHh')
+DATA_SIZE    = BLOCK_SIZE - HEADER.size
+PREAMBLE     = struct.Struct('<BBHHH')
+
+VBAT_UNIT_MV = 10       # HISTORY_VBAT_UNIT_MV
+TEMP_UNIT_C  = 0.25     # sd_temp_get() step
+FLAG_BOOT    = 0x01
+
+RING_BLOCKS   = 1024 // BLOCK_SIZE     # a flash page of them; the ring has two
+
+TOKEN_ESCAPE  = 0x80
+TOKEN_RUN_MIN = 0x81
+TOKEN_RUN_MAX = 0xFE
+
+
+def crc16(data, crc=0xFFFF):
+    # crc16_compute() from the nRF SDK (CCITT, 0xFFFF seed)
+    for b in data:
+        crc = ((crc >> 8) & 0xFF) | ((crc << 8) & 0xFFFF)
+        crc ^= b
+        crc ^= (crc & 0xFF) >> 4
+        crc ^= (crc << 12) & 0xFFFF
+        crc ^= ((crc & 0xFF) << 5) & 0xFFFF
+    return crc
+
+
+def zigzag(v):
+    return ((v << 1) ^ (v >> 31)) & 0xFFFFFFFF
+
+
+def unzigzag(z):
+    return (z >> 1) ^ -(z & 1)
+
+
+def varint_put(v):
+    out = bytearray()
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+    return out
+
+
+def varint_get(data, pos):
+    v = shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        v |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return v, pos
+
+
+# --- encoder: same rules as history_append() / block_close() --------------
+
+class Encoder:
+    def __init__(self):
+        self.blocks = []
+        self.seq = 0
+        self.boot = True
+        self._reset()
+
+    def _reset(self):
+        self.count = 0
+        self.data = bytearray()
+        self.last_tok = None
+
+    def _block(self):
+        data = bytes(self.data) + b'\xff' * (DATA_SIZE - len(self.data))
+        flags = FLAG_BOOT if self.boot else 0
+        body = HEADER.pack(0, self.seq, self.count, flags, self.vbat0, self.temp0)[2:] + data
+        return struct.pack('<H', crc16(body)) + body
+
+    def _close(self):
+        self.blocks.append(self._block())
+        self.seq = (self.seq + 1) & 0xFFFF
+        if self.seq == 0xFFFF:
+            self.seq = 0
+        self.boot = False
+        self._reset()
+
+    def append(self, vbat, temp):
+        if self.count == 255:
+            self._close()
+        if self.count == 0:
+            self.vbat0, self.temp0, self.count = vbat, temp, 1
+        elif (vbat, temp) == (self.last_vbat, self.last_temp) and self.last_tok is not None \
+                and (self.data[self.last_tok] == 0x00 or
+                     TOKEN_RUN_MIN <= self.data[self.last_tok] < TOKEN_RUN_MAX):
+            t = self.data[self.last_tok]
+            self.data[self.last_tok] = TOKEN_RUN_MIN if t == 0 else t + 1
+            self.count += 1
+        else:
+            zv, zt = zigzag(vbat - self.last_vbat), zigzag(temp - self.last_temp)
+            if zv < 8 and zt < 16:
+                tok = bytes([(zv << 4) | zt])
+            else:
+                tok = bytes([TOKEN_ESCAPE]) + varint_put(zv) + varint_put(zt)
+            if len(self.data) + len(tok) > DATA_SIZE:
+                self._close()
+                return self.append(vbat, temp)
+            self.last_tok = len(self.data)
+            self.data += tok
+            self.count += 1
+        self.last_vbat, self.last_temp = vbat, temp
+
+    def dump(self, interval_min=60, age_min=0):
+        # Flushed like a download: the partial block goes last, and stays.
+        blocks = self.blocks + ([self._block()] if self.count else [])
+        return PREAMBLE.pack(VERSION, BLOCK_SIZE, len(blocks), interval_min, age_min) + b''.join(blocks)
+
+
+# --- decoder ---------------------------------------------------------------
+
+def decode_block(block):
+    crc, seq, count, flags, vbat, temp = HEADER.unpack_from(block)
+    if crc != crc16(block[2:]):
+        raise ValueError('block %d: bad crc' % seq)
+    data = block[HEADER.size:]
+    samples = [(vbat, temp)]
+    pos = 0
+    while len(samples) < count:
+        t = data[pos]
+        pos += 1
+        if t < TOKEN_ESCAPE:
+            vbat += unzigzag(t >> 4)
+            temp += unzigzag(t & 0x0F)
+            samples.append((vbat, temp))
+        elif t == TOKEN_ESCAPE:
+            zv, pos = varint_get(data, pos)
+            zt, pos = varint_get(data, pos)
+            vbat += unzigzag(zv)
+            temp += unzigzag(zt)
+            samples.append((vbat, temp))
+        else:
+            samples += [(vbat, temp)] * (t - 0x7F)
+    return seq, flags, samples
+
+
+def decode(dump):
+    version, block_size, count, interval_min, age_min = PREAMBLE.unpack_from(dump)
+    if version != VERSION or block_size != BLOCK_SIZE:
+        raise ValueError('unsupported history version %d / block size %d' % (version, block_size))
+    body = dump[PREAMBLE.size:]
+    if len(body) < count * BLOCK_SIZE:
+        raise ValueError('short download: %d of %d blocks' % (len(body) // BLOCK_SIZE, count))
+    segments = [[]]
+    for i in range(count):
+        seq, flags, samples = decode_block(body[i * BLOCK_SIZE:(i + 1) * BLOCK_SIZE])
+        if flags & FLAG_BOOT and segments[-1]:
+            segments.append([])
+        segments[-1] += samples
+    return interval_min, age_min, segments
+
+
+def read_dump(path):
+    raw = open(path, 'rb').read()
+    try:
+        text = raw.decode('ascii')
+        hexdigits = ''.join(text.replace('0x', ' ').replace(',', ' ').replace('-', ' ').split())
+        return bytes.fromhex(hexdigits)
+    except ValueError:
+        return raw
+
+
+def read_trace(path):
+    trace = []
+    for line in open(path):
+        line = line.split('#')[0].strip()
+        if not line:
+            continue
+        vbat, temp = line.split(',')[:2]
+        trace.append((int(round(float(vbat) / VBAT_UNIT_MV)),
+                      int(round(float(temp) / TEMP_UNIT_C))))
+    return trace
+
+
+def synthetic_traces():
+    rnd = random.Random(2016)
+    yield 'flat', [(300, 88)] * 2000
+    yield 'steps', [(300 - i // 97, 80 + (i // 13) % 5) for i in range(2000)]
+    yield 'daily', [(int(300 - i / 40.0),
+                     int(88 + 24 * math.sin(i * 2 * math.pi / 24)) + rnd.choice((-1, 0, 1)))
+                    for i in range(24 * 90)]
+    yield 'noise', [(rnd.randrange(180, 360), rnd.randrange(-160, 340)) for _ in range(500)]
+
+
+def ring_kept(count):
+    # The ring erases its oldest page as the head enters it.
+    if count <= 2 * RING_BLOCKS:
+        return count
+    return RING_BLOCKS + (count - 1) % RING_BLOCKS + 1
+
+
+# --- commands ---------------------------------------------------------------
+
+def cmd_decode(path):
+    interval_min, age_min, segments = decode(read_dump(path))
+    print('# interval %d min, newest sample %d min ago' % (interval_min, age_min))
+    print('minutes_ago,vbat_mv,temp_c')
+    for n, segment in enumerate(segments):
+        if n:
+            print('# reset: time gap unknown')
+        for i, (vbat, temp) in enumerate(segment):
+            ago = age_min + (len(segment) - 1 - i) * interval_min if n == len(segments) - 1 else ''
+            print('%s,%d,%.2f' % (ago, vbat * VBAT_UNIT_MV, temp * TEMP_UNIT_C))
+
+
+def cmd_encode(trace_path, dump_path):
+    enc = Encoder()
+    for vbat, temp in read_trace(trace_path):
+        enc.append(vbat, temp)
+    open(dump_path, 'wb').write(enc.dump())
+
+
+def cmd_check(paths):
+    traces = [(p, read_trace(p)) for p in paths] or list(synthetic_traces())
+    ok = True
+    for name, trace in traces:
+        enc = Encoder()
+        for vbat, temp in trace:
+            enc.append(vbat, temp)
+        dump = enc.dump()
+        _, _, segments = decode(dump)
+        good = segments == [trace]
+        ok &= good
+        print('%-12s %5d samples  %5d bytes  %.2f bytes/sample  %s' %
+              (name, len(trace), len(dump) - PREAMBLE.size,
+               (len(dump) - PREAMBLE.size) / float(max(len(trace), 1)),
+               'ok' if good else 'MISMATCH'))
+    return 0 if ok else 1
+
+
+def run_host(program, trace):
+    fd, csv = tempfile.mkstemp(suffix='.csv')
+    with os.fdopen(fd, 'w') as f:
+        for vbat, temp in trace:
+            f.write('%d,%.2f\n' % (vbat * VBAT_UNIT_MV, temp * TEMP_UNIT_C))
+    dump = csv[:-4] + '.bin'
+    try:
+        subprocess.check_call([program, csv, dump])
+        return open(dump, 'rb').read()
+    finally:
+        os.remove(csv)
+        if os.path.exists(dump):
+            os.remove(dump)
+
+
+def cmd_host(program, paths):
+    traces = [(name, trace, None) for name, trace in synthetic_traces()]
+    for p in paths:
+        if p.endswith('.csv'):
+            traces.append((p, read_trace(p), None))
+        else:
+            recorded = read_dump(p)
+            _, _, segments = decode(recorded)
+            if len(segments) != 1:
+                raise ValueError('%s: a reset in the recording' % p)
+            traces.append((p, segments[0], recorded))
+    ok = True
+    for name, trace, recorded in traces:
+        enc = Encoder()
+        for vbat, temp in trace:
+            enc.append(vbat, temp)
+        tail = enc._block() if enc.count else b''
+        kept = enc.blocks[len(enc.blocks) - ring_kept(len(enc.blocks)):]
+        want = PREAMBLE.pack(VERSION, BLOCK_SIZE, len(kept) + (1 if tail else 0), 60, 0) + \
+            b''.join(kept) + tail
+        got = run_host(program, trace)
+        good = got == want and (recorded is None or got == recorded == enc.dump())
+        ok &= good
+        print('%-20s %5d samples  %3d blocks  %3d kept  %s' %
+              (os.path.basename(name), len(trace), len(enc.blocks) + (1 if tail else 0),
+               len(kept) + (1 if tail else 0), 'ok' if good else 'MISMATCH'))
+    return 0 if ok else 1
+
+
+def main(argv):
+    if len(argv) >= 3 and argv[1] == 'decode':
+        cmd_decode(argv[2])
+    elif len(argv) == 4 and argv[1] == 'encode':
+        cmd_encode(argv[2], argv[3])
+    elif len(argv) >= 2 and argv[1] == 'check':
+        return cmd_check(argv[2:])
+    elif len(argv) >= 3 and argv[1] == 'host':
+        return cmd_host(argv[2], argv[3:])
+    else:
+        sys.stderr.write('usage: history.py decode <dump> | encode <csv> <dump> | check [csv ...] | '
+                         'host <history_host> [csv | dump ...]\n')
+        return 2
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,273 @@
+/*---------------------------------------------------------------------------*/
+/*  history_host.c   fw/app/history.c on the host: a trace in, a download   */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  history_host <trace.csv> <dump>
+ *
+ *  The firmware's encoder, as "history.py encode" is the tool's: each
+ *  "vbat_mv,temp_c" line of the trace is one sample, taken by history.c
+ *  through its own event handler, and the download that follows is what
+ *  a central would have put together from the notifications.
+ *
+ *  The two history pages are host memory that behaves as NOR flash, and
+ *  the flash queue runs its jobs after each sample, so no block is
+ *  dropped; a long trace wraps the ring as the tag would.  The TX buffers
+ *  run out every few notifications, so the download resumes on
+ *  BLE_EVT_TX_COMPLETE as it does over the air.
+ *
+ *  "history.py host history_host" checks the dumps against the Python
+ *  encoder, on the synthetic traces and on the recorded ones in traces/.
+ */
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+
+#include "nrf51.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "ble.h"
+#include "app_timer.h"
+#include "pstorage.h"
+#include "crc16.h"
+
+#include "config.h"
+#include "evq.h"
+#include "history.h"
+#include "ble_eddy.h"
+#include "battery.h"
+#include "temperature.h"
+#include "flash_queue.h"
+#include "diag.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define PAGE_SIZE           1024                // NRF_FICR->CODEPAGESIZE
+#define PAGES               2                   // HISTORY_PAGES
+#define FLASH_BASE          0x30000UL           // below 4G: block_id is 32 bits
+
+#define TX_BUFFERS          3                   // free after each TX_COMPLETE
+#define DUMP_MAX            (sizeof(history_preamble_t) + PAGES * PAGE_SIZE + HISTORY_BLOCK_SIZE)
+
+ble_eddy_t              g_eddy_service;
+diag_t                  g_diag;
+
+static evq_handler_t    m_sample;               // history.c's, from evq_put()
+static uint16_t         m_vbat_mv;
+static int16_t          m_temp;
+
+static uint8_t          m_dump [DUMP_MAX];
+static size_t           m_dump_len;
+static unsigned         m_tx_free;
+
+/*---------------------------------------------------------------------------*/
+/*  Flash: a write can only clear bits, an erase sets the page.              */
+/*---------------------------------------------------------------------------*/
+uint32_t flash_queue_write(uint32_t * p_dst, uint32_t const * p_src, uint16_t words,
+                           flash_queue_cb_t cb, void * p_context)
+{
+    while (words-- > 0)
+        *p_dst++ &= *p_src++;
+
+    if (cb != NULL)
+        cb(NRF_SUCCESS, p_context);
+    return NRF_SUCCESS;
+}
+
+uint32_t flash_queue_erase(uint32_t * p_page, uint16_t pages,
+                           flash_queue_cb_t cb, void * p_context)
+{
+    memset(p_page, 0xFF, (size_t) pages * PAGE_SIZE);
+
+    if (cb != NULL)
+        cb(NRF_SUCCESS, p_context);
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_register(pstorage_module_param_t * p_module_param, pstorage_handle_t * p_block_id)
+{
+    if (p_module_param->block_size != PAGE_SIZE || p_module_param->block_count != PAGES)
+        return NRF_ERROR_INVALID_PARAM;
+
+    p_block_id->module_id = 0;
+    p_block_id->block_id  = FLASH_BASE;
+    return NRF_SUCCESS;
+}
+
+uint16_t crc16_compute(const uint8_t * p_data, uint32_t size, const uint16_t * p_crc)
+{
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        crc  = (uint8_t) (crc >> 8) | (crc << 8);
+        crc ^= p_data[i];
+        crc ^= (uint8_t) (crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+    return crc;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The sample: the trace's values, taken when history.c asks.               */
+/*---------------------------------------------------------------------------*/
+uint16_t battery_level_get(void)
+{
+    return m_vbat_mv;
+}
+
+int16_t temperature_raw_get(void)
+{
+    return m_temp;
+}
+
+/* Only the first sample is put, at init: the minute tick is not run. */
+uint32_t evq_put(evq_priority_t priority, evq_handler_t handler, uintptr_t arg)
+{
+    m_sample = handler;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_critical_region_enter(uint8_t * p_is_nested_critical_region)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_critical_region_exit(uint8_t is_nested_critical_region)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_create(app_timer_id_t * p_timer_id, app_timer_mode_t mode,
+                          app_timer_timeout_handler_t timeout_handler)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The download, as the central receives it.                                */
+/*---------------------------------------------------------------------------*/
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * const p_hvx_params)
+{
+    uint16_t len = *p_hvx_params->p_len;
+
+    if (m_tx_free == 0)
+        return BLE_ERROR_NO_TX_BUFFERS;
+    if (len > GATT_MTU_SIZE_DEFAULT - 3 || m_dump_len + len > sizeof(m_dump)) {
+        fprintf(stderr, "history_host: notification of %u bytes\n", (unsigned) len);
+        exit(1);
+    }
+
+    memcpy(&m_dump[m_dump_len], p_hvx_params->p_data, len);
+    m_dump_len += len;
+    m_tx_free--;
+    return NRF_SUCCESS;
+}
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    fprintf(stderr, "%s:%u: error 0x%x\n", (const char *) p_file_name, (unsigned) line_num,
+            (unsigned) error_code);
+    exit(3);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void * map(uintptr_t base, size_t size)
+{
+    void * p = mmap((void *) base, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (p == MAP_FAILED || p != (void *) base) {
+        perror("history_host: mmap");
+        exit(2);
+    }
+    return p;
+}
+
+/* As history.py's read_trace(), '#' starts a comment; history.py host
+   feeds it whole steps, so the rounding is the same. */
+static unsigned feed(FILE * p_trace)
+{
+    char     line [256];
+    unsigned samples = 0;
+    double   mv, c;
+
+    while (fgets(line, sizeof(line), p_trace) != NULL) {
+        line[strcspn(line, "#")] = '\0';
+        if (sscanf(line, " %lf , %lf", &mv, &c) != 2)
+            continue;
+
+        m_vbat_mv = (uint16_t) lround(mv);
+        m_temp    = (int16_t) lround(c * 4);
+        m_sample(0);
+        samples++;
+    }
+    return samples;
+}
+
+int main(int argc, char * argv [])
+{
+    ble_evt_t  evt;
+    FILE     * p_trace;
+    FILE     * p_dump;
+    size_t     len;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: history_host <trace.csv> <dump>\n");
+        return 2;
+    }
+    p_trace = fopen(argv[1], "r");
+    if (p_trace == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    /* The FICR, for PSTORAGE_FLASH_PAGE_SIZE; the pages, erased. */
+    map(NRF_FICR_BASE, 4096);
+    *(uint32_t *) &NRF_FICR->CODEPAGESIZE = PAGE_SIZE;
+    memset(map(FLASH_BASE, PAGES * PAGE_SIZE), 0xFF, PAGES * PAGE_SIZE);
+
+    history_init();
+
+    /* init asked for the first sample; each line of the trace is one. */
+    if (m_sample == NULL || feed(p_trace) == 0) {
+        fprintf(stderr, "history_host: %s: no samples\n", argv[1]);
+        return 2;
+    }
+    fclose(p_trace);
+
+    g_eddy_service.conn_handle = 0;
+    m_tx_free = TX_BUFFERS;
+    history_download_start();
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id = BLE_EVT_TX_COMPLETE;
+    do {
+        len = m_dump_len;
+        m_tx_free = TX_BUFFERS;
+        history_on_ble_evt(&evt);
+    } while (m_dump_len != len);
+
+    p_dump = fopen(argv[2], "wb");
+    if (p_dump == NULL || fwrite(m_dump, 1, m_dump_len, p_dump) != m_dump_len ||
+        fclose(p_dump) != 0) {
+        perror(argv[2]);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,725 @@
+/*---------------------------------------------------------------------------*/
+/*  driver.c   runs the firmware on the host against a script               */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  trackr_host [-q] [-c] [-e] [-s seed] [-f flash.bin] [-w pins.vcd] script.txt
+ *
+ *  The script is what happens to the tag, one line each, at a time in ms
+ *  from power on, in time order ('#' starts a comment):
+ *
+ *      <ms> button down|up         the button, pressed or let go
+ *      <ms> connect [interval ms]  a central connects (connectable only)
+ *      <ms> disconnect             and goes away
+ *      <ms> write <uuid> <hex>     writes a characteristic, by 16-bit UUID
+ *      <ms> cccd <uuid> on|off     notifications on or off
+ *      <ms> read <uuid>            traces the value
+ *      <ms> radio active|inactive  a radio notification, out of turn
+ *      <ms> vbat <mV>              the battery voltage, 3000 at the start
+ *      <ms> temp <C>               the die temperature, 25 at the start
+ *      <ms> reset                  the reset pin
+ *      <ms> adv <ms>               the advertising interval, as the console's
+ *      <ms> mix <uid> <url> <tlm>  the Eddystone frame mix, as the console's
+ *      <ms> tx <dBm>               the TX power, as the console's
+ *      <ms> expect <text>          a trace line since the last expect has it
+ *      <ms> wave <pin> <window ms> hz|duty|gap|edges <min> <max>
+ *                                  the pin over the window before, see wave.c
+ *
+ *  Everything that happens is traced to stdout, stamped in seconds: radio
+ *  packets, pins, flash operations, the firmware's log lines ("log").  The
+ *  run ends at the last line, with a table of the calls into the firmware
+ *  (and with -c the instructions they took); with -e, the energy the run
+ *  took and the coin cell's life at that rate (see energy.c).  A day of
+ *  script with -q runs in well under a minute.  -w writes the pins out as
+ *  VCD.  Exit status 1 if an expect or a wave check was not met, 2 for a
+ *  bad script or the firmware doing something the chip would not.
+ *
+ *  A reset starts the process again (exec), from main(), with what a reset
+ *  keeps: flash, the .noinit crash record, GPREGRET, the pins outside.
+ */
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "nrf51.h"
+#include "nrf51_bitfields.h"
+#include "ble_gap.h"
+
+#include "trackr_board.h"
+#include "crash.h"
+#include "advert.h"
+#include "eddystone.h"
+
+#include "host.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#define LINE_MAX_LEN        256
+#define LOG_LINE_MAX        200
+#define RESUME_MAGIC        0x54534552      // "REST"
+
+typedef struct {
+    uint32_t  line;                 // in the file, for the messages
+    double    ms;
+    char      text [LINE_MAX_LEN];  // the command and its arguments
+} script_line_t;
+
+static script_line_t * m_script;
+static uint32_t        m_script_count;
+static uint32_t        m_script_next;
+static const char    * m_script_name;
+
+static bool            m_quiet;
+static bool            m_expecting;         // the script has an expect
+static bool            m_off;               // System OFF
+static bool            m_energy;            // -e
+static const char    * m_vcd;               // -w
+
+static int             m_button = -1;       // as driven: -1 let go, 0 down
+
+/* Trace lines since the last expect, when there is one to come. */
+static char          * m_seen;
+static size_t          m_seen_len;
+static size_t          m_seen_size;
+
+/* The firmware's log, put together into lines. */
+static char            m_log [LOG_LINE_MAX + 1];
+static uint32_t        m_log_len;
+
+static char         ** m_argv;
+
+/*---------------------------------------------------------------------------*/
+/*  What a reset keeps.                                                      */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    uint32_t         magic;
+    uint32_t         reason;
+    sim_time_t       now;
+    uint32_t         script_next;
+    uint32_t         seed;
+    uint32_t         gpregret;
+    int32_t          button;
+    uint16_t         vbat_mv;
+    int32_t          temp;
+    sim_ctx_stats_t  ctx [SIM_CTX_COUNT];
+    energy_t         energy;
+    crash_record_t   crash;
+    uint64_t         seen_len;          // then the flash, then the seen lines
+} resume_t;
+
+/*---------------------------------------------------------------------------*/
+/*  Trace                                                                    */
+/*---------------------------------------------------------------------------*/
+bool trace_wanted(void)
+{
+    return !m_quiet || m_expecting;
+}
+
+static void seen_add(const char * text)
+{
+    size_t len = strlen(text) + 1;
+
+    if (m_seen_len + len > m_seen_size) {
+        m_seen_size = (m_seen_len + len) * 2;
+        m_seen = realloc(m_seen, m_seen_size);
+        if (m_seen == NULL) {
+            fprintf(stderr, "host: out of memory\n");
+            exit(2);
+        }
+    }
+    memcpy(&m_seen[m_seen_len], text, len);
+    m_seen_len += len;
+}
+
+void trace(const char * fmt, ...)
+{
+    char    text [LINE_MAX_LEN];
+    va_list args;
+
+    if (!trace_wanted())
+        return;
+
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    if (!m_quiet)
+        fprintf(stdout, "%6llu.%06llu %s\n",
+                (unsigned long long) (g_sim_now / 1000000000),
+                (unsigned long long) (g_sim_now % 1000000000 / 1000), text);
+    if (m_expecting)
+        seen_add(text);
+}
+
+/* Has any line since the last expect got it?  Then start again. */
+static bool seen_has(const char * text)
+{
+    size_t i = 0;
+    bool   found = false;
+
+    while (i < m_seen_len && !found) {
+        found = (strstr(&m_seen[i], text) != NULL);
+        i += strlen(&m_seen[i]) + 1;
+    }
+    m_seen_len = 0;
+    return found;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The firmware's printf(), puts() and putchar(), wrapped by the linker.    */
+/*  Host code here writes with fprintf() to stay out of the way.             */
+/*---------------------------------------------------------------------------*/
+static void log_char(char ch)
+{
+    if (ch == '\r')
+        return;
+    if (ch == '\n' || m_log_len == LOG_LINE_MAX) {
+        m_log[m_log_len] = '\0';
+        if (m_log_len > 0)
+            trace("log %s", m_log);
+        m_log_len = 0;
+        if (ch == '\n')
+            return;
+    }
+    m_log[m_log_len++] = ch;
+}
+
+static void log_text(const char * text)
+{
+    while (*text)
+        log_char(*text++);
+}
+
+int __wrap_printf(const char * fmt, ...)
+{
+    char    text [LINE_MAX_LEN];
+    va_list args;
+    int     len;
+
+    va_start(args, fmt);
+    len = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    log_text(text);
+    return len;
+}
+
+int __wrap_puts(const char * text)
+{
+    log_text(text);
+    log_char('\n');
+    return 1;
+}
+
+int __wrap_putchar(int ch)
+{
+    log_char((char) ch);
+    return ch;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The script                                                               */
+/*---------------------------------------------------------------------------*/
+static void script_error(const script_line_t * p_line, const char * what)
+{
+    fprintf(stderr, "%s:%u: %s: %s\n", m_script_name, (unsigned) p_line->line,
+            what, p_line->text);
+    exit(2);
+}
+
+static void script_load(const char * name)
+{
+    FILE   * fp = fopen(name, "r");
+    char     buf [LINE_MAX_LEN];
+    uint32_t line = 0;
+    uint32_t size = 0;
+    double   last = 0;
+
+    if (fp == NULL) {
+        fprintf(stderr, "host: cannot open %s: %s\n", name, strerror(errno));
+        exit(2);
+    }
+    m_script_name = name;
+
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        script_line_t * p;
+        char          * s = buf;
+        char          * end;
+
+        line++;
+        s[strcspn(s, "#\r\n")] = '\0';
+        while (isspace((unsigned char) *s))
+            s++;
+        if (*s == '\0')
+            continue;
+
+        if (m_script_count == size) {
+            size = size ? size * 2 : 64;
+            m_script = realloc(m_script, size * sizeof(*m_script));
+        }
+        p = &m_script[m_script_count++];
+        p->line = line;
+        p->ms   = strtod(s, &end);
+
+        while (isspace((unsigned char) *end))
+            end++;
+        for (s = end + strlen(end); s > end && isspace((unsigned char) s[-1]); s--)
+            ;
+        *s = '\0';
+        snprintf(p->text, sizeof(p->text), "%s", end);
+
+        if (end == buf || p->ms < last)
+            script_error(p, "out of time order");
+        last = p->ms;
+
+        if (strncmp(p->text, "expect ", 7) == 0)
+            m_expecting = true;
+    }
+    fclose(fp);
+}
+
+static sim_time_t script_time(const script_line_t * p_line)
+{
+    return (sim_time_t) (p_line->ms * 1000000.0 + 0.5);
+}
+
+/* The bytes of a hex string, or -1. */
+static int hex_parse(const char * s, uint8_t * p_data, int max)
+{
+    int len = 0;
+
+    while (isxdigit((unsigned char) s[0]) && isxdigit((unsigned char) s[1])) {
+        unsigned byte;
+        if (len == max)
+            return -1;
+        sscanf(s, "%2x", &byte);
+        p_data[len++] = (uint8_t) byte;
+        s += 2;
+    }
+    return (*s == '\0') ? len : -1;
+}
+
+static void button(int level)
+{
+    m_button = level;
+    regs_pin_drive(BSP_BUTTON_0, level);
+}
+
+/* wave <pin> <window ms> hz|duty|gap|edges <min> <max> */
+static void wave_check(const script_line_t * p_line)
+{
+    static const char * const names [] = { "hz", "duty", "gap", "edges" };
+
+    char     name [16];
+    unsigned pin;
+    double   window, min, max, lo = 0, hi = 0;
+    int      measure;
+    int      count;
+
+    if (sscanf(p_line->text, "wave %u %lf %15s %lf %lf", &pin, &window, name, &min, &max) != 5 ||
+        pin > 31 || window <= 0)
+        script_error(p_line, "what is this");
+
+    for (measure = 0; measure <= WAVE_EDGES; measure++)
+        if (strcmp(name, names[measure]) == 0)
+            break;
+    if (measure > WAVE_EDGES)
+        script_error(p_line, "hz, duty, gap or edges");
+
+    count = wave_measure(pin, (sim_time_t) (window * 1000000.0 + 0.5), measure, &lo, &hi);
+    if (count < 0)
+        script_error(p_line, "the window goes back before the pins kept");
+
+    if (count == 0 || lo < min || hi > max) {
+        if (count == 0)
+            fprintf(stderr, "%s:%u: pin %u %s: nothing to measure\n", m_script_name,
+                    (unsigned) p_line->line, pin, name);
+        else
+            fprintf(stderr, "%s:%u: pin %u %s %g..%g, not within %g..%g\n", m_script_name,
+                    (unsigned) p_line->line, pin, name, lo, hi, min, max);
+        exit(1);
+    }
+    if (!m_quiet)
+        trace("wave pin %u %s %g..%g", pin, name, lo, hi);
+}
+
+static void script_run(const script_line_t * p_line)
+{
+    char     cmd [32] = "";
+    char     arg [LINE_MAX_LEN] = "";
+    char     val [LINE_MAX_LEN] = "";
+    uint8_t  data [64];
+    unsigned uuid;
+    unsigned mix [3];
+    int      len;
+    uint32_t err_code;
+
+    sscanf(p_line->text, "%31s %255s %255s", cmd, arg, val);
+
+    if (strcmp(cmd, "expect") == 0) {
+        const char * text = p_line->text + 6;
+        while (isspace((unsigned char) *text))
+            text++;
+        if (!seen_has(text)) {
+            fprintf(stderr, "%s:%u: expected \"%s\", not seen\n", m_script_name,
+                    (unsigned) p_line->line, text);
+            exit(1);
+        }
+        return;
+    }
+
+    if (strcmp(cmd, "wave") == 0) {
+        wave_check(p_line);
+        return;
+    }
+
+    if (!m_quiet)
+        trace("script %s", p_line->text);
+
+    if (strcmp(cmd, "button") == 0 && strcmp(arg, "down") == 0)
+        button(0);
+    else if (strcmp(cmd, "button") == 0 && strcmp(arg, "up") == 0)
+        button(-1);
+    else if (strcmp(cmd, "vbat") == 0 && atoi(arg) > 0)
+        g_regs_vbat_mv = atoi(arg);
+    else if (strcmp(cmd, "temp") == 0 && arg[0])
+        g_sd_temp = (int32_t) (atof(arg) * 4);
+    else if (strcmp(cmd, "reset") == 0)
+        sim_reset(POWER_RESETREAS_RESETPIN_Msk);
+    else if (m_off)
+        script_error(p_line, "the chip is off");
+    else if (strcmp(cmd, "connect") == 0) {
+        if (!sd_host_connect(arg[0] ? atoi(arg) : 0))
+            script_error(p_line, "not advertising connectable");
+    }
+    else if (strcmp(cmd, "disconnect") == 0) {
+        if (!sd_host_disconnect())
+            script_error(p_line, "not connected");
+    }
+    else if (strcmp(cmd, "write") == 0 && sscanf(arg, "%x", &uuid) == 1 &&
+             (len = hex_parse(val, data, sizeof(data))) >= 0) {
+        if (!sd_host_write(uuid, false, data, len))
+            script_error(p_line, "not connected, or no such characteristic");
+    }
+    else if (strcmp(cmd, "cccd") == 0 && sscanf(arg, "%x", &uuid) == 1 &&
+             (strcmp(val, "on") == 0 || strcmp(val, "off") == 0)) {
+        data[0] = (strcmp(val, "on") == 0);
+        data[1] = 0;
+        if (!sd_host_write(uuid, true, data, 2))
+            script_error(p_line, "not connected, or no notifications there");
+    }
+    else if (strcmp(cmd, "read") == 0 && sscanf(arg, "%x", &uuid) == 1) {
+        if (!sd_host_read(uuid))
+            script_error(p_line, "not connected, or no such characteristic");
+    }
+    else if (strcmp(cmd, "radio") == 0 && strcmp(arg, "active") == 0)
+        sd_host_radio(true);
+    else if (strcmp(cmd, "radio") == 0 && strcmp(arg, "inactive") == 0)
+        sd_host_radio(false);
+    else if (strcmp(cmd, "adv") == 0 && atoi(arg) > 0) {
+        sim_irq_enter(SIM_CTX_MAIN);
+        err_code = advertising_interval_set((uint16_t) atoi(arg));
+        sim_irq_exit();
+        if (err_code != NRF_SUCCESS)
+            script_error(p_line, "refused");
+    }
+    else if (strcmp(cmd, "mix") == 0 &&
+             sscanf(p_line->text, "mix %u %u %u", &mix[0], &mix[1], &mix[2]) == 3 &&
+             mix[0] < 256 && mix[1] < 256 && mix[2] < 256) {
+        sim_irq_enter(SIM_CTX_MAIN);
+        eddystone_mix_set(mix[0], mix[1], mix[2]);
+        sim_irq_exit();
+    }
+    else if (strcmp(cmd, "tx") == 0 && arg[0]) {
+        sim_irq_enter(SIM_CTX_MAIN);
+        err_code = sd_ble_gap_tx_power_set((int8_t) atoi(arg));
+        sim_irq_exit();
+        if (err_code != NRF_SUCCESS)
+            script_error(p_line, "refused");
+    }
+    else
+        script_error(p_line, "what is this");
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The end of the run                                                       */
+/*---------------------------------------------------------------------------*/
+static void summary(void)
+{
+    uint32_t ctx;
+
+    fprintf(stdout, "\n%s: %llu.%03llu s\n\n", m_script_name,
+            (unsigned long long) (g_sim_now / 1000000000),
+            (unsigned long long) (g_sim_now % 1000000000 / 1000000));
+
+    if (g_sim_count)
+        fprintf(stdout, "  %-8s %8s %14s %10s %10s\n", "context", "calls",
+                "instructions", "per call", "most");
+    else
+        fprintf(stdout, "  %-8s %8s\n", "context", "calls");
+
+    for (ctx = 0; ctx < SIM_CTX_COUNT; ctx++) {
+        sim_ctx_stats_t * p = &g_sim_ctx[ctx];
+        if (!g_sim_count)
+            fprintf(stdout, "  %-8s %8u\n", g_sim_ctx_names[ctx], (unsigned) p->calls);
+        else
+            fprintf(stdout, "  %-8s %8u %14llu %10llu %10llu\n", g_sim_ctx_names[ctx],
+                    (unsigned) p->calls, (unsigned long long) p->instructions,
+                    (unsigned long long) (p->counted ? p->instructions / p->counted : 0),
+                    (unsigned long long) p->max);
+    }
+    fflush(stdout);
+}
+
+static void finish(void) __attribute__ ((noreturn));
+
+static void finish(void)
+{
+    if (m_log_len > 0)
+        log_char('\n');
+    summary();
+    if (m_energy)
+        energy_report();
+    exit(0);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Asleep in sd_app_evt_wait(): the next thing due, or the script's next   */
+/*  line, the thing first if both are at the same time.                      */
+/*---------------------------------------------------------------------------*/
+void sim_wait(void)
+{
+    sim_time_t until;
+
+    if (m_script_next == m_script_count)
+        finish();
+
+    until = script_time(&m_script[m_script_next]);
+
+    if (sim_step(until))
+        return;
+
+    sim_time_set(until);
+    script_run(&m_script[m_script_next++]);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Resets                                                                   */
+/*---------------------------------------------------------------------------*/
+void sim_reset(uint32_t reason)
+{
+    resume_t resume;
+    char     fd_arg [16];
+    char   * argv [64];
+    int      argc = 0;
+    int      fd;
+
+    if (m_log_len > 0)
+        log_char('\n');
+    trace("reset%s%s%s", (reason & POWER_RESETREAS_SREQ_Msk)     ? " sreq" : "",
+                         (reason & POWER_RESETREAS_RESETPIN_Msk) ? " pin"  : "",
+                         (reason & POWER_RESETREAS_OFF_Msk)      ? " off"  : "");
+    fflush(stdout);
+    wave_flush();
+
+    energy_reset();
+
+    memset(&resume, 0, sizeof(resume));
+    resume.magic       = RESUME_MAGIC;
+    resume.reason      = reason;
+    resume.now         = g_sim_now;
+    resume.script_next = m_script_next;
+    resume.seed        = g_sim_seed;
+    resume.gpregret    = ((NRF_POWER_Type *) regs_host(NRF_POWER))->GPREGRET;
+    resume.button      = m_button;
+    resume.vbat_mv     = g_regs_vbat_mv;
+    resume.temp        = g_sd_temp;
+    resume.seen_len    = m_seen_len;
+    memcpy(resume.ctx, g_sim_ctx, sizeof(resume.ctx));
+    resume.energy      = g_energy;
+
+    /* RAM goes with System OFF; the crash record only lives through resets. */
+    if (!m_off)
+        resume.crash = *crash_record_get();
+
+    fd = memfd_create("resume", 0);
+    if (fd < 0 ||
+        write(fd, &resume, sizeof(resume)) != sizeof(resume) ||
+        write(fd, (void *) FLASH_START, FLASH_END - FLASH_START) != FLASH_END - FLASH_START ||
+        write(fd, m_seen, m_seen_len) != (ssize_t) m_seen_len) {
+        fprintf(stderr, "host: cannot keep the state over the reset\n");
+        exit(2);
+    }
+    lseek(fd, 0, SEEK_SET);
+    snprintf(fd_arg, sizeof(fd_arg), "%d", fd);
+
+    /* The same arguments, and where to carry on from. */
+    argv[argc++] = m_argv[0];
+    argv[argc++] = "-r";
+    argv[argc++] = fd_arg;
+    for (char ** p = &m_argv[1]; *p != NULL && argc < 62; p++)
+        argv[argc++] = *p;
+    argv[argc] = NULL;
+
+    execv("/proc/self/exe", argv);
+    fprintf(stderr, "host: cannot restart: %s\n", strerror(errno));
+    exit(2);
+}
+
+static void resume(int fd)
+{
+    resume_t resume;
+
+    if (read(fd, &resume, sizeof(resume)) != sizeof(resume) || resume.magic != RESUME_MAGIC ||
+        read(fd, (void *) FLASH_START, FLASH_END - FLASH_START) != FLASH_END - FLASH_START) {
+        fprintf(stderr, "host: no state to resume from\n");
+        exit(2);
+    }
+    m_seen_len = m_seen_size = resume.seen_len;
+    m_seen = malloc(m_seen_size + 1);
+    if (read(fd, m_seen, m_seen_len) != (ssize_t) m_seen_len) {
+        fprintf(stderr, "host: no state to resume from\n");
+        exit(2);
+    }
+    close(fd);
+
+    sim_time_set(resume.now);
+    m_script_next  = resume.script_next;
+    g_sim_seed     = resume.seed;
+    g_regs_vbat_mv = resume.vbat_mv;
+    g_sd_temp      = resume.temp;
+    memcpy(g_sim_ctx, resume.ctx, sizeof(g_sim_ctx));
+    g_energy       = resume.energy;
+
+    ((NRF_POWER_Type *) regs_host(NRF_POWER))->GPREGRET = resume.gpregret;
+    regs_reset_reason(resume.reason);
+    *crash_record_get() = resume.crash;
+
+    if (resume.button >= 0)
+        button(resume.button);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  System OFF: only the pins with SENSE set can wake it, with a reset.     */
+/*---------------------------------------------------------------------------*/
+static bool off_wakeup(void)
+{
+    NRF_GPIO_Type * gpio = regs_host(NRF_GPIO);
+    uint32_t        pin;
+
+    for (pin = 0; pin < 32; pin++) {
+        uint32_t sense = (gpio->PIN_CNF[pin] & GPIO_PIN_CNF_SENSE_Msk) >> GPIO_PIN_CNF_SENSE_Pos;
+        uint32_t level = (gpio->IN >> pin) & 1;
+
+        if ((sense == GPIO_PIN_CNF_SENSE_High && level) ||
+            (sense == GPIO_PIN_CNF_SENSE_Low  && !level))
+            return true;
+    }
+    return false;
+}
+
+void sim_system_off(void)
+{
+    if (m_log_len > 0)
+        log_char('\n');
+    trace("system off");
+    m_off = true;
+    energy_off();
+
+    /* Nothing runs: only the script, until a pin wakes the chip. */
+    while (!off_wakeup()) {
+        if (m_script_next == m_script_count)
+            finish();
+        sim_time_set(script_time(&m_script[m_script_next]));
+        script_run(&m_script[m_script_next++]);
+    }
+    sim_reset(POWER_RESETREAS_OFF_Msk);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void usage(void)
+{
+    fprintf(stderr, "usage: trackr_host [-q] [-c] [-e] [-s seed] [-f flash.bin] [-w pins.vcd] script.txt\n");
+    exit(2);
+}
+
+static void flash_load(const char * name)
+{
+    FILE * fp = fopen(name, "rb");
+
+    if (fp == NULL) {
+        fprintf(stderr, "host: cannot open %s: %s\n", name, strerror(errno));
+        exit(2);
+    }
+    if (fread((void *) FLASH_START, 1, FLASH_END - FLASH_START, fp) == 0) {
+        fprintf(stderr, "host: %s is empty\n", name);
+        exit(2);
+    }
+    fclose(fp);
+}
+
+int main(int argc, char * argv [])
+{
+    const char * flash = NULL;
+    sigset_t     none;
+    int          resume_fd = -1;
+    int          opt;
+
+    /* A reset from a register write comes out of a signal handler. */
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+
+    m_argv = argv;
+
+    while ((opt = getopt(argc, argv, "qces:f:w:r:")) != -1) {
+        switch (opt) {
+            case 'q':  m_quiet = true;                              break;
+            case 'c':  g_sim_count = true;                          break;
+            case 'e':  m_energy = true;                             break;
+            case 's':  g_sim_seed = strtoul(optarg, NULL, 0) | 1;   break;
+            case 'f':  flash = optarg;                              break;
+            case 'w':  m_vcd = optarg;                              break;
+            case 'r':  resume_fd = atoi(optarg);                    break;
+            default:   usage();
+        }
+    }
+    if (optind != argc - 1)
+        usage();
+
+    /* -e wants the CPU's share too: a sample of the calls is enough. */
+    g_sim_sample = g_sim_count ? 1 : m_energy ? 1024 : 0;
+
+    regs_init();
+    script_load(argv[optind]);
+
+    if (resume_fd >= 0) {
+        resume(resume_fd);
+    }
+    else {
+        if (flash)
+            flash_load(flash);
+        regs_reset_reason(0);               // power on
+        sim_time_set(0);
+        energy_init();
+    }
+    wave_start(m_vcd, resume_fd >= 0);
+
+    sd_host_init();
+
+    sim_irq_enter(SIM_CTX_BOOT);
+    firmware_main();
+
+    return 0;
+}
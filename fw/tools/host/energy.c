@@ -0,0 +1,280 @@
+/*---------------------------------------------------------------------------*/
+/*  energy.c   the charge the run takes from the battery, and its life      */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Everything that draws current is tallied as it happens, in simulated
+ *  time: each radio event by its length on air and the TX power, the
+ *  16 MHz crystal, the timers, flash writes and erases, ADC and TEMP
+ *  samples, the LED while its pin is high and the piezo each time its
+ *  legs swing.  The CPU's share comes from the instructions each context
+ *  takes (counted in a sample of the calls, see sim.c), at a round
+ *  number of cycles each.
+ *
+ *  The currents are the nRF51822's, from its product specification
+ *  (v3.1, 3 V, LDO: the firmware never turns the DC/DC converter on).
+ *  The board's own, the LED and the piezo, are estimates: measure them
+ *  and put them here.
+ *
+ *  The average over the run projects a CR2032's life.  Every periodic job
+ *  in the firmware comes round within a day, so a day of script is enough
+ *  to stand for a year.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trackr_board.h"
+
+#include "host.h"
+
+/*---------------------------------------------------------------------------*/
+/*  Currents, in uA.                                                         */
+/*---------------------------------------------------------------------------*/
+#define I_ON            2.6         // System ON, RTC running, RAM retained
+#define I_OFF           0.6         // System OFF
+#define I_CPU           4400.0      // running from flash at 16 MHz
+#define I_RX            13000.0     // 1 Mbps
+#define I_X16M          470.0       // 16 MHz crystal
+#define I_RC16M         750.0       // 16 MHz RC, for a timer without the crystal
+#define I_TIMER         100.0       // a TIMER running
+#define I_ADC           260.0       // converting
+#define I_TEMP          1000.0      // measuring
+#define I_FLASH         2500.0      // writing or erasing, CPU halted
+
+/* TX, by power; between the figures the specification gives, interpolated. */
+static const struct {
+    int8_t  dbm;
+    double  ua;
+} m_tx [] = {
+    { 4, 16000.0 }, { 0, 10500.0 }, { -4, 8000.0 }, { -8, 7000.0 }, { -12, 6500.0 },
+    { -16, 6000.0 }, { -20, 5500.0 }, { -30, 5500.0 }, { -40, 5500.0 },
+};
+
+/* The SoftDevice's own work around each radio event, at I_CPU. */
+#define SD_EVENT_US     400
+
+/* The CPU: exception entry and return, and the SoftDevice's dispatch, per
+   call; and cycles per instruction.  The count is of x86 instructions from
+   the same source: Thumb takes more of them, and loads and branches take
+   two cycles on the Cortex-M0, so two each is the round figure. */
+#define CPU_CALL_CYCLES 100
+#define CPU_CYCLES      2
+#define CPU_HZ          16000000.0
+
+/* The board: the LED through its resistor, and the piezo's capacitance. */
+#define I_LED           2000.0
+#define PIEZO_NF        20.0
+
+#define CR2032_MAH      225.0       // nominal, to 2.0 V
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static const char * m_names [ENERGY_COUNT] = {
+    "sleep", "off", "adv", "conn", "crystal", "timer1", "timer2",
+    "led", "piezo", "flash", "adc", "temp",
+};
+
+energy_t  g_energy;
+
+static bool   m_crystal;            // the timers run on it, not the RC
+static int    m_piezo = 0;          // the legs' difference: -1, 0 or 1
+
+/* The ones drawing a current now, up to now. */
+static void accrue(void)
+{
+    double   s = (double) (g_sim_now - g_energy.last) / 1e9;
+    unsigned i;
+
+    for (i = 0; i < ENERGY_COUNT; i++) {
+        energy_tally_t * p = &g_energy.tally[i];
+        if (p->ua > 0) {
+            p->time   += g_sim_now - g_energy.last;
+            p->charge += p->ua * s;
+        }
+    }
+    g_energy.last = g_sim_now;
+}
+
+static void on(energy_item_t item, double ua)
+{
+    energy_tally_t * p = &g_energy.tally[item];
+
+    accrue();
+    if (p->ua == 0 && ua > 0)
+        p->count++;
+    p->ua = ua;
+}
+
+/* Something that takes us, and uc with it. */
+static void event(energy_item_t item, double us, double uc)
+{
+    energy_tally_t * p = &g_energy.tally[item];
+
+    p->count++;
+    p->time   += SIM_US(us);
+    p->charge += uc;
+}
+
+static double tx_ua(int8_t dbm)
+{
+    unsigned i;
+
+    for (i = 1; i < sizeof(m_tx) / sizeof(m_tx[0]); i++) {
+        if (dbm >= m_tx[i].dbm)
+            return m_tx[i].ua + (m_tx[i - 1].ua - m_tx[i].ua) *
+                   (dbm - m_tx[i].dbm) / (m_tx[i - 1].dbm - m_tx[i].dbm);
+    }
+    return m_tx[i - 1].ua;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  From the SoftDevice and the registers.                                   */
+/*---------------------------------------------------------------------------*/
+void energy_init(void)
+{
+    memset(&g_energy, 0, sizeof(g_energy));
+    on(ENERGY_SLEEP, I_ON);
+}
+
+/* The crystal runs for the whole event, start up included. */
+void energy_radio(energy_item_t item, uint32_t event_us, uint32_t tx_us, uint32_t rx_us,
+                  int8_t tx_power)
+{
+    event(item, event_us, (tx_ua(tx_power) * tx_us + I_RX * rx_us + I_X16M * event_us +
+                           I_CPU * SD_EVENT_US) / 1e6);
+}
+
+void energy_crystal(bool running)
+{
+    m_crystal = running;
+    on(ENERGY_CRYSTAL, running ? I_X16M : 0);
+
+    /* The timers' clock changes under them. */
+    if (g_energy.tally[ENERGY_TIMER1].ua > 0)
+        on(ENERGY_TIMER1, I_TIMER + (m_crystal ? 0 : I_RC16M));
+    if (g_energy.tally[ENERGY_TIMER2].ua > 0)
+        on(ENERGY_TIMER2, I_TIMER + (m_crystal ? 0 : I_RC16M));
+}
+
+void energy_timer(uint32_t n, bool running)
+{
+    on((n == 1) ? ENERGY_TIMER1 : ENERGY_TIMER2,
+       running ? I_TIMER + (m_crystal ? 0 : I_RC16M) : 0);
+}
+
+void energy_flash(uint32_t us)
+{
+    event(ENERGY_FLASH, us, I_FLASH * us / 1e6);
+}
+
+/* 20, 36 or 68 us for 8, 9 or 10 bits. */
+void energy_adc(uint32_t bits)
+{
+    uint32_t us = (bits == 8) ? 20 : (bits == 9) ? 36 : 68;
+
+    event(ENERGY_ADC, us, I_ADC * us / 1e6);
+}
+
+void energy_temp(void)
+{
+    event(ENERGY_TEMP, 36, I_TEMP * 36 / 1e6);
+}
+
+/* The piezo sits across the two buzzer legs: each swing charges it. */
+void energy_pins(uint32_t levels)
+{
+    on(ENERGY_LED, (levels & (1UL << TRACKR_LED)) ? I_LED : 0);
+
+#ifdef BUZZER_SUPPORT
+    int piezo = (int) ((levels >> TRACKR_BUZZER_R) & 1) - (int) ((levels >> TRACKR_BUZZER_L) & 1);
+
+    if (piezo != m_piezo) {
+        double swing = (piezo > m_piezo) ? piezo - m_piezo : m_piezo - piezo;
+        event(ENERGY_PIEZO, 0, PIEZO_NF * 1e-3 * swing * g_regs_vbat_mv / 1000);
+        m_piezo = piezo;
+    }
+#endif
+}
+
+/* System OFF: nothing but the wake up logic. */
+void energy_off(void)
+{
+    unsigned i;
+
+    accrue();
+    for (i = 0; i < ENERGY_COUNT; i++)
+        g_energy.tally[i].ua = 0;
+    on(ENERGY_OFF, I_OFF);
+}
+
+/* A reset stops the peripherals; the chip comes up asleep. */
+void energy_reset(void)
+{
+    unsigned i;
+
+    accrue();
+    for (i = 0; i < ENERGY_COUNT; i++)
+        g_energy.tally[i].ua = 0;
+    on(ENERGY_SLEEP, I_ON);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The report, after the run.                                               */
+/*---------------------------------------------------------------------------*/
+static double m_seconds;
+
+static void row(const char * name, uint64_t count, double seconds, double uc)
+{
+    fprintf(stdout, "  %-12s %10llu %12.3f s %12.3f mC %10.3f uA\n", name,
+            (unsigned long long) count, seconds, uc / 1000, uc / m_seconds);
+}
+
+void energy_report(void)
+{
+    double   total = 0;
+    double   ua;
+    double   days;
+    unsigned i;
+
+    accrue();
+    m_seconds = (double) g_sim_now / 1e9;
+    if (m_seconds == 0)
+        return;
+
+    fprintf(stdout, "\n  %-12s %10s %14s %15s %13s\n", "energy", "count", "time", "charge",
+            "average");
+
+    for (i = 0; i < ENERGY_COUNT; i++) {
+        energy_tally_t * p = &g_energy.tally[i];
+        if (p->count == 0)
+            continue;
+        row(m_names[i], p->count, (double) p->time / 1e9, p->charge);
+        total += p->charge;
+    }
+
+    /* The calls whose instructions were not counted took the average. */
+    for (i = 0; i < SIM_CTX_COUNT; i++) {
+        sim_ctx_stats_t * p = &g_sim_ctx[i];
+        char              name [16];
+        double            cycles;
+
+        if (p->calls == 0)
+            continue;
+        cycles  = p->counted ? (double) p->instructions / p->counted * CPU_CYCLES : 0;
+        cycles  = (cycles + CPU_CALL_CYCLES) * p->calls;
+        snprintf(name, sizeof(name), "cpu %s", g_sim_ctx_names[i]);
+        row(name, p->calls, cycles / CPU_HZ, cycles / CPU_HZ * I_CPU);
+        total += cycles / CPU_HZ * I_CPU;
+    }
+
+    ua   = total / m_seconds;
+    days = CR2032_MAH * 3600 / ua / 86400 * 1000;
+
+    fprintf(stdout, "  %-12s %10s %14s %12.3f mC %10.3f uA\n", "total", "", "", total / 1000, ua);
+    fprintf(stdout, "\n  CR2032, %.0f mAh: %.0f days (%.1f years); a year takes %.0f mAh\n",
+            CR2032_MAH, days, days / 365, ua * 24 * 365 / 1000);
+    fflush(stdout);
+}
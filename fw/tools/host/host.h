@@ -0,0 +1,235 @@
+/*---------------------------------------------------------------------------*/
+/*  host.h   the host build: simulated time, registers and SoftDevice       */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The firmware runs unchanged on one thread.  Everything else happens in
+ *  simulated time: a list of things due, which sd_app_evt_wait() works
+ *  through until one of them has called into the firmware.  Handlers take
+ *  no simulated time; -c counts the instructions they take instead.
+ */
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/*  Time, in nanoseconds from power on.                                      */
+/*---------------------------------------------------------------------------*/
+typedef uint64_t  sim_time_t;
+
+#define SIM_NEVER           UINT64_MAX
+#define SIM_US(us)          ((sim_time_t) (us) * 1000)
+#define SIM_MS(ms)          ((sim_time_t) (ms) * 1000000)
+
+/* RTC1 ticks, 32768 a second, from the power on. */
+uint64_t   sim_ticks(sim_time_t t);
+sim_time_t sim_ticks_time(uint64_t ticks);
+
+extern sim_time_t  g_sim_now;
+
+/* Moves the clock, RTC1->COUNTER with it. */
+void sim_time_set(sim_time_t t);
+
+typedef void (* sim_handler_t)(uintptr_t arg);
+
+/* One shot; at equal times in the order they were asked for. */
+void sim_at(sim_time_t when, sim_handler_t handler, uintptr_t arg);
+void sim_cancel(sim_handler_t handler, uintptr_t arg);
+
+/* Runs the first thing due, if any is due by limit. */
+bool sim_step(sim_time_t limit);
+sim_time_t sim_next(void);
+
+/* Time passing with the CPU busy: nrf_delay_us(). */
+void sim_busy(sim_time_t duration);
+
+uint32_t sim_rand(void);
+extern uint32_t  g_sim_seed;            // -s
+
+/*---------------------------------------------------------------------------*/
+/*  Calls into the firmware, per interrupt (and the main loop).              */
+/*---------------------------------------------------------------------------*/
+typedef enum {
+    SIM_CTX_BOOT,           // main() up to the main loop
+    SIM_CTX_MAIN,
+    SIM_CTX_RADIO,          // radio notification, SWI1
+    SIM_CTX_BLE,            // SoftDevice events, SWI2
+    SIM_CTX_SOC,
+    SIM_CTX_TIMER,          // app_timer, RTC1
+    SIM_CTX_GPIOTE,
+    SIM_CTX_COUNT
+} sim_ctx_t;
+
+typedef struct {
+    uint32_t  calls;
+    uint32_t  counted;      // calls whose instructions were counted
+    uint64_t  instructions;
+    uint64_t  max;          // instructions, most in one call
+} sim_ctx_stats_t;
+
+extern sim_ctx_stats_t  g_sim_ctx [SIM_CTX_COUNT];
+extern const char *     g_sim_ctx_names [SIM_CTX_COUNT];
+
+void sim_irq_enter(sim_ctx_t ctx);
+void sim_irq_exit(void);
+
+/* -c: count the firmware's instructions per context. */
+extern bool  g_sim_count;
+
+/* Count them in the first call of each context and one in this many
+   after it (1 with -c, 0 for none). */
+extern uint32_t  g_sim_sample;
+
+/* Set when an interrupt has run: sd_app_evt_wait() can return. */
+extern bool  g_sim_woken;
+
+/* Asleep: the next thing due, or the next line of the script. */
+void sim_wait(void);
+
+/*---------------------------------------------------------------------------*/
+/*  Trace: one line per thing that happened, stamped with the time.          */
+/*---------------------------------------------------------------------------*/
+void trace(const char * fmt, ...) __attribute__ ((format (printf, 1, 2)));
+
+/* Worth formatting: printed, or an expect is waiting for it. */
+bool trace_wanted(void);
+
+/*---------------------------------------------------------------------------*/
+/*  Registers (regs.c)                                                       */
+/*---------------------------------------------------------------------------*/
+#define FLASH_START         0x10000         // below is nothing we use
+#define FLASH_END           0x40000         // 256 pages of 1K
+#define FLASH_PAGE_SIZE     1024
+
+void regs_init(void);
+
+/* Where host code reads and writes the registers: the firmware's are trapped. */
+void * regs_host(volatile void * p_reg);
+
+/* A write from the SoftDevice (PPI): as if the firmware had written it. */
+void regs_write(volatile uint32_t * p_reg, uint32_t value);
+
+/* Inputs: the button, from the script; 0 or 1, or -1 to let it float. */
+void regs_pin_drive(uint32_t pin, int level);
+uint32_t regs_pins_in(void);
+
+extern uint16_t  g_regs_vbat_mv;
+
+/* POWER->RESETREAS at the boot. */
+void regs_reset_reason(uint32_t reason);
+
+/* Counts the firmware's instructions while set; see sim_irq_enter(). */
+void regs_count(bool on);
+uint64_t regs_instructions(void);
+extern bool  g_regs_counting;
+
+/*---------------------------------------------------------------------------*/
+/*  SoftDevice (softdevice.c)                                                */
+/*---------------------------------------------------------------------------*/
+void sd_host_init(void);
+
+/* From the script. */
+bool sd_host_connect(uint32_t interval_ms);
+bool sd_host_disconnect(void);
+bool sd_host_write(uint16_t uuid, bool cccd, const uint8_t * p_data, uint16_t len);
+bool sd_host_read(uint16_t uuid);
+void sd_host_radio(bool active);
+
+extern int32_t  g_sd_temp;                  // 0.25 C steps
+
+/* FIPS-197 AES-128 (aes.c), checked by sd_host_init(). */
+void aes128_encrypt(const uint8_t key [16], const uint8_t in [16], uint8_t out [16]);
+
+/*---------------------------------------------------------------------------*/
+/*  SDK modules (sdk.c)                                                      */
+/*---------------------------------------------------------------------------*/
+/* Into the firmware, each as the interrupt it comes in on. */
+void sdk_ble_evt(void * p_ble_evt);
+void sdk_sys_evt(uint32_t evt_id);
+void sdk_pins_changed(uint32_t low_to_high, uint32_t high_to_low);
+void sdk_radio_notification(bool active);
+
+/*---------------------------------------------------------------------------*/
+/*  Energy (energy.c): the charge taken, per thing that takes it.            */
+/*---------------------------------------------------------------------------*/
+typedef enum {
+    ENERGY_SLEEP,
+    ENERGY_OFF,
+    ENERGY_ADV,             // per advertising event
+    ENERGY_CONN,            // per connection event
+    ENERGY_CRYSTAL,         // the 16 MHz crystal, while requested
+    ENERGY_TIMER1,
+    ENERGY_TIMER2,
+    ENERGY_LED,             // while the pin is high
+    ENERGY_PIEZO,           // per swing of the buzzer legs
+    ENERGY_FLASH,
+    ENERGY_ADC,
+    ENERGY_TEMP,
+    ENERGY_COUNT
+} energy_item_t;
+
+typedef struct {
+    uint64_t    count;
+    sim_time_t  time;
+    double      charge;     // uC
+    double      ua;         // drawing now, if on
+} energy_tally_t;
+
+/* Kept across a reset, with the time. */
+typedef struct {
+    energy_tally_t  tally [ENERGY_COUNT];
+    sim_time_t      last;   // accrued up to
+} energy_t;
+
+extern energy_t  g_energy;
+
+void energy_init(void);
+void energy_reset(void);
+void energy_off(void);
+void energy_radio(energy_item_t item, uint32_t event_us, uint32_t tx_us, uint32_t rx_us,
+                  int8_t tx_power);
+void energy_crystal(bool running);
+void energy_timer(uint32_t n, bool running);
+void energy_flash(uint32_t us);
+void energy_adc(uint32_t bits);
+void energy_temp(void);
+void energy_pins(uint32_t levels);
+
+/* -e: the table, and the CR2032's life at the average. */
+void energy_report(void);
+
+/*---------------------------------------------------------------------------*/
+/*  Waveforms (wave.c): the pins' changes, kept and with -w written as VCD.  */
+/*---------------------------------------------------------------------------*/
+typedef enum {
+    WAVE_HZ,                // of each full period, rising edge to rising edge
+    WAVE_DUTY,              // high, in % of each full period
+    WAVE_GAP,               // the longest between two edges, in ms
+    WAVE_EDGES,
+} wave_measure_t;
+
+/* From now, with the clock set; appending to the VCD file after a reset. */
+void wave_start(const char * vcd_name, bool resumed);
+void wave_pins(uint32_t levels);
+void wave_flush(void);
+
+/* Over the window before now: how many values, or -1 if it is not all kept. */
+int wave_measure(uint32_t pin, sim_time_t window, wave_measure_t measure,
+                 double * p_lo, double * p_hi);
+
+/*---------------------------------------------------------------------------*/
+/*  Driver (driver.c)                                                        */
+/*---------------------------------------------------------------------------*/
+
+/* Ends the run with a reset: the process starts again from main(). */
+void sim_reset(uint32_t reason) __attribute__ ((noreturn));
+
+/* System OFF: the script runs on until the button wakes it. */
+void sim_system_off(void) __attribute__ ((noreturn));
+
+/* The firmware's main(), renamed. */
+int firmware_main(void);
+
+#endif /* __HOST_H__ */
@@ -0,0 +1,25 @@
+/*---------------------------------------------------------------------------*/
+/*  app_error.h   host stand-in for the SDK's                                */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef APP_ERROR_H__
+#define APP_ERROR_H__
+#include <stdint.h>
+#include <stdio.h>
+#include "nrf_error.h"
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name);
+
+#define APP_ERROR_HANDLER(ERR_CODE) \
+    do { app_error_handler((ERR_CODE), __LINE__, (uint8_t*) __FILE__); } while (0)
+
+#define APP_ERROR_CHECK(ERR_CODE) \
+    do { const uint32_t LOCAL_ERR_CODE = (ERR_CODE); \
+         if (LOCAL_ERR_CODE != NRF_SUCCESS) { APP_ERROR_HANDLER(LOCAL_ERR_CODE); } \
+    } while (0)
+
+#define APP_ERROR_CHECK_BOOL(BOOLEAN_VALUE) \
+    do { const uint32_t LOCAL_BOOLEAN_VALUE = (BOOLEAN_VALUE); \
+         if (!LOCAL_BOOLEAN_VALUE) { app_error_handler(0, __LINE__, (uint8_t*) __FILE__); } \
+    } while (0)
+#endif
@@ -0,0 +1,33 @@
+/*---------------------------------------------------------------------------*/
+/*  app_gpiote.h   host stand-in for the SDK's                               */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef APP_GPIOTE_H__
+#define APP_GPIOTE_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf.h"
+#include "app_error.h"
+#include "app_util.h"
+
+#define GPIOTE_USER_NODE_SIZE 20
+#define NO_OF_PINS            32
+
+typedef uint8_t app_gpiote_user_id_t;
+typedef void (*app_gpiote_event_handler_t)(uint32_t event_pins_low_to_high, uint32_t event_pins_high_to_low);
+
+#define APP_GPIOTE_BUF_SIZE(MAX_USERS)  ((MAX_USERS) * GPIOTE_USER_NODE_SIZE)
+
+#define APP_GPIOTE_INIT(MAX_USERS) \
+    do { static uint32_t app_gpiote_buf[CEIL_DIV(APP_GPIOTE_BUF_SIZE(MAX_USERS), sizeof(uint32_t))]; \
+         uint32_t ERR_CODE = app_gpiote_init((MAX_USERS), app_gpiote_buf); \
+         APP_ERROR_CHECK(ERR_CODE); \
+    } while (0)
+
+uint32_t app_gpiote_init(uint8_t max_users, void * p_buffer);
+uint32_t app_gpiote_user_register(app_gpiote_user_id_t * p_user_id, uint32_t pins_low_to_high_mask,
+                                  uint32_t pins_high_to_low_mask, app_gpiote_event_handler_t event_handler);
+uint32_t app_gpiote_user_enable(app_gpiote_user_id_t user_id);
+uint32_t app_gpiote_user_disable(app_gpiote_user_id_t user_id);
+uint32_t app_gpiote_pins_state_get(app_gpiote_user_id_t user_id, uint32_t * p_pins);
+#endif
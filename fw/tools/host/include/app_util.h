@@ -0,0 +1,66 @@
+/*---------------------------------------------------------------------------*/
+/*  app_util.h   host stand-in for the SDK's                                 */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef APP_UTIL_H__
+#define APP_UTIL_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "compiler_abstraction.h"
+#include "nordic_common.h"
+
+typedef struct {
+  uint16_t  size;
+  uint8_t * p_data;
+} uint8_array_t;
+
+enum {
+  UNIT_0_625_MS = 625,
+  UNIT_1_25_MS  = 1250,
+  UNIT_10_MS    = 10000
+};
+
+#define STATIC_ASSERT(EXPR) typedef char static_assert_type_##__LINE__[(EXPR) ? 1 : -1] __attribute__((unused))
+#define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
+#define ROUNDED_DIV(A, B) (((A) + ((B) / 2)) / (B))
+#define IS_POWER_OF_TWO(A) ( ((A) != 0) && ((((A) - 1) & (A)) == 0) )
+#define CEIL_DIV(A, B) (((A) - 1) / (B) + 1)
+#define ALIGN_NUM(alignment, number) ((number - 1) + alignment - ((number - 1) % alignment))
+
+typedef uint8_t uint16_le_t[2];
+typedef uint8_t uint32_le_t[4];
+
+static __INLINE uint8_t uint16_encode(uint16_t value, uint8_t * p_encoded_data)
+{
+    p_encoded_data[0] = (uint8_t) ((value & 0x00FF) >> 0);
+    p_encoded_data[1] = (uint8_t) ((value & 0xFF00) >> 8);
+    return sizeof(uint16_t);
+}
+
+static __INLINE uint8_t uint32_encode(uint32_t value, uint8_t * p_encoded_data)
+{
+    p_encoded_data[0] = (uint8_t) ((value & 0x000000FF) >> 0);
+    p_encoded_data[1] = (uint8_t) ((value & 0x0000FF00) >> 8);
+    p_encoded_data[2] = (uint8_t) ((value & 0x00FF0000) >> 16);
+    p_encoded_data[3] = (uint8_t) ((value & 0xFF000000) >> 24);
+    return sizeof(uint32_t);
+}
+
+static __INLINE uint16_t uint16_decode(const uint8_t * p_encoded_data)
+{
+    return ( (((uint16_t)((uint8_t *)p_encoded_data)[0])) |
+             (((uint16_t)((uint8_t *)p_encoded_data)[1]) << 8 ));
+}
+
+static __INLINE uint32_t uint32_decode(const uint8_t * p_encoded_data)
+{
+    return ( (((uint32_t)((uint8_t *)p_encoded_data)[0]) << 0)  |
+             (((uint32_t)((uint8_t *)p_encoded_data)[1]) << 8)  |
+             (((uint32_t)((uint8_t *)p_encoded_data)[2]) << 16) |
+             (((uint32_t)((uint8_t *)p_encoded_data)[3]) << 24 ));
+}
+
+#define CRITICAL_REGION_ENTER()  do { uint8_t __CR_NESTED = 0; sd_nvic_critical_region_enter(&__CR_NESTED);
+#define CRITICAL_REGION_EXIT()   sd_nvic_critical_region_exit(__CR_NESTED); } while (0)
+
+#endif
@@ -0,0 +1,69 @@
+/*---------------------------------------------------------------------------*/
+/*  ble.h   host stand-in for the SDK's                                      */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef BLE_H__
+#define BLE_H__
+#include <stdint.h>
+#include "ble_types.h"
+#include "ble_gap.h"
+#include "ble_gatts.h"
+#include "nrf_error.h"
+
+#define BLE_EVT_BASE 0x01
+enum BLE_COMMON_EVTS {
+  BLE_EVT_TX_COMPLETE = BLE_EVT_BASE,
+  BLE_EVT_USER_MEM_REQUEST,
+  BLE_EVT_USER_MEM_RELEASE
+};
+
+#define BLE_EVTS_PTR_ALIGNMENT 4
+
+#define BLE_ERROR_INVALID_CONN_HANDLE (NRF_ERROR_STK_BASE_NUM+0x002)
+#define BLE_ERROR_INVALID_ATTR_HANDLE (NRF_ERROR_STK_BASE_NUM+0x003)
+#define BLE_ERROR_NO_TX_BUFFERS       (NRF_ERROR_STK_BASE_NUM+0x004)
+typedef struct {
+  uint8_t count;
+} ble_evt_tx_complete_t;
+
+typedef struct {
+  uint16_t conn_handle;
+  union {
+    ble_evt_tx_complete_t tx_complete;
+  } params;
+} ble_common_evt_t;
+
+typedef struct {
+  uint16_t evt_id;
+  uint16_t evt_len;
+} ble_evt_hdr_t;
+
+typedef struct {
+  ble_evt_hdr_t header;
+  union {
+    ble_common_evt_t  common_evt;
+    ble_gap_evt_t     gap_evt;
+    ble_gatts_evt_t   gatts_evt;
+  } evt;
+} ble_evt_t;
+
+typedef struct {
+  uint8_t service_changed : 1;
+} ble_gatts_enable_params_t;
+
+typedef struct {
+  ble_gatts_enable_params_t gatts_enable_params;
+} ble_enable_params_t;
+
+typedef union {
+  ble_gap_opt_t gap;
+} ble_opt_t;
+
+uint32_t sd_ble_enable(ble_enable_params_t * p_ble_enable_params);
+uint32_t sd_ble_evt_get(uint8_t * p_dest, uint16_t * p_len);
+uint32_t sd_ble_tx_buffer_count_get(uint8_t * p_count);
+uint32_t sd_ble_uuid_encode(ble_uuid_t const * const p_uuid, uint8_t * const p_uuid_le_len, uint8_t * const p_uuid_le);
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * const p_vs_uuid, uint8_t * const p_uuid_type);
+uint32_t sd_ble_opt_set(uint32_t opt_id, ble_opt_t const * p_opt);
+uint32_t sd_ble_opt_get(uint32_t opt_id, ble_opt_t * p_opt);
+#endif
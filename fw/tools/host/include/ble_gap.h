@@ -0,0 +1,281 @@
+/*---------------------------------------------------------------------------*/
+/*  ble_gap.h   host stand-in for the SDK's                                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef BLE_GAP_H__
+#define BLE_GAP_H__
+#include <stdint.h>
+#include "ble_types.h"
+#include "nrf_error.h"
+
+#define BLE_GAP_EVT_BASE  0x10
+enum BLE_GAP_EVTS {
+  BLE_GAP_EVT_CONNECTED = BLE_GAP_EVT_BASE,
+  BLE_GAP_EVT_DISCONNECTED,
+  BLE_GAP_EVT_CONN_PARAM_UPDATE,
+  BLE_GAP_EVT_SEC_PARAMS_REQUEST,
+  BLE_GAP_EVT_SEC_INFO_REQUEST,
+  BLE_GAP_EVT_PASSKEY_DISPLAY,
+  BLE_GAP_EVT_AUTH_KEY_REQUEST,
+  BLE_GAP_EVT_AUTH_STATUS,
+  BLE_GAP_EVT_CONN_SEC_UPDATE,
+  BLE_GAP_EVT_TIMEOUT,
+  BLE_GAP_EVT_RSSI_CHANGED,
+  BLE_GAP_EVT_ADV_REPORT,
+  BLE_GAP_EVT_SEC_REQUEST,
+  BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST,
+  BLE_GAP_EVT_SCAN_REQ_REPORT,
+};
+
+#define BLE_GAP_OPT_BASE 0x20
+enum BLE_GAP_OPTS {
+  BLE_GAP_OPT_LOCAL_CONN_LATENCY = BLE_GAP_OPT_BASE,
+  BLE_GAP_OPT_PASSKEY,
+  BLE_GAP_OPT_PRIVACY,
+  BLE_GAP_OPT_SCAN_REQ_REPORT,
+  BLE_GAP_OPT_COMPAT_MODE
+};
+
+#define NRF_GAP_ERR_BASE                (NRF_ERROR_STK_BASE_NUM + 0x200)
+#define BLE_ERROR_GAP_INVALID_BLE_ADDR  (NRF_GAP_ERR_BASE + 0x002)
+
+#define BLE_GAP_ADV_INTERVAL_MIN        0x0020
+#define BLE_GAP_ADV_INTERVAL_MAX        0x4000
+#define BLE_GAP_ADV_NONCON_INTERVAL_MIN 0x00A0
+
+#define BLE_GAP_ADDR_TYPE_PUBLIC                        0x00
+#define BLE_GAP_ADDR_TYPE_RANDOM_STATIC                 0x01
+#define BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_RESOLVABLE     0x02
+#define BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_NON_RESOLVABLE 0x03
+
+#define BLE_GAP_ADDR_CYCLE_MODE_NONE 0x00
+#define BLE_GAP_ADDR_CYCLE_MODE_AUTO 0x01
+#define BLE_GAP_DEFAULT_PRIVATE_ADDR_CYCLE_INTERVAL_S (60 * 15)
+#define BLE_GAP_MAX_PRIVATE_ADDR_CYCLE_INTERVAL_S (0x1FFF)
+
+#define BLE_GAP_ADDR_LEN 6
+#define BLE_GAP_ADV_MAX_SIZE 31
+
+#define BLE_GAP_AD_TYPE_FLAGS                               0x01
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE         0x03
+#define BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE        0x07
+#define BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME                    0x08
+#define BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME                 0x09
+
+#define BLE_GAP_ADV_TYPE_ADV_IND          0x00
+#define BLE_GAP_ADV_TYPE_ADV_DIRECT_IND   0x01
+#define BLE_GAP_ADV_TYPE_ADV_SCAN_IND     0x02
+#define BLE_GAP_ADV_TYPE_ADV_NONCONN_IND  0x03
+
+#define BLE_GAP_ADV_FLAG_LE_LIMITED_DISC_MODE         (0x01)
+#define BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE         (0x02)
+#define BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED         (0x04)
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_LIMITED_DISC_MODE   (BLE_GAP_ADV_FLAG_LE_LIMITED_DISC_MODE | BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED)
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE   (BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE | BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED)
+
+#define BLE_GAP_ADV_TIMEOUT_LIMITED_MAX  180
+#define BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED 0
+
+#define BLE_GAP_TIMEOUT_SRC_ADVERTISEMENT 0x00
+#define BLE_GAP_TIMEOUT_SRC_SECURITY_REQUEST 0x01
+#define BLE_GAP_TIMEOUT_SRC_SCAN 0x02
+#define BLE_GAP_TIMEOUT_SRC_CONN 0x03
+
+#define BLE_GAP_IO_CAPS_DISPLAY_ONLY      0x00
+#define BLE_GAP_IO_CAPS_DISPLAY_YESNO     0x01
+#define BLE_GAP_IO_CAPS_KEYBOARD_ONLY     0x02
+#define BLE_GAP_IO_CAPS_NONE              0x03
+#define BLE_GAP_IO_CAPS_KEYBOARD_DISPLAY  0x04
+
+#define BLE_GAP_SEC_KEY_LEN 16
+
+typedef struct {
+  uint8_t addr_type;
+  uint8_t addr[BLE_GAP_ADDR_LEN];
+} ble_gap_addr_t;
+
+typedef struct {
+  uint16_t min_conn_interval;
+  uint16_t max_conn_interval;
+  uint16_t slave_latency;
+  uint16_t conn_sup_timeout;
+} ble_gap_conn_params_t;
+
+typedef struct {
+  uint8_t sm : 4;
+  uint8_t lv : 4;
+} ble_gap_conn_sec_mode_t;
+
+typedef struct {
+  ble_gap_conn_sec_mode_t sec_mode;
+  uint8_t                 encr_key_size;
+} ble_gap_conn_sec_t;
+
+typedef struct {
+  uint8_t irk[BLE_GAP_SEC_KEY_LEN];
+} ble_gap_irk_t;
+
+typedef struct {
+  uint8_t          addr_count;
+  ble_gap_addr_t **pp_addrs;
+  uint8_t          irk_count;
+  ble_gap_irk_t  **pp_irks;
+} ble_gap_whitelist_t;
+
+typedef struct {
+  uint8_t               type;
+  ble_gap_addr_t      * p_peer_addr;
+  uint8_t               fp;
+  ble_gap_whitelist_t * p_whitelist;
+  uint16_t              interval;
+  uint16_t              timeout;
+  struct {
+    uint8_t ch_37_off : 1;
+    uint8_t ch_38_off : 1;
+    uint8_t ch_39_off : 1;
+  } channel_mask;
+} ble_gap_adv_params_t;
+
+typedef struct {
+  uint8_t enc  : 1;
+  uint8_t id   : 1;
+  uint8_t sign : 1;
+} ble_gap_sec_kdist_t;
+
+typedef struct {
+  uint8_t  bond    : 1;
+  uint8_t  mitm    : 1;
+  uint8_t  io_caps : 3;
+  uint8_t  oob     : 1;
+  uint8_t  min_key_size;
+  uint8_t  max_key_size;
+  ble_gap_sec_kdist_t kdist_periph;
+  ble_gap_sec_kdist_t kdist_central;
+} ble_gap_sec_params_t;
+
+typedef struct {
+  ble_gap_irk_t  id_info;
+  ble_gap_addr_t id_addr_info;
+} ble_gap_id_key_t;
+
+typedef struct {
+  uint8_t  ltk[BLE_GAP_SEC_KEY_LEN];
+  uint8_t  auth : 1;
+  uint8_t  ltk_len : 7;
+} ble_gap_enc_info_t;
+
+typedef struct {
+  uint16_t ediv;
+  uint8_t  rand[8];
+} ble_gap_master_id_t;
+
+typedef struct {
+  ble_gap_enc_info_t  enc_info;
+  ble_gap_master_id_t master_id;
+} ble_gap_enc_key_t;
+
+typedef struct {
+  uint8_t csrk[BLE_GAP_SEC_KEY_LEN];
+} ble_gap_sign_info_t;
+
+typedef struct {
+  ble_gap_enc_key_t   * p_enc_key;
+  ble_gap_id_key_t    * p_id_key;
+  ble_gap_sign_info_t * p_sign_key;
+} ble_gap_sec_keys_t;
+
+typedef struct {
+  ble_gap_sec_keys_t keys_periph;
+  ble_gap_sec_keys_t keys_central;
+} ble_gap_sec_keyset_t;
+
+typedef struct {
+  ble_gap_addr_t        peer_addr;
+  uint8_t               irk_match :1;
+  uint8_t               irk_match_idx  :7;
+  ble_gap_conn_params_t conn_params;
+} ble_gap_evt_connected_t;
+
+typedef struct {
+  uint8_t reason;
+} ble_gap_evt_disconnected_t;
+
+typedef struct {
+  ble_gap_conn_params_t conn_params;
+} ble_gap_evt_conn_param_update_t;
+
+typedef struct {
+  uint8_t src;
+} ble_gap_evt_timeout_t;
+
+typedef struct {
+  ble_gap_sec_params_t peer_params;
+} ble_gap_evt_sec_params_request_t;
+
+typedef struct {
+  ble_gap_addr_t peer_addr;
+  uint16_t       div;
+  uint8_t        enc_info  : 1;
+  uint8_t        id_info   : 1;
+  uint8_t        sign_info : 1;
+} ble_gap_evt_sec_info_request_t;
+
+typedef struct {
+  uint8_t auth_status;
+  uint8_t error_src : 2;
+  uint8_t bonded : 1;
+  ble_gap_sec_kdist_t kdist_periph;
+  ble_gap_sec_kdist_t kdist_central;
+} ble_gap_evt_auth_status_t;
+
+typedef struct {
+  ble_gap_conn_sec_t conn_sec;
+} ble_gap_evt_conn_sec_update_t;
+
+typedef struct {
+  uint16_t conn_handle;
+  union {
+    ble_gap_evt_connected_t           connected;
+    ble_gap_evt_disconnected_t        disconnected;
+    ble_gap_evt_conn_param_update_t   conn_param_update;
+    ble_gap_evt_sec_params_request_t  sec_params_request;
+    ble_gap_evt_sec_info_request_t    sec_info_request;
+    ble_gap_evt_auth_status_t         auth_status;
+    ble_gap_evt_conn_sec_update_t     conn_sec_update;
+    ble_gap_evt_timeout_t             timeout;
+  } params;
+} ble_gap_evt_t;
+
+typedef struct {
+  ble_gap_irk_t * p_irk;
+  uint16_t        interval_s;
+} ble_gap_opt_privacy_t;
+
+typedef struct {
+  uint8_t const * p_passkey;
+} ble_gap_opt_passkey_t;
+
+typedef union {
+  ble_gap_opt_passkey_t  passkey;
+  ble_gap_opt_privacy_t  privacy;
+} ble_gap_opt_t;
+
+#define BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(ptr) do {(ptr)->sm = 0; (ptr)->lv = 0;} while(0)
+#define BLE_GAP_CONN_SEC_MODE_SET_OPEN(ptr)      do {(ptr)->sm = 1; (ptr)->lv = 1;} while(0)
+#define BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(ptr) do {(ptr)->sm = 1; (ptr)->lv = 2;} while(0)
+
+uint32_t sd_ble_gap_address_set(uint8_t addr_cycle_mode, ble_gap_addr_t const * const p_addr);
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t * const p_addr);
+uint32_t sd_ble_gap_adv_data_set(uint8_t const * const p_data, uint8_t dlen, uint8_t const * const p_sr_data, uint8_t srdlen);
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const * const p_adv_params);
+uint32_t sd_ble_gap_adv_stop(void);
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const * const p_conn_params);
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code);
+uint32_t sd_ble_gap_tx_power_set(int8_t tx_power);
+uint32_t sd_ble_gap_appearance_set(uint16_t appearance);
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const * const p_conn_params);
+uint32_t sd_ble_gap_ppcp_get(ble_gap_conn_params_t * const p_conn_params);
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const * const p_write_perm, uint8_t const * const p_dev_name, uint16_t len);
+uint32_t sd_ble_gap_sec_params_reply(uint16_t conn_handle, uint8_t sec_status, ble_gap_sec_params_t const * p_sec_params, ble_gap_sec_keyset_t const * p_sec_keyset);
+uint32_t sd_ble_gap_sec_info_reply(uint16_t conn_handle, ble_gap_enc_info_t const * p_enc_info, ble_gap_irk_t const * p_id_info, ble_gap_sign_info_t const * p_sign_info);
+#endif
@@ -0,0 +1,54 @@
+/*---------------------------------------------------------------------------*/
+/*  ble_gatt.h   host stand-in for the SDK's                                 */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef BLE_GATT_H__
+#define BLE_GATT_H__
+#include <stdint.h>
+#include "ble_types.h"
+
+#define GATT_MTU_SIZE_DEFAULT 23
+#define BLE_GATT_HANDLE_INVALID 0x0000
+#define BLE_GATT_HANDLE_START   0x0001
+#define BLE_GATT_HANDLE_END     0xFFFF
+
+#define BLE_GATT_HVX_INVALID      0x00
+#define BLE_GATT_HVX_NOTIFICATION 0x01
+#define BLE_GATT_HVX_INDICATION   0x02
+
+#define BLE_GATT_OP_INVALID         0x00
+#define BLE_GATT_OP_WRITE_REQ       0x01
+#define BLE_GATT_OP_WRITE_CMD       0x02
+#define BLE_GATT_OP_SIGN_WRITE_CMD  0x03
+#define BLE_GATT_OP_PREP_WRITE_REQ  0x04
+#define BLE_GATT_OP_EXEC_WRITE_REQ  0x05
+
+#define BLE_GATT_STATUS_SUCCESS                   0x0000
+#define BLE_GATT_STATUS_ATTERR_READ_NOT_PERMITTED 0x0102
+#define BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED 0x0103
+#define BLE_GATT_STATUS_ATTERR_INVALID_OFFSET     0x0107
+#define BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH 0x010D
+
+#define BLE_GATT_CPF_FORMAT_RFU     0x00
+#define BLE_GATT_CPF_FORMAT_BOOLEAN 0x01
+#define BLE_GATT_CPF_FORMAT_UINT8   0x04
+#define BLE_GATT_CPF_FORMAT_UINT16  0x06
+#define BLE_GATT_CPF_FORMAT_UINT32  0x08
+#define BLE_GATT_CPF_FORMAT_UTF8S   0x19
+#define BLE_GATT_CPF_FORMAT_STRUCT  0x1B
+
+typedef struct {
+  uint8_t broadcast       :1;
+  uint8_t read            :1;
+  uint8_t write_wo_resp   :1;
+  uint8_t write           :1;
+  uint8_t notify          :1;
+  uint8_t indicate        :1;
+  uint8_t auth_signed_wr  :1;
+} ble_gatt_char_props_t;
+
+typedef struct {
+  uint8_t reliable_wr     :1;
+  uint8_t wr_aux          :1;
+} ble_gatt_char_ext_props_t;
+#endif
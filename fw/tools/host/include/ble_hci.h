@@ -0,0 +1,11 @@
+/*---------------------------------------------------------------------------*/
+/*  ble_hci.h   host stand-in for the SDK's                                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef BLE_HCI_H__
+#define BLE_HCI_H__
+#define BLE_HCI_STATUS_CODE_SUCCESS                        0x00
+#define BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION          0x13
+#define BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION           0x16
+#define BLE_HCI_CONN_INTERVAL_UNACCEPTABLE                 0x3B
+#endif
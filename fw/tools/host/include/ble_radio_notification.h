@@ -0,0 +1,16 @@
+/*---------------------------------------------------------------------------*/
+/*  ble_radio_notification.h   host stand-in for the SDK's                   */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef BLE_RADIO_NOTIFICATION_H__
+#define BLE_RADIO_NOTIFICATION_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_soc.h"
+
+typedef void (*ble_radio_notification_evt_handler_t) (bool radio_active);
+
+uint32_t ble_radio_notification_init(nrf_app_irq_priority_t irq_priority,
+                                     nrf_radio_notification_distance_t distance,
+                                     ble_radio_notification_evt_handler_t evt_handler);
+#endif
@@ -0,0 +1,44 @@
+/*---------------------------------------------------------------------------*/
+/*  ble_srv_common.h   host stand-in for the SDK's                           */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef BLE_SRV_COMMON_H__
+#define BLE_SRV_COMMON_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_types.h"
+#include "app_util.h"
+#include "ble.h"
+#include "ble_gap.h"
+#include "ble_gatt.h"
+
+#define BLE_UUID_BATTERY_SERVICE                0x180F
+#define BLE_UUID_DEVICE_INFORMATION_SERVICE     0x180A
+
+#define BLE_CCCD_VALUE_LEN 2
+
+typedef void (*ble_srv_error_handler_t) (uint32_t nrf_error);
+
+typedef struct {
+  ble_gap_conn_sec_mode_t read_perm;
+  ble_gap_conn_sec_mode_t write_perm;
+} ble_srv_security_mode_t;
+
+typedef struct {
+  ble_gap_conn_sec_mode_t cccd_write_perm;
+  ble_gap_conn_sec_mode_t read_perm;
+  ble_gap_conn_sec_mode_t write_perm;
+} ble_srv_cccd_security_mode_t;
+
+static __INLINE bool ble_srv_is_notification_enabled(uint8_t * p_encoded_data)
+{
+    uint16_t cccd_value = uint16_decode(p_encoded_data);
+    return ((cccd_value & BLE_GATT_HVX_NOTIFICATION) != 0);
+}
+
+static __INLINE bool ble_srv_is_indication_enabled(uint8_t * p_encoded_data)
+{
+    uint16_t cccd_value = uint16_decode(p_encoded_data);
+    return ((cccd_value & BLE_GATT_HVX_INDICATION) != 0);
+}
+#endif
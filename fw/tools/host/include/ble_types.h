@@ -0,0 +1,40 @@
+/*---------------------------------------------------------------------------*/
+/*  ble_types.h   host stand-in for the SDK's                                */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef BLE_TYPES_H__
+#define BLE_TYPES_H__
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLE_CONN_HANDLE_INVALID 0xFFFF
+#define BLE_CONN_HANDLE_ALL     0xFFFE
+
+#define BLE_UUID_UNKNOWN                              0x0000
+#define BLE_UUID_SERVICE_PRIMARY                      0x2800
+#define BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG        0x2902
+#define BLE_UUID_GAP                                  0x1800
+#define BLE_UUID_GATT                                 0x1801
+
+#define BLE_UUID_TYPE_UNKNOWN       0x00
+#define BLE_UUID_TYPE_BLE           0x01
+#define BLE_UUID_TYPE_VENDOR_BEGIN  0x02
+
+#define BLE_UUID_BLE_ASSIGN(instance, value) do { \
+            instance.type = BLE_UUID_TYPE_BLE; \
+            instance.uuid = value;} while(0)
+
+typedef struct {
+  uint8_t uuid128[16];
+} ble_uuid128_t;
+
+typedef struct {
+  uint16_t uuid;
+  uint8_t  type;
+} ble_uuid_t;
+
+typedef struct {
+  uint8_t  * p_data;
+  uint16_t   len;
+} ble_data_t;
+#endif
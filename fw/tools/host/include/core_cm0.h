@@ -0,0 +1,41 @@
+/*---------------------------------------------------------------------------*/
+/*  core_cm0.h   host stand-in for the SDK's                                 */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef CORE_CM0_H
+#define CORE_CM0_H
+
+#include <stdint.h>
+
+typedef struct {
+  volatile uint32_t CPUID;
+  volatile uint32_t ICSR;
+  uint32_t RESERVED0;
+  volatile uint32_t AIRCR;
+  volatile uint32_t SCR;
+  volatile uint32_t CCR;
+} SCB_Type;
+#define SCS_BASE                    0xE000E000UL
+#define SCB_BASE                    (SCS_BASE + 0x0D00UL)
+#define SCB                         ((SCB_Type *) SCB_BASE)
+#define SCB_AIRCR_VECTKEY_Pos       16
+#define SCB_AIRCR_SYSRESETREQ_Msk   (1UL << 2)
+#define __DSB()                     ((void)0)
+
+void     NVIC_SystemReset(void);
+void     NVIC_EnableIRQ(IRQn_Type irqn);
+void     NVIC_DisableIRQ(IRQn_Type irqn);
+void     NVIC_SetPriority(IRQn_Type irqn, uint32_t priority);
+void     NVIC_ClearPendingIRQ(IRQn_Type irqn);
+void     NVIC_SetPendingIRQ(IRQn_Type irqn);
+void     __disable_irq(void);
+void     __enable_irq(void);
+uint32_t __get_MSP(void);
+uint32_t __get_PRIMASK(void);
+void     __set_PRIMASK(uint32_t primask);
+void     __WFE(void);
+void     __SEV(void);
+#define  __BKPT(v)  ((void)0)
+#define  __NOP()    ((void)0)
+
+#endif /* CORE_CM0_H */
@@ -0,0 +1,9 @@
+/*---------------------------------------------------------------------------*/
+/*  crc16.h   host stand-in for the SDK's                                    */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef CRC16_H__
+#define CRC16_H__
+#include <stdint.h>
+uint16_t crc16_compute(const uint8_t * p_data, uint32_t size, const uint16_t * p_crc);
+#endif
@@ -0,0 +1,68 @@
+/*---------------------------------------------------------------------------*/
+/*  device_manager.h   host stand-in for the SDK's                           */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef DEVICE_MANAGER_H__
+#define DEVICE_MANAGER_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_gap.h"
+
+#define DM_INVALID_ID 0xFF
+
+typedef uint8_t dm_application_instance_t;
+
+#define DM_PROTOCOL_CNTXT_NONE         0x00
+#define DM_PROTOCOL_CNTXT_GATT_SRVR_ID 0x01
+
+#define DM_EVT_CONNECTION              0x11
+#define DM_EVT_DISCONNECTION           0x12
+#define DM_EVT_SECURITY_SETUP          0x13
+#define DM_EVT_SECURITY_SETUP_COMPLETE 0x14
+#define DM_EVT_LINK_SECURED            0x15
+#define DM_EVT_SECURITY_SETUP_REFRESH  0x16
+#define DM_EVT_DEVICE_CONTEXT_LOADED   0x21
+#define DM_EVT_DEVICE_CONTEXT_STORED   0x22
+#define DM_EVT_DEVICE_CONTEXT_DELETED  0x23
+
+typedef struct {
+  uint8_t  appl_id;
+  uint8_t  connection_id;
+  uint8_t  device_id;
+  uint8_t  service_id;
+} dm_handle_t;
+
+typedef struct {
+  uint8_t       event_id;
+  dm_handle_t * p_event_handle;
+  void        * p_event_param;
+  uint16_t      event_paramlen;
+} dm_event_t;
+
+typedef uint32_t (*dm_event_cb_t)(dm_handle_t const * p_handle,
+                                  dm_event_t const  * p_event,
+                                  uint32_t            event_result);
+
+typedef struct {
+  bool clear_persistent_data;
+} dm_init_param_t;
+
+typedef struct {
+  dm_event_cb_t        evt_handler;
+  uint8_t              service_type;
+  ble_gap_sec_params_t sec_param;
+} dm_application_param_t;
+
+typedef struct {
+  ble_gap_irk_t  id_info;
+  ble_gap_addr_t id_addr_info;
+} dm_id_key_t;
+
+uint32_t dm_init(dm_init_param_t const * p_init_param);
+uint32_t dm_register(dm_application_instance_t * p_appl_instance, dm_application_param_t const * p_appl_param);
+uint32_t dm_ble_evt_handler(ble_evt_t * p_ble_evt);
+uint32_t dm_security_setup_req(dm_handle_t * p_handle);
+uint32_t dm_handle_initialize(dm_handle_t * p_handle);
+uint32_t dm_device_delete_all(dm_application_instance_t const * p_appl_instance);
+#endif
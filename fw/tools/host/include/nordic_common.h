@@ -0,0 +1,26 @@
+/*---------------------------------------------------------------------------*/
+/*  nordic_common.h   host stand-in for the SDK's                            */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NORDIC_COMMON_H__
+#define NORDIC_COMMON_H__
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#define UNUSED_PARAMETER(X) (void)(X)
+#define UNUSED_VARIABLE(X)  (void)(X)
+#define IS_SET(W, B) (((W) >> (B)) & 1)
+#define BIT_0 0x01
+#define BIT_1 0x02
+#define BIT_2 0x04
+#define BIT_3 0x08
+#define BIT_4 0x10
+#define BIT_5 0x20
+#define BIT_6 0x40
+#define BIT_7 0x80
+#define MSB(a) (((a) & 0xFF00) >> 8)
+#define LSB(a) ((a) & 0x00FF)
+#endif
@@ -0,0 +1,8 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf.h   host stand-in for the SDK's                                      */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NRF_H
+#define NRF_H
+#include "nrf51.h"
+#endif
@@ -0,0 +1,330 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf51.h   host stand-in for the SDK's                                    */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The registers the firmware uses, at their nRF51 offsets and addresses:
+ *  regs.c maps memory there, so raw addresses like buzzer.c's PAN 73
+ *  workaround land in the same place as NRF_TIMER2->... does.
+ */
+#ifndef NRF51_H
+#define NRF51_H
+
+#include <stdint.h>
+
+#define __I  volatile const
+#define __O  volatile
+#define __IO volatile
+
+typedef enum {
+  Reset_IRQn = -15, NonMaskableInt_IRQn = -14, HardFault_IRQn = -13,
+  SVCall_IRQn = -5, DebugMonitor_IRQn = -4, PendSV_IRQn = -2, SysTick_IRQn = -1,
+  POWER_CLOCK_IRQn = 0, RADIO_IRQn = 1, UART0_IRQn = 2, SPI0_TWI0_IRQn = 3,
+  SPI1_TWI1_IRQn = 4, GPIOTE_IRQn = 6, ADC_IRQn = 7, TIMER0_IRQn = 8,
+  TIMER1_IRQn = 9, TIMER2_IRQn = 10, RTC0_IRQn = 11, TEMP_IRQn = 12,
+  RNG_IRQn = 13, ECB_IRQn = 14, CCM_AAR_IRQn = 15, WDT_IRQn = 16,
+  RTC1_IRQn = 17, QDEC_IRQn = 18, LPCOMP_IRQn = 19, SWI0_IRQn = 20,
+  SWI1_IRQn = 21, SWI2_IRQn = 22, SWI3_IRQn = 23, SWI4_IRQn = 24, SWI5_IRQn = 25
+} IRQn_Type;
+
+typedef struct {
+  __O  uint32_t TASKS_HFCLKSTART;
+  __O  uint32_t TASKS_HFCLKSTOP;
+  __O  uint32_t TASKS_LFCLKSTART;
+  __O  uint32_t TASKS_LFCLKSTOP;
+  __O  uint32_t TASKS_CAL;
+  __O  uint32_t TASKS_CTSTART;
+  __O  uint32_t TASKS_CTSTOP;
+       uint32_t RESERVED0[57];
+  __IO uint32_t EVENTS_HFCLKSTARTED;            // 0x100
+  __IO uint32_t EVENTS_LFCLKSTARTED;
+       uint32_t RESERVED1;
+  __IO uint32_t EVENTS_DONE;
+  __IO uint32_t EVENTS_CTTO;
+       uint32_t RESERVED2[124];
+  __IO uint32_t INTENSET;                       // 0x304
+  __IO uint32_t INTENCLR;
+       uint32_t RESERVED3[63];
+  __I  uint32_t HFCLKRUN;                       // 0x408
+  __I  uint32_t HFCLKSTAT;
+       uint32_t RESERVED4;
+  __I  uint32_t LFCLKRUN;
+  __I  uint32_t LFCLKSTAT;
+  __I  uint32_t LFCLKSRCCOPY;
+       uint32_t RESERVED5[62];
+  __IO uint32_t LFCLKSRC;                       // 0x518
+       uint32_t RESERVED6[7];
+  __IO uint32_t CTIV;                           // 0x538
+       uint32_t RESERVED7[5];
+  __IO uint32_t XTALFREQ;                       // 0x550
+} NRF_CLOCK_Type;
+
+typedef struct {
+       uint32_t RESERVED0[30];
+  __O  uint32_t TASKS_CONSTLAT;                 // 0x078
+  __O  uint32_t TASKS_LOWPWR;
+       uint32_t RESERVED1[34];
+  __IO uint32_t EVENTS_POFWARN;                 // 0x108
+       uint32_t RESERVED2[126];
+  __IO uint32_t INTENSET;                       // 0x304
+  __IO uint32_t INTENCLR;
+       uint32_t RESERVED3[61];
+  __IO uint32_t RESETREAS;                      // 0x400
+       uint32_t RESERVED4[9];
+  __I  uint32_t RAMSTATUS;                      // 0x428
+       uint32_t RESERVED5[53];
+  __O  uint32_t SYSTEMOFF;                      // 0x500
+       uint32_t RESERVED6[3];
+  __IO uint32_t POFCON;                         // 0x510
+       uint32_t RESERVED7[2];
+  __IO uint32_t GPREGRET;                       // 0x51C
+       uint32_t RESERVED8;
+  __IO uint32_t RAMON;                          // 0x524
+       uint32_t RESERVED9[7];
+  __IO uint32_t RESET;                          // 0x544
+       uint32_t RESERVED10[3];
+  __IO uint32_t RAMONB;                         // 0x554
+       uint32_t RESERVED11[8];
+  __IO uint32_t DCDCEN;                         // 0x578
+} NRF_POWER_Type;
+
+typedef struct {
+       uint32_t RESERVED0[321];
+  __IO uint32_t OUT;                            // 0x504
+  __IO uint32_t OUTSET;
+  __IO uint32_t OUTCLR;
+  __I  uint32_t IN;
+  __IO uint32_t DIR;
+  __IO uint32_t DIRSET;
+  __IO uint32_t DIRCLR;
+       uint32_t RESERVED1[120];
+  __IO uint32_t PIN_CNF[32];                    // 0x700
+} NRF_GPIO_Type;
+
+typedef struct {
+  __O  uint32_t TASKS_OUT[4];                   // 0x000
+       uint32_t RESERVED0[60];
+  __IO uint32_t EVENTS_IN[4];                   // 0x100
+       uint32_t RESERVED1[27];
+  __IO uint32_t EVENTS_PORT;                    // 0x17C
+       uint32_t RESERVED2[97];
+  __IO uint32_t INTENSET;                       // 0x304
+  __IO uint32_t INTENCLR;
+       uint32_t RESERVED3[129];
+  __IO uint32_t CONFIG[4];                      // 0x510
+       uint32_t RESERVED4[695];
+  __IO uint32_t POWER;                          // 0xFFC
+} NRF_GPIOTE_Type;
+
+typedef struct {
+  __O  uint32_t EN;
+  __O  uint32_t DIS;
+} PPI_TASKS_CHG_Type;
+
+typedef struct {
+  __IO uint32_t EEP;
+  __IO uint32_t TEP;
+} PPI_CH_Type;
+
+typedef struct {
+  PPI_TASKS_CHG_Type TASKS_CHG[4];              // 0x000
+       uint32_t RESERVED0[312];
+  __IO uint32_t CHEN;                           // 0x500
+  __IO uint32_t CHENSET;
+  __IO uint32_t CHENCLR;
+       uint32_t RESERVED1;
+  PPI_CH_Type   CH[16];                         // 0x510
+       uint32_t RESERVED2[156];
+  __IO uint32_t CHG[4];                         // 0x800
+} NRF_PPI_Type;
+
+typedef struct {
+  __O  uint32_t TASKS_START;                    // 0x000
+  __O  uint32_t TASKS_STOP;
+  __O  uint32_t TASKS_COUNT;
+  __O  uint32_t TASKS_CLEAR;
+  __O  uint32_t TASKS_SHUTDOWN;
+       uint32_t RESERVED0[11];
+  __O  uint32_t TASKS_CAPTURE[4];               // 0x040
+       uint32_t RESERVED1[60];
+  __IO uint32_t EVENTS_COMPARE[4];              // 0x140
+       uint32_t RESERVED2[44];
+  __IO uint32_t SHORTS;                         // 0x200
+       uint32_t RESERVED3[64];
+  __IO uint32_t INTENSET;                       // 0x304
+  __IO uint32_t INTENCLR;
+       uint32_t RESERVED4[126];
+  __IO uint32_t MODE;                           // 0x504
+  __IO uint32_t BITMODE;
+       uint32_t RESERVED5;
+  __IO uint32_t PRESCALER;                      // 0x510
+       uint32_t RESERVED6[11];
+  __IO uint32_t CC[4];                          // 0x540
+       uint32_t RESERVED7[683];
+  __IO uint32_t POWER;                          // 0xFFC
+} NRF_TIMER_Type;
+
+typedef struct {
+  __O  uint32_t TASKS_START;                    // 0x000
+  __O  uint32_t TASKS_STOP;
+  __O  uint32_t TASKS_CLEAR;
+  __O  uint32_t TASKS_TRIGOVRFLW;
+       uint32_t RESERVED0[60];
+  __IO uint32_t EVENTS_TICK;                    // 0x100
+  __IO uint32_t EVENTS_OVRFLW;
+       uint32_t RESERVED1[14];
+  __IO uint32_t EVENTS_COMPARE[4];              // 0x140
+       uint32_t RESERVED2[109];
+  __IO uint32_t INTENSET;                       // 0x304
+  __IO uint32_t INTENCLR;
+       uint32_t RESERVED3[13];
+  __IO uint32_t EVTEN;                          // 0x340
+  __IO uint32_t EVTENSET;
+  __IO uint32_t EVTENCLR;
+       uint32_t RESERVED4[110];
+  __I  uint32_t COUNTER;                        // 0x504
+  __IO uint32_t PRESCALER;
+       uint32_t RESERVED5[13];
+  __IO uint32_t CC[4];                          // 0x540
+       uint32_t RESERVED6[683];
+  __IO uint32_t POWER;                          // 0xFFC
+} NRF_RTC_Type;
+
+typedef struct {
+  __O  uint32_t TASKS_START;                    // 0x000
+  __O  uint32_t TASKS_STOP;
+       uint32_t RESERVED0[62];
+  __IO uint32_t EVENTS_END;                     // 0x100
+       uint32_t RESERVED1[128];
+  __IO uint32_t INTENSET;                       // 0x304
+  __IO uint32_t INTENCLR;
+       uint32_t RESERVED2[61];
+  __I  uint32_t BUSY;                           // 0x400
+       uint32_t RESERVED3[63];
+  __IO uint32_t ENABLE;                         // 0x500
+  __IO uint32_t CONFIG;
+  __I  uint32_t RESULT;
+       uint32_t RESERVED4[700];
+  __IO uint32_t POWER;                          // 0xFFC
+} NRF_ADC_Type;
+
+typedef struct {
+  __O  uint32_t TASKS_STARTRX;                  // 0x000
+  __O  uint32_t TASKS_STOPRX;
+  __O  uint32_t TASKS_STARTTX;
+  __O  uint32_t TASKS_STOPTX;
+       uint32_t RESERVED0[3];
+  __O  uint32_t TASKS_SUSPEND;                  // 0x01C
+       uint32_t RESERVED1[56];
+  __IO uint32_t EVENTS_CTS;                     // 0x100
+  __IO uint32_t EVENTS_NCTS;
+  __IO uint32_t EVENTS_RXDRDY;
+       uint32_t RESERVED2[4];
+  __IO uint32_t EVENTS_TXDRDY;                  // 0x11C
+       uint32_t RESERVED3;
+  __IO uint32_t EVENTS_ERROR;                   // 0x124
+       uint32_t RESERVED4[7];
+  __IO uint32_t EVENTS_RXTO;                    // 0x144
+       uint32_t RESERVED5[46];
+  __IO uint32_t SHORTS;                         // 0x200
+       uint32_t RESERVED6[64];
+  __IO uint32_t INTENSET;                       // 0x304
+  __IO uint32_t INTENCLR;
+       uint32_t RESERVED7[93];
+  __IO uint32_t ERRORSRC;                       // 0x480
+       uint32_t RESERVED8[31];
+  __IO uint32_t ENABLE;                         // 0x500
+       uint32_t RESERVED9;
+  __IO uint32_t PSELRTS;                        // 0x508
+  __IO uint32_t PSELTXD;
+  __IO uint32_t PSELCTS;
+  __IO uint32_t PSELRXD;
+  __I  uint32_t RXD;
+  __O  uint32_t TXD;
+       uint32_t RESERVED10;
+  __IO uint32_t BAUDRATE;                       // 0x524
+       uint32_t RESERVED11[17];
+  __IO uint32_t CONFIG;                         // 0x56C
+       uint32_t RESERVED12[675];
+  __IO uint32_t POWER;                          // 0xFFC
+} NRF_UART_Type;
+
+typedef struct {
+       uint32_t RESERVED0[4];
+  __I  uint32_t CODEPAGESIZE;                   // 0x010
+  __I  uint32_t CODESIZE;
+       uint32_t RESERVED1[4];
+  __I  uint32_t CLENR0;                         // 0x028
+  __I  uint32_t PPFC;
+       uint32_t RESERVED2;
+  __I  uint32_t NUMRAMBLOCK;                    // 0x034
+  __I  uint32_t SIZERAMBLOCKS;
+       uint32_t RESERVED3[8];
+  __I  uint32_t CONFIGID;                       // 0x05C
+  __I  uint32_t DEVICEID[2];
+       uint32_t RESERVED4[6];
+  __I  uint32_t ER[4];                          // 0x080
+  __I  uint32_t IR[4];
+  __I  uint32_t DEVICEADDRTYPE;                 // 0x0A0
+  __I  uint32_t DEVICEADDR[2];
+} NRF_FICR_Type;
+
+typedef struct {
+  __IO uint32_t CLENR0;                         // 0x000
+  __IO uint32_t RBPCONF;
+  __IO uint32_t XTALFREQ;
+       uint32_t RESERVED0;
+  __I  uint32_t FWID;                           // 0x010
+  __IO uint32_t BOOTLOADERADDR;
+  __IO uint32_t NRFFW[14];
+  __IO uint32_t NRFHW[12];                      // 0x050
+  __IO uint32_t CUSTOMER[32];                   // 0x080
+} NRF_UICR_Type;
+
+typedef struct {
+       uint32_t RESERVED0[256];
+  __I  uint32_t READY;                          // 0x400
+       uint32_t RESERVED1[64];
+  __IO uint32_t CONFIG;                         // 0x504
+  __IO uint32_t ERASEPAGE;
+  __IO uint32_t ERASEALL;
+  __IO uint32_t ERASEPROTECTEDPAGE;
+  __IO uint32_t ERASEUICR;
+} NRF_NVMC_Type;
+
+#define NRF_FICR_BASE     0x10000000UL
+#define NRF_UICR_BASE     0x10001000UL
+#define NRF_CLOCK_BASE    0x40000000UL
+#define NRF_POWER_BASE    0x40000000UL
+#define NRF_UART0_BASE    0x40002000UL
+#define NRF_GPIOTE_BASE   0x40006000UL
+#define NRF_ADC_BASE      0x40007000UL
+#define NRF_TIMER0_BASE   0x40008000UL
+#define NRF_TIMER1_BASE   0x40009000UL
+#define NRF_TIMER2_BASE   0x4000A000UL
+#define NRF_RTC0_BASE     0x4000B000UL
+#define NRF_RTC1_BASE     0x40011000UL
+#define NRF_NVMC_BASE     0x4001E000UL
+#define NRF_PPI_BASE      0x4001F000UL
+#define NRF_GPIO_BASE     0x50000000UL
+
+#define NRF_FICR    ((NRF_FICR_Type   *) NRF_FICR_BASE)
+#define NRF_UICR    ((NRF_UICR_Type   *) NRF_UICR_BASE)
+#define NRF_CLOCK   ((NRF_CLOCK_Type  *) NRF_CLOCK_BASE)
+#define NRF_POWER   ((NRF_POWER_Type  *) NRF_POWER_BASE)
+#define NRF_UART0   ((NRF_UART_Type   *) NRF_UART0_BASE)
+#define NRF_GPIOTE  ((NRF_GPIOTE_Type *) NRF_GPIOTE_BASE)
+#define NRF_ADC     ((NRF_ADC_Type    *) NRF_ADC_BASE)
+#define NRF_TIMER0  ((NRF_TIMER_Type  *) NRF_TIMER0_BASE)
+#define NRF_TIMER1  ((NRF_TIMER_Type  *) NRF_TIMER1_BASE)
+#define NRF_TIMER2  ((NRF_TIMER_Type  *) NRF_TIMER2_BASE)
+#define NRF_RTC0    ((NRF_RTC_Type    *) NRF_RTC0_BASE)
+#define NRF_RTC1    ((NRF_RTC_Type    *) NRF_RTC1_BASE)
+#define NRF_NVMC    ((NRF_NVMC_Type   *) NRF_NVMC_BASE)
+#define NRF_PPI     ((NRF_PPI_Type    *) NRF_PPI_BASE)
+#define NRF_GPIO    ((NRF_GPIO_Type   *) NRF_GPIO_BASE)
+
+#include "core_cm0.h"
+#include "nrf51_bitfields.h"
+
+#endif /* NRF51_H */
@@ -0,0 +1,129 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf51_bitfields.h   host stand-in for the SDK's                          */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NRF51_BITFIELDS_H
+#define NRF51_BITFIELDS_H
+
+#define ADC_CONFIG_RES_Pos (0UL)
+#define ADC_CONFIG_RES_8bit (0x00UL)
+#define ADC_CONFIG_RES_9bit (0x01UL)
+#define ADC_CONFIG_RES_10bit (0x02UL)
+#define ADC_CONFIG_INPSEL_Pos (2UL)
+#define ADC_CONFIG_INPSEL_AnalogInputNoPrescaling (0x00UL)
+#define ADC_CONFIG_INPSEL_SupplyOneThirdPrescaling (0x06UL)
+#define ADC_CONFIG_REFSEL_Pos (5UL)
+#define ADC_CONFIG_REFSEL_VBG (0x00UL)
+#define ADC_CONFIG_PSEL_Pos (8UL)
+#define ADC_CONFIG_PSEL_Disabled (0UL)
+#define ADC_CONFIG_EXTREFSEL_Pos (16UL)
+#define ADC_CONFIG_EXTREFSEL_None (0UL)
+#define ADC_ENABLE_ENABLE_Disabled (0x00UL)
+#define ADC_ENABLE_ENABLE_Enabled (0x01UL)
+#define ADC_INTENSET_END_Pos (0UL)
+#define ADC_INTENSET_END_Msk (0x1UL << ADC_INTENSET_END_Pos)
+
+#define TIMER_MODE_MODE_Timer (0UL)
+#define TIMER_MODE_MODE_Counter (1UL)
+#define TIMER_BITMODE_BITMODE_16Bit (0x00UL)
+#define TIMER_BITMODE_BITMODE_08Bit (0x01UL)
+#define TIMER_BITMODE_BITMODE_24Bit (0x02UL)
+#define TIMER_BITMODE_BITMODE_32Bit (0x03UL)
+#define TIMER_SHORTS_COMPARE0_CLEAR_Pos (0UL)
+#define TIMER_SHORTS_COMPARE0_CLEAR_Enabled (1UL)
+#define TIMER_SHORTS_COMPARE1_CLEAR_Pos (1UL)
+#define TIMER_SHORTS_COMPARE1_CLEAR_Enabled (1UL)
+#define TIMER_SHORTS_COMPARE0_STOP_Pos (8UL)
+#define TIMER_SHORTS_COMPARE0_STOP_Enabled (1UL)
+#define TIMER_SHORTS_COMPARE1_STOP_Pos (9UL)
+#define TIMER_SHORTS_COMPARE1_STOP_Enabled (1UL)
+#define TIMER_INTENSET_COMPARE0_Pos (16UL)
+#define TIMER_INTENSET_COMPARE0_Msk (0x1UL << TIMER_INTENSET_COMPARE0_Pos)
+#define TIMER_INTENSET_COMPARE1_Pos (17UL)
+#define TIMER_INTENSET_COMPARE1_Msk (0x1UL << TIMER_INTENSET_COMPARE1_Pos)
+
+#define RTC_EVTEN_COMPARE0_Pos (16UL)
+#define RTC_EVTEN_COMPARE0_Msk (0x1UL << RTC_EVTEN_COMPARE0_Pos)
+#define RTC_EVTEN_COMPARE1_Pos (17UL)
+#define RTC_EVTEN_COMPARE1_Msk (0x1UL << RTC_EVTEN_COMPARE1_Pos)
+#define RTC_INTENSET_COMPARE0_Pos (16UL)
+#define RTC_INTENSET_COMPARE0_Msk (0x1UL << RTC_INTENSET_COMPARE0_Pos)
+#define RTC_INTENSET_COMPARE1_Pos (17UL)
+#define RTC_INTENSET_COMPARE1_Msk (0x1UL << RTC_INTENSET_COMPARE1_Pos)
+#define RTC_INTENSET_COMPARE2_Pos (18UL)
+#define RTC_INTENSET_COMPARE2_Msk (0x1UL << RTC_INTENSET_COMPARE2_Pos)
+#define RTC_INTENSET_COMPARE3_Pos (19UL)
+#define RTC_INTENSET_COMPARE3_Msk (0x1UL << RTC_INTENSET_COMPARE3_Pos)
+
+#define PPI_CHEN_CH0_Pos (0UL)
+#define PPI_CHEN_CH0_Enabled (1UL)
+#define PPI_CHEN_CH1_Pos (1UL)
+#define PPI_CHEN_CH1_Enabled (1UL)
+#define PPI_CHEN_CH2_Pos (2UL)
+#define PPI_CHEN_CH2_Enabled (1UL)
+#define PPI_CHEN_CH3_Pos (3UL)
+#define PPI_CHEN_CH3_Enabled (1UL)
+
+#define GPIOTE_CONFIG_MODE_Pos (0UL)
+#define GPIOTE_CONFIG_MODE_Disabled (0x00UL)
+#define GPIOTE_CONFIG_MODE_Event (0x01UL)
+#define GPIOTE_CONFIG_MODE_Task (0x03UL)
+#define GPIOTE_CONFIG_PSEL_Pos (8UL)
+#define GPIOTE_CONFIG_PSEL_Msk (0x1FUL << GPIOTE_CONFIG_PSEL_Pos)
+#define GPIOTE_CONFIG_POLARITY_Pos (16UL)
+#define GPIOTE_CONFIG_POLARITY_LoToHi (0x01UL)
+#define GPIOTE_CONFIG_POLARITY_HiToLo (0x02UL)
+#define GPIOTE_CONFIG_POLARITY_Toggle (0x03UL)
+#define GPIOTE_CONFIG_OUTINIT_Pos (20UL)
+#define GPIOTE_CONFIG_OUTINIT_Low (0x00UL)
+#define GPIOTE_CONFIG_OUTINIT_High (0x01UL)
+#define GPIOTE_INTENSET_PORT_Pos (31UL)
+#define GPIOTE_INTENSET_PORT_Msk (0x1UL << GPIOTE_INTENSET_PORT_Pos)
+
+#define GPIO_PIN_CNF_DIR_Pos (0UL)
+#define GPIO_PIN_CNF_DIR_Input (0x00UL)
+#define GPIO_PIN_CNF_DIR_Output (0x01UL)
+#define GPIO_PIN_CNF_INPUT_Pos (1UL)
+#define GPIO_PIN_CNF_INPUT_Connect (0x00UL)
+#define GPIO_PIN_CNF_PULL_Pos (2UL)
+#define GPIO_PIN_CNF_PULL_Pullup (0x03UL)
+#define GPIO_PIN_CNF_SENSE_Pos (16UL)
+#define GPIO_PIN_CNF_SENSE_Msk (0x3UL << GPIO_PIN_CNF_SENSE_Pos)
+#define GPIO_PIN_CNF_SENSE_Disabled (0x00UL)
+#define GPIO_PIN_CNF_SENSE_High (0x02UL)
+#define GPIO_PIN_CNF_SENSE_Low (0x03UL)
+
+#define UART_BAUDRATE_BAUDRATE_Pos (0UL)
+#define UART_BAUDRATE_BAUDRATE_Baud38400 (0x009D5000UL)
+#define UART_BAUDRATE_BAUDRATE_Baud115200 (0x01D7E000UL)
+#define UART_ENABLE_ENABLE_Disabled (0x00UL)
+#define UART_ENABLE_ENABLE_Enabled (0x04UL)
+#define UART_INTENSET_RXDRDY_Pos (2UL)
+#define UART_INTENSET_RXDRDY_Msk (0x1UL << UART_INTENSET_RXDRDY_Pos)
+#define UART_INTENSET_TXDRDY_Pos (7UL)
+#define UART_INTENSET_TXDRDY_Msk (0x1UL << UART_INTENSET_TXDRDY_Pos)
+#define UART_INTENSET_ERROR_Pos (9UL)
+#define UART_INTENSET_ERROR_Msk (0x1UL << UART_INTENSET_ERROR_Pos)
+#define UART_INTENCLR_TXDRDY_Pos (7UL)
+#define UART_INTENCLR_TXDRDY_Msk (0x1UL << UART_INTENCLR_TXDRDY_Pos)
+
+#define POWER_RESETREAS_RESETPIN_Msk (0x1UL << 0)
+#define POWER_RESETREAS_DOG_Msk      (0x1UL << 1)
+#define POWER_RESETREAS_SREQ_Msk     (0x1UL << 2)
+#define POWER_RESETREAS_LOCKUP_Msk   (0x1UL << 3)
+#define POWER_RESETREAS_OFF_Msk      (0x1UL << 16)
+#define POWER_RESETREAS_LPCOMP_Msk   (0x1UL << 17)
+#define POWER_RESETREAS_DIF_Msk      (0x1UL << 18)
+
+#define CLOCK_HFCLKSTAT_SRC_Pos (0UL)
+#define CLOCK_HFCLKSTAT_SRC_Msk (0x1UL << CLOCK_HFCLKSTAT_SRC_Pos)
+#define CLOCK_HFCLKSTAT_SRC_Xtal (1UL)
+
+#define NVMC_READY_READY_Busy (0x00UL)
+#define NVMC_READY_READY_Ready (0x01UL)
+#define NVMC_CONFIG_WEN_Pos (0UL)
+#define NVMC_CONFIG_WEN_Ren (0x00UL)
+#define NVMC_CONFIG_WEN_Wen (0x01UL)
+#define NVMC_CONFIG_WEN_Een (0x02UL)
+
+#endif /* NRF51_BITFIELDS_H */
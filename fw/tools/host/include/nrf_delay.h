@@ -0,0 +1,10 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf_delay.h   host stand-in for the SDK's                                */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NRF_DELAY_H
+#define NRF_DELAY_H
+#include <stdint.h>
+void nrf_delay_us(uint32_t volatile number_of_us);
+void nrf_delay_ms(uint32_t volatile number_of_ms);
+#endif
@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf_gpio.h   host stand-in for the SDK's                                 */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NRF_GPIO_H__
+#define NRF_GPIO_H__
+#include <stdint.h>
+#include "nrf51.h"
+#include "nrf51_bitfields.h"
+
+typedef enum {
+  NRF_GPIO_PIN_NOPULL   = 0,
+  NRF_GPIO_PIN_PULLDOWN = 1,
+  NRF_GPIO_PIN_PULLUP   = 3,
+} nrf_gpio_pin_pull_t;
+
+typedef enum {
+  NRF_GPIO_PIN_NOSENSE    = GPIO_PIN_CNF_SENSE_Disabled,
+  NRF_GPIO_PIN_SENSE_LOW  = GPIO_PIN_CNF_SENSE_Low,
+  NRF_GPIO_PIN_SENSE_HIGH = GPIO_PIN_CNF_SENSE_High,
+} nrf_gpio_pin_sense_t;
+
+static __inline void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+    NRF_GPIO->PIN_CNF[pin_number] = (GPIO_PIN_CNF_DIR_Output << GPIO_PIN_CNF_DIR_Pos);
+    NRF_GPIO->DIRSET = (1UL << pin_number);
+}
+
+static __inline void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config)
+{
+    NRF_GPIO->PIN_CNF[pin_number] = (GPIO_PIN_CNF_DIR_Input << GPIO_PIN_CNF_DIR_Pos) |
+                                    (pull_config << GPIO_PIN_CNF_PULL_Pos);
+    NRF_GPIO->DIRCLR = (1UL << pin_number);
+}
+
+static __inline void nrf_gpio_cfg_sense_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config,
+                                              nrf_gpio_pin_sense_t sense_config)
+{
+    NRF_GPIO->PIN_CNF[pin_number] = (sense_config << GPIO_PIN_CNF_SENSE_Pos) |
+                                    (GPIO_PIN_CNF_DIR_Input << GPIO_PIN_CNF_DIR_Pos) |
+                                    (pull_config << GPIO_PIN_CNF_PULL_Pos);
+    NRF_GPIO->DIRCLR = (1UL << pin_number);
+}
+
+static __inline void nrf_gpio_pin_set(uint32_t pin_number)
+{
+    NRF_GPIO->OUTSET = (1UL << pin_number);
+}
+
+static __inline void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+    NRF_GPIO->OUTCLR = (1UL << pin_number);
+}
+
+static __inline uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    return ((NRF_GPIO->IN >> pin_number) & 1UL);
+}
+#endif
@@ -0,0 +1,36 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf_gpiote.h   host stand-in for the SDK's                               */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NRF_GPIOTE_H__
+#define NRF_GPIOTE_H__
+#include <stdint.h>
+#include "nrf51.h"
+#include "nrf51_bitfields.h"
+
+typedef enum {
+  NRF_GPIOTE_POLARITY_LOTOHI = GPIOTE_CONFIG_POLARITY_LoToHi,
+  NRF_GPIOTE_POLARITY_HITOLO = GPIOTE_CONFIG_POLARITY_HiToLo,
+  NRF_GPIOTE_POLARITY_TOGGLE = GPIOTE_CONFIG_POLARITY_Toggle
+} nrf_gpiote_polarity_t;
+
+typedef enum {
+  NRF_GPIOTE_INITIAL_VALUE_LOW  = GPIOTE_CONFIG_OUTINIT_Low,
+  NRF_GPIOTE_INITIAL_VALUE_HIGH = GPIOTE_CONFIG_OUTINIT_High
+} nrf_gpiote_outinit_t;
+
+static __inline void nrf_gpiote_task_config(uint32_t channel_number, uint32_t pin_number,
+                                            nrf_gpiote_polarity_t polarity,
+                                            nrf_gpiote_outinit_t initial_value)
+{
+    NRF_GPIOTE->CONFIG[channel_number] = (GPIOTE_CONFIG_MODE_Task << GPIOTE_CONFIG_MODE_Pos) |
+                                         ((pin_number << GPIOTE_CONFIG_PSEL_Pos) & GPIOTE_CONFIG_PSEL_Msk) |
+                                         ((uint32_t)polarity << GPIOTE_CONFIG_POLARITY_Pos) |
+                                         ((uint32_t)initial_value << GPIOTE_CONFIG_OUTINIT_Pos);
+}
+
+static __inline void nrf_gpiote_unconfig(uint32_t channel_number)
+{
+    NRF_GPIOTE->CONFIG[channel_number] = (GPIOTE_CONFIG_MODE_Disabled << GPIOTE_CONFIG_MODE_Pos);
+}
+#endif
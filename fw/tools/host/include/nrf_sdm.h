@@ -0,0 +1,29 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf_sdm.h   host stand-in for the SDK's                                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NRF_SDM_H__
+#define NRF_SDM_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_error.h"
+
+typedef enum {
+  NRF_CLOCK_LFCLKSRC_SYNTH_250_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_500_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_250_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_150_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_100_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_75_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_50_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_30_PPM,
+  NRF_CLOCK_LFCLKSRC_XTAL_20_PPM,
+  NRF_CLOCK_LFCLKSRC_RC_250_PPM_250MS_CALIBRATION,
+} nrf_clock_lfclksrc_t;
+
+typedef void (*softdevice_assertion_handler_t)(uint32_t pc, uint16_t line_number, const uint8_t * p_file_name);
+
+uint32_t sd_softdevice_enable(nrf_clock_lfclksrc_t clock_source, softdevice_assertion_handler_t assertion_handler);
+uint32_t sd_softdevice_disable(void);
+uint32_t sd_softdevice_is_enabled(uint8_t * p_softdevice_enabled);
+#endif
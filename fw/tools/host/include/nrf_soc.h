@@ -0,0 +1,94 @@
+/*---------------------------------------------------------------------------*/
+/*  nrf_soc.h   host stand-in for the SDK's                                  */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef NRF_SOC_H__
+#define NRF_SOC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf51.h"
+#include "nrf_error.h"
+#include "nrf_error_soc.h"
+
+enum NRF_SOC_EVTS {
+  NRF_EVT_HFCLKSTARTED,
+  NRF_EVT_POWER_FAILURE_WARNING,
+  NRF_EVT_FLASH_OPERATION_SUCCESS,
+  NRF_EVT_FLASH_OPERATION_ERROR,
+  NRF_EVT_RADIO_BLOCKED,
+  NRF_EVT_RADIO_CANCELED,
+  NRF_EVT_RADIO_SIGNAL_CALLBACK_INVALID_RETURN,
+  NRF_EVT_RADIO_SESSION_IDLE,
+  NRF_EVT_RADIO_SESSION_CLOSED,
+  NRF_EVT_NUMBER_OF_EVTS
+};
+
+typedef enum NRF_APP_PRIORITIES {
+  NRF_APP_PRIORITY_HIGH = 1,
+  NRF_APP_PRIORITY_LOW  = 3
+} nrf_app_irq_priority_t;
+
+typedef enum NRF_RADIO_NOTIFICATION_DISTANCES {
+  NRF_RADIO_NOTIFICATION_DISTANCE_NONE = 0,
+  NRF_RADIO_NOTIFICATION_DISTANCE_800US,
+  NRF_RADIO_NOTIFICATION_DISTANCE_1740US,
+  NRF_RADIO_NOTIFICATION_DISTANCE_2680US,
+  NRF_RADIO_NOTIFICATION_DISTANCE_3620US,
+  NRF_RADIO_NOTIFICATION_DISTANCE_4560US,
+  NRF_RADIO_NOTIFICATION_DISTANCE_5500US
+} nrf_radio_notification_distance_t;
+
+enum NRF_RADIO_NOTIFICATION_TYPES {
+  NRF_RADIO_NOTIFICATION_TYPE_NONE = 0,
+  NRF_RADIO_NOTIFICATION_TYPE_INT_ON_ACTIVE,
+  NRF_RADIO_NOTIFICATION_TYPE_INT_ON_INACTIVE,
+  NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH
+};
+
+#define SOC_ECB_KEY_LENGTH         (16)
+#define SOC_ECB_CLEARTEXT_LENGTH   (16)
+#define SOC_ECB_CIPHERTEXT_LENGTH  (SOC_ECB_CLEARTEXT_LENGTH)
+
+typedef uint8_t soc_ecb_key_t[SOC_ECB_KEY_LENGTH];
+typedef uint8_t soc_ecb_cleartext_t[SOC_ECB_CLEARTEXT_LENGTH];
+typedef uint8_t soc_ecb_ciphertext_t[SOC_ECB_CIPHERTEXT_LENGTH];
+
+typedef struct {
+  soc_ecb_key_t        key;
+  soc_ecb_cleartext_t  cleartext;
+  soc_ecb_ciphertext_t ciphertext;
+} nrf_ecb_hal_data_t;
+
+typedef volatile uint8_t nrf_mutex_t;
+
+uint32_t sd_app_evt_wait(void);
+uint32_t sd_evt_get(uint32_t * p_evt_id);
+uint32_t sd_temp_get(int32_t * p_temp);
+uint32_t sd_rand_application_vector_get(uint8_t * p_buff, uint8_t length);
+uint32_t sd_ecb_block_encrypt(nrf_ecb_hal_data_t * p_ecb_data);
+uint32_t sd_ppi_channel_enable_get(uint32_t * p_channel_enable);
+uint32_t sd_ppi_channel_enable_set(uint32_t channel_enable_set_msk);
+uint32_t sd_ppi_channel_enable_clr(uint32_t channel_enable_clr_msk);
+uint32_t sd_ppi_channel_assign(uint8_t channel_num, const volatile void * evt_endpoint, const volatile void * task_endpoint);
+uint32_t sd_clock_hfclk_request(void);
+uint32_t sd_clock_hfclk_release(void);
+uint32_t sd_clock_hfclk_is_running(uint32_t * p_is_running);
+uint32_t sd_radio_notification_cfg_set(uint8_t type, uint8_t distance);
+uint32_t sd_flash_page_erase(uint32_t page_number);
+uint32_t sd_flash_write(uint32_t * const p_dst, uint32_t const * const p_src, uint32_t size);
+uint32_t sd_power_reset_reason_get(uint32_t * p_reset_reason);
+uint32_t sd_power_reset_reason_clr(uint32_t reset_reason_clr_msk);
+uint32_t sd_power_gpregret_get(uint32_t * p_gpregret);
+uint32_t sd_power_gpregret_set(uint32_t gpregret_msk);
+uint32_t sd_power_gpregret_clr(uint32_t gpregret_msk);
+uint32_t sd_power_system_off(void);
+uint32_t sd_nvic_EnableIRQ(IRQn_Type IRQn);
+uint32_t sd_nvic_DisableIRQ(IRQn_Type IRQn);
+uint32_t sd_nvic_SetPriority(IRQn_Type IRQn, uint32_t priority);
+uint32_t sd_nvic_ClearPendingIRQ(IRQn_Type IRQn);
+uint32_t sd_nvic_SetPendingIRQ(IRQn_Type IRQn);
+uint32_t sd_nvic_critical_region_enter(uint8_t * p_is_nested_critical_region);
+uint32_t sd_nvic_critical_region_exit(uint8_t is_nested_critical_region);
+
+#endif /* NRF_SOC_H__ */
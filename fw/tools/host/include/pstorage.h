@@ -0,0 +1,36 @@
+/*---------------------------------------------------------------------------*/
+/*  pstorage.h   host stand-in for the SDK's                                 */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef PSTORAGE_H__
+#define PSTORAGE_H__
+#include <stdint.h>
+#include "pstorage_platform.h"
+
+#define PSTORAGE_ERROR_OP_CODE   0x01
+#define PSTORAGE_STORE_OP_CODE   0x02
+#define PSTORAGE_LOAD_OP_CODE    0x03
+#define PSTORAGE_CLEAR_OP_CODE   0x04
+#define PSTORAGE_UPDATE_OP_CODE  0x05
+
+typedef void (*pstorage_ntf_cb_t)(pstorage_handle_t * p_handle,
+                                  uint8_t             op_code,
+                                  uint32_t            result,
+                                  uint8_t           * p_data,
+                                  uint32_t            data_len);
+
+typedef struct {
+  pstorage_ntf_cb_t cb;
+  pstorage_size_t   block_size;
+  pstorage_size_t   block_count;
+} pstorage_module_param_t;
+
+uint32_t pstorage_init(void);
+uint32_t pstorage_register(pstorage_module_param_t * p_module_param, pstorage_handle_t * p_block_id);
+uint32_t pstorage_block_identifier_get(pstorage_handle_t * p_base_id, pstorage_size_t block_num, pstorage_handle_t * p_block_id);
+uint32_t pstorage_store(pstorage_handle_t * p_dest, uint8_t * p_src, pstorage_size_t size, pstorage_size_t offset);
+uint32_t pstorage_update(pstorage_handle_t * p_dest, uint8_t * p_src, pstorage_size_t size, pstorage_size_t offset);
+uint32_t pstorage_load(uint8_t * p_dest, pstorage_handle_t * p_src, pstorage_size_t size, pstorage_size_t offset);
+uint32_t pstorage_clear(pstorage_handle_t * p_base_id, pstorage_size_t size);
+uint32_t pstorage_access_status_get(uint32_t * p_count);
+#endif
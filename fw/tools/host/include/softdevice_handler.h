@@ -0,0 +1,32 @@
+/*---------------------------------------------------------------------------*/
+/*  softdevice_handler.h   host stand-in for the SDK's                       */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+#ifndef SOFTDEVICE_HANDLER_H__
+#define SOFTDEVICE_HANDLER_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_sdm.h"
+#include "nrf_soc.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "ble.h"
+
+typedef uint32_t (*softdevice_evt_schedule_func_t) (void);
+typedef void (*ble_evt_handler_t) (ble_evt_t * p_ble_evt);
+typedef void (*sys_evt_handler_t) (uint32_t evt_id);
+
+uint32_t softdevice_handler_init(nrf_clock_lfclksrc_t clock_source,
+                                 void * p_evt_buffer,
+                                 uint16_t evt_buffer_size,
+                                 softdevice_evt_schedule_func_t evt_schedule_func);
+uint32_t softdevice_handler_sd_disable(void);
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler);
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler);
+
+#define SOFTDEVICE_HANDLER_INIT(CLOCK_SOURCE, USE_SCHEDULER) \
+    do { static uint32_t BLE_EVT_BUFFER[64]; \
+         uint32_t ERR_CODE = softdevice_handler_init((CLOCK_SOURCE), BLE_EVT_BUFFER, sizeof(BLE_EVT_BUFFER), NULL); \
+         APP_ERROR_CHECK(ERR_CODE); \
+    } while (0)
+#endif
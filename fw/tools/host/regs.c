@@ -0,0 +1,764 @@
+/*---------------------------------------------------------------------------*/
+/*  regs.c   the nRF51 memory map and the peripherals the firmware touches   */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Flash, FICR, UICR and the peripherals are mapped at their nRF51
+ *  addresses, so the firmware's raw addresses work too (-no-pie keeps
+ *  the rest of the program below 4G, where the firmware's uint32_t
+ *  casts can reach it).
+ *
+ *  A peripheral that does something when written is trapped: its page is
+ *  mapped twice, read only at the firmware's address and read/write
+ *  somewhere else for the host.  A firmware write faults; the handler
+ *  opens the page for one instruction (the x86 trap flag), then closes it
+ *  again and hands whatever changed to the peripheral's model.  So
+ *  NRF_ADC->TASKS_START = 1 sets EVENTS_END by the time the firmware's
+ *  loop reads it.  Reads go straight through.
+ *
+ *  The trap flag also counts instructions: with counting on, every step
+ *  taken inside the firmware's code (the fwtext section, see the
+ *  makefile) is one more.
+ */
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#include "nrf51.h"
+#include "nrf51_bitfields.h"
+
+#include "host.h"
+
+#define PAGE            4096
+#define TRAP_FLAG       0x100               // EFLAGS.TF
+
+/* The layout in include/nrf51.h, checked against the reference manual. */
+_Static_assert(offsetof(NRF_GPIO_Type,   OUT)            == 0x504, "GPIO");
+_Static_assert(offsetof(NRF_GPIO_Type,   PIN_CNF)        == 0x700, "GPIO");
+_Static_assert(offsetof(NRF_GPIOTE_Type, EVENTS_PORT)    == 0x17C, "GPIOTE");
+_Static_assert(offsetof(NRF_GPIOTE_Type, CONFIG)         == 0x510, "GPIOTE");
+_Static_assert(offsetof(NRF_GPIOTE_Type, POWER)          == 0xFFC, "GPIOTE");
+_Static_assert(offsetof(NRF_PPI_Type,    CH)             == 0x510, "PPI");
+_Static_assert(offsetof(NRF_PPI_Type,    CHG)            == 0x800, "PPI");
+_Static_assert(offsetof(NRF_TIMER_Type,  EVENTS_COMPARE) == 0x140, "TIMER");
+_Static_assert(offsetof(NRF_TIMER_Type,  CC)             == 0x540, "TIMER");
+_Static_assert(offsetof(NRF_TIMER_Type,  POWER)          == 0xFFC, "TIMER");
+_Static_assert(offsetof(NRF_RTC_Type,    COUNTER)        == 0x504, "RTC");
+_Static_assert(offsetof(NRF_RTC_Type,    POWER)          == 0xFFC, "RTC");
+_Static_assert(offsetof(NRF_ADC_Type,    RESULT)         == 0x508, "ADC");
+_Static_assert(offsetof(NRF_ADC_Type,    POWER)          == 0xFFC, "ADC");
+_Static_assert(offsetof(NRF_UART_Type,   CONFIG)         == 0x56C, "UART");
+_Static_assert(offsetof(NRF_UART_Type,   POWER)          == 0xFFC, "UART");
+_Static_assert(offsetof(NRF_NVMC_Type,   ERASEUICR)      == 0x514, "NVMC");
+_Static_assert(offsetof(NRF_FICR_Type,   DEVICEADDR)     == 0x0A4, "FICR");
+_Static_assert(offsetof(NRF_UICR_Type,   NRFHW)          == 0x050, "UICR");
+_Static_assert(offsetof(NRF_UICR_Type,   CUSTOMER)       == 0x080, "UICR");
+_Static_assert(offsetof(NRF_CLOCK_Type,  XTALFREQ)       == 0x550, "CLOCK");
+_Static_assert(offsetof(NRF_POWER_Type,  RESETREAS)      == 0x400, "POWER");
+_Static_assert(offsetof(NRF_POWER_Type,  DCDCEN)         == 0x578, "POWER");
+
+/* Registers the firmware only reads, written here. */
+#define SET(reg, value)     (*(volatile uint32_t *) &(reg) = (value))
+
+typedef struct {
+    uintptr_t   base;
+    const char * name;
+    void     (* write)(uint32_t offset, uint32_t value);
+    uint8_t   * host;                       // where the host sees it
+} page_t;
+
+static void power_write(uint32_t offset, uint32_t value);
+static void gpiote_write(uint32_t offset, uint32_t value);
+static void adc_write(uint32_t offset, uint32_t value);
+static void timer_write(uint32_t offset, uint32_t value);
+static void nvmc_write(uint32_t offset, uint32_t value);
+static void ppi_write(uint32_t offset, uint32_t value);
+static void gpio_write(uint32_t offset, uint32_t value);
+static void scs_write(uint32_t offset, uint32_t value);
+
+/* Trapped: mapped twice. */
+static page_t  m_trapped [] = {
+    { NRF_POWER_BASE,   "power",  power_write  },
+    { NRF_GPIOTE_BASE,  "gpiote", gpiote_write },
+    { NRF_ADC_BASE,     "adc",    adc_write    },
+    { NRF_TIMER1_BASE,  "timer1", timer_write  },
+    { NRF_TIMER2_BASE,  "timer2", timer_write  },
+    { NRF_NVMC_BASE,    "nvmc",   nvmc_write   },
+    { NRF_PPI_BASE,     "ppi",    ppi_write    },
+    { NRF_GPIO_BASE,    "gpio",   gpio_write   },
+    { SCS_BASE,         "scs",    scs_write    },
+};
+#define TRAPPED_COUNT   (sizeof(m_trapped) / sizeof(m_trapped[0]))
+
+/* Plain memory: nothing happens on a write, or nothing the firmware uses. */
+static const uintptr_t  m_plain [] = {
+    NRF_FICR_BASE, NRF_UICR_BASE, NRF_UART0_BASE,
+    NRF_TIMER0_BASE, NRF_RTC0_BASE, NRF_RTC1_BASE,
+};
+
+/* The page open for one instruction. */
+static page_t   * m_open;
+static uintptr_t  m_open_addr;
+static bool       m_open_write;
+static uint8_t    m_before [PAGE];
+
+bool              g_regs_counting;
+static uint64_t   m_instructions;
+
+/* Made by the linker from the section the makefile renames .text to. */
+extern const char __start_fwtext [], __stop_fwtext [];
+
+/* The page being written: the timers share one model. */
+static page_t   * m_writing;
+
+uint16_t          g_regs_vbat_mv = 3000;
+
+/*---------------------------------------------------------------------------*/
+/*  The RAM diag.c paints, and the symbols the nRF51 linker script gives.    */
+/*---------------------------------------------------------------------------*/
+uint32_t  host_ram [4096] __attribute__ ((aligned (8)));   // 16K, as nRF51822
+
+__asm__ (".globl __HeapBase\n"    ".set __HeapBase,    host_ram\n"
+         ".globl __HeapLimit\n"   ".set __HeapLimit,   host_ram + 2048\n"
+         ".globl __StackTop\n"    ".set __StackTop,    host_ram + 16384\n");
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static page_t * page_find(uintptr_t addr)
+{
+    unsigned i;
+
+    for (i = 0; i < TRAPPED_COUNT; i++)
+        if (addr - m_trapped[i].base < PAGE)
+            return &m_trapped[i];
+    return NULL;
+}
+
+void * regs_host(volatile void * p_reg)
+{
+    uintptr_t addr = (uintptr_t) p_reg;
+    page_t  * p    = page_find(addr);
+
+    return p ? p->host + (addr - p->base) : (void *) addr;
+}
+
+void regs_write(volatile uint32_t * p_reg, uint32_t value)
+{
+    uintptr_t addr = (uintptr_t) p_reg;
+    page_t  * p    = page_find(addr);
+
+    if (p == NULL) {
+        *p_reg = value;
+        return;
+    }
+    *(volatile uint32_t *) (p->host + (addr - p->base)) = value;
+    m_writing = p;
+    p->write(addr - p->base, value);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The traps.                                                               */
+/*---------------------------------------------------------------------------*/
+static void fault(const char * what, uintptr_t addr, const ucontext_t * uc)
+{
+    fprintf(stderr, "host: %s at 0x%lx, pc 0x%lx\n", what, (unsigned long) addr,
+            (unsigned long) uc->uc_mcontext.gregs[REG_RIP]);
+    signal(SIGSEGV, SIG_DFL);               // fault again, for real
+}
+
+static void on_segv(int sig, siginfo_t * si, void * p_context)
+{
+    ucontext_t * uc   = p_context;
+    uintptr_t    addr = (uintptr_t) si->si_addr;
+    page_t     * p    = page_find(addr);
+
+    if (p == NULL || m_open != NULL) {
+        fault(p ? "two registers in one instruction" : "bad access", addr, uc);
+        return;
+    }
+
+    m_open       = p;
+    m_open_addr  = addr;
+    m_open_write = (uc->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+    memcpy(m_before, p->host, PAGE);
+
+    mprotect((void *) p->base, PAGE, PROT_READ | PROT_WRITE);
+    uc->uc_mcontext.gregs[REG_EFL] |= TRAP_FLAG;
+}
+
+static void on_trap(int sig, siginfo_t * si, void * p_context)
+{
+    ucontext_t * uc = p_context;
+
+    if (m_open != NULL) {
+        page_t   * p    = m_open;
+        uint32_t * now  = (uint32_t *) p->host;
+        uint32_t * then = (uint32_t *) m_before;
+        uint32_t   hit  = (m_open_addr - p->base) / 4;
+        uint32_t   offsets [4], values [4];
+        uint32_t   count = 0;
+        uint32_t   i;
+
+        mprotect((void *) p->base, PAGE, PROT_READ);
+        m_open = NULL;
+
+        /* Whatever changed, and the word written even if it did not.  All
+           found before any model runs: models write other registers. */
+        for (i = 0; i < PAGE / 4 && count < 4; i++) {
+            if (now[i] != then[i] || (m_open_write && i == hit)) {
+                offsets[count] = i * 4;
+                values[count++] = now[i];
+            }
+        }
+        m_writing = p;
+        for (i = 0; i < count; i++)
+            p->write(offsets[i], values[i]);
+    }
+
+    if (g_regs_counting) {
+        const char * rip = (const char *) uc->uc_mcontext.gregs[REG_RIP];
+        if (rip >= __start_fwtext && rip < __stop_fwtext)
+            m_instructions++;
+    }
+    else {
+        uc->uc_mcontext.gregs[REG_EFL] &= ~TRAP_FLAG;
+    }
+}
+
+void regs_count(bool on)
+{
+    g_regs_counting = on;
+    if (on)
+        __asm__ volatile ("sub $128, %%rsp; pushfq; orq $0x100, (%%rsp); popfq; add $128, %%rsp"
+                          ::: "memory", "cc");      // past the red zone
+}
+
+uint64_t regs_instructions(void)
+{
+    return m_instructions;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Pins: GPIO, with GPIOTE tasks taking pins over.                          */
+/*---------------------------------------------------------------------------*/
+static uint32_t  m_levels;                  // what is on the pins
+static uint32_t  m_ext_mask;                // pins driven from outside
+static uint32_t  m_ext_levels;
+static uint32_t  m_gpiote_out [4];          // task channel outputs
+static bool      m_compare;                 // a timer's, through PPI: not traced
+
+#define GPIO    ((NRF_GPIO_Type *)   regs_host(NRF_GPIO))
+#define GPIOTE  ((NRF_GPIOTE_Type *) regs_host(NRF_GPIOTE))
+
+static int gpiote_task_channel(uint32_t pin)
+{
+    int n;
+
+    for (n = 0; n < 4; n++) {
+        uint32_t config = GPIOTE->CONFIG[n];
+        if ((config & 3) == GPIOTE_CONFIG_MODE_Task &&
+            ((config & GPIOTE_CONFIG_PSEL_Msk) >> GPIOTE_CONFIG_PSEL_Pos) == pin)
+            return n;
+    }
+    return -1;
+}
+
+static uint32_t pin_level(uint32_t pin)
+{
+    uint32_t bit = 1UL << pin;
+    uint32_t cnf = GPIO->PIN_CNF[pin];
+    int      n   = gpiote_task_channel(pin);
+
+    if (n >= 0)
+        return m_gpiote_out[n];
+    if (GPIO->DIR & bit)
+        return (GPIO->OUT & bit) ? 1 : 0;
+    if (m_ext_mask & bit)
+        return (m_ext_levels & bit) ? 1 : 0;
+
+    switch ((cnf >> GPIO_PIN_CNF_PULL_Pos) & 3) {
+        case GPIO_PIN_CNF_PULL_Pullup:   return 1;
+        case 1:                          return 0;     // pull down
+        default:                         return (m_levels & bit) ? 1 : 0;
+    }
+}
+
+/* Returns the pins that changed; outputs are traced, unless a timer toggled
+   them: a tone is thousands a second. */
+static uint32_t pins_update(void)
+{
+    uint32_t levels = 0;
+    uint32_t in     = 0;
+    uint32_t changed;
+    uint32_t pin;
+
+    for (pin = 0; pin < 32; pin++) {
+        levels |= pin_level(pin) << pin;
+        /* The input buffer is connected unless PIN_CNF says otherwise. */
+        if (((GPIO->PIN_CNF[pin] >> GPIO_PIN_CNF_INPUT_Pos) & 1) == GPIO_PIN_CNF_INPUT_Connect)
+            in |= levels & (1UL << pin);
+    }
+    SET(GPIO->IN, in);
+
+    changed  = levels ^ m_levels;
+    m_levels = levels;
+    if (changed) {
+        energy_pins(levels);
+        wave_pins(levels);
+    }
+
+    for (pin = 0; pin < 32 && !m_compare; pin++) {
+        if ((changed & ~m_ext_mask) & (1UL << pin))
+            trace("pin %u %u", (unsigned) pin, (unsigned) (levels >> pin) & 1);
+    }
+    return changed;
+}
+
+void regs_pin_drive(uint32_t pin, int level)
+{
+    uint32_t bit = 1UL << pin;
+    uint32_t before = m_levels;
+    uint32_t changed;
+
+    if (level < 0) {
+        m_ext_mask &= ~bit;
+    }
+    else {
+        m_ext_mask |= bit;
+        m_ext_levels = level ? (m_ext_levels | bit) : (m_ext_levels & ~bit);
+    }
+
+    changed = pins_update() & bit;
+    if (changed)
+        sdk_pins_changed(changed & m_levels, changed & before);
+}
+
+uint32_t regs_pins_in(void)
+{
+    return GPIO->IN;
+}
+
+static void gpio_write(uint32_t offset, uint32_t value)
+{
+    NRF_GPIO_Type * gpio = GPIO;
+
+    switch (offset) {
+        case offsetof(NRF_GPIO_Type, OUTSET):  gpio->OUT |= value;  break;
+        case offsetof(NRF_GPIO_Type, OUTCLR):  gpio->OUT &= ~value; break;
+        case offsetof(NRF_GPIO_Type, DIRSET):  gpio->DIR |= value;  break;
+        case offsetof(NRF_GPIO_Type, DIRCLR):  gpio->DIR &= ~value; break;
+        case offsetof(NRF_GPIO_Type, IN):      break;               // read only
+        default:
+            if (offset >= offsetof(NRF_GPIO_Type, PIN_CNF)) {
+                uint32_t pin = (offset - offsetof(NRF_GPIO_Type, PIN_CNF)) / 4;
+                if (value & (GPIO_PIN_CNF_DIR_Output << GPIO_PIN_CNF_DIR_Pos))
+                    gpio->DIR |= 1UL << pin;
+                else
+                    gpio->DIR &= ~(1UL << pin);
+            }
+            break;
+    }
+
+    /* The set and clear registers read back as OUT and DIR. */
+    gpio->OUTSET = gpio->OUTCLR = gpio->OUT;
+    gpio->DIRSET = gpio->DIRCLR = gpio->DIR;
+    if (offset >= offsetof(NRF_GPIO_Type, DIR) && offset <= offsetof(NRF_GPIO_Type, DIRCLR)) {
+        uint32_t pin;
+        for (pin = 0; pin < 32; pin++) {
+            gpio->PIN_CNF[pin] &= ~1UL;
+            gpio->PIN_CNF[pin] |= (gpio->DIR >> pin) & 1;
+        }
+    }
+
+    pins_update();
+}
+
+static void gpiote_write(uint32_t offset, uint32_t value)
+{
+    NRF_GPIOTE_Type * gpiote = GPIOTE;
+    uint32_t          n;
+
+    if (offset < sizeof(gpiote->TASKS_OUT)) {
+        n = offset / 4;
+        gpiote->TASKS_OUT[n] = 0;
+        if ((gpiote->CONFIG[n] & 3) != GPIOTE_CONFIG_MODE_Task)
+            return;
+        switch ((gpiote->CONFIG[n] >> GPIOTE_CONFIG_POLARITY_Pos) & 3) {
+            case GPIOTE_CONFIG_POLARITY_LoToHi:  m_gpiote_out[n] = 1;  break;
+            case GPIOTE_CONFIG_POLARITY_HiToLo:  m_gpiote_out[n] = 0;  break;
+            case GPIOTE_CONFIG_POLARITY_Toggle:  m_gpiote_out[n] ^= 1; break;
+        }
+        pins_update();
+    }
+    else if (offset >= offsetof(NRF_GPIOTE_Type, CONFIG) &&
+             offset <  offsetof(NRF_GPIOTE_Type, CONFIG) + sizeof(gpiote->CONFIG)) {
+        n = (offset - offsetof(NRF_GPIOTE_Type, CONFIG)) / 4;
+        m_gpiote_out[n] = (value >> GPIOTE_CONFIG_OUTINIT_Pos) & 1;
+        pins_update();
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  ADC: a conversion is done as soon as it is started.                      */
+/*---------------------------------------------------------------------------*/
+static void adc_write(uint32_t offset, uint32_t value)
+{
+    NRF_ADC_Type * adc = regs_host(NRF_ADC);
+    uint32_t       config = adc->CONFIG;
+    uint32_t       full, mv, ref;
+
+    if (offset == offsetof(NRF_ADC_Type, TASKS_STOP)) {
+        adc->TASKS_STOP = 0;
+        return;
+    }
+    if (offset != offsetof(NRF_ADC_Type, TASKS_START))
+        return;
+
+    adc->TASKS_START = 0;
+    if (adc->ENABLE != ADC_ENABLE_ENABLE_Enabled)
+        return;
+
+    full = (1UL << (8 + (config & 3))) - 1;
+
+    switch ((config >> ADC_CONFIG_INPSEL_Pos) & 7) {
+        case 5:  mv = g_regs_vbat_mv * 2 / 3; break;          // supply 2/3
+        case ADC_CONFIG_INPSEL_SupplyOneThirdPrescaling:
+                 mv = g_regs_vbat_mv / 3;     break;
+        default: mv = 0;                      break;          // no analog in
+    }
+    switch ((config >> ADC_CONFIG_REFSEL_Pos) & 3) {
+        case ADC_CONFIG_REFSEL_VBG:  ref = 1200;                   break;
+        case 2:                      ref = g_regs_vbat_mv / 2;     break;
+        default:                     ref = g_regs_vbat_mv / 3;     break;
+    }
+
+    SET(adc->RESULT, (mv >= ref) ? full : mv * full / ref);
+    adc->EVENTS_END = 1;
+    energy_adc(8 + (config & 3));
+    trace("adc %u", (unsigned) adc->RESULT);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Timers: the count is worked out from the time, and the next compare put  */
+/*  on the list.  When it comes due it sets EVENTS_COMPARE, runs the shorts  */
+/*  and fires the PPI channels listening: the LED and the buzzer toggle     */
+/*  their pins that way, with no code running.  INTEN is not modelled: the  */
+/*  firmware's timers never interrupt.                                       */
+/*                                                                           */
+/*  PAN-73 is held to: a compare only reaches GPIOTE while the timer's own  */
+/*  undocumented register at 0xC0C is 1, as the errata has it.               */
+/*---------------------------------------------------------------------------*/
+#define TIMER_PAN73     0xC0C
+
+static struct {
+    bool        running;
+    sim_time_t  since;                      // when the count was base
+    uint32_t    base;
+    bool        pan73_told;                 // since the start
+} m_timer [3];                              // TIMER0 is the SoftDevice's
+
+static const uint32_t  m_timer_mask [4] = { 0xFFFF, 0xFF, 0xFFFFFF, 0xFFFFFFFF };
+
+static NRF_TIMER_Type * timer_host(uint32_t n)
+{
+    return regs_host((volatile void *) (NRF_TIMER0_BASE + n * PAGE));
+}
+
+/* At 16 MHz >> PRESCALER: the first moment the count is ticks on. */
+static sim_time_t timer_ns(NRF_TIMER_Type * timer, uint64_t ticks)
+{
+    return (ticks * (1000ULL << (timer->PRESCALER & 0xF)) + 15) / 16;
+}
+
+static uint32_t timer_count(uint32_t n)
+{
+    NRF_TIMER_Type * timer = timer_host(n);
+    uint64_t         ticks = 0;
+
+    if (m_timer[n].running)
+        ticks = (g_sim_now - m_timer[n].since) * 16 / (1000ULL << (timer->PRESCALER & 0xF));
+
+    return (m_timer[n].base + ticks) & m_timer_mask[timer->BITMODE & 3];
+}
+
+static void timer_compare(uintptr_t n);
+
+/* The count taken from here, and the next compare due. */
+static void timer_schedule(uint32_t n)
+{
+    NRF_TIMER_Type * timer = timer_host(n);
+    uint64_t         wrap  = (uint64_t) m_timer_mask[timer->BITMODE & 3] + 1;
+    uint64_t         next  = wrap;
+    uint64_t         ticks;
+    uint32_t         i;
+
+    m_timer[n].base  = timer_count(n);
+    m_timer[n].since = g_sim_now;
+    sim_cancel(timer_compare, n);
+
+    if (!m_timer[n].running)
+        return;
+
+    /* A compare at the count now has just been: it is a wrap away. */
+    for (i = 0; i < 4; i++) {
+        ticks = (timer->CC[i] - m_timer[n].base) & (wrap - 1);
+        if (ticks == 0)
+            ticks = wrap;
+        if (ticks < next)
+            next = ticks;
+    }
+    sim_at(g_sim_now + timer_ns(timer, next), timer_compare, n);
+}
+
+static void timer_run(uint32_t n, bool running)
+{
+    if (m_timer[n].running != running)
+        energy_timer(n, running);
+    m_timer[n].running = running;
+}
+
+static void timer_compare(uintptr_t n)
+{
+    NRF_TIMER_Type * timer = timer_host(n);
+    NRF_PPI_Type   * ppi   = regs_host(NRF_PPI);
+    NRF_TIMER_Type * fw    = (NRF_TIMER_Type *) (NRF_TIMER0_BASE + n * PAGE);
+    uint32_t         count = timer_count(n);
+    uint32_t         fired = 0;
+    uint32_t         i, ch;
+
+    for (i = 0; i < 4; i++) {
+        if (timer->CC[i] == count) {
+            timer->EVENTS_COMPARE[i] = 1;
+            fired |= 1UL << i;
+        }
+    }
+
+    m_timer[n].base  = (timer->SHORTS & fired) ? 0 : count;       // COMPAREn_CLEAR
+    m_timer[n].since = g_sim_now;
+    if (timer->SHORTS & (fired << TIMER_SHORTS_COMPARE0_STOP_Pos))
+        timer_run(n, false);
+
+    m_compare = true;
+    for (i = 0; i < 4; i++) {
+        if (!(fired & (1UL << i)))
+            continue;
+        for (ch = 0; ch < 16; ch++) {
+            uint32_t tep = ppi->CH[ch].TEP;
+
+            if (!(ppi->CHEN & (1UL << ch)) ||
+                ppi->CH[ch].EEP != (uint32_t) (uintptr_t) &fw->EVENTS_COMPARE[i])
+                continue;
+            if (tep - NRF_GPIOTE_BASE < PAGE &&
+                *(volatile uint32_t *) ((uint8_t *) timer + TIMER_PAN73) != 1) {
+                if (!m_timer[n].pan73_told)
+                    trace("timer%u compare lost: PAN-73", (unsigned) n);
+                m_timer[n].pan73_told = true;
+                continue;
+            }
+            regs_write((volatile uint32_t *) (uintptr_t) tep, 1);
+        }
+    }
+    m_compare = false;
+
+    timer_schedule(n);
+}
+
+static void timer_write(uint32_t offset, uint32_t value)
+{
+    uint32_t         n     = (m_writing->base - NRF_TIMER0_BASE) / PAGE;
+    NRF_TIMER_Type * timer = (NRF_TIMER_Type *) m_writing->host;
+
+    m_timer[n].base  = timer_count(n);
+    m_timer[n].since = g_sim_now;
+
+    switch (offset) {
+        case offsetof(NRF_TIMER_Type, TASKS_START):
+            trace("%s start", m_writing->name);
+            timer_run(n, true);
+            m_timer[n].pan73_told = false;
+            break;
+        case offsetof(NRF_TIMER_Type, TASKS_SHUTDOWN):
+            m_timer[n].base = 0;
+            /* fall through */
+        case offsetof(NRF_TIMER_Type, TASKS_STOP):
+            trace("%s stop", m_writing->name);
+            timer_run(n, false);
+            break;
+        case offsetof(NRF_TIMER_Type, TASKS_CLEAR):
+            m_timer[n].base = 0;
+            break;
+        default:
+            if (offset >= offsetof(NRF_TIMER_Type, TASKS_CAPTURE) &&
+                offset <  offsetof(NRF_TIMER_Type, TASKS_CAPTURE) + sizeof(timer->TASKS_CAPTURE))
+                timer->CC[(offset - offsetof(NRF_TIMER_Type, TASKS_CAPTURE)) / 4] = m_timer[n].base;
+            break;
+    }
+    if (offset < offsetof(NRF_TIMER_Type, EVENTS_COMPARE))
+        *(volatile uint32_t *) ((uint8_t *) timer + offset) = 0;    // tasks
+
+    timer_schedule(n);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  PPI: channel enables set and cleared.                                    */
+/*---------------------------------------------------------------------------*/
+static void ppi_write(uint32_t offset, uint32_t value)
+{
+    NRF_PPI_Type * ppi = regs_host(NRF_PPI);
+
+    switch (offset) {
+        case offsetof(NRF_PPI_Type, CHENSET):  ppi->CHEN |= value;  break;
+        case offsetof(NRF_PPI_Type, CHENCLR):  ppi->CHEN &= ~value; break;
+        default:                                                    break;
+    }
+    ppi->CHENSET = ppi->CHENCLR = ppi->CHEN;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  NVMC: page erase; writes are plain memory, so it is always ready.        */
+/*---------------------------------------------------------------------------*/
+static void nvmc_write(uint32_t offset, uint32_t value)
+{
+    NRF_NVMC_Type * nvmc = regs_host(NRF_NVMC);
+
+    if (offset != offsetof(NRF_NVMC_Type, ERASEPAGE))
+        return;
+
+    if (nvmc->CONFIG != NVMC_CONFIG_WEN_Een ||
+        value % FLASH_PAGE_SIZE || value < FLASH_START || value >= FLASH_END) {
+        trace("nvmc erase 0x%x refused", (unsigned) value);
+        return;
+    }
+    memset((void *) (uintptr_t) value, 0xFF, FLASH_PAGE_SIZE);
+    trace("nvmc erase 0x%x", (unsigned) value);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  POWER: RESETREAS is write 1 to clear.                                    */
+/*---------------------------------------------------------------------------*/
+static uint32_t  m_resetreas;
+
+static void power_write(uint32_t offset, uint32_t value)
+{
+    NRF_POWER_Type * power = regs_host(NRF_POWER);
+
+    if (offset == offsetof(NRF_POWER_Type, RESETREAS)) {
+        m_resetreas &= ~value;
+        power->RESETREAS = m_resetreas;
+    }
+}
+
+void regs_reset_reason(uint32_t reason)
+{
+    NRF_POWER_Type * power = regs_host(NRF_POWER);
+
+    m_resetreas = reason;
+    power->RESETREAS = reason;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  System control: the reset request.                                       */
+/*---------------------------------------------------------------------------*/
+static void scs_write(uint32_t offset, uint32_t value)
+{
+    if (offset == SCB_BASE - SCS_BASE + offsetof(SCB_Type, AIRCR) &&
+        (value >> SCB_AIRCR_VECTKEY_Pos) == 0x05FA &&
+        (value & SCB_AIRCR_SYSRESETREQ_Msk))
+        sim_reset(POWER_RESETREAS_SREQ_Msk);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The core: interrupts are only ever taken in sd_app_evt_wait().           */
+/*---------------------------------------------------------------------------*/
+void NVIC_SystemReset(void)
+{
+    sim_reset(POWER_RESETREAS_SREQ_Msk);
+}
+
+void     __disable_irq(void)                  { }
+void     __enable_irq(void)                   { }
+uint32_t __get_PRIMASK(void)                  { return 0; }
+void     __set_PRIMASK(uint32_t primask)      { }
+void     __WFE(void)                          { }
+void     __SEV(void)                          { }
+
+/* Near the top of host_ram: diag_init() paints below it. */
+uint32_t __get_MSP(void)
+{
+    return (uint32_t) (uintptr_t) &host_ram[4096 - 64];
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void map(uintptr_t base, size_t size, int prot, int flags, int fd, off_t offset)
+{
+    void * p = mmap((void *) base, size, prot, flags | MAP_FIXED_NOREPLACE, fd, offset);
+
+    if (p != (void *) base) {
+        fprintf(stderr, "host: cannot map 0x%lx\n", (unsigned long) base);
+        exit(2);
+    }
+}
+
+void regs_init(void)
+{
+    struct sigaction sa;
+    NRF_FICR_Type  * ficr = NRF_FICR;
+    uint8_t        * host;
+    unsigned         i;
+    int              fd;
+
+    map(FLASH_START, FLASH_END - FLASH_START, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    memset((void *) FLASH_START, 0xFF, FLASH_END - FLASH_START);
+
+    for (i = 0; i < sizeof(m_plain) / sizeof(m_plain[0]); i++)
+        map(m_plain[i], PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    fd = memfd_create("regs", 0);
+    if (fd < 0 || ftruncate(fd, TRAPPED_COUNT * PAGE) != 0) {
+        perror("host: memfd");
+        exit(2);
+    }
+    host = mmap(NULL, TRAPPED_COUNT * PAGE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    for (i = 0; i < TRAPPED_COUNT; i++) {
+        m_trapped[i].host = host + i * PAGE;
+        map(m_trapped[i].base, PAGE, PROT_READ, MAP_SHARED, fd, i * PAGE);
+    }
+
+    /* nRF51822 QFAA: 256K of flash in 1K pages, 16K of RAM. */
+    SET(ficr->CODEPAGESIZE,   FLASH_PAGE_SIZE);
+    SET(ficr->CODESIZE,       FLASH_END / FLASH_PAGE_SIZE);
+    SET(ficr->CLENR0,         0xFFFFFFFF);
+    SET(ficr->NUMRAMBLOCK,    2);
+    SET(ficr->SIZERAMBLOCKS,  0x2000);
+    SET(ficr->DEVICEID[0],    0x12345678);
+    SET(ficr->DEVICEID[1],    0x9ABCDEF0);
+    for (i = 0; i < 4; i++) {
+        SET(ficr->ER[i],      0x11111111 * (i + 1));
+        SET(ficr->IR[i],      0x01020304 + 0x04040404 * i);
+    }
+    SET(ficr->DEVICEADDRTYPE, 1);
+    SET(ficr->DEVICEADDR[0],  0xC0FFEE42);
+    SET(ficr->DEVICEADDR[1],  0xFFFFF00D);
+    memset((void *) NRF_UICR_BASE, 0xFF, PAGE);
+
+    SET(((NRF_NVMC_Type *) regs_host(NRF_NVMC))->READY, NVMC_READY_READY_Ready);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_flags     = SA_SIGINFO;
+    sa.sa_sigaction = on_segv;
+    sigaction(SIGSEGV, &sa, NULL);
+    sa.sa_sigaction = on_trap;
+    sigaction(SIGTRAP, &sa, NULL);
+
+    pins_update();
+}
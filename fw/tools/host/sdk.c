@@ -0,0 +1,582 @@
+/*---------------------------------------------------------------------------*/
+/*  sdk.c   the SDK modules the firmware links against, on the host          */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The same API and the same rules as SDK 7.2, in as little code as the
+ *  firmware needs: app_timer on the RTC1 count, app_gpiote, the part of
+ *  pstorage the firmware uses (it writes through flash_queue.c), the
+ *  device manager without bonding, ble_conn_params, the radio notification
+ *  and the SoftDevice handler.
+ *
+ *  Each way into the firmware is the interrupt it would come in on, for
+ *  the counts in the summary.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "nrf_delay.h"
+#include "app_timer.h"
+#include "app_gpiote.h"
+#include "pstorage.h"
+#include "device_manager.h"
+#include "ble_conn_params.h"
+#include "ble_hci.h"
+#include "ble_radio_notification.h"
+#include "softdevice_handler.h"
+#include "crc16.h"
+
+#include "host.h"
+
+/*---------------------------------------------------------------------------*/
+/*  app_timer: RTC1, 24 bits.                                                */
+/*---------------------------------------------------------------------------*/
+#define APP_TIMER_MAX           16
+#define RTC_COUNTER_MASK        0x00FFFFFF
+
+typedef struct {
+    app_timer_mode_t             mode;
+    app_timer_timeout_handler_t  handler;
+    void                       * p_context;
+    uint32_t                     period;        // ticks, repeated timers
+    uint64_t                     expiry;        // ticks from power on
+} app_timer_t;
+
+static app_timer_t  m_timers [APP_TIMER_MAX];
+static uint8_t      m_timers_max;
+static uint8_t      m_timers_created;
+static uint32_t     m_prescaler;
+
+static void timer_expired(uintptr_t id)
+{
+    app_timer_t * p_timer = &m_timers[id];
+
+    /* Rearmed first: the handler may well stop it. */
+    if (p_timer->mode == APP_TIMER_MODE_REPEATED) {
+        p_timer->expiry += p_timer->period * (m_prescaler + 1);
+        sim_at(sim_ticks_time(p_timer->expiry), timer_expired, id);
+    }
+
+    sim_irq_enter(SIM_CTX_TIMER);
+    p_timer->handler(p_timer->p_context);
+    sim_irq_exit();
+}
+
+uint32_t app_timer_init(uint32_t prescaler, uint8_t max_timers, uint8_t op_queues_size,
+                        void * p_buffer, app_timer_evt_schedule_func_t evt_schedule_func)
+{
+    if (p_buffer == NULL || max_timers > APP_TIMER_MAX)
+        return NRF_ERROR_INVALID_PARAM;
+
+    m_prescaler      = prescaler;
+    m_timers_max     = max_timers;
+    m_timers_created = 0;
+
+    ((NRF_RTC_Type *) regs_host(NRF_RTC1))->PRESCALER = prescaler;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_create(app_timer_id_t * p_timer_id, app_timer_mode_t mode,
+                          app_timer_timeout_handler_t timeout_handler)
+{
+    if (timeout_handler == NULL || p_timer_id == NULL)
+        return NRF_ERROR_INVALID_PARAM;
+    if (m_timers_created == m_timers_max)
+        return NRF_ERROR_NO_MEM;
+
+    m_timers[m_timers_created].mode    = mode;
+    m_timers[m_timers_created].handler = timeout_handler;
+    *p_timer_id = m_timers_created++;
+    return NRF_SUCCESS;
+}
+
+/* Started again if it is running. */
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    app_timer_t * p_timer = &m_timers[timer_id];
+
+    if (timer_id >= m_timers_created)
+        return NRF_ERROR_INVALID_STATE;
+    if (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS || timeout_ticks > RTC_COUNTER_MASK)
+        return NRF_ERROR_INVALID_PARAM;
+
+    p_timer->p_context = p_context;
+    p_timer->period    = timeout_ticks;
+    p_timer->expiry    = sim_ticks(g_sim_now) + timeout_ticks * (m_prescaler + 1);
+
+    sim_cancel(timer_expired, timer_id);
+    sim_at(sim_ticks_time(p_timer->expiry), timer_expired, timer_id);
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop(app_timer_id_t timer_id)
+{
+    if (timer_id >= m_timers_created)
+        return NRF_ERROR_INVALID_STATE;
+
+    sim_cancel(timer_expired, timer_id);
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop_all(void)
+{
+    uint32_t id;
+
+    for (id = 0; id < m_timers_created; id++)
+        sim_cancel(timer_expired, id);
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(uint32_t * p_ticks)
+{
+    *p_ticks = ((NRF_RTC_Type *) regs_host(NRF_RTC1))->COUNTER;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from, uint32_t * p_ticks_diff)
+{
+    *p_ticks_diff = (ticks_to - ticks_from) & RTC_COUNTER_MASK;
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  app_gpiote: the PORT event, one interrupt for all users.                 */
+/*---------------------------------------------------------------------------*/
+#define GPIOTE_USERS_MAX        4
+
+typedef struct {
+    bool                        enabled;
+    uint32_t                    low_to_high;
+    uint32_t                    high_to_low;
+    app_gpiote_event_handler_t  handler;
+} gpiote_user_t;
+
+static gpiote_user_t  m_users [GPIOTE_USERS_MAX];
+static uint8_t        m_users_max;
+static uint8_t        m_users_count;
+
+uint32_t app_gpiote_init(uint8_t max_users, void * p_buffer)
+{
+    if (p_buffer == NULL || max_users > GPIOTE_USERS_MAX)
+        return NRF_ERROR_INVALID_PARAM;
+
+    m_users_max   = max_users;
+    m_users_count = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_gpiote_user_register(app_gpiote_user_id_t * p_user_id, uint32_t pins_low_to_high_mask,
+                                  uint32_t pins_high_to_low_mask, app_gpiote_event_handler_t event_handler)
+{
+    if (m_users_count == m_users_max)
+        return NRF_ERROR_NO_MEM;
+
+    m_users[m_users_count].enabled     = false;
+    m_users[m_users_count].low_to_high = pins_low_to_high_mask;
+    m_users[m_users_count].high_to_low = pins_high_to_low_mask;
+    m_users[m_users_count].handler     = event_handler;
+    *p_user_id = m_users_count++;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_gpiote_user_enable(app_gpiote_user_id_t user_id)
+{
+    if (user_id >= m_users_count)
+        return NRF_ERROR_INVALID_PARAM;
+    m_users[user_id].enabled = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_gpiote_user_disable(app_gpiote_user_id_t user_id)
+{
+    if (user_id >= m_users_count)
+        return NRF_ERROR_INVALID_PARAM;
+    m_users[user_id].enabled = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_gpiote_pins_state_get(app_gpiote_user_id_t user_id, uint32_t * p_pins)
+{
+    if (user_id >= m_users_count)
+        return NRF_ERROR_INVALID_PARAM;
+    *p_pins = regs_pins_in();
+    return NRF_SUCCESS;
+}
+
+/* An input changed level (regs.c). */
+void sdk_pins_changed(uint32_t low_to_high, uint32_t high_to_low)
+{
+    bool     entered = false;
+    uint8_t  i;
+
+    for (i = 0; i < m_users_count; i++) {
+        gpiote_user_t * p = &m_users[i];
+        uint32_t        l2h = low_to_high & p->low_to_high;
+        uint32_t        h2l = high_to_low & p->high_to_low;
+
+        if (!p->enabled || (l2h | h2l) == 0)
+            continue;
+        if (!entered) {
+            sim_irq_enter(SIM_CTX_GPIOTE);
+            entered = true;
+        }
+        p->handler(l2h, h2l);
+    }
+    if (entered)
+        sim_irq_exit();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  pstorage: pages handed out in the order of registration.                 */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    pstorage_ntf_cb_t  cb;
+    pstorage_size_t    block_size;
+    pstorage_size_t    block_count;
+    uint32_t           base;
+} pstorage_module_t;
+
+static pstorage_module_t  m_modules [PSTORAGE_MAX_APPLICATIONS];
+static uint32_t           m_modules_count;
+static uint32_t           m_next_page;
+
+uint32_t pstorage_init(void)
+{
+    m_modules_count = 0;
+    m_next_page     = PSTORAGE_DATA_START_ADDR;
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_register(pstorage_module_param_t * p_module_param, pstorage_handle_t * p_block_id)
+{
+    pstorage_module_param_t * p = p_module_param;
+    uint32_t                  size;
+
+    if (p->cb == NULL || p_block_id == NULL)
+        return NRF_ERROR_NULL;
+    if (m_modules_count == PSTORAGE_MAX_APPLICATIONS)
+        return NRF_ERROR_NO_MEM;
+    if (p->block_size < PSTORAGE_MIN_BLOCK_SIZE || p->block_size > PSTORAGE_MAX_BLOCK_SIZE ||
+        p->block_count == 0 || (p->block_size % 4) != 0)
+        return NRF_ERROR_INVALID_PARAM;
+
+    size = (uint32_t) p->block_size * p->block_count;
+    size = (size + PSTORAGE_FLASH_PAGE_SIZE - 1) / PSTORAGE_FLASH_PAGE_SIZE * PSTORAGE_FLASH_PAGE_SIZE;
+    if (m_next_page + size > PSTORAGE_DATA_END_ADDR)
+        return NRF_ERROR_NO_MEM;
+
+    m_modules[m_modules_count].cb          = p->cb;
+    m_modules[m_modules_count].block_size  = p->block_size;
+    m_modules[m_modules_count].block_count = p->block_count;
+    m_modules[m_modules_count].base        = m_next_page;
+
+    p_block_id->module_id = m_modules_count++;
+    p_block_id->block_id  = m_next_page;
+
+    m_next_page += size;
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_block_identifier_get(pstorage_handle_t * p_base_id, pstorage_size_t block_num,
+                                       pstorage_handle_t * p_block_id)
+{
+    pstorage_module_t * p_module;
+
+    if (p_base_id->module_id >= m_modules_count)
+        return NRF_ERROR_INVALID_PARAM;
+    p_module = &m_modules[p_base_id->module_id];
+    if (block_num >= p_module->block_count)
+        return NRF_ERROR_INVALID_PARAM;
+
+    p_block_id->module_id = p_base_id->module_id;
+    p_block_id->block_id  = p_module->base + (uint32_t) block_num * p_module->block_size;
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_load(uint8_t * p_dest, pstorage_handle_t * p_src, pstorage_size_t size,
+                       pstorage_size_t offset)
+{
+    if (p_src->module_id >= m_modules_count)
+        return NRF_ERROR_INVALID_PARAM;
+    if (size == 0 || (size % 4) != 0 || (offset % 4) != 0 ||
+        offset + size > m_modules[p_src->module_id].block_size)
+        return NRF_ERROR_INVALID_ADDR;
+
+    memcpy(p_dest, (const uint8_t *) (uintptr_t) (p_src->block_id + offset), size);
+    return NRF_SUCCESS;
+}
+
+/* The firmware writes through flash_queue.c: none of these are pstorage's. */
+void pstorage_sys_event_handler(uint32_t sys_evt)
+{
+}
+
+uint32_t pstorage_access_status_get(uint32_t * p_count)
+{
+    *p_count = 0;
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  device_manager: its page, and the connection events.  No bonds.          */
+/*---------------------------------------------------------------------------*/
+static pstorage_handle_t  m_dm_storage;
+static dm_event_cb_t      m_dm_handler;
+
+static void dm_pstorage_cb(pstorage_handle_t * p_handle, uint8_t op_code, uint32_t result,
+                           uint8_t * p_data, uint32_t data_len)
+{
+}
+
+uint32_t dm_init(dm_init_param_t const * p_init_param)
+{
+    pstorage_module_param_t param;
+
+    param.cb          = dm_pstorage_cb;
+    param.block_size  = PSTORAGE_FLASH_PAGE_SIZE;
+    param.block_count = 1;
+    return pstorage_register(&param, &m_dm_storage);
+}
+
+uint32_t dm_register(dm_application_instance_t * p_appl_instance,
+                     dm_application_param_t const * p_appl_param)
+{
+    if (m_dm_handler != NULL)
+        return NRF_ERROR_NO_MEM;
+
+    m_dm_handler     = p_appl_param->evt_handler;
+    *p_appl_instance = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t dm_ble_evt_handler(ble_evt_t * p_ble_evt)
+{
+    dm_handle_t handle = { 0, 0, DM_INVALID_ID, 0 };
+    dm_event_t  event;
+
+    memset(&event, 0, sizeof(event));
+    event.p_event_handle = &handle;
+
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_CONNECTED:     event.event_id = DM_EVT_CONNECTION;     break;
+        case BLE_GAP_EVT_DISCONNECTED:  event.event_id = DM_EVT_DISCONNECTION;  break;
+        default:                        return NRF_SUCCESS;
+    }
+    if (m_dm_handler != NULL)
+        m_dm_handler(&handle, &event, NRF_SUCCESS);
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  ble_conn_params: asks for the preferred interval until it gets it.      */
+/*---------------------------------------------------------------------------*/
+static ble_conn_params_init_t  m_cp_config;
+static ble_gap_conn_params_t   m_cp_preferred;
+static ble_gap_conn_params_t   m_cp_current;
+static uint16_t                m_cp_conn_handle = BLE_CONN_HANDLE_INVALID;
+static uint8_t                 m_cp_update_count;
+static app_timer_id_t          m_cp_timer_id;
+
+static void cp_event(ble_conn_params_evt_type_t type)
+{
+    ble_conn_params_evt_t evt;
+
+    if (type == BLE_CONN_PARAMS_EVT_FAILED && m_cp_config.disconnect_on_fail) {
+        uint32_t err_code = sd_ble_gap_disconnect(m_cp_conn_handle,
+                                                  BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
+        if (err_code != NRF_SUCCESS && m_cp_config.error_handler != NULL)
+            m_cp_config.error_handler(err_code);
+        return;
+    }
+    if (m_cp_config.evt_handler != NULL) {
+        evt.evt_type = type;
+        m_cp_config.evt_handler(&evt);
+    }
+}
+
+static void cp_negotiate(void)
+{
+    uint32_t delay;
+
+    if (m_cp_current.max_conn_interval >= m_cp_preferred.min_conn_interval &&
+        m_cp_current.max_conn_interval <= m_cp_preferred.max_conn_interval) {
+        cp_event(BLE_CONN_PARAMS_EVT_SUCCEEDED);
+        return;
+    }
+    delay = (m_cp_update_count == 0) ? m_cp_config.first_conn_params_update_delay
+                                     : m_cp_config.next_conn_params_update_delay;
+    APP_ERROR_CHECK( app_timer_start(m_cp_timer_id, delay, NULL) );
+}
+
+static void cp_timeout_handler(void * p_context)
+{
+    uint32_t err_code;
+
+    if (m_cp_conn_handle == BLE_CONN_HANDLE_INVALID)
+        return;
+
+    if (m_cp_update_count < m_cp_config.max_conn_params_update_count) {
+        m_cp_update_count++;
+        err_code = sd_ble_gap_conn_param_update(m_cp_conn_handle, &m_cp_preferred);
+        if (err_code != NRF_SUCCESS && m_cp_config.error_handler != NULL)
+            m_cp_config.error_handler(err_code);
+    }
+    else {
+        cp_event(BLE_CONN_PARAMS_EVT_FAILED);
+    }
+}
+
+uint32_t ble_conn_params_init(const ble_conn_params_init_t * p_init)
+{
+    uint32_t err_code;
+
+    m_cp_config = *p_init;
+
+    if (p_init->p_conn_params != NULL) {
+        m_cp_preferred = *p_init->p_conn_params;
+        err_code = sd_ble_gap_ppcp_set(&m_cp_preferred);
+    }
+    else {
+        err_code = sd_ble_gap_ppcp_get(&m_cp_preferred);
+    }
+    if (err_code != NRF_SUCCESS)
+        return err_code;
+
+    return app_timer_create(&m_cp_timer_id, APP_TIMER_MODE_SINGLE_SHOT, cp_timeout_handler);
+}
+
+void ble_conn_params_on_ble_evt(ble_evt_t * p_ble_evt)
+{
+    switch (p_ble_evt->header.evt_id) {
+
+        case BLE_GAP_EVT_CONNECTED:
+            m_cp_conn_handle  = p_ble_evt->evt.gap_evt.conn_handle;
+            m_cp_current      = p_ble_evt->evt.gap_evt.params.connected.conn_params;
+            m_cp_update_count = 0;
+            cp_negotiate();
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            m_cp_conn_handle = BLE_CONN_HANDLE_INVALID;
+            APP_ERROR_CHECK( app_timer_stop(m_cp_timer_id) );
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            m_cp_current = p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params;
+            cp_negotiate();
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Radio notification, SWI1.                                                */
+/*---------------------------------------------------------------------------*/
+static ble_radio_notification_evt_handler_t  m_radio_handler;
+
+uint32_t ble_radio_notification_init(nrf_app_irq_priority_t irq_priority,
+                                     nrf_radio_notification_distance_t distance,
+                                     ble_radio_notification_evt_handler_t evt_handler)
+{
+    m_radio_handler = evt_handler;
+    return sd_radio_notification_cfg_set(NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH, distance);
+}
+
+void sdk_radio_notification(bool active)
+{
+    if (m_radio_handler == NULL)
+        return;
+
+    sim_irq_enter(SIM_CTX_RADIO);
+    m_radio_handler(active);
+    sim_irq_exit();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  SoftDevice handler, SWI2: BLE and SoC events.                            */
+/*---------------------------------------------------------------------------*/
+static ble_evt_handler_t  m_ble_handler;
+static sys_evt_handler_t  m_sys_handler;
+
+uint32_t softdevice_handler_init(nrf_clock_lfclksrc_t clock_source, void * p_evt_buffer,
+                                 uint16_t evt_buffer_size,
+                                 softdevice_evt_schedule_func_t evt_schedule_func)
+{
+    if (p_evt_buffer == NULL)
+        return NRF_ERROR_INVALID_PARAM;
+    return sd_softdevice_enable(clock_source, NULL);
+}
+
+uint32_t softdevice_handler_sd_disable(void)
+{
+    return sd_softdevice_disable();
+}
+
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler)
+{
+    if (ble_evt_handler == NULL)
+        return NRF_ERROR_NULL;
+    m_ble_handler = ble_evt_handler;
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler)
+{
+    if (sys_evt_handler == NULL)
+        return NRF_ERROR_NULL;
+    m_sys_handler = sys_evt_handler;
+    return NRF_SUCCESS;
+}
+
+void sdk_ble_evt(void * p_ble_evt)
+{
+    if (m_ble_handler == NULL)
+        return;
+
+    sim_irq_enter(SIM_CTX_BLE);
+    m_ble_handler((ble_evt_t *) p_ble_evt);
+    sim_irq_exit();
+}
+
+void sdk_sys_evt(uint32_t evt_id)
+{
+    if (m_sys_handler == NULL)
+        return;
+
+    sim_irq_enter(SIM_CTX_SOC);
+    m_sys_handler(evt_id);
+    sim_irq_exit();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  crc16 (CCITT, as the SDK computes it) and nrf_delay.                     */
+/*---------------------------------------------------------------------------*/
+uint16_t crc16_compute(const uint8_t * p_data, uint32_t size, const uint16_t * p_crc)
+{
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        crc  = (uint8_t) (crc >> 8) | (crc << 8);
+        crc ^= p_data[i];
+        crc ^= (uint8_t) (crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+    return crc;
+}
+
+void nrf_delay_us(uint32_t volatile number_of_us)
+{
+    sim_busy(SIM_US(number_of_us));
+}
+
+void nrf_delay_ms(uint32_t volatile number_of_ms)
+{
+    sim_busy(SIM_MS(number_of_ms));
+}
@@ -0,0 +1,228 @@
+/*---------------------------------------------------------------------------*/
+/*  sim.c   simulated time: the things due, and the calls into the firmware */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Nothing happens between the things due: time jumps from one to the
+ *  next, and RTC1->COUNTER, which the firmware reads directly, with it.
+ *  The list is short (a few timers, the next radio event, a flash job),
+ *  so it is kept unsorted and scanned.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nrf51.h"
+
+#include "host.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#define SIM_EVENTS_MAX      64
+#define SIM_CTX_DEPTH       4
+
+typedef struct {
+    sim_time_t     when;
+    uint64_t       seq;             // ties go in the order asked for
+    sim_handler_t  handler;
+    uintptr_t      arg;
+} sim_event_t;
+
+static sim_event_t  m_events [SIM_EVENTS_MAX];
+static uint32_t     m_count;
+static uint64_t     m_seq;
+
+sim_time_t          g_sim_now;
+
+uint32_t            g_sim_seed = 1;
+
+/*---------------------------------------------------------------------------*/
+/*  32768 ticks a second, counted from power on so they never drift.        */
+/*---------------------------------------------------------------------------*/
+uint64_t sim_ticks(sim_time_t t)
+{
+    return (t / 1000000000) * 32768 + (t % 1000000000) * 32768 / 1000000000;
+}
+
+/* The first moment the counter reads ticks. */
+sim_time_t sim_ticks_time(uint64_t ticks)
+{
+    return (ticks / 32768) * 1000000000 + ((ticks % 32768) * 1000000000 + 32767) / 32768;
+}
+
+static void clock_update(void)
+{
+    NRF_RTC_Type * rtc = regs_host(NRF_RTC1);
+
+    *(volatile uint32_t *) &rtc->COUNTER = sim_ticks(g_sim_now) & 0x00FFFFFF;
+}
+
+void sim_time_set(sim_time_t t)
+{
+    g_sim_now = t;
+    clock_update();
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void sim_at(sim_time_t when, sim_handler_t handler, uintptr_t arg)
+{
+    if (m_count == SIM_EVENTS_MAX) {
+        fprintf(stderr, "host: more than %d things due\n", SIM_EVENTS_MAX);
+        exit(2);
+    }
+    m_events[m_count].when    = (when < g_sim_now) ? g_sim_now : when;
+    m_events[m_count].seq     = m_seq++;
+    m_events[m_count].handler = handler;
+    m_events[m_count].arg     = arg;
+    m_count++;
+}
+
+void sim_cancel(sim_handler_t handler, uintptr_t arg)
+{
+    uint32_t i = 0;
+
+    while (i < m_count) {
+        if (m_events[i].handler == handler && m_events[i].arg == arg)
+            m_events[i] = m_events[--m_count];
+        else
+            i++;
+    }
+}
+
+static int sim_first(void)
+{
+    int      first = -1;
+    uint32_t i;
+
+    for (i = 0; i < m_count; i++) {
+        if (first < 0 || m_events[i].when < m_events[first].when ||
+            (m_events[i].when == m_events[first].when && m_events[i].seq < m_events[first].seq))
+            first = i;
+    }
+    return first;
+}
+
+sim_time_t sim_next(void)
+{
+    int first = sim_first();
+
+    return (first < 0) ? SIM_NEVER : m_events[first].when;
+}
+
+bool sim_step(sim_time_t limit)
+{
+    int         first = sim_first();
+    sim_event_t event;
+
+    if (first < 0 || m_events[first].when > limit)
+        return false;
+
+    event = m_events[first];
+    m_events[first] = m_events[--m_count];
+
+    sim_time_set(event.when);
+    event.handler(event.arg);
+    return true;
+}
+
+/* The CPU spinning: what comes due meanwhile waits until it is done. */
+void sim_busy(sim_time_t duration)
+{
+    sim_time_set(g_sim_now + duration);
+}
+
+/* xorshift32: the same run for the same seed. */
+uint32_t sim_rand(void)
+{
+    g_sim_seed ^= g_sim_seed << 13;
+    g_sim_seed ^= g_sim_seed >> 17;
+    g_sim_seed ^= g_sim_seed << 5;
+    return g_sim_seed;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Per context: calls, and with -c the firmware instructions in them.  An   */
+/*  interrupt inside another pauses the count of the one it interrupted.     */
+/*  Counting single-steps, so -e only counts a sample of the calls.          */
+/*---------------------------------------------------------------------------*/
+sim_ctx_stats_t  g_sim_ctx [SIM_CTX_COUNT];
+
+const char *     g_sim_ctx_names [SIM_CTX_COUNT] = {
+    "boot", "main", "radio", "ble", "soc", "timer", "gpiote",
+};
+
+bool             g_sim_woken;
+bool             g_sim_count;           // -c
+uint32_t         g_sim_sample;
+
+static struct {
+    sim_ctx_t  ctx;
+    bool       counted;
+    uint64_t   start;                   // regs_instructions() at entry
+    uint64_t   done;                    // before an interrupt took over
+} m_stack [SIM_CTX_DEPTH];
+
+static uint32_t  m_depth;
+
+void sim_irq_enter(sim_ctx_t ctx)
+{
+    uint64_t now = regs_instructions();
+
+    if (m_depth == SIM_CTX_DEPTH) {
+        fprintf(stderr, "host: interrupts nested too deep\n");
+        exit(2);
+    }
+    if (m_depth > 0)
+        m_stack[m_depth - 1].done += now - m_stack[m_depth - 1].start;
+
+    g_sim_ctx[ctx].calls++;
+
+    m_stack[m_depth].ctx     = ctx;
+    m_stack[m_depth].counted = g_sim_sample && (g_sim_ctx[ctx].calls - 1) % g_sim_sample == 0;
+    m_stack[m_depth].start   = now;
+    m_stack[m_depth].done    = 0;
+
+    if (m_stack[m_depth].counted || g_regs_counting)
+        regs_count(m_stack[m_depth].counted);
+    m_depth++;
+}
+
+void sim_irq_exit(void)
+{
+    uint64_t          now;
+    uint64_t          used;
+    sim_ctx_stats_t * p_stats;
+
+    if (g_regs_counting)
+        regs_count(false);
+
+    now = regs_instructions();
+
+    if (m_depth == 0) {
+        fprintf(stderr, "host: interrupt exit without its entry\n");
+        exit(2);
+    }
+    m_depth--;
+    used    = m_stack[m_depth].done + now - m_stack[m_depth].start;
+    p_stats = &g_sim_ctx[m_stack[m_depth].ctx];
+
+    if (m_stack[m_depth].counted) {
+        p_stats->counted++;
+        p_stats->instructions += used;
+        if (used > p_stats->max)
+            p_stats->max = used;
+    }
+
+    if (m_depth > 0) {
+        m_stack[m_depth - 1].start = now;
+        if (m_stack[m_depth - 1].counted)
+            regs_count(true);
+    }
+
+    if (m_stack[m_depth].ctx != SIM_CTX_MAIN && m_stack[m_depth].ctx != SIM_CTX_BOOT)
+        g_sim_woken = true;
+}
@@ -0,0 +1,1220 @@
+/*---------------------------------------------------------------------------*/
+/*  softdevice.c   a stand-in for the S110 SoftDevice, in simulated time    */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Enough of S110 for this firmware, kept to what the firmware can see:
+ *
+ *  - Advertising: one event every interval plus advDelay (0-10 ms), the
+ *    PDU sent on three channels with whatever adv data is set when it
+ *    goes out.  Radio notifications come the configured distance before
+ *    each event and when it is over.  A connectable advertiser times out.
+ *  - Connections come from the script.  Connection events raise the radio
+ *    notifications too, and give notifications their TX buffers back.
+ *  - The GATT server: a table of attributes, values where the firmware
+ *    asked for them, writes from the script as BLE_GATTS_EVT_WRITE.
+ *  - Flash writes and erases complete later with a SoC event, and only
+ *    ever clear bits, like the NVMC.
+ *  - Random numbers are repeatable (-s), the ECB is real AES-128.
+ *
+ *  Events go to the firmware through the SDK's softdevice_handler (sdk.c),
+ *  each from the list of things due, never from inside an sd_*() call.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nordic_common.h"
+#include "nrf51.h"
+#include "nrf_soc.h"
+#include "nrf_sdm.h"
+#include "ble.h"
+#include "ble_gap.h"
+#include "ble_gatts.h"
+#include "ble_hci.h"
+
+#include "host.h"
+
+/*---------------------------------------------------------------------------*/
+/*  Radio timing: 1 Mbps, nRF51 and Bluetooth 4.1 figures.                   */
+/*---------------------------------------------------------------------------*/
+#define ADV_DELAY_MAX_US        10000   // advDelay
+#define ADV_FIRST_US            250     // start to the first event's notification
+#define RADIO_RAMP_US           140     // TX ramp up, per channel
+#define RADIO_US_PER_BYTE       8
+#define ADV_PDU_OVERHEAD        16      // preamble, access address, header, AdvA, CRC
+#define ADV_LISTEN_US           200     // after ADV_IND, for a request
+#define CONN_EVENT_US           400     // empty packets both ways
+#define CONN_TX_US              220     // of it, ramp up and our packet
+#define HFCLK_START_US          800     // 16 MHz crystal
+#define FLASH_WORD_US           46      // t_WRITE
+#define FLASH_ERASE_US          22300   // t_ERASEPAGE
+
+#define TX_BUFFERS              7
+#define EVT_BUF_WORDS           ((sizeof(ble_evt_t) + BLE_GATTS_VAR_ATTR_LEN_MAX + 3) / 4)
+#define EVT_QUEUE_SIZE          16
+
+static const uint16_t  m_distances_us [] = { 0, 800, 1740, 2680, 3620, 4560, 5500 };
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static struct {
+    bool                  on;
+    ble_gap_adv_params_t  params;
+    uint8_t               data [BLE_GAP_ADV_MAX_SIZE];
+    uint8_t               len;
+    uint8_t               sr_data [BLE_GAP_ADV_MAX_SIZE];
+    uint8_t               sr_len;
+    sim_time_t            next;         // the next event's TX
+} m_adv;
+
+static struct {
+    uint16_t               handle;      // BLE_CONN_HANDLE_INVALID when not
+    ble_gap_conn_params_t  params;
+    sim_time_t             next;
+    uint8_t                tx_free;
+    uint8_t                tx_sent;
+    bool                   disconnecting;
+    uint8_t                reason;
+} m_conn = { .handle = BLE_CONN_HANDLE_INVALID };
+
+static ble_gap_conn_params_t  m_ppcp;
+static ble_gap_addr_t         m_addr;
+static int8_t                 m_tx_power;
+
+static uint8_t   m_notify_type;
+static uint8_t   m_notify_distance;
+static bool      m_radio_active;            // told the firmware so
+
+static bool      m_hfclk_requested;
+static bool      m_hfclk_running;
+
+static uint8_t   m_critical;
+
+int32_t          g_sd_temp = 25 * 4;
+
+/* What waits for the firmware's handlers. */
+static uint32_t  m_ble_queue [EVT_QUEUE_SIZE][EVT_BUF_WORDS];
+static uint8_t   m_ble_head, m_ble_count;
+static uint32_t  m_sys_queue [EVT_QUEUE_SIZE];
+static uint8_t   m_sys_head, m_sys_count;
+
+/* One flash operation at a time. */
+static struct {
+    bool              busy;
+    uint32_t        * p_dst;
+    const uint32_t  * p_src;            // NULL for an erase
+    uint32_t          words;
+} m_flash;
+
+/*---------------------------------------------------------------------------*/
+/*  Events to the firmware.                                                  */
+/*---------------------------------------------------------------------------*/
+static void ble_deliver(uintptr_t arg)
+{
+    ble_evt_t * p_evt = (ble_evt_t *) m_ble_queue[m_ble_head];
+
+    m_ble_head = (m_ble_head + 1) % EVT_QUEUE_SIZE;
+    m_ble_count--;
+    sdk_ble_evt(p_evt);
+}
+
+/* Zeroed, header filled in; the caller fills the rest before returning. */
+static ble_evt_t * ble_evt_new(uint16_t evt_id, uint16_t len)
+{
+    ble_evt_t * p_evt;
+
+    if (m_ble_count == EVT_QUEUE_SIZE) {
+        fprintf(stderr, "host: BLE event queue full\n");
+        exit(2);
+    }
+    p_evt = (ble_evt_t *) m_ble_queue[(m_ble_head + m_ble_count++) % EVT_QUEUE_SIZE];
+    memset(p_evt, 0, sizeof(m_ble_queue[0]));
+    p_evt->header.evt_id  = evt_id;
+    p_evt->header.evt_len = len;
+
+    sim_at(g_sim_now, ble_deliver, 0);
+    return p_evt;
+}
+
+static void sys_deliver(uintptr_t arg)
+{
+    uint32_t evt_id = m_sys_queue[m_sys_head];
+
+    m_sys_head = (m_sys_head + 1) % EVT_QUEUE_SIZE;
+    m_sys_count--;
+    sdk_sys_evt(evt_id);
+}
+
+static void sys_evt(uint32_t evt_id)
+{
+    m_sys_queue[(m_sys_head + m_sys_count++) % EVT_QUEUE_SIZE] = evt_id;
+    sim_at(g_sim_now, sys_deliver, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Radio notifications, around every advertising and connection event.      */
+/*---------------------------------------------------------------------------*/
+static void radio_notify(uintptr_t active)
+{
+    uint8_t want = active ? NRF_RADIO_NOTIFICATION_TYPE_INT_ON_ACTIVE
+                          : NRF_RADIO_NOTIFICATION_TYPE_INT_ON_INACTIVE;
+
+    m_radio_active = active;
+    if (m_notify_type == want || m_notify_type == NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH)
+        sdk_radio_notification(active);
+}
+
+static sim_time_t radio_distance(void)
+{
+    return SIM_US(m_distances_us[m_notify_distance]);
+}
+
+/* An event's TX at when: the notification goes ahead of it. */
+static void radio_event_at(sim_time_t when, sim_handler_t event)
+{
+    if (m_notify_type != NRF_RADIO_NOTIFICATION_TYPE_NONE)
+        sim_at(when - radio_distance(), radio_notify, 1);
+    sim_at(when, event, 0);
+}
+
+/* A stop between the notification and the end: the firmware hears the end. */
+static void radio_event_cancel(sim_handler_t event, sim_handler_t end)
+{
+    sim_cancel(radio_notify, 1);
+    sim_cancel(event, 0);
+    sim_cancel(end, 0);
+    if (m_radio_active)
+        sim_at(g_sim_now, radio_notify, 0);
+}
+
+void sd_host_radio(bool active)
+{
+    radio_notify(active);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Advertising.                                                             */
+/*---------------------------------------------------------------------------*/
+static const char * adv_type_name(uint8_t type)
+{
+    switch (type) {
+        case BLE_GAP_ADV_TYPE_ADV_IND:          return "ADV_IND";
+        case BLE_GAP_ADV_TYPE_ADV_DIRECT_IND:   return "ADV_DIRECT_IND";
+        case BLE_GAP_ADV_TYPE_ADV_SCAN_IND:     return "ADV_SCAN_IND";
+        default:                                return "ADV_NONCONN_IND";
+    }
+}
+
+static uint32_t adv_channels(void)
+{
+    return 3 - m_adv.params.channel_mask.ch_37_off
+             - m_adv.params.channel_mask.ch_38_off
+             - m_adv.params.channel_mask.ch_39_off;
+}
+
+/* On air, all channels: the PDU each time, and the wait for a request. */
+static uint32_t adv_event_us(void)
+{
+    uint32_t us = RADIO_RAMP_US + (ADV_PDU_OVERHEAD + m_adv.len) * RADIO_US_PER_BYTE;
+
+    if (m_adv.params.type != BLE_GAP_ADV_TYPE_ADV_NONCONN_IND)
+        us += ADV_LISTEN_US;
+    return us * adv_channels();
+}
+
+static void adv_end(uintptr_t arg);
+
+static void adv_tx(uintptr_t arg)
+{
+    char    hex [2 * BLE_GAP_ADV_MAX_SIZE + 1];
+    uint8_t i;
+
+    if (trace_wanted()) {
+        for (i = 0; i < m_adv.len; i++)
+            sprintf(&hex[2 * i], "%02x", m_adv.data[i]);
+        hex[2 * m_adv.len] = '\0';
+        trace("adv %s %u %s", adv_type_name(m_adv.params.type), m_adv.len, hex);
+    }
+    energy_radio(ENERGY_ADV, adv_event_us(),
+                 (RADIO_RAMP_US + (ADV_PDU_OVERHEAD + m_adv.len) * RADIO_US_PER_BYTE) * adv_channels(),
+                 (m_adv.params.type != BLE_GAP_ADV_TYPE_ADV_NONCONN_IND) ? ADV_LISTEN_US * adv_channels() : 0,
+                 m_tx_power);
+    sim_at(g_sim_now + SIM_US(adv_event_us()), adv_end, 0);
+}
+
+static void adv_end(uintptr_t arg)
+{
+    radio_notify(0);
+
+    m_adv.next = g_sim_now - SIM_US(adv_event_us())
+               + SIM_US(m_adv.params.interval * 625)
+               + SIM_US(sim_rand() % (ADV_DELAY_MAX_US + 1));
+    radio_event_at(m_adv.next, adv_tx);
+}
+
+static void adv_stop(void)
+{
+    m_adv.on = false;
+    radio_event_cancel(adv_tx, adv_end);
+}
+
+static void adv_timeout(uintptr_t arg)
+{
+    ble_evt_t * p_evt;
+
+    adv_stop();
+    trace("adv timeout");
+
+    p_evt = ble_evt_new(BLE_GAP_EVT_TIMEOUT, sizeof(ble_gap_evt_t));
+    p_evt->evt.gap_evt.conn_handle        = BLE_CONN_HANDLE_INVALID;
+    p_evt->evt.gap_evt.params.timeout.src = BLE_GAP_TIMEOUT_SRC_ADVERTISEMENT;
+}
+
+/* Each AD structure fits; it is what a scanner would choke on. */
+static bool adv_data_valid(const uint8_t * p_data, uint8_t len)
+{
+    uint8_t i = 0;
+
+    while (i < len) {
+        if (p_data[i] == 0 || i + 1 + p_data[i] > len)
+            return false;
+        i += 1 + p_data[i];
+    }
+    return true;
+}
+
+uint32_t sd_ble_gap_adv_data_set(uint8_t const * const p_data, uint8_t dlen,
+                                 uint8_t const * const p_sr_data, uint8_t srdlen)
+{
+    if (dlen > BLE_GAP_ADV_MAX_SIZE || srdlen > BLE_GAP_ADV_MAX_SIZE)
+        return NRF_ERROR_INVALID_LENGTH;
+    if ((dlen && p_data == NULL) || (srdlen && p_sr_data == NULL))
+        return NRF_ERROR_INVALID_ADDR;
+    if (!adv_data_valid(p_data, dlen) || !adv_data_valid(p_sr_data, srdlen))
+        return NRF_ERROR_INVALID_DATA;
+
+    if (p_data != NULL) {
+        memcpy(m_adv.data, p_data, dlen);
+        m_adv.len = dlen;
+    }
+    if (p_sr_data != NULL) {
+        memcpy(m_adv.sr_data, p_sr_data, srdlen);
+        m_adv.sr_len = srdlen;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_adv_start(ble_gap_adv_params_t const * const p_adv_params)
+{
+    const ble_gap_adv_params_t * p = p_adv_params;
+    uint16_t                     min;
+
+    if (p == NULL)
+        return NRF_ERROR_INVALID_ADDR;
+    if (m_adv.on || (m_conn.handle != BLE_CONN_HANDLE_INVALID &&
+                     p->type != BLE_GAP_ADV_TYPE_ADV_NONCONN_IND))
+        return NRF_ERROR_INVALID_STATE;
+
+    min = (p->type == BLE_GAP_ADV_TYPE_ADV_IND) ? BLE_GAP_ADV_INTERVAL_MIN
+                                                : BLE_GAP_ADV_NONCON_INTERVAL_MIN;
+    if (p->type > BLE_GAP_ADV_TYPE_ADV_NONCONN_IND ||
+        p->interval < min || p->interval > BLE_GAP_ADV_INTERVAL_MAX ||
+        p->timeout > BLE_GAP_ADV_TIMEOUT_LIMITED_MAX ||
+        (p->channel_mask.ch_37_off && p->channel_mask.ch_38_off && p->channel_mask.ch_39_off))
+        return NRF_ERROR_INVALID_PARAM;
+
+    m_adv.on     = true;
+    m_adv.params = *p;
+    m_adv.next   = g_sim_now + SIM_US(ADV_FIRST_US) + radio_distance();
+
+    trace("adv start %s %u ms%s", adv_type_name(p->type),
+          (unsigned) (p->interval * 625 / 1000), p->timeout ? ", timeout" : "");
+
+    radio_event_at(m_adv.next, adv_tx);
+    if (p->timeout)
+        sim_at(g_sim_now + SIM_MS(p->timeout * 1000), adv_timeout, 0);
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_adv_stop(void)
+{
+    if (!m_adv.on)
+        return NRF_ERROR_INVALID_STATE;
+
+    adv_stop();
+    sim_cancel(adv_timeout, 0);
+    trace("adv stop");
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Connections.                                                             */
+/*---------------------------------------------------------------------------*/
+static void conn_end(uintptr_t arg);
+
+static void conn_event(uintptr_t arg)
+{
+    ble_evt_t * p_evt;
+
+    if (m_conn.disconnecting) {
+        radio_notify(0);
+        m_conn.handle        = BLE_CONN_HANDLE_INVALID;
+        m_conn.disconnecting = false;
+        trace("disconnected 0x%02x", m_conn.reason);
+
+        p_evt = ble_evt_new(BLE_GAP_EVT_DISCONNECTED, sizeof(ble_gap_evt_t));
+        p_evt->evt.gap_evt.conn_handle = 0;
+        p_evt->evt.gap_evt.params.disconnected.reason = m_conn.reason;
+        return;
+    }
+
+    if (m_conn.tx_sent) {
+        p_evt = ble_evt_new(BLE_EVT_TX_COMPLETE, sizeof(ble_common_evt_t));
+        p_evt->evt.common_evt.conn_handle = 0;
+        p_evt->evt.common_evt.params.tx_complete.count = m_conn.tx_sent;
+        m_conn.tx_free += m_conn.tx_sent;
+        m_conn.tx_sent  = 0;
+    }
+    energy_radio(ENERGY_CONN, CONN_EVENT_US, CONN_TX_US, CONN_EVENT_US - CONN_TX_US, m_tx_power);
+    sim_at(g_sim_now + SIM_US(CONN_EVENT_US), conn_end, 0);
+}
+
+static void conn_end(uintptr_t arg)
+{
+    radio_notify(0);
+
+    m_conn.next = g_sim_now - SIM_US(CONN_EVENT_US)
+                + SIM_US(m_conn.params.max_conn_interval * 1250);
+    radio_event_at(m_conn.next, conn_event);
+}
+
+static void gatts_connected(void);
+
+bool sd_host_connect(uint32_t interval_ms)
+{
+    ble_evt_t * p_evt;
+
+    if (!m_adv.on || m_adv.params.type == BLE_GAP_ADV_TYPE_ADV_NONCONN_IND)
+        return false;
+
+    adv_stop();
+    sim_cancel(adv_timeout, 0);
+
+    m_conn.handle  = 0;
+    m_conn.tx_free = TX_BUFFERS;
+    m_conn.tx_sent = 0;
+    m_conn.params.min_conn_interval = interval_ms ? (interval_ms * 4 + 4) / 5
+                                                  : m_ppcp.max_conn_interval;
+    m_conn.params.max_conn_interval = m_conn.params.min_conn_interval;
+    m_conn.params.slave_latency     = 0;
+    m_conn.params.conn_sup_timeout  = 400;         // 4 s
+    gatts_connected();
+
+    trace("connected, %u.%02u ms", m_conn.params.max_conn_interval * 125 / 100,
+          m_conn.params.max_conn_interval * 125 % 100);
+
+    p_evt = ble_evt_new(BLE_GAP_EVT_CONNECTED, sizeof(ble_gap_evt_t));
+    p_evt->evt.gap_evt.conn_handle = 0;
+    p_evt->evt.gap_evt.params.connected.peer_addr.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+    memcpy(p_evt->evt.gap_evt.params.connected.peer_addr.addr, "\x01\x02\x03\x04\x05\xC6", 6);
+    p_evt->evt.gap_evt.params.connected.conn_params = m_conn.params;
+
+    m_conn.next = g_sim_now + SIM_US(m_conn.params.max_conn_interval * 1250);
+    radio_event_at(m_conn.next, conn_event);
+    return true;
+}
+
+/* The peer goes away: at the next connection event. */
+bool sd_host_disconnect(void)
+{
+    if (m_conn.handle == BLE_CONN_HANDLE_INVALID || m_conn.disconnecting)
+        return false;
+
+    m_conn.disconnecting = true;
+    m_conn.reason        = BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION;
+    return true;
+}
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code)
+{
+    if (conn_handle != m_conn.handle || m_conn.handle == BLE_CONN_HANDLE_INVALID)
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    if (m_conn.disconnecting)
+        return NRF_ERROR_INVALID_STATE;
+
+    m_conn.disconnecting = true;
+    m_conn.reason        = BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle,
+                                      ble_gap_conn_params_t const * const p_conn_params)
+{
+    ble_evt_t * p_evt;
+
+    if (conn_handle != m_conn.handle || m_conn.handle == BLE_CONN_HANDLE_INVALID)
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+
+    /* The central takes the longest interval offered. */
+    m_conn.params = p_conn_params ? *p_conn_params : m_ppcp;
+    m_conn.params.min_conn_interval = m_conn.params.max_conn_interval;
+
+    p_evt = ble_evt_new(BLE_GAP_EVT_CONN_PARAM_UPDATE, sizeof(ble_gap_evt_t));
+    p_evt->evt.gap_evt.conn_handle = 0;
+    p_evt->evt.gap_evt.params.conn_param_update.conn_params = m_conn.params;
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  GAP settings.                                                            */
+/*---------------------------------------------------------------------------*/
+uint32_t sd_ble_gap_address_set(uint8_t addr_cycle_mode, ble_gap_addr_t const * const p_addr)
+{
+    uint8_t top;
+
+    if (p_addr == NULL)
+        return NRF_ERROR_INVALID_ADDR;
+    if (addr_cycle_mode != BLE_GAP_ADDR_CYCLE_MODE_NONE)
+        return NRF_ERROR_NOT_SUPPORTED;
+
+    /* The two top bits say which kind of random address it is. */
+    top = p_addr->addr[5] >> 6;
+    switch (p_addr->addr_type) {
+        case BLE_GAP_ADDR_TYPE_PUBLIC:                          top = 0xFF; break;
+        case BLE_GAP_ADDR_TYPE_RANDOM_STATIC:                   top ^= 3;   break;
+        case BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_RESOLVABLE:       top ^= 1;   break;
+        case BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_NON_RESOLVABLE:               break;
+        default:                                                top = 1;    break;
+    }
+    if (top != 0 && top != 0xFF)
+        return BLE_ERROR_GAP_INVALID_BLE_ADDR;
+
+    m_addr = *p_addr;
+    trace("address %02x:%02x:%02x:%02x:%02x:%02x",
+          m_addr.addr[5], m_addr.addr[4], m_addr.addr[3],
+          m_addr.addr[2], m_addr.addr[1], m_addr.addr[0]);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_address_get(ble_gap_addr_t * const p_addr)
+{
+    *p_addr = m_addr;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_tx_power_set(int8_t tx_power)
+{
+    switch (tx_power) {
+        case -40: case -30: case -20: case -16: case -12:
+        case -8:  case -4:  case 0:   case 4:
+            m_tx_power = tx_power;
+            trace("tx power %d dBm", tx_power);
+            return NRF_SUCCESS;
+        default:
+            return NRF_ERROR_INVALID_PARAM;
+    }
+}
+
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const * const p_conn_params)
+{
+    m_ppcp = *p_conn_params;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_ppcp_get(ble_gap_conn_params_t * const p_conn_params)
+{
+    *p_conn_params = m_ppcp;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const * const p_write_perm,
+                                    uint8_t const * const p_dev_name, uint16_t len)
+{
+    return (len > 31) ? NRF_ERROR_INVALID_LENGTH : NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_appearance_set(uint16_t appearance)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_sec_params_reply(uint16_t conn_handle, uint8_t sec_status,
+                                     ble_gap_sec_params_t const * p_sec_params,
+                                     ble_gap_sec_keyset_t const * p_sec_keyset)
+{
+    return (conn_handle == m_conn.handle) ? NRF_SUCCESS : BLE_ERROR_INVALID_CONN_HANDLE;
+}
+
+uint32_t sd_ble_gap_sec_info_reply(uint16_t conn_handle, ble_gap_enc_info_t const * p_enc_info,
+                                   ble_gap_irk_t const * p_id_info,
+                                   ble_gap_sign_info_t const * p_sign_info)
+{
+    return (conn_handle == m_conn.handle) ? NRF_SUCCESS : BLE_ERROR_INVALID_CONN_HANDLE;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  GATT server.                                                             */
+/*---------------------------------------------------------------------------*/
+#define ATTR_MAX        64
+#define ATTR_MEM        2048
+
+typedef enum { ATTR_SERVICE, ATTR_DECL, ATTR_VALUE, ATTR_CCCD, ATTR_DESC } attr_kind_t;
+
+typedef struct {
+    attr_kind_t               kind;
+    ble_gatts_attr_context_t  context;      // as a write event carries it
+    ble_gap_conn_sec_mode_t   read_perm;
+    ble_gap_conn_sec_mode_t   write_perm;
+    uint8_t                 * p_value;
+    uint16_t                  len;
+    uint16_t                  max_len;
+    bool                      vlen;
+} attr_t;
+
+static attr_t    m_attrs [ATTR_MAX];        // handle 1 is m_attrs[0]
+static uint16_t  m_attr_count;
+static uint8_t   m_attr_mem [ATTR_MEM];     // values the stack keeps
+static uint16_t  m_attr_mem_used;
+
+static uint8_t        m_vs_count;
+static ble_uuid128_t  m_vs_uuids [4];
+
+static attr_t * attr_get(uint16_t handle)
+{
+    return (handle >= 1 && handle <= m_attr_count) ? &m_attrs[handle - 1] : NULL;
+}
+
+static attr_t * attr_add(attr_kind_t kind, const ble_gatts_attr_context_t * p_context)
+{
+    attr_t * p;
+
+    if (m_attr_count == ATTR_MAX)
+        return NULL;
+    p = &m_attrs[m_attr_count++];
+    memset(p, 0, sizeof(*p));
+    p->kind    = kind;
+    p->context = *p_context;
+    return p;
+}
+
+static uint8_t * attr_mem(uint16_t len)
+{
+    uint8_t * p = &m_attr_mem[m_attr_mem_used];
+
+    if (m_attr_mem_used + len > ATTR_MEM)
+        return NULL;
+    m_attr_mem_used += (len + 3) & ~3;
+    return p;
+}
+
+static bool sec_open(ble_gap_conn_sec_mode_t mode)
+{
+    return mode.sm == 1 && mode.lv == 1;
+}
+
+static void gatts_connected(void)
+{
+    uint16_t i;
+
+    /* No bonds kept: every connection starts with notifications off. */
+    for (i = 0; i < m_attr_count; i++)
+        if (m_attrs[i].kind == ATTR_CCCD)
+            memset(m_attrs[i].p_value, 0, 2);
+}
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * const p_vs_uuid, uint8_t * const p_uuid_type)
+{
+    if (m_vs_count == sizeof(m_vs_uuids) / sizeof(m_vs_uuids[0]))
+        return NRF_ERROR_NO_MEM;
+
+    m_vs_uuids[m_vs_count] = *p_vs_uuid;
+    *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN + m_vs_count++;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_uuid_encode(ble_uuid_t const * const p_uuid, uint8_t * const p_uuid_le_len,
+                            uint8_t * const p_uuid_le)
+{
+    if (p_uuid->type == BLE_UUID_TYPE_BLE) {
+        *p_uuid_le_len = 2;
+        if (p_uuid_le) {
+            p_uuid_le[0] = p_uuid->uuid & 0xFF;
+            p_uuid_le[1] = p_uuid->uuid >> 8;
+        }
+        return NRF_SUCCESS;
+    }
+    if (p_uuid->type < BLE_UUID_TYPE_VENDOR_BEGIN ||
+        p_uuid->type >= BLE_UUID_TYPE_VENDOR_BEGIN + m_vs_count)
+        return NRF_ERROR_INVALID_PARAM;
+
+    /* The base with the 16 bits in octets 12 and 13. */
+    *p_uuid_le_len = 16;
+    if (p_uuid_le) {
+        memcpy(p_uuid_le, m_vs_uuids[p_uuid->type - BLE_UUID_TYPE_VENDOR_BEGIN].uuid128, 16);
+        p_uuid_le[12] = p_uuid->uuid & 0xFF;
+        p_uuid_le[13] = p_uuid->uuid >> 8;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const * const p_uuid,
+                                  uint16_t * const p_handle)
+{
+    ble_gatts_attr_context_t context;
+    attr_t                 * p;
+
+    memset(&context, 0, sizeof(context));
+    context.svc_uuid    = *p_uuid;
+    context.srvc_handle = m_attr_count + 1;
+
+    if ((p = attr_add(ATTR_SERVICE, &context)) == NULL)
+        return NRF_ERROR_NO_MEM;
+
+    *p_handle = context.srvc_handle;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle,
+                                         ble_gatts_char_md_t const * const p_char_md,
+                                         ble_gatts_attr_t const * const p_attr_char_value,
+                                         ble_gatts_char_handles_t * const p_handles)
+{
+    const ble_gatts_attr_t    * p_value = p_attr_char_value;
+    const ble_gatts_attr_md_t * p_md    = p_value->p_attr_md;
+    ble_gatts_attr_context_t    context;
+    attr_t                    * p_service = attr_get(service_handle);
+    attr_t                    * p;
+
+    if (p_service == NULL || p_service->kind != ATTR_SERVICE)
+        return NRF_ERROR_INVALID_PARAM;
+    if (p_value->max_len > BLE_GATTS_VAR_ATTR_LEN_MAX ||
+        p_value->init_offs + p_value->init_len > p_value->max_len)
+        return NRF_ERROR_INVALID_PARAM;
+
+    context              = p_service->context;
+    context.char_uuid    = *p_value->p_uuid;
+    context.value_handle = m_attr_count + 2;
+
+    memset(p_handles, 0, sizeof(*p_handles));
+
+    if (attr_add(ATTR_DECL, &context) == NULL || (p = attr_add(ATTR_VALUE, &context)) == NULL)
+        return NRF_ERROR_NO_MEM;
+
+    p_handles->value_handle = context.value_handle;
+    p->read_perm  = p_md->read_perm;
+    p->write_perm = p_md->write_perm;
+    p->max_len    = p_value->max_len;
+    p->vlen       = p_md->vlen;
+    p->len        = p_value->init_offs + p_value->init_len;
+
+    if (p_md->vloc == BLE_GATTS_VLOC_USER) {
+        p->p_value = p_value->p_value;
+    }
+    else {
+        if ((p->p_value = attr_mem(p->max_len)) == NULL)
+            return NRF_ERROR_NO_MEM;
+        if (p_value->p_value)
+            memcpy(p->p_value + p_value->init_offs, p_value->p_value, p_value->init_len);
+    }
+
+    if (p_char_md->char_props.notify || p_char_md->char_props.indicate) {
+        context.desc_uuid.type = BLE_UUID_TYPE_BLE;
+        context.desc_uuid.uuid = BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG;
+        if ((p = attr_add(ATTR_CCCD, &context)) == NULL || (p->p_value = attr_mem(2)) == NULL)
+            return NRF_ERROR_NO_MEM;
+        p->read_perm  = p_char_md->p_cccd_md ? p_char_md->p_cccd_md->read_perm  : p_md->read_perm;
+        p->write_perm = p_char_md->p_cccd_md ? p_char_md->p_cccd_md->write_perm : p_md->read_perm;
+        p->len = p->max_len = 2;
+        memset(p->p_value, 0, 2);
+        p_handles->cccd_handle = m_attr_count;
+    }
+
+    if (p_char_md->p_char_user_desc) {
+        context.desc_uuid.type = BLE_UUID_TYPE_BLE;
+        context.desc_uuid.uuid = 0x2901;
+        if ((p = attr_add(ATTR_DESC, &context)) == NULL)
+            return NRF_ERROR_NO_MEM;
+        p->p_value = p_char_md->p_char_user_desc;
+        p->len = p->max_len = p_char_md->char_user_desc_size;
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&p->read_perm);
+        p_handles->user_desc_handle = m_attr_count;
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_value_set(uint16_t handle, uint16_t offset, uint16_t * const p_len,
+                                uint8_t const * const p_value)
+{
+    attr_t * p = attr_get(handle);
+
+    if (p == NULL || p->p_value == NULL)
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    if (offset + *p_len > p->max_len)
+        return NRF_ERROR_INVALID_PARAM;
+
+    if (p_value)
+        memcpy(p->p_value + offset, p_value, *p_len);
+    if (p->vlen || offset + *p_len > p->len)
+        p->len = offset + *p_len;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_value_get(uint16_t handle, uint16_t offset, uint16_t * const p_len,
+                                uint8_t * const p_data)
+{
+    attr_t * p = attr_get(handle);
+
+    if (p == NULL || p->p_value == NULL)
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    if (offset > p->len)
+        return NRF_ERROR_INVALID_PARAM;
+
+    if (p_data)
+        memcpy(p_data, p->p_value + offset, MIN(*p_len, p->len - offset));
+    *p_len = p->len - offset;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_sys_attr_set(uint16_t conn_handle, uint8_t const * const p_sys_attr_data,
+                                   uint16_t len)
+{
+    return (conn_handle == m_conn.handle) ? NRF_SUCCESS : BLE_ERROR_INVALID_CONN_HANDLE;
+}
+
+static void hex_format(char * out, const uint8_t * p_data, uint16_t len)
+{
+    uint16_t i;
+
+    for (i = 0; i < len; i++)
+        sprintf(&out[2 * i], "%02x", p_data[i]);
+    out[2 * len] = '\0';
+}
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * const p_hvx_params)
+{
+    const ble_gatts_hvx_params_t * p_hvx = p_hvx_params;
+    attr_t                       * p     = attr_get(p_hvx->handle);
+    attr_t                       * p_cccd;
+    uint16_t                       len;
+    char                           hex [2 * (GATT_MTU_SIZE_DEFAULT - 3) + 1];
+
+    if (conn_handle != m_conn.handle || m_conn.handle == BLE_CONN_HANDLE_INVALID)
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    if (p == NULL || p->kind != ATTR_VALUE)
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    if (p_hvx->type != BLE_GATT_HVX_NOTIFICATION)
+        return NRF_ERROR_NOT_SUPPORTED;
+
+    p_cccd = attr_get(p_hvx->handle + 1);
+    if (p_cccd == NULL || p_cccd->kind != ATTR_CCCD ||
+        !(p_cccd->p_value[0] & BLE_GATT_HVX_NOTIFICATION))
+        return NRF_ERROR_INVALID_STATE;
+    if (m_conn.tx_free == 0)
+        return BLE_ERROR_NO_TX_BUFFERS;
+
+    /* Notifications update the value too; one packet's worth goes. */
+    len = p_hvx->p_len ? *p_hvx->p_len : p->len;
+    if (p_hvx->offset + len > p->max_len)
+        return NRF_ERROR_INVALID_PARAM;
+    if (p_hvx->p_data) {
+        memcpy(p->p_value + p_hvx->offset, p_hvx->p_data, len);
+        if (p->vlen)
+            p->len = p_hvx->offset + len;
+    }
+    len = MIN(len, GATT_MTU_SIZE_DEFAULT - 3);
+    if (p_hvx->p_len)
+        *p_hvx->p_len = len;
+
+    m_conn.tx_free--;
+    m_conn.tx_sent++;
+
+    if (trace_wanted()) {
+        hex_format(hex, p->p_value + p_hvx->offset, len);
+        trace("notify %04x %s", p->context.char_uuid.uuid, hex);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_tx_buffer_count_get(uint8_t * p_count)
+{
+    *p_count = TX_BUFFERS;
+    return NRF_SUCCESS;
+}
+
+/* By 16-bit UUID: the value, or its CCCD. */
+static attr_t * attr_find(uint16_t uuid, bool cccd)
+{
+    uint16_t i;
+
+    for (i = 0; i < m_attr_count; i++) {
+        attr_t * p = &m_attrs[i];
+        if (p->kind == (cccd ? ATTR_CCCD : ATTR_VALUE) && p->context.char_uuid.uuid == uuid)
+            return p;
+    }
+    return NULL;
+}
+
+bool sd_host_write(uint16_t uuid, bool cccd, const uint8_t * p_data, uint16_t len)
+{
+    attr_t                * p = attr_find(uuid, cccd);
+    ble_evt_t             * p_evt;
+    ble_gatts_evt_write_t * p_write;
+
+    if (m_conn.handle == BLE_CONN_HANDLE_INVALID || p == NULL)
+        return false;
+    if (!sec_open(p->write_perm) || len > p->max_len) {
+        trace("write %04x%s refused", uuid, cccd ? " cccd" : "");
+        return true;
+    }
+
+    /* A shorter write to a fixed length value lands at its start. */
+    memcpy(p->p_value, p_data, len);
+    if (p->vlen || len > p->len)
+        p->len = len;
+
+    p_evt = ble_evt_new(BLE_GATTS_EVT_WRITE, sizeof(ble_gatts_evt_t) + len);
+    p_evt->evt.gatts_evt.conn_handle = 0;
+    p_write          = &p_evt->evt.gatts_evt.params.write;
+    p_write->handle  = (uint16_t) (p - m_attrs) + 1;
+    p_write->op      = BLE_GATT_OP_WRITE_REQ;
+    p_write->context = p->context;
+    p_write->offset  = 0;
+    p_write->len     = len;
+    memcpy(p_write->data, p_data, len);
+    return true;
+}
+
+bool sd_host_read(uint16_t uuid)
+{
+    attr_t * p = attr_find(uuid, false);
+    char     hex [2 * BLE_GATTS_VAR_ATTR_LEN_MAX + 1];
+
+    if (m_conn.handle == BLE_CONN_HANDLE_INVALID || p == NULL)
+        return false;
+    if (!sec_open(p->read_perm)) {
+        trace("read %04x refused", uuid);
+        return true;
+    }
+    hex_format(hex, p->p_value, p->len);
+    trace("read %04x %s", uuid, hex);
+    return true;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  BLE common.                                                              */
+/*---------------------------------------------------------------------------*/
+uint32_t sd_ble_enable(ble_enable_params_t * p_ble_enable_params)
+{
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_opt_set(uint32_t opt_id, ble_opt_t const * p_opt)
+{
+    return (opt_id == BLE_GAP_OPT_PRIVACY) ? NRF_SUCCESS : NRF_ERROR_NOT_SUPPORTED;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  SoC: flash.                                                              */
+/*---------------------------------------------------------------------------*/
+static void flash_done(uintptr_t arg)
+{
+    uint32_t i;
+
+    if (m_flash.p_src == NULL) {
+        memset(m_flash.p_dst, 0xFF, FLASH_PAGE_SIZE);
+        trace("flash erase 0x%x", (unsigned) (uintptr_t) m_flash.p_dst);
+    }
+    else {
+        /* Flash only ever goes from 1 to 0 without an erase. */
+        for (i = 0; i < m_flash.words; i++)
+            m_flash.p_dst[i] &= m_flash.p_src[i];
+        trace("flash write 0x%x %u", (unsigned) (uintptr_t) m_flash.p_dst,
+              (unsigned) m_flash.words);
+    }
+
+    m_flash.busy = false;
+    sys_evt(NRF_EVT_FLASH_OPERATION_SUCCESS);
+}
+
+static bool flash_range(uintptr_t start, uint32_t bytes)
+{
+    return start >= FLASH_START && start + bytes <= FLASH_END;
+}
+
+uint32_t sd_flash_page_erase(uint32_t page_number)
+{
+    uintptr_t addr = (uintptr_t) page_number * FLASH_PAGE_SIZE;
+
+    if (m_flash.busy)
+        return NRF_ERROR_BUSY;
+    if (!flash_range(addr, FLASH_PAGE_SIZE))
+        return NRF_ERROR_INVALID_ADDR;
+
+    m_flash.busy  = true;
+    m_flash.p_dst = (uint32_t *) addr;
+    m_flash.p_src = NULL;
+    energy_flash(FLASH_ERASE_US);
+    sim_at(g_sim_now + SIM_US(FLASH_ERASE_US), flash_done, 0);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_flash_write(uint32_t * const p_dst, uint32_t const * const p_src, uint32_t size)
+{
+    if (m_flash.busy)
+        return NRF_ERROR_BUSY;
+    if (((uintptr_t) p_dst & 3) || ((uintptr_t) p_src & 3) ||
+        !flash_range((uintptr_t) p_dst, size * 4))
+        return NRF_ERROR_INVALID_ADDR;
+    if (size == 0 || size > 256)
+        return NRF_ERROR_INVALID_LENGTH;
+
+    /* p_src is read when the write happens, as the SoftDevice does. */
+    m_flash.busy  = true;
+    m_flash.p_dst = p_dst;
+    m_flash.p_src = p_src;
+    m_flash.words = size;
+    energy_flash(FLASH_WORD_US * size);
+    sim_at(g_sim_now + SIM_US(FLASH_WORD_US * size), flash_done, 0);
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  SoC: clock, radio notification, PPI, power.                              */
+/*---------------------------------------------------------------------------*/
+static void hfclk_started(uintptr_t arg)
+{
+    m_hfclk_running = true;
+    trace("hfclk on");
+    sys_evt(NRF_EVT_HFCLKSTARTED);
+}
+
+uint32_t sd_clock_hfclk_request(void)
+{
+    if (!m_hfclk_requested) {
+        m_hfclk_requested = true;
+        energy_crystal(true);
+        sim_at(g_sim_now + SIM_US(HFCLK_START_US), hfclk_started, 0);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_clock_hfclk_release(void)
+{
+    if (m_hfclk_requested) {
+        m_hfclk_requested = false;
+        energy_crystal(false);
+        sim_cancel(hfclk_started, 0);
+        if (m_hfclk_running)
+            trace("hfclk off");
+        m_hfclk_running = false;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_clock_hfclk_is_running(uint32_t * p_is_running)
+{
+    *p_is_running = m_hfclk_running;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_radio_notification_cfg_set(uint8_t type, uint8_t distance)
+{
+    if (type > NRF_RADIO_NOTIFICATION_TYPE_INT_ON_BOTH ||
+        distance > NRF_RADIO_NOTIFICATION_DISTANCE_5500US)
+        return NRF_ERROR_INVALID_PARAM;
+
+    m_notify_type     = type;
+    m_notify_distance = distance;
+    return NRF_SUCCESS;
+}
+
+/* The application may have channels 0 to 7. */
+uint32_t sd_ppi_channel_assign(uint8_t channel_num, const volatile void * evt_endpoint,
+                               const volatile void * task_endpoint)
+{
+    if (channel_num > 7)
+        return NRF_ERROR_SOC_PPI_INVALID_CHANNEL;
+
+    regs_write(&NRF_PPI->CH[channel_num].EEP, (uint32_t) (uintptr_t) evt_endpoint);
+    regs_write(&NRF_PPI->CH[channel_num].TEP, (uint32_t) (uintptr_t) task_endpoint);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ppi_channel_enable_set(uint32_t channel_enable_set_msk)
+{
+    if (channel_enable_set_msk & ~0xFFUL)
+        return NRF_ERROR_SOC_PPI_INVALID_CHANNEL;
+    regs_write(&NRF_PPI->CHENSET, channel_enable_set_msk);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ppi_channel_enable_clr(uint32_t channel_enable_clr_msk)
+{
+    if (channel_enable_clr_msk & ~0xFFUL)
+        return NRF_ERROR_SOC_PPI_INVALID_CHANNEL;
+    regs_write(&NRF_PPI->CHENCLR, channel_enable_clr_msk);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ppi_channel_enable_get(uint32_t * p_channel_enable)
+{
+    *p_channel_enable = ((NRF_PPI_Type *) regs_host(NRF_PPI))->CHEN;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_reset_reason_get(uint32_t * p_reset_reason)
+{
+    *p_reset_reason = ((NRF_POWER_Type *) regs_host(NRF_POWER))->RESETREAS;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_reset_reason_clr(uint32_t reset_reason_clr_msk)
+{
+    regs_write(&NRF_POWER->RESETREAS, reset_reason_clr_msk);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_gpregret_get(uint32_t * p_gpregret)
+{
+    *p_gpregret = ((NRF_POWER_Type *) regs_host(NRF_POWER))->GPREGRET;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_gpregret_set(uint32_t gpregret_msk)
+{
+    ((NRF_POWER_Type *) regs_host(NRF_POWER))->GPREGRET |= gpregret_msk;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_gpregret_clr(uint32_t gpregret_msk)
+{
+    ((NRF_POWER_Type *) regs_host(NRF_POWER))->GPREGRET &= ~gpregret_msk;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_system_off(void)
+{
+    sim_system_off();
+}
+
+/*---------------------------------------------------------------------------*/
+/*  SoC: the rest.                                                           */
+/*---------------------------------------------------------------------------*/
+uint32_t sd_app_evt_wait(void)
+{
+    sim_irq_exit();                     // the main loop's pass ends here
+
+    g_sim_woken = false;
+    while (!g_sim_woken)
+        sim_wait();
+
+    sim_irq_enter(SIM_CTX_MAIN);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_evt_get(uint32_t * p_evt_id)
+{
+    return NRF_ERROR_NOT_FOUND;         // handed over directly
+}
+
+uint32_t sd_temp_get(int32_t * p_temp)
+{
+    *p_temp = g_sd_temp;
+    energy_temp();
+    trace("temp %d.%02d", (int) (g_sd_temp / 4), (int) (g_sd_temp % 4) * 25);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_rand_application_vector_get(uint8_t * p_buff, uint8_t length)
+{
+    while (length--)
+        *p_buff++ = (uint8_t) sim_rand();
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_critical_region_enter(uint8_t * p_is_nested_critical_region)
+{
+    *p_is_nested_critical_region = (m_critical > 0);
+    m_critical++;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_critical_region_exit(uint8_t is_nested_critical_region)
+{
+    if (m_critical == 0 || is_nested_critical_region != (m_critical > 1)) {
+        fprintf(stderr, "host: critical region exit without its enter\n");
+        exit(2);
+    }
+    m_critical--;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_EnableIRQ(IRQn_Type IRQn)                          { return NRF_SUCCESS; }
+uint32_t sd_nvic_DisableIRQ(IRQn_Type IRQn)                         { return NRF_SUCCESS; }
+uint32_t sd_nvic_SetPriority(IRQn_Type IRQn, uint32_t priority)     { return NRF_SUCCESS; }
+uint32_t sd_nvic_ClearPendingIRQ(IRQn_Type IRQn)                    { return NRF_SUCCESS; }
+uint32_t sd_nvic_SetPendingIRQ(IRQn_Type IRQn)                      { return NRF_SUCCESS; }
+
+uint32_t sd_softdevice_enable(nrf_clock_lfclksrc_t clock_source,
+                              softdevice_assertion_handler_t assertion_handler)
+{
+    return NRF_SUCCESS;
+}
+
+/* Everything the SoftDevice runs stops. */
+uint32_t sd_softdevice_disable(void)
+{
+    if (m_adv.on)
+        adv_stop();
+    sim_cancel(adv_timeout, 0);
+    sim_cancel(conn_event, 0);
+    sim_cancel(conn_end, 0);
+    sim_cancel(radio_notify, 1);
+    m_conn.handle = BLE_CONN_HANDLE_INVALID;
+    trace("softdevice disabled");
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  ECB: AES-128, encrypt only, as the peripheral (aes.c).                   */
+/*---------------------------------------------------------------------------*/
+uint32_t sd_ecb_block_encrypt(nrf_ecb_hal_data_t * p_ecb_data)
+{
+    aes128_encrypt(p_ecb_data->key, p_ecb_data->cleartext, p_ecb_data->ciphertext);
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+void sd_host_init(void)
+{
+    static const uint8_t key [16] = {
+        0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+    static const uint8_t in [16] = {
+        0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d,
+        0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34 };
+    static const uint8_t want [16] = {
+        0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb,
+        0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32 };
+    uint8_t out [16];
+
+    /* FIPS-197 appendix B, so a broken ECB shows up before privacy.c. */
+    aes128_encrypt(key, in, out);
+    if (memcmp(out, want, 16) != 0) {
+        fprintf(stderr, "host: AES-128 self test failed\n");
+        exit(2);
+    }
+
+    /* S110's defaults. */
+    m_ppcp.min_conn_interval = 6;
+    m_ppcp.max_conn_interval = 80;
+    m_ppcp.conn_sup_timeout  = 400;
+}
@@ -0,0 +1,233 @@
+/*---------------------------------------------------------------------------*/
+/*  wave.c   the pins' waveforms: a VCD file, and the checks on them        */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  Every change on the pins is kept, with its time, in a ring of the last
+ *  WAVE_HISTORY, and with -w written out as VCD for a waveform viewer
+ *  (GTKWave and the like): what the logic analyser showed, without the
+ *  board.  A tone, both legs toggling at 5 kHz, fills the ring in 13 s.
+ *
+ *  The script's wave lines measure one pin over a window before their
+ *  time: the frequency and the duty cycle of each full period, from one
+ *  rising edge to the next; the longest gap between two edges; or the
+ *  number of edges.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trackr_board.h"
+
+#include "host.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+#define WAVE_HISTORY        (1UL << 18)
+
+typedef struct {
+    sim_time_t  when;
+    uint32_t    levels;             // all the pins, after the change
+} wave_edge_t;
+
+static wave_edge_t  m_ring [WAVE_HISTORY];
+static uint32_t     m_head;         // the next to write
+static uint32_t     m_count;
+
+/* Before the oldest in the ring: the pins, and since when. */
+static uint32_t     m_base_levels;
+static sim_time_t   m_base_time;
+
+static uint32_t     m_levels;
+static bool         m_started;
+
+static FILE       * m_vcd;
+static sim_time_t   m_vcd_time;
+
+/* Named in the VCD file as well as numbered. */
+static const struct {
+    uint32_t      pin;
+    const char  * name;
+} m_names [] = {
+    { TRACKR_LED,       "led"      },
+    { BSP_BUTTON_0,     "button"   },
+#ifdef BUZZER_SUPPORT
+    { TRACKR_BUZZER_R,  "buzzer_r" },
+    { TRACKR_BUZZER_L,  "buzzer_l" },
+#endif
+};
+
+/*---------------------------------------------------------------------------*/
+/*  VCD: one wire per pin, the time in ns.                                   */
+/*---------------------------------------------------------------------------*/
+static void vcd_time(void)
+{
+    if (g_sim_now != m_vcd_time) {
+        fprintf(m_vcd, "#%llu\n", (unsigned long long) g_sim_now);
+        m_vcd_time = g_sim_now;
+    }
+}
+
+static void vcd_header(void)
+{
+    uint32_t pin;
+    unsigned i;
+
+    fprintf(m_vcd, "$comment trackr_host $end\n$timescale 1ns $end\n$scope module trackr $end\n");
+    for (pin = 0; pin < 32; pin++) {
+        const char * name = NULL;
+        for (i = 0; i < sizeof(m_names) / sizeof(m_names[0]); i++)
+            if (m_names[i].pin == pin)
+                name = m_names[i].name;
+        fprintf(m_vcd, "$var wire 1 %c P0_%02u%s%s $end\n", '!' + pin, (unsigned) pin,
+                name ? "_" : "", name ? name : "");
+    }
+    fprintf(m_vcd, "$upscope $end\n$enddefinitions $end\n");
+}
+
+/* All the pins as they are: at the start, and after a reset. */
+static void vcd_dump(void)
+{
+    uint32_t pin;
+
+    fprintf(m_vcd, "#%llu\n", (unsigned long long) g_sim_now);
+    m_vcd_time = g_sim_now;
+    for (pin = 0; pin < 32; pin++)
+        fprintf(m_vcd, "%u%c\n", (unsigned) (m_levels >> pin) & 1, '!' + pin);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Called with the clock set: the process starts with it at 0, and a       */
+/*  reset sets it after the registers are up.                                */
+/*---------------------------------------------------------------------------*/
+void wave_start(const char * vcd_name, bool resumed)
+{
+    m_head        = 0;
+    m_count       = 0;
+    m_base_levels = m_levels;
+    m_base_time   = g_sim_now;
+    m_started     = true;
+
+    if (vcd_name == NULL)
+        return;
+
+    m_vcd = fopen(vcd_name, resumed ? "a" : "w");
+    if (m_vcd == NULL) {
+        perror("host: vcd");
+        exit(2);
+    }
+    if (!resumed)
+        vcd_header();
+    vcd_dump();
+}
+
+void wave_pins(uint32_t levels)
+{
+    uint32_t changed = levels ^ m_levels;
+    uint32_t pin;
+
+    m_levels = levels;
+    if (!m_started || changed == 0)
+        return;
+
+    if (m_count == WAVE_HISTORY) {
+        m_base_levels = m_ring[m_head].levels;
+        m_base_time   = m_ring[m_head].when;
+    }
+    else {
+        m_count++;
+    }
+    m_ring[m_head].when   = g_sim_now;
+    m_ring[m_head].levels = levels;
+    m_head = (m_head + 1) % WAVE_HISTORY;
+
+    if (m_vcd != NULL) {
+        vcd_time();
+        for (pin = 0; pin < 32; pin++)
+            if (changed & (1UL << pin))
+                fprintf(m_vcd, "%u%c\n", (unsigned) (levels >> pin) & 1, '!' + pin);
+    }
+}
+
+void wave_flush(void)
+{
+    if (m_vcd != NULL)
+        fflush(m_vcd);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  The checks.                                                              */
+/*---------------------------------------------------------------------------*/
+static void range(double value, uint32_t * p_count, double * p_lo, double * p_hi)
+{
+    if (*p_count == 0 || value < *p_lo)
+        *p_lo = value;
+    if (*p_count == 0 || value > *p_hi)
+        *p_hi = value;
+    (*p_count)++;
+}
+
+/* The window's values, lowest and highest: how many, or -1 if it reaches
+   back before what is kept. */
+int wave_measure(uint32_t pin, sim_time_t window, wave_measure_t measure,
+                 double * p_lo, double * p_hi)
+{
+    sim_time_t start = (window < g_sim_now) ? g_sim_now - window : 0;
+    sim_time_t rise  = 0, fall = 0, edge = 0;
+    bool       risen = false, fallen = false, edged = false;
+    uint32_t   count = 0;
+    uint32_t   edges = 0;
+    uint32_t   first = 0;               // back from the newest
+    uint32_t   level;
+    uint32_t   i;
+
+    if (start < m_base_time)
+        return -1;
+
+    /* The first change in the window, and the level before it. */
+    while (first < m_count && m_ring[(m_head + WAVE_HISTORY - 1 - first) % WAVE_HISTORY].when > start)
+        first++;
+    level = (first < m_count) ? m_ring[(m_head + WAVE_HISTORY - 1 - first) % WAVE_HISTORY].levels
+                              : m_base_levels;
+    level = (level >> pin) & 1;
+
+    for (i = first; i-- > 0; ) {
+        const wave_edge_t * p = &m_ring[(m_head + WAVE_HISTORY - 1 - i) % WAVE_HISTORY];
+
+        if (((p->levels >> pin) & 1) == level)
+            continue;
+        level ^= 1;
+        edges++;
+
+        if (edged && measure == WAVE_GAP) {
+            if (count == 0 || (double) (p->when - edge) / 1e6 > *p_hi)
+                *p_lo = *p_hi = (double) (p->when - edge) / 1e6;
+            count = 1;
+        }
+        edge  = p->when;
+        edged = true;
+
+        if (!level) {
+            fall   = p->when;
+            fallen = risen;
+            continue;
+        }
+        if (risen && fallen) {
+            if (measure == WAVE_HZ)
+                range(1e9 / (double) (p->when - rise), &count, p_lo, p_hi);
+            else if (measure == WAVE_DUTY)
+                range(100.0 * (double) (fall - rise) / (double) (p->when - rise), &count, p_lo, p_hi);
+        }
+        rise   = p->when;
+        risen  = true;
+        fallen = false;
+    }
+
+    if (measure == WAVE_EDGES) {
+        *p_lo = *p_hi = edges;
+        count = 1;
+    }
+    return count;
+}
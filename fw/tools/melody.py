@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+#
+#  melody.py   compile buzzer melodies into flash tables
+#  Copyright (c) 2016 Robin Callender. All Rights Reserved.
+#
+#  Melodies are written in RTTTL, one per line (fw/app/tones.txt):
+#
+#    name: d=4,o=5,b=120: 8c6, p, 4a#., 2g/700
+#
+#  d, o and b are the default duration, octave and beats per minute.  A
+#  note is [duration]letter[#][.][octave][.]; "p" is a pause and "." makes
+#  it half as long again.  One extension: "/ms" at the end gives a note a
+#  length in milliseconds that no division of the beat gives.  Lines that
+#  start with white space carry on the melody above; lines that start with
+#  "#" are comments.
+#
+#  Out come tones.c, const buzzer_play_t tables with each note already a
+#  TIMER2 compare value and each length already app_timer ticks, and
+#  tones.h to go with it.  The makefile runs this when tones.txt changes:
+#
+#    melody.py tones.txt tones.c tones.h
+#
+
+import math
+import re
+import sys
+
+TIMER_HZ    = 4000000           # BUZZER_TIMER_HZ, fw/app/buzzer.h
+COMPARE_MAX = 0xFFFF            # TIMER2 runs 16 bits wide
+MS_MAX      = 1999              # BUZZER_MS() fits in 16 bits, prescaler 0
+
+DEFAULTS    = {'d': 4, 'o': 6, 'b': 63}
+DURATIONS   = (1, 2, 4, 8, 16, 32)
+SEMITONES   = {'c': -9, 'd': -7, 'e': -5, 'f': -4, 'g': -2, 'a': 0, 'b': 2, 'h': 2}
+
+NAME        = re.compile(r'[A-Za-z_][A-Za-z_0-9]*$')
+NOTE        = re.compile(r'(\d*)([a-hp])(#?)(\.?)(\d?)(\.?)(?:/(\d+))?$')
+
+
+class MelodyError(Exception):
+    pass
+
+
+# --- parsing ---------------------------------------------------------------
+
+def frequency(letter, sharp, octave):
+    """Equal temperament, a4 = 440 Hz."""
+    semitone = SEMITONES[letter] + (1 if sharp else 0) + 12 * (octave - 4)
+    return 440.0 * 2 ** (semitone / 12.0)
+
+
+def compare(hz):
+    """Toggled on every compare: two compares make one period."""
+    value = int(round(TIMER_HZ / (2.0 * hz)))
+    if not 1 <= value <= COMPARE_MAX:
+        raise MelodyError('%.0f Hz is out of range for the buzzer' % hz)
+    return value
+
+
+def parse_defaults(text):
+    values = dict(DEFAULTS)
+    for item in filter(None, (s.strip() for s in text.split(','))):
+        key, _, value = item.partition('=')
+        key = key.strip().lower()
+        if key not in values or not value.strip().isdigit():
+            raise MelodyError('bad default "%s"' % item)
+        values[key] = int(value)
+    if values['d'] not in DURATIONS:
+        raise MelodyError('bad default duration %d' % values['d'])
+    if values['b'] == 0:
+        raise MelodyError('b=0')
+    return values
+
+
+def parse_note(text, defaults):
+    """One note as (ms, hz or None for a pause)."""
+    m = NOTE.match(text.lower())
+    if not m:
+        raise MelodyError('bad note "%s"' % text)
+    div, letter, sharp, dot1, octave, dot2, ms = m.groups()
+
+    if ms:
+        ms = int(ms)
+    else:
+        div = int(div) if div else defaults['d']
+        if div not in DURATIONS:
+            raise MelodyError('bad duration in "%s"' % text)
+        ms = 4 * 60000.0 / defaults['b'] / div
+        if dot1 or dot2:
+            ms *= 1.5
+        ms = int(round(ms))
+
+    if not 1 <= ms <= MS_MAX:
+        raise MelodyError('"%s" is %d ms, 1 to %d allowed' % (text, ms, MS_MAX))
+
+    if letter == 'p':
+        return ms, None
+    octave = int(octave) if octave else defaults['o']
+    hz = frequency(letter, sharp, octave)
+    compare(hz)
+    return ms, hz
+
+
+def logical_lines(source):
+    """Comments out, continuation lines joined, with the first line number."""
+    current, start = None, 0
+    for number, line in enumerate(source.splitlines(), 1):
+        line = line.rstrip()
+        if not line.strip() or line.lstrip().startswith('#'):
+            continue
+        if line[0] in ' \t' and current is not None:
+            current += ' ' + line.strip()
+            continue
+        if current is not None:
+            yield start, current
+        current, start = line.strip(), number
+    if current is not None:
+        yield start, current
+
+
+def parse(source):
+    """[(name, rtttl, [(ms, hz or None), ...]), ...]"""
+    melodies, names = [], set()
+    for number, line in logical_lines(source):
+        try:
+            parts = line.split(':')
+            if len(parts) != 3:
+                raise MelodyError('expected name: defaults: notes')
+            name, defaults, notes = (p.strip() for p in parts)
+            if not NAME.match(name):
+                raise MelodyError('bad name "%s"' % name)
+            if name in names:
+                raise MelodyError('%s is already defined' % name)
+            defaults = parse_defaults(defaults)
+            steps = [parse_note(n.strip(), defaults) for n in notes.split(',') if n.strip()]
+            if not steps:
+                raise MelodyError('%s has no notes' % name)
+        except MelodyError as e:
+            raise MelodyError('line %d: %s' % (number, e))
+        names.add(name)
+        melodies.append((name, line.split(':', 1)[1].strip(), steps))
+    return melodies
+
+
+# --- output ----------------------------------------------------------------
+
+BANNER = '''\
+/*---------------------------------------------------------------------------*/
+/*  %-73s*/
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+'''
+
+
+def note_name(hz):
+    semitone = int(round(12 * math.log(hz / 440.0, 2))) + 9 + 48
+    return '%s%d' % (('c', 'c#', 'd', 'd#', 'e', 'f', 'f#', 'g', 'g#', 'a', 'a#', 'b')[semitone % 12],
+                     semitone // 12)
+
+
+def emit_c(melodies, source_name):
+    out = [BANNER % ('tones.c   generated by melody.py from %s: do not edit' % source_name)]
+    out.append('#include <stdint.h>\n\n#include "app_util.h"\n\n'
+               '#include "config.h"\n#include "buzzer.h"\n#include "tones.h"\n\n')
+
+    longest = max(ms for _, _, steps in melodies for ms, _ in steps)
+    out.append('/* melody.py worked to this timer clock and this longest note. */\n')
+    out.append('STATIC_ASSERT(BUZZER_TIMER_HZ == %d && BUZZER_MS(%d) <= 0xFFFF);\n'
+               % (TIMER_HZ, longest))
+
+    for name, rtttl, steps in melodies:
+        out.append('\n/* %s */\n' % rtttl.replace('*/', '* /'))
+        out.append('const buzzer_play_t %s [] = {\n' % name)
+        for ms, hz in steps:
+            if hz is None:
+                out.append('    {.action = BUZZER_PLAY_QUIET, .duration = BUZZER_MS(%4d), '
+                           '.compare = %5d},\n' % (ms, 0))
+            else:
+                out.append('    {.action = BUZZER_PLAY_TONE,  .duration = BUZZER_MS(%4d), '
+                           '.compare = %5d},   // %-3s %5.0f Hz\n'
+                           % (ms, compare(hz), note_name(hz), hz))
+        out.append('    {.action = BUZZER_PLAY_DONE,  .duration = 0,              '
+                   '.compare =     0},\n')
+        out.append('};\n')
+    return ''.join(out)
+
+
+def emit_h(melodies, source_name):
+    out = [BANNER % ('tones.h   generated by melody.py from %s: do not edit' % source_name)]
+    out.append('#ifndef __TONES_H__\n#define __TONES_H__\n\n#include "buzzer.h"\n\n')
+    for name, _, _ in melodies:
+        out.append('extern const buzzer_play_t %s [];\n' % name)
+    out.append('\n#endif /* __TONES_H__ */\n')
+    return ''.join(out)
+
+
+def main(argv):
+    if len(argv) != 4:
+        sys.stderr.write('usage: melody.py <tones.txt> <tones.c> <tones.h>\n')
+        return 2
+    source_name = argv[1].replace('\\', '/').rsplit('/', 1)[-1]
+    try:
+        melodies = parse(open(argv[1]).read())
+        if not melodies:
+            raise MelodyError('no melodies')
+        c, h = emit_c(melodies, source_name), emit_h(melodies, source_name)
+    except MelodyError as e:
+        sys.stderr.write('%s: %s\n' % (argv[1], e))
+        return 1
+    open(argv[2], 'w').write(c)
+    open(argv[3], 'w').write(h)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
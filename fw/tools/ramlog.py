@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+#
+#  ramlog.py   read the RAM debug log over SWD
+#  Copyright (c) 2016 Robin Callender. All Rights Reserved.
+#
+#  Firmware built with DBGLOG_RAM="yes" logs into a ring in RAM (see
+#  fw/app/ramlog.h) instead of the UART.  This polls it through OpenOCD's
+#  Tcl port while the target runs, and writes what it reads to stdout:
+#
+#    openocd -f interface/jlink.cfg -c "transport select swd" -f target/nrf51.cfg
+#    ramlog.py --elf fw/app/gcc/_build/trackr.elf
+#
+#  or reads it once from a RAM image saved by any other means, e.g. after
+#  a crash with JLink's "savebin ram.bin 0x20000000 0x4000":
+#
+#    ramlog.py --image ram.bin
+#
+#  Without --elf the block is found by its id.  With DBGLOG_TOKENS the
+#  output is records: save it and decode it with dbglog.py.
+#
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+RAM_BASE  = 0x20000000
+RAM_SIZE  = 0x4000
+RAMLOG_ID = b'RAMLOG1\0'
+SYMBOL    = 'g_ramlog'
+
+HEADER    = 16          # id[8], size, written
+
+
+# --- finding the block -----------------------------------------------------
+
+def symbol_address(path, wanted):
+    elf = open(path, 'rb').read()
+    if elf[:4] != b'\x7fELF':
+        raise ValueError('%s: not an ELF file' % path)
+    if elf[4] == 2:
+        shoff, = struct.unpack_from('<Q', elf, 0x28)
+        shentsize, shnum = struct.unpack_from('<HH', elf, 0x3A)
+        shfmt, symfmt, symsize = '<IIQQQQIIQQ', '<IBBHQQ', 24
+        sym_name, sym_value = 0, 4
+    else:
+        shoff, = struct.unpack_from('<I', elf, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', elf, 0x2E)
+        shfmt, symfmt, symsize = '<IIIIIIIIII', '<IIIBBH', 16
+        sym_name, sym_value = 0, 1
+
+    sections = [struct.unpack_from(shfmt, elf, shoff + i * shentsize) for i in range(shnum)]
+    for sh in sections:
+        if sh[1] != 2:                          # SHT_SYMTAB
+            continue
+        strtab = sections[sh[6]]
+        for off in range(sh[4], sh[4] + sh[5], symsize):
+            sym = struct.unpack_from(symfmt, elf, off)
+            start = strtab[4] + sym[sym_name]
+            name = elf[start:elf.index(b'\0', start)].decode()
+            if name == wanted:
+                return sym[sym_value]
+    raise ValueError('%s: no symbol %s (built without DBGLOG_RAM?)' % (path, wanted))
+
+
+def find_id(memory, base):
+    at = memory.find(RAMLOG_ID)
+    if at < 0:
+        raise ValueError('no RAM log found (built without DBGLOG_RAM, or not started yet?)')
+    return base + at
+
+
+# --- memory access ---------------------------------------------------------
+
+class Image:
+    """A saved RAM image."""
+    def __init__(self, path, base):
+        self.data, self.base = open(path, 'rb').read(), base
+
+    def read(self, addr, length):
+        at = addr - self.base
+        if at < 0 or at + length > len(self.data):
+            raise ValueError('0x%08x+%d is outside the image' % (addr, length))
+        return self.data[at:at + length]
+
+
+class OpenOCD:
+    """OpenOCD's Tcl port: reads go through the debug port while the CPU runs."""
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port))
+
+    def command(self, text):
+        self.sock.sendall(text.encode() + b'\x1a')
+        reply = b''
+        while not reply.endswith(b'\x1a'):
+            chunk = self.sock.recv(65536)
+            if not chunk:
+                raise IOError('OpenOCD closed the connection')
+            reply += chunk
+        return reply[:-1].decode()
+
+    def read(self, addr, length):
+        out = bytearray()
+        for line in self.command('mdb 0x%08x %d' % (addr, length)).splitlines():
+            if ':' in line:
+                out += bytes(int(b, 16) for b in line.split(':', 1)[1].split())
+        if len(out) != length:
+            raise IOError('short read at 0x%08x' % addr)
+        return bytes(out)
+
+
+# --- the ring --------------------------------------------------------------
+
+class Ring:
+    def __init__(self, memory, addr):
+        self.memory, self.addr = memory, addr
+        ident, self.size = struct.unpack('<8sI', memory.read(addr, 12))
+        if ident != RAMLOG_ID or self.size & (self.size - 1):
+            raise ValueError('no RAM log at 0x%08x' % addr)
+        self.seen = 0
+
+    def written(self):
+        return struct.unpack('<I', self.memory.read(self.addr + 12, 4))[0]
+
+    def poll(self):
+        """New bytes since the last call, and how many were overwritten first."""
+        first = self.written()
+        if first < self.seen:                   # the target was reset
+            self.seen = 0
+        if first == self.seen:
+            return b'', 0
+
+        data = self.memory.read(self.addr + HEADER, self.size)
+        after = self.written()
+
+        # Anything before after - size may have been overwritten while read.
+        start = max(self.seen, after - self.size)
+        lost = start - self.seen
+        out = bytes(data[i % self.size] for i in range(start, first))
+        self.seen = first
+        return out, lost
+
+
+def main():
+    ap = argparse.ArgumentParser(description='read the DBGLOG_RAM log over SWD')
+    ap.add_argument('--elf', help='the running .elf, to find %s' % SYMBOL)
+    ap.add_argument('--image', help='read once from a saved RAM image')
+    ap.add_argument('--base', type=lambda s: int(s, 0), default=RAM_BASE,
+                    help='address of the image (default 0x%08x)' % RAM_BASE)
+    ap.add_argument('--openocd', default='localhost:6666', help='Tcl host:port')
+    ap.add_argument('--interval', type=float, default=0.1, help='poll seconds')
+    args = ap.parse_args()
+
+    if args.image:
+        memory = Image(args.image, args.base)
+    else:
+        host, port = args.openocd.rsplit(':', 1)
+        memory = OpenOCD(host, int(port))
+
+    if args.elf:
+        addr = symbol_address(args.elf, SYMBOL)
+    elif args.image:
+        addr = find_id(memory.data, memory.base)
+    else:
+        addr = find_id(memory.read(RAM_BASE, RAM_SIZE), RAM_BASE)
+
+    ring = Ring(memory, addr)
+    out = sys.stdout.buffer
+
+    while True:
+        data, lost = ring.poll()
+        if lost:
+            sys.stderr.write('[%d bytes overwritten before they were read]\n' % lost)
+        out.write(data)
+        out.flush()
+        if args.image:
+            return 0
+        time.sleep(args.interval)
+
+
+if __name__ == '__main__':
+    try:
+        sys.exit(main())
+    except KeyboardInterrupt:
+        sys.exit(0)
@@ -0,0 +1,525 @@
+/*---------------------------------------------------------------------------*/
+/*  settings_test.c   fw/app/settings.c against a simulated flash           */
+/*  Copyright (c) 2016 Robin Callender. All Rights Reserved.                 */
+/*---------------------------------------------------------------------------*/
+/*
+ *  The two settings pages are host memory that behaves as NOR flash: a
+ *  write can only clear bits, an erase sets the whole page, and erases
+ *  are counted per page.  flash_queue_write() and _erase() only queue;
+ *  flash_run() carries the jobs out in order and calls back, as the real
+ *  queue does from the SoftDevice's event.
+ *
+ *  Each boot is a fork(), so settings.c starts with its statics zeroed
+ *  and sees only what is in the flash, which is shared.  A power cut is
+ *  a step number: every word written and every erase is a step, and at
+ *  that one the boot dies with the word half written or the page half
+ *  erased.  The next boot has to come up with the settings of the save
+ *  that was cut, or of the one before it, and go on saving.
+ */
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "nrf51.h"
+#include "nrf_error.h"
+#include "pstorage.h"
+#include "crc16.h"
+
+#include "settings.h"
+#include "flash_queue.h"
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+
+#define PAGE_SIZE           1024                // NRF_FICR->CODEPAGESIZE
+#define PAGE_WORDS          (PAGE_SIZE / 4)
+#define PAGES               2                   // SETTINGS_PAGES
+#define FLASH_BASE          0x30000UL           // below 4G: block_id is 32 bits
+
+/* The slots after the header, so the saves between two compactions. */
+#define RECORDS_PER_PAGE    (PAGE_SIZE / 32 - 1)
+
+#define EXIT_CUT            42
+
+typedef enum {
+    OP_NONE = 0,
+    OP_WRITE,
+    OP_ERASE,
+} op_t;
+
+/* Shared between the boots, and with the parent. */
+typedef struct {
+    uint32_t  erases [PAGES];
+    uint32_t  words;                // written, all pages
+    uint32_t  steps;                // words written and pages erased
+    uint32_t  cut_at;               // the step the power goes at; 0: never
+    uint32_t  fail_erases;          // erases left to fail
+    uint32_t  saving;               // the save under way, by its count
+    op_t      last_op;
+    int       last_page;
+    bool      written_unerased;     // a write to a page whose erase failed
+    bool      erase_failed [PAGES];
+} sim_t;
+
+static sim_t  * m_sim;
+
+static int      m_failed;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: %s: %s\n", __FILE__, __LINE__, __func__, #cond); \
+            m_failed++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/*---------------------------------------------------------------------------*/
+/*  Flash                                                                    */
+/*---------------------------------------------------------------------------*/
+static uint32_t * flash_word(uint32_t addr)
+{
+    return (uint32_t *) (uintptr_t) addr;
+}
+
+static int flash_page(uint32_t addr)
+{
+    return (int) ((addr - FLASH_BASE) / PAGE_SIZE);
+}
+
+static void flash_erase_all(void)
+{
+    memset(flash_word(FLASH_BASE), 0xFF, PAGES * PAGE_SIZE);
+    memset(m_sim, 0, sizeof(*m_sim));
+}
+
+/* True if the power goes now. */
+static bool flash_step(void)
+{
+    return (++m_sim->steps == m_sim->cut_at);
+}
+
+static uint32_t flash_do_write(uint32_t * p_dst, uint32_t const * p_src, uint16_t words)
+{
+    int page = flash_page((uint32_t) (uintptr_t) p_dst);
+
+    m_sim->last_op   = OP_WRITE;
+    m_sim->last_page = page;
+    if (m_sim->erase_failed[page])
+        m_sim->written_unerased = true;
+
+    while (words-- > 0) {
+        if (flash_step()) {
+            *p_dst &= *p_src | 0xFFFF0000;          // half the bits programmed
+            _exit(EXIT_CUT);
+        }
+        *p_dst++ &= *p_src++;
+        m_sim->words++;
+    }
+    return NRF_SUCCESS;
+}
+
+static uint32_t flash_do_erase(uint32_t * p_page)
+{
+    int page = flash_page((uint32_t) (uintptr_t) p_page);
+
+    m_sim->last_op   = OP_ERASE;
+    m_sim->last_page = page;
+
+    if (m_sim->fail_erases > 0) {
+        m_sim->fail_erases--;
+        m_sim->erase_failed[page] = true;
+        return NRF_ERROR_TIMEOUT;
+    }
+    if (flash_step()) {
+        memset(p_page, 0xFF, PAGE_SIZE / 2);        // half way through
+        _exit(EXIT_CUT);
+    }
+    memset(p_page, 0xFF, PAGE_SIZE);
+    m_sim->erases[page]++;
+    m_sim->erase_failed[page] = false;
+    return NRF_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------*/
+/*  flash_queue: jobs in order, each called back when done.                 */
+/*---------------------------------------------------------------------------*/
+typedef struct {
+    op_t               op;
+    uint32_t         * p_dst;
+    uint32_t const   * p_src;
+    uint16_t           words;
+    flash_queue_cb_t   cb;
+    void             * p_context;
+} job_t;
+
+static job_t    m_jobs [16];
+static unsigned m_job_head;
+static unsigned m_job_count;
+
+static uint32_t job_put(op_t op, uint32_t * p_dst, uint32_t const * p_src, uint16_t words,
+                        flash_queue_cb_t cb, void * p_context)
+{
+    job_t * p;
+
+    if (m_job_count == sizeof(m_jobs) / sizeof(m_jobs[0]))
+        return NRF_ERROR_NO_MEM;
+
+    p = &m_jobs[(m_job_head + m_job_count++) % (sizeof(m_jobs) / sizeof(m_jobs[0]))];
+    p->op        = op;
+    p->p_dst     = p_dst;
+    p->p_src     = p_src;
+    p->words     = words;
+    p->cb        = cb;
+    p->p_context = p_context;
+    return NRF_SUCCESS;
+}
+
+uint32_t flash_queue_write(uint32_t * p_dst, uint32_t const * p_src, uint16_t words,
+                           flash_queue_cb_t cb, void * p_context)
+{
+    return job_put(OP_WRITE, p_dst, p_src, words, cb, p_context);
+}
+
+uint32_t flash_queue_erase(uint32_t * p_page, uint16_t pages,
+                           flash_queue_cb_t cb, void * p_context)
+{
+    return job_put(OP_ERASE, p_page, NULL, pages, cb, p_context);
+}
+
+bool flash_queue_busy(void)
+{
+    return (m_job_count > 0);
+}
+
+static void flash_run(void)
+{
+    while (m_job_count > 0) {
+        job_t    job = m_jobs[m_job_head];
+        uint32_t result;
+
+        m_job_head = (m_job_head + 1) % (sizeof(m_jobs) / sizeof(m_jobs[0]));
+        m_job_count--;
+
+        if (job.op == OP_WRITE)
+            result = flash_do_write(job.p_dst, job.p_src, job.words);
+        else
+            result = flash_do_erase(job.p_dst);
+
+        if (job.cb != NULL)
+            job.cb(result, job.p_context);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/*  pstorage: the pages, and loads.  crc16 as the SDK computes it.           */
+/*---------------------------------------------------------------------------*/
+uint32_t pstorage_register(pstorage_module_param_t * p_module_param, pstorage_handle_t * p_block_id)
+{
+    if (p_module_param->block_size != PAGE_SIZE || p_module_param->block_count != PAGES)
+        return NRF_ERROR_INVALID_PARAM;
+
+    p_block_id->module_id = 0;
+    p_block_id->block_id  = FLASH_BASE;
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_block_identifier_get(pstorage_handle_t * p_base_id, pstorage_size_t block_num,
+                                       pstorage_handle_t * p_block_id)
+{
+    if (block_num >= PAGES)
+        return NRF_ERROR_INVALID_PARAM;
+
+    p_block_id->module_id = p_base_id->module_id;
+    p_block_id->block_id  = p_base_id->block_id + (uint32_t) block_num * PAGE_SIZE;
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_load(uint8_t * p_dest, pstorage_handle_t * p_src, pstorage_size_t size,
+                       pstorage_size_t offset)
+{
+    if (size == 0 || (size % 4) != 0 || (offset % 4) != 0 || offset + size > PAGE_SIZE)
+        return NRF_ERROR_INVALID_ADDR;
+
+    memcpy(p_dest, flash_word(p_src->block_id + offset), size);
+    return NRF_SUCCESS;
+}
+
+uint16_t crc16_compute(const uint8_t * p_data, uint32_t size, const uint16_t * p_crc)
+{
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        crc  = (uint8_t) (crc >> 8) | (crc << 8);
+        crc ^= p_data[i];
+        crc ^= (uint8_t) (crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+    return crc;
+}
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    printf("%s:%u: error 0x%x\n", (const char *) p_file_name, (unsigned) line_num,
+           (unsigned) error_code);
+    _exit(3);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Boots and saves                                                          */
+/*---------------------------------------------------------------------------*/
+
+/* Save number n: the count, and a URL that goes with it. */
+static void save(uint16_t n)
+{
+    settings_t * p = settings_get();
+
+    m_sim->saving = n;
+
+    p->reset_count = n;
+    p->url_len     = (uint8_t) snprintf(p->url, sizeof(p->url), "x.yz/%u", (unsigned) n);
+
+    settings_save();
+    flash_run();
+}
+
+static bool loaded_is(uint16_t n)
+{
+    settings_t * p = settings_get();
+    char         url [sizeof(p->url) + 1];
+
+    if (n == 0)
+        return p->reset_count == 0 && p->url_len == strlen(URL_DEFAULT_STRING);
+
+    snprintf(url, sizeof(url), "x.yz/%u", (unsigned) n);
+    return p->reset_count == n && p->url_len == strlen(url) &&
+           memcmp(p->url, url, p->url_len) == 0;
+}
+
+/* One boot: settings_init() then body, in a child.  The exit status. */
+static int boot(void (* body)(uint16_t), uint16_t arg)
+{
+    pid_t pid;
+    int   status;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        m_failed = 0;
+        settings_init();
+        body(arg);
+        fflush(stdout);
+        _exit(m_failed ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 4;
+}
+
+static void saves_from_1(uint16_t count)
+{
+    uint16_t n;
+
+    for (n = 1; n <= count; n++)
+        save(n);
+}
+
+static void expect_loaded(uint16_t n)
+{
+    CHECK(loaded_is(n));
+}
+
+/* After a cut in save n: n or n - 1, then saving goes on. */
+static void expect_recovered(uint16_t n)
+{
+    settings_t * p = settings_get();
+    uint16_t     i;
+
+    if (!loaded_is(n) && !loaded_is(n - 1)) {
+        printf("cut at step %u, in save %u: loaded %u\n", (unsigned) m_sim->cut_at,
+               (unsigned) n, (unsigned) p->reset_count);
+        m_failed++;
+        return;
+    }
+    for (i = 1; i <= RECORDS_PER_PAGE + 2; i++)
+        save(n + i);
+}
+
+/*---------------------------------------------------------------------------*/
+/*  Tests                                                                    */
+/*---------------------------------------------------------------------------*/
+static void test_fresh_flash_gives_defaults(void)
+{
+    flash_erase_all();
+
+    CHECK(boot(expect_loaded, 0) == 0);
+    CHECK(boot(saves_from_1, 1) == 0);
+    CHECK(boot(expect_loaded, 1) == 0);
+}
+
+static void test_last_save_wins_across_compactions(void)
+{
+    flash_erase_all();
+
+    CHECK(boot(saves_from_1, 5 * RECORDS_PER_PAGE + 3) == 0);
+    CHECK(boot(expect_loaded, 5 * RECORDS_PER_PAGE + 3) == 0);
+}
+
+/* One erase to start, then one per page's worth of saves, in turn. */
+static void test_erase_counts(void)
+{
+    const uint16_t saves    = 1000;
+    const uint32_t expected = 1 + (saves - 1) / RECORDS_PER_PAGE;
+
+    flash_erase_all();
+
+    CHECK(boot(saves_from_1, saves) == 0);
+    CHECK(m_sim->erases[0] + m_sim->erases[1] == expected);
+    CHECK(m_sim->erases[1] - m_sim->erases[0] <= 1);
+    CHECK(m_sim->words == saves * 8 + expected * 3);
+
+    printf("%u saves: %u + %u erases, %u words written\n", (unsigned) saves,
+           (unsigned) m_sim->erases[0], (unsigned) m_sim->erases[1], (unsigned) m_sim->words);
+}
+
+/*
+ *  The power goes at every step of enough saves for three compactions,
+ *  each time from the same start: every word of every append, and every
+ *  erase, copy and header write of a compaction.
+ */
+static void test_power_cut_at_every_step(void)
+{
+    const uint16_t saves = 3 * RECORDS_PER_PAGE + 2;
+    uint32_t       steps;
+    uint32_t       cut;
+    unsigned       in_erase = 0, in_write = 0, cuts = 0;
+
+    flash_erase_all();
+    CHECK(boot(saves_from_1, saves) == 0);
+    steps = m_sim->steps;
+
+    for (cut = 1; cut <= steps; cut++) {
+        uint16_t saving;
+
+        flash_erase_all();
+        m_sim->cut_at = cut;
+        if (boot(saves_from_1, saves) != EXIT_CUT) {
+            CHECK(false);
+            continue;
+        }
+        cuts++;
+        if (m_sim->last_op == OP_ERASE)
+            in_erase++;
+        else
+            in_write++;
+
+        saving = m_sim->saving;
+        m_sim->cut_at = 0;
+        CHECK(boot(expect_recovered, saving) == 0);
+    }
+
+    printf("%u power cuts, %u in erases and %u in writes: all recovered\n",
+           cuts, in_erase, in_write);
+}
+
+/* A failed erase: nothing is written over the page, and a retry finishes. */
+static void fill_then_fail_an_erase(uint16_t count)
+{
+    saves_from_1(count);
+
+    m_sim->fail_erases = 1;
+    save(count + 1);
+
+    CHECK(m_sim->erase_failed[0] == false);
+    CHECK(!m_sim->written_unerased);
+    CHECK(m_sim->erases[0] == 1);       // the retry
+}
+
+static void test_failed_erase_stops_compaction(void)
+{
+    flash_erase_all();
+
+    /* Page 1 first, so the compaction that fails is into page 0, which
+       still holds the settings from before. */
+    memset(flash_word(FLASH_BASE), 0xA5, PAGE_SIZE);
+
+    CHECK(boot(fill_then_fail_an_erase, RECORDS_PER_PAGE) == 0);
+    CHECK(boot(expect_loaded, RECORDS_PER_PAGE + 1) == 0);
+}
+
+/* A page that will not erase: a few tries a save, not an endless loop. */
+static void fill_then_wear_a_page(uint16_t count)
+{
+    saves_from_1(count);
+
+    m_sim->fail_erases = 1000;
+    save(count + 1);
+    CHECK(m_sim->fail_erases == 1000 - 3);          // SETTINGS_ATTEMPTS
+
+    save(count + 2);
+    CHECK(m_sim->fail_erases == 1000 - 6);
+    CHECK(!m_sim->written_unerased);
+
+    m_sim->fail_erases = 0;
+    save(count + 3);
+    CHECK(m_sim->erases[0] == 1);
+}
+
+static void test_worn_page_waits_for_the_next_save(void)
+{
+    flash_erase_all();
+    memset(flash_word(FLASH_BASE), 0xA5, PAGE_SIZE);
+
+    CHECK(boot(fill_then_wear_a_page, RECORDS_PER_PAGE) == 0);
+    CHECK(boot(expect_loaded, RECORDS_PER_PAGE + 3) == 0);
+}
+
+/*---------------------------------------------------------------------------*/
+/*                                                                           */
+/*---------------------------------------------------------------------------*/
+static void * map(uintptr_t base, size_t size, int flags)
+{
+    void * p = mmap((void *) base, size, PROT_READ | PROT_WRITE,
+                    flags | MAP_ANONYMOUS | (base ? MAP_FIXED_NOREPLACE : 0), -1, 0);
+
+    if (p == MAP_FAILED || (base && p != (void *) base)) {
+        perror("settings_test: mmap");
+        exit(2);
+    }
+    return p;
+}
+
+int main(void)
+{
+    static void (* const tests [])(void) = {
+        test_fresh_flash_gives_defaults,
+        test_last_save_wins_across_compactions,
+        test_erase_counts,
+        test_power_cut_at_every_step,
+        test_failed_erase_stops_compaction,
+        test_worn_page_waits_for_the_next_save,
+    };
+    const int count = sizeof(tests) / sizeof(tests[0]);
+    int       i;
+
+    /* The FICR, for PSTORAGE_FLASH_PAGE_SIZE; the pages, kept over forks. */
+    map(NRF_FICR_BASE, 4096, MAP_PRIVATE);
+    *(uint32_t *) &NRF_FICR->CODEPAGESIZE = PAGE_SIZE;
+
+    map(FLASH_BASE, PAGES * PAGE_SIZE, MAP_SHARED);
+    m_sim = map(0, sizeof(sim_t), MAP_SHARED);
+
+    for (i = 0; i < count; i++)
+        tests[i]();
+
+    printf("%d tests, %d checks failed\n", count, m_failed);
+    return m_failed ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+#
+#  telemetry.py   decode the live telemetry stream
+#  Copyright (c) 2016 Robin Callender. All Rights Reserved.
+#
+#  Input is the notifications received from the Telemetry characteristic
+#  (0xfad5), one 20-byte packet per line in hex (spaces, dashes and a
+#  leading 0x are ignored).  The packet format is in fw/app/telemetry.h.
+#
+#  Usage:
+#    telemetry.py <capture.txt>         prints samples as CSV, stats as comments
+#
+
+import re
+import struct
+import sys
+
+SAMPLE       = struct.Struct('<HBBh')
+STATS        = struct.Struct('<IIIHI')
+PER_PACKET   = 3
+PACKET_STATS = 0x80
+
+ADC_MV       = 1200.0 * 3 / 255     # VDD/3 against the 1.2 V band gap
+TEMP_UNIT_C  = 0.25
+TICK_US      = 1e6 / 32768
+
+
+def packets(lines):
+    for line in lines:
+        line = re.sub(r'0x|[\s:-]', '', line)
+        if line:
+            yield bytes.fromhex(line)
+
+
+def main(argv):
+    if len(argv) != 2:
+        sys.stderr.write('usage: telemetry.py <capture.txt>\n')
+        return 2
+
+    print('ticks,vbat_mv,temp_c,sched_latency_us')
+    expect = None
+    lost = 0
+    for p in packets(open(argv[1])):
+        seq = p[0] & 0x7F
+        if expect is not None and seq != expect:
+            lost += (seq - expect) & 0x7F
+            print('# %d packets lost' % ((seq - expect) & 0x7F))
+        expect = (seq + 1) & 0x7F
+
+        if p[0] & PACKET_STATS:
+            adv, radio, sent, rate, dropped = STATS.unpack_from(p, 2)
+            print('# adv %d radio %d sent %d bytes, %d bytes/s, %d samples dropped'
+                  % (adv, radio, sent, rate, dropped))
+            continue
+
+        if p[1]:
+            print('# %d samples dropped on the device' % p[1])
+        for i in range(PER_PACKET):
+            ticks, adc, latency, temp = SAMPLE.unpack_from(p, 2 + i * SAMPLE.size)
+            print('%d,%d,%.2f,%d' % (ticks, adc * ADC_MV, temp * TEMP_UNIT_C, latency * TICK_US))
+
+    if lost:
+        sys.stderr.write('%d packets lost in the capture\n' % lost)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+#
+#  test_melody.py   host tests for melody.py
+#  Copyright (c) 2016 Robin Callender. All Rights Reserved.
+#
+#    python3 test_melody.py
+#
+
+import os
+import unittest
+
+import melody
+
+APP = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'app')
+
+
+def steps(text):
+    return melody.parse(text)[0][2]
+
+
+class Notes(unittest.TestCase):
+
+    def test_a4_is_440(self):
+        self.assertAlmostEqual(melody.frequency('a', '', 4), 440.0)
+        self.assertEqual(melody.compare(440.0), 4545)
+
+    def test_octaves_and_sharps(self):
+        self.assertAlmostEqual(melody.frequency('a', '', 5), 880.0)
+        self.assertAlmostEqual(melody.frequency('c', '', 4), 261.63, places=2)
+        self.assertAlmostEqual(melody.frequency('c', '#', 4), 277.18, places=2)
+        self.assertEqual(melody.frequency('h', '', 4), melody.frequency('b', '', 4))
+
+    def test_compare_range(self):
+        self.assertEqual(melody.compare(melody.TIMER_HZ / 2.0), 1)
+        self.assertRaises(melody.MelodyError, melody.compare, 20.0)
+
+    def test_note_name(self):
+        self.assertEqual(melody.note_name(440.0), 'a4')
+        self.assertEqual(melody.note_name(melody.frequency('d', '#', 8)), 'd#8')
+
+
+class Durations(unittest.TestCase):
+
+    def test_defaults(self):
+        ms, hz = steps('x: d=4,o=5,b=300: c')[0]
+        self.assertEqual(ms, 200)
+        self.assertAlmostEqual(hz, melody.frequency('c', '', 5))
+
+    def test_rtttl_defaults_when_missing(self):
+        # d=4, o=6, b=63
+        ms, hz = steps('x: : c')[0]
+        self.assertEqual(ms, 952)
+        self.assertAlmostEqual(hz, melody.frequency('c', '', 6))
+
+    def test_divisions_and_dots(self):
+        self.assertEqual([ms for ms, _ in steps('x: b=300: 8c, 2c, 4c., 4c5.')],
+                         [100, 400, 300, 300])
+
+    def test_milliseconds(self):
+        self.assertEqual(steps('x: b=300: c/700, p/1')[0][0], 700)
+        self.assertEqual(steps('x: b=300: c/700, p/1')[1], (1, None))
+
+    def test_limits(self):
+        self.assertRaises(melody.MelodyError, melody.parse, 'x: b=30: 1c')
+        self.assertRaises(melody.MelodyError, melody.parse, 'x: : c/0')
+        self.assertRaises(melody.MelodyError, melody.parse, 'x: : 3c')
+        self.assertRaises(melody.MelodyError, melody.parse, 'x: d=3: c')
+        self.assertRaises(melody.MelodyError, melody.parse, 'x: b=0: c')
+
+
+class Source(unittest.TestCase):
+
+    def test_comments_and_continuations(self):
+        text = '# header\n\nx: b=300: c#,\n    d#\n  # not a note\ny: : p\n'
+        melodies = melody.parse(text)
+        self.assertEqual([m[0] for m in melodies], ['x', 'y'])
+        self.assertEqual(len(melodies[0][2]), 2)
+        self.assertAlmostEqual(melodies[0][2][1][1], melody.frequency('d', '#', 6))
+
+    def test_errors_carry_the_line(self):
+        with self.assertRaises(melody.MelodyError) as e:
+            melody.parse('x: : c\n\ny: : q\n')
+        self.assertIn('line 3', str(e.exception))
+
+    def test_bad_lines(self):
+        for text in ('x: c', '1x: : c', 'x: : ', 'x: z=1: c', 'x: : c\nx: : d'):
+            self.assertRaises(melody.MelodyError, melody.parse, text)
+
+
+class Output(unittest.TestCase):
+
+    def test_table(self):
+        c = melody.emit_c(melody.parse('beep: b=300: a4, p, a4/50'), 'beep.txt')
+        self.assertIn('const buzzer_play_t beep [] = {', c)
+        self.assertIn('BUZZER_PLAY_TONE,  .duration = BUZZER_MS( 200), .compare =  4545}', c)
+        self.assertIn('BUZZER_PLAY_QUIET, .duration = BUZZER_MS( 200), .compare =     0}', c)
+        self.assertIn('BUZZER_MS(  50)', c)
+        self.assertIn('BUZZER_MS(200) <= 0xFFFF', c)
+        self.assertTrue(c.rstrip().endswith('.compare =     0},\n};'))
+
+    def test_header(self):
+        h = melody.emit_h(melody.parse('a: : c\nb: : d'), 'x.txt')
+        self.assertIn('extern const buzzer_play_t a [];', h)
+        self.assertIn('extern const buzzer_play_t b [];', h)
+
+    def test_checked_in_tables_are_current(self):
+        melodies = melody.parse(open(os.path.join(APP, 'tones.txt')).read())
+        self.assertEqual(open(os.path.join(APP, 'tones.c')).read(),
+                         melody.emit_c(melodies, 'tones.txt'))
+        self.assertEqual(open(os.path.join(APP, 'tones.h')).read(),
+                         melody.emit_h(melodies, 'tones.txt'))
+
+
+if __name__ == '__main__':
+    unittest.main()